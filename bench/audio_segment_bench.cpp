@@ -0,0 +1,153 @@
+#include "audio_segment_tsrt.h"
+#include "constants_config_tsrt.h"
+#include "sample_ring_tsrt.h"
+#include "segment_pool_tsrt.h"
+#include "segment_view_tsrt.h"
+
+#include <benchmark/benchmark.h>
+#include <utility>
+#include <vector>
+
+// Audio_Segment, sample ring and segment view microbenchmarks
+// The range argument is the segment size in samples, a half segment comes from the segment pool, a full segment and
+// twice that are not pooled and go to the heap.
+
+namespace {
+
+// no engine opens sessions here, this is the chunk of the pool the first one would reserve
+const bool pools_reserved = Segment_Pool::reserve_sessions(1);
+
+} // namespace
+
+/**
+ * @brief Constructing and destroying a segment, a pool round trip or a zeroed heap allocation.
+*/
+static void BM_Audio_Segment_Allocate(benchmark::State& state) {
+    const size_t size = static_cast<size_t>(state.range(0));
+    for (auto _ : state) {
+        Audio_Segment segment(size);
+        benchmark::DoNotOptimize(segment.get_audio());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Audio_Segment_Allocate)->Arg(SAMPLES_PER_HALF_SEGMENT)->Arg(SAMPLES_PER_SEGMENT)->Arg(2 * SAMPLES_PER_SEGMENT);
+
+/**
+ * @brief Copy constructing a segment, an allocation and a copy of the samples.
+*/
+static void BM_Audio_Segment_Copy(benchmark::State& state) {
+    const size_t size = static_cast<size_t>(state.range(0));
+    const Audio_Segment source(size);
+    for (auto _ : state) {
+        Audio_Segment copy(source);
+        benchmark::DoNotOptimize(copy.get_audio());
+    }
+    state.SetBytesProcessed(state.iterations() * size * sizeof(float));
+}
+BENCHMARK(BM_Audio_Segment_Copy)->Arg(SAMPLES_PER_HALF_SEGMENT)->Arg(SAMPLES_PER_SEGMENT)->Arg(2 * SAMPLES_PER_SEGMENT);
+
+/**
+ * @brief Copy assigning into a segment of the same size.
+*/
+static void BM_Audio_Segment_Copy_Assign(benchmark::State& state) {
+    const size_t size = static_cast<size_t>(state.range(0));
+    const Audio_Segment source(size);
+    Audio_Segment destination(size);
+    for (auto _ : state) {
+        destination = source;
+        benchmark::DoNotOptimize(destination.get_audio());
+    }
+    state.SetBytesProcessed(state.iterations() * size * sizeof(float));
+}
+BENCHMARK(BM_Audio_Segment_Copy_Assign)->Arg(SAMPLES_PER_HALF_SEGMENT)->Arg(SAMPLES_PER_SEGMENT);
+
+/**
+ * @brief Move constructing a segment, the source is left empty.
+*/
+static void BM_Audio_Segment_Move(benchmark::State& state) {
+    const size_t size = static_cast<size_t>(state.range(0));
+    Audio_Segment source(size);
+    for (auto _ : state) {
+        Audio_Segment moved(std::move(source));
+        benchmark::DoNotOptimize(moved.get_audio());
+        source = std::move(moved);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Audio_Segment_Move)->Arg(SAMPLES_PER_HALF_SEGMENT)->Arg(SAMPLES_PER_SEGMENT);
+
+/**
+ * @brief Move assigning between two segments, a swap so neither side allocates.
+*/
+static void BM_Audio_Segment_Move_Assign(benchmark::State& state) {
+    const size_t size = static_cast<size_t>(state.range(0));
+    Audio_Segment first(size);
+    Audio_Segment second(size);
+    for (auto _ : state) {
+        first = std::move(second);
+        benchmark::DoNotOptimize(first.get_audio());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Audio_Segment_Move_Assign)->Arg(SAMPLES_PER_HALF_SEGMENT)->Arg(SAMPLES_PER_SEGMENT);
+
+/**
+ * @brief Giving a moved from segment fresh storage.
+*/
+static void BM_Audio_Segment_Reset_Audio(benchmark::State& state) {
+    const size_t size = static_cast<size_t>(state.range(0));
+    Audio_Segment segment(size);
+    for (auto _ : state) {
+        segment.reset_audio();
+        benchmark::DoNotOptimize(segment.get_audio());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Audio_Segment_Reset_Audio)->Arg(SAMPLES_PER_HALF_SEGMENT)->Arg(SAMPLES_PER_SEGMENT);
+
+/**
+ * @brief Appending a half segment to the sample ring and taking every window it completes, the preprocessing hop's steady state.
+*/
+static void BM_Sample_Ring_Windows(benchmark::State& state) {
+    Sample_Ring ring(SAMPLE_RING_CAPACITY);
+    Window_Cursor cursor(WINDOW_LENGTH, WINDOW_HOP);
+    std::vector<float> half_segment(SAMPLES_PER_HALF_SEGMENT);
+    for (auto _ : state) {
+        ring.write(half_segment.data(), half_segment.size());
+        while (cursor.ready(ring.get_write_index()))
+            benchmark::DoNotOptimize(ring.view(cursor.advance(), cursor.get_length()).data);
+    }
+    state.SetBytesProcessed(state.iterations() * SAMPLES_PER_HALF_SEGMENT * sizeof(float));
+    state.counters["double_mapped"] = ring.is_double_mapped() ? 1.0 : 0.0;
+}
+BENCHMARK(BM_Sample_Ring_Windows);
+
+/**
+ * @brief Sharing a window past its release and dropping the view, a pin pool round trip.
+*/
+static void BM_Segment_View_Share(benchmark::State& state) {
+    Sample_Ring ring(SAMPLE_RING_CAPACITY);
+    Window_Pins pins(WINDOW_PIN_CAPACITY);
+    const Sample_View window = ring.view(0, WINDOW_LENGTH);
+    for (auto _ : state) {
+        Segment_View view = pins.pin(window, 0);
+        benchmark::DoNotOptimize(view.get_samples().data);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Segment_View_Share);
+
+/**
+ * @brief Copying a shared window, what each further stage holding it costs, compare BM_Audio_Segment_Copy.
+*/
+static void BM_Segment_View_Copy(benchmark::State& state) {
+    Sample_Ring ring(SAMPLE_RING_CAPACITY);
+    Window_Pins pins(WINDOW_PIN_CAPACITY);
+    const Segment_View view = pins.pin(ring.view(0, WINDOW_LENGTH), 0);
+    for (auto _ : state) {
+        Segment_View copy(view);
+        benchmark::DoNotOptimize(copy.get_samples().data);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Segment_View_Copy);
@@ -0,0 +1,201 @@
+#include "constants_config_tsrt.h"
+#include "dsp_kernels_tsrt.h"
+#include "exceptions_tsrt.h"
+#include "fft_tsrt.h"
+
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <random>
+#include <vector>
+
+extern "C" {
+#include <libavutil/tx.h>
+}
+
+// FFT microbenchmarks
+// The in-tree real FFT against FFmpeg's real av_tx, forward and inverse, on the frame sizes the DSP stages use: the
+// denoiser's and voice activity detector's 256, a half segment and the log mel frame's 400, 512 and a segment's 800.
+// Both compute the same unnormalized spectrum, so the times compare directly.
+
+static const std::vector<int64_t> FFT_BENCH_SIZES = {DENOISE_FRAME_SAMPLES, SAMPLES_PER_HALF_SEGMENT, 512, SAMPLES_PER_SEGMENT};
+
+/**
+ * @brief One frame of white noise.
+*/
+static std::vector<float> make_frame(size_t size) {
+    std::mt19937 generator(SAMPLE_RATE);
+    std::uniform_real_distribution<float> distribution(-0.5f, 0.5f);
+    std::vector<float> frame(size);
+    for (float& sample : frame)
+        sample = distribution(generator);
+    return frame;
+}
+
+/**
+ * @brief Every dsp_isa with every size, the arguments of the in-tree FFT's benchmarks.
+*/
+static void fft_isa_sizes(benchmark::internal::Benchmark* benchmark) {
+    for (int64_t isa = DSP_SCALAR; isa <= DSP_AVX512; ++isa)
+        for (const int64_t size : FFT_BENCH_SIZES)
+            benchmark->Args({isa, size});
+}
+
+/**
+ * @brief Every size, the argument of FFmpeg's benchmarks.
+*/
+static void fft_sizes(benchmark::internal::Benchmark* benchmark) {
+    for (const int64_t size : FFT_BENCH_SIZES)
+        benchmark->Arg(size);
+}
+
+/**
+ * @brief Sets the counters every FFT benchmark reports.
+*/
+static void set_fft_counters(benchmark::State& state, size_t size) {
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * size * sizeof(float));
+}
+
+/**
+ * @brief Transforms a frame of white noise into its spectrum with the in-tree FFT per iteration.
+ *
+ * @details The arguments are the dsp_isa whose kernels run, skipped if the CPU does not support it, and the frame size.
+*/
+static void BM_Fft_Forward(benchmark::State& state) {
+    const Dsp_Kernels* kernels = get_dsp_kernels(static_cast<dsp_isa>(state.range(0)));
+    if (kernels == nullptr) {
+        state.SkipWithError("Instruction set not supported");
+        return;
+    }
+    const size_t size = static_cast<size_t>(state.range(1));
+    std::unique_ptr<Real_Fft> fft;
+    try {
+        fft = std::make_unique<Real_Fft>(size, *kernels);
+    } catch (const Tsrt_Exception& e) {
+        state.SkipWithError(e.what());
+        return;
+    }
+
+    const std::vector<float> frame = make_frame(size);
+    std::vector<float> spectrum(size + 2);
+    for (auto _ : state) {
+        fft->forward(spectrum.data(), frame.data());
+        benchmark::DoNotOptimize(spectrum.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetLabel(kernels->name);
+    set_fft_counters(state, size);
+}
+BENCHMARK(BM_Fft_Forward)->Apply(fft_isa_sizes);
+
+/**
+ * @brief Transforms the spectrum of a frame of white noise back into the frame with the in-tree FFT per iteration.
+ *
+ * @details The arguments are the dsp_isa whose kernels run, skipped if the CPU does not support it, and the frame size.
+*/
+static void BM_Fft_Inverse(benchmark::State& state) {
+    const Dsp_Kernels* kernels = get_dsp_kernels(static_cast<dsp_isa>(state.range(0)));
+    if (kernels == nullptr) {
+        state.SkipWithError("Instruction set not supported");
+        return;
+    }
+    const size_t size = static_cast<size_t>(state.range(1));
+    std::unique_ptr<Real_Fft> fft;
+    try {
+        fft = std::make_unique<Real_Fft>(size, *kernels);
+    } catch (const Tsrt_Exception& e) {
+        state.SkipWithError(e.what());
+        return;
+    }
+
+    std::vector<float> frame = make_frame(size);
+    std::vector<float> spectrum(size + 2);
+    fft->forward(spectrum.data(), frame.data());
+    for (auto _ : state) {
+        fft->inverse(frame.data(), spectrum.data(), 1.0f / size);
+        benchmark::DoNotOptimize(frame.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetLabel(kernels->name);
+    set_fft_counters(state, size);
+}
+BENCHMARK(BM_Fft_Inverse)->Apply(fft_isa_sizes);
+
+/**
+ * @brief A real av_tx of one size and direction, the context freed with it.
+*/
+struct Av_Tx {
+    AVTXContext* context = nullptr;
+    av_tx_fn transform = nullptr;
+
+    Av_Tx(size_t size, int inverse, float scale) {
+        if (av_tx_init(&context, &transform, AV_TX_FLOAT_RDFT, inverse, static_cast<int>(size), &scale, 0) < 0)
+            context = nullptr;
+    }
+
+    ~Av_Tx() {
+        av_tx_uninit(&context);
+    }
+
+    Av_Tx(const Av_Tx&) = delete;
+    Av_Tx& operator=(const Av_Tx&) = delete;
+};
+
+/**
+ * @brief Transforms a frame of white noise into its spectrum with FFmpeg's av_tx per iteration.
+ *
+ * @details The argument is the frame size, skipped if av_tx has no real transform of it.
+*/
+static void BM_Av_Tx_Forward(benchmark::State& state) {
+    const size_t size = static_cast<size_t>(state.range(0));
+    Av_Tx tx(size, 0, 1.0f);
+    if (tx.context == nullptr) {
+        state.SkipWithError("av_tx has no real transform of this size");
+        return;
+    }
+
+    std::vector<float> frame = make_frame(size);
+    std::vector<AVComplexFloat> spectrum(size / 2 + 1);
+    for (auto _ : state) {
+        tx.transform(tx.context, spectrum.data(), frame.data(), sizeof(float));
+        benchmark::DoNotOptimize(spectrum.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetLabel("ffmpeg");
+    set_fft_counters(state, size);
+}
+BENCHMARK(BM_Av_Tx_Forward)->Apply(fft_sizes);
+
+/**
+ * @brief Transforms the spectrum of a frame of white noise back into the frame with FFmpeg's av_tx per iteration.
+ *
+ * @details The argument is the frame size, skipped if av_tx has no real transform of it. The inverse may overwrite its
+ * input, so the spectrum is copied back first, the copy is a small part of the time.
+*/
+static void BM_Av_Tx_Inverse(benchmark::State& state) {
+    const size_t size = static_cast<size_t>(state.range(0));
+    Av_Tx forward(size, 0, 1.0f);
+    Av_Tx inverse(size, 1, 1.0f / size);
+    if (forward.context == nullptr || inverse.context == nullptr) {
+        state.SkipWithError("av_tx has no real transform of this size");
+        return;
+    }
+
+    std::vector<float> frame = make_frame(size);
+    std::vector<AVComplexFloat> spectrum(size / 2 + 1);
+    forward.transform(forward.context, spectrum.data(), frame.data(), sizeof(float));
+    std::vector<AVComplexFloat> input(spectrum);
+    for (auto _ : state) {
+        input = spectrum;
+        inverse.transform(inverse.context, frame.data(), input.data(), sizeof(AVComplexFloat));
+        benchmark::DoNotOptimize(frame.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetLabel("ffmpeg");
+    set_fft_counters(state, size);
+}
+BENCHMARK(BM_Av_Tx_Inverse)->Apply(fft_sizes);
@@ -0,0 +1,259 @@
+#include "audio_segment_tsrt.h"
+#include "constants_config_tsrt.h"
+#include "dsp_kernels_tsrt.h"
+#include "exceptions_tsrt.h"
+#include "log_mel_tsrt.h"
+#include "native_preprocessor_tsrt.h"
+#include "preprocessor_tsrt.h"
+#include "segment_pool_tsrt.h"
+#include "status_codes_tsrt.h"
+#include "voice_activity_tsrt.h"
+
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+// Preprocessing microbenchmarks
+// Preprocessor_tsrt only needs FFmpeg, so these run on machines without an input device.
+// They are skipped rather than failing the whole run if the filter graph can not be built.
+// The FFmpeg graph and the native preprocessor report the same counters, so they compare directly: real_time_factor
+// is the processing time divided by the audio duration, below 1 keeps up with capture, and latency_ms the delay added.
+
+/**
+ * @brief One half segment of white noise.
+ *
+ * @details Noise rather than silence so the denoisers do real work.
+*/
+static std::vector<float> make_noise() {
+    std::mt19937 generator(SAMPLE_RATE);
+    std::uniform_real_distribution<float> distribution(-0.5f, 0.5f);
+    std::vector<float> noise(SAMPLES_PER_HALF_SEGMENT);
+    for (float& sample : noise)
+        sample = distribution(generator);
+    return noise;
+}
+
+/**
+ * @brief Sets the counters every preprocessing benchmark reports.
+*/
+static void set_preprocess_counters(benchmark::State& state, uint64_t latency) {
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * SAMPLES_PER_HALF_SEGMENT * sizeof(float));
+    state.counters["real_time_factor"] = benchmark::Counter(
+        static_cast<double>(state.iterations()) * SAMPLES_PER_HALF_SEGMENT / SAMPLE_RATE,
+        benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+    state.counters["latency_ms"] = static_cast<double>(latency) * MS_PER_SEC / SAMPLE_RATE;
+}
+
+/**
+ * @brief Pushes one half segment of white noise into the FFmpeg filter graph per iteration and drains the sink.
+ *
+ * @details The graph holds on to pushed buffers for its delay, so the iterations cycle through as many buffers as it
+ * may hold.
+*/
+static void BM_Preprocess_Half_Segment(benchmark::State& state) {
+    std::unique_ptr<Preprocessor_tsrt> preprocessor;
+    try {
+        preprocessor = std::make_unique<Preprocessor_tsrt>();
+    } catch (const Tsrt_Exception& e) {
+        state.SkipWithError(e.what());
+        return;
+    }
+
+    const std::vector<float> noise = make_noise();
+    // no engine opens sessions here, the segments come from the chunk the first one would reserve
+    Segment_Pool::reserve_sessions(1);
+    std::vector<Audio_Segment> half_segments;
+    for (size_t i = 0; i < PREPROCESS_MAX_HELD_INPUTS; ++i)
+        half_segments.emplace_back(SAMPLES_PER_HALF_SEGMENT);
+
+    uint64_t sample_index = 0;
+    Filtered_Audio filtered;
+    try {
+        for (auto _ : state) {
+            Audio_Segment& half_segment = half_segments[(sample_index / SAMPLES_PER_HALF_SEGMENT) % half_segments.size()];
+            // a 400 sample copy, noise next to the filter graph
+            std::copy(noise.begin(), noise.end(), half_segment.get_audio());
+            preprocessor->push_audio(half_segment.get_audio(), SAMPLES_PER_HALF_SEGMENT, sample_index);
+            sample_index += SAMPLES_PER_HALF_SEGMENT;
+            while (preprocessor->pull_audio(filtered))
+                benchmark::DoNotOptimize(filtered.samples);
+        }
+    } catch (const Tsrt_Exception& e) {
+        state.SkipWithError(e.what());
+        return;
+    }
+
+    set_preprocess_counters(state, preprocessor->get_latency());
+}
+BENCHMARK(BM_Preprocess_Half_Segment)->UseRealTime();
+
+/**
+ * @brief Runs one half segment of white noise through the native preprocessor in place per iteration.
+ *
+ * @details The argument is the dsp_isa whose kernels run, skipped if the CPU does not support it.
+*/
+static void BM_Native_Preprocess_Half_Segment(benchmark::State& state) {
+    const Dsp_Kernels* kernels = get_dsp_kernels(static_cast<dsp_isa>(state.range(0)));
+    if (kernels == nullptr) {
+        state.SkipWithError("Instruction set not supported");
+        return;
+    }
+    std::unique_ptr<Native_Preprocessor_tsrt> preprocessor;
+    try {
+        preprocessor = std::make_unique<Native_Preprocessor_tsrt>(Preprocessor_Config(), *kernels);
+    } catch (const Tsrt_Exception& e) {
+        state.SkipWithError(e.what());
+        return;
+    }
+
+    const std::vector<float> noise = make_noise();
+    Audio_Segment half_segment(SAMPLES_PER_HALF_SEGMENT);
+    for (auto _ : state) {
+        // a 400 sample copy, noise next to the filters
+        std::copy(noise.begin(), noise.end(), half_segment.get_audio());
+        preprocessor->preprocess(half_segment.get_audio(), SAMPLES_PER_HALF_SEGMENT);
+        benchmark::DoNotOptimize(half_segment.get_audio());
+    }
+
+    state.SetLabel(kernels->name);
+    set_preprocess_counters(state, preprocessor->get_latency());
+}
+BENCHMARK(BM_Native_Preprocess_Half_Segment)->DenseRange(DSP_SCALAR, DSP_AVX512)->UseRealTime();
+
+/**
+ * @brief Runs clean audio through the native preprocessor in place, one half segment per iteration.
+ *
+ * @details Half segments of a tone alternate with silent ones, a headset feed with no noise to remove, so once the SNR
+ * estimate settles the denoiser is bypassed. bypassed reports the share of its frames that were. The argument is the
+ * dsp_isa whose kernels run, skipped if the CPU does not support it.
+*/
+static void BM_Native_Preprocess_Clean_Half_Segment(benchmark::State& state) {
+    const Dsp_Kernels* kernels = get_dsp_kernels(static_cast<dsp_isa>(state.range(0)));
+    if (kernels == nullptr) {
+        state.SkipWithError("Instruction set not supported");
+        return;
+    }
+    std::unique_ptr<Native_Preprocessor_tsrt> preprocessor;
+    try {
+        preprocessor = std::make_unique<Native_Preprocessor_tsrt>(Preprocessor_Config(), *kernels);
+    } catch (const Tsrt_Exception& e) {
+        state.SkipWithError(e.what());
+        return;
+    }
+
+    std::vector<float> tone(SAMPLES_PER_HALF_SEGMENT);
+    for (size_t n = 0; n < tone.size(); ++n)
+        tone[n] = 0.25f * static_cast<float>(std::sin(2.0 * 3.14159265358979323846 * 440.0 * n / SAMPLE_RATE));
+    const std::vector<float> silence(SAMPLES_PER_HALF_SEGMENT, 0.0f);
+    Audio_Segment half_segment(SAMPLES_PER_HALF_SEGMENT);
+    uint64_t iteration = 0;
+    for (auto _ : state) {
+        const std::vector<float>& audio = iteration++ % 2 == 0 ? tone : silence;
+        std::copy(audio.begin(), audio.end(), half_segment.get_audio());
+        preprocessor->preprocess(half_segment.get_audio(), SAMPLES_PER_HALF_SEGMENT);
+        benchmark::DoNotOptimize(half_segment.get_audio());
+    }
+
+    state.SetLabel(kernels->name);
+    set_preprocess_counters(state, preprocessor->get_latency());
+    const Denoise_Stats stats = preprocessor->get_denoise_stats();
+    state.counters["bypassed"] = stats.frames > 0 ? static_cast<double>(stats.bypassed) / static_cast<double>(stats.frames) : 0.0;
+}
+BENCHMARK(BM_Native_Preprocess_Clean_Half_Segment)->DenseRange(DSP_SCALAR, DSP_AVX512)->UseRealTime();
+
+/**
+ * @brief Runs one half segment of white noise through the band pass biquad in place per iteration.
+ *
+ * @details The argument is the dsp_isa whose kernels run, skipped if the CPU does not support it. Shows what the block
+ * formulation gains over the serial recursion on its own.
+*/
+static void BM_Biquad_Half_Segment(benchmark::State& state) {
+    const Dsp_Kernels* kernels = get_dsp_kernels(static_cast<dsp_isa>(state.range(0)));
+    if (kernels == nullptr) {
+        state.SkipWithError("Instruction set not supported");
+        return;
+    }
+    Biquad_Cascade bandpass(*kernels);
+    bandpass.add_bandpass(BANDPASS_F, BANDPASS_W);
+
+    const std::vector<float> noise = make_noise();
+    Audio_Segment half_segment(SAMPLES_PER_HALF_SEGMENT);
+    for (auto _ : state) {
+        std::copy(noise.begin(), noise.end(), half_segment.get_audio());
+        bandpass.process(half_segment.get_audio(), SAMPLES_PER_HALF_SEGMENT);
+        benchmark::DoNotOptimize(half_segment.get_audio());
+    }
+
+    state.SetLabel(kernels->name);
+    set_preprocess_counters(state, 0);
+}
+BENCHMARK(BM_Biquad_Half_Segment)->DenseRange(DSP_SCALAR, DSP_AVX512)->UseRealTime();
+
+/**
+ * @brief Classifies one half segment of white noise with voice activity detection per iteration.
+ *
+ * @details The argument is the dsp_isa whose kernels run, skipped if the CPU does not support it. What gating the
+ * analyses costs, next to what the preprocessing costs.
+*/
+static void BM_Voice_Activity_Half_Segment(benchmark::State& state) {
+    const Dsp_Kernels* kernels = get_dsp_kernels(static_cast<dsp_isa>(state.range(0)));
+    if (kernels == nullptr) {
+        state.SkipWithError("Instruction set not supported");
+        return;
+    }
+    std::unique_ptr<Voice_Activity_Detector> voice_activity;
+    try {
+        voice_activity = std::make_unique<Voice_Activity_Detector>(*kernels);
+    } catch (const Tsrt_Exception& e) {
+        state.SkipWithError(e.what());
+        return;
+    }
+
+    const std::vector<float> noise = make_noise();
+    uint64_t sample_index = 0;
+    for (auto _ : state) {
+        voice_activity->process(noise.data(), noise.size());
+        sample_index += noise.size();
+        benchmark::DoNotOptimize(voice_activity->speech_since(sample_index - noise.size()));
+    }
+
+    state.SetLabel(kernels->name);
+    set_preprocess_counters(state, 0);
+}
+BENCHMARK(BM_Voice_Activity_Half_Segment)->DenseRange(DSP_SCALAR, DSP_AVX512)->UseRealTime();
+
+/**
+ * @brief Computes the log mel features of one half segment of white noise per iteration.
+ *
+ * @details The argument is the dsp_isa whose kernels run, skipped if the CPU does not support it. The frames of a half
+ * segment, computed once for every analysis.
+*/
+static void BM_Log_Mel_Half_Segment(benchmark::State& state) {
+    const Dsp_Kernels* kernels = get_dsp_kernels(static_cast<dsp_isa>(state.range(0)));
+    if (kernels == nullptr) {
+        state.SkipWithError("Instruction set not supported");
+        return;
+    }
+    std::unique_ptr<Log_Mel_Extractor> mel_features;
+    try {
+        mel_features = std::make_unique<Log_Mel_Extractor>(SAMPLE_RING_CAPACITY, *kernels);
+    } catch (const Tsrt_Exception& e) {
+        state.SkipWithError(e.what());
+        return;
+    }
+
+    const std::vector<float> noise = make_noise();
+    for (auto _ : state) {
+        mel_features->process(noise.data(), noise.size());
+        benchmark::DoNotOptimize(mel_features->get_frames());
+    }
+
+    state.SetLabel(kernels->name);
+    set_preprocess_counters(state, 0);
+}
+BENCHMARK(BM_Log_Mel_Half_Segment)->DenseRange(DSP_SCALAR, DSP_AVX512)->UseRealTime();
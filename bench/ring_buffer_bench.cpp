@@ -0,0 +1,176 @@
+#include "audio_segment_tsrt.h"
+#include "broadcast_ring_buffer_tsrt.h"
+#include "constants_config_tsrt.h"
+#include "ring_buffer_tsrt.h"
+#include "spsc_ring_buffer_tsrt.h"
+#include "wait_strategy_tsrt.h"
+
+#include <atomic>
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// Ring buffer microbenchmarks
+// Throughput is items per second through the ring, latency is the time from push to the consumer reading the item.
+// The element is a timestamp rather than an Audio_Segment so the numbers are the cost of the ring itself.
+
+namespace {
+
+constexpr size_t BENCH_RING_SIZE = 1024;
+
+struct Bench_Item {
+    int64_t pushed_ns;
+};
+
+int64_t now_ns() noexcept {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Push to pop latency seen by one consumer.
+*/
+struct Latency {
+    int64_t total_ns = 0;
+    int64_t max_ns = 0;
+    int64_t count = 0;
+
+    void record(const Bench_Item& item) noexcept {
+        const int64_t latency = now_ns() - item.pushed_ns;
+        total_ns += latency;
+        max_ns = std::max(max_ns, latency);
+        ++count;
+    }
+
+    void merge(const Latency& other) noexcept {
+        total_ns += other.total_ns;
+        max_ns = std::max(max_ns, other.max_ns);
+        count += other.count;
+    }
+
+    void report(benchmark::State& state) const {
+        state.counters["latency_mean_ns"] = count == 0 ? 0.0 : static_cast<double>(total_ns) / count;
+        state.counters["latency_max_ns"] = static_cast<double>(max_ns);
+    }
+};
+
+} // namespace
+
+/**
+ * @brief Single threaded push then pop through the lock-free single producer, single consumer ring buffer.
+*/
+static void BM_Spsc_Push_Pop(benchmark::State& state) {
+    Spsc_Ring_Buffer<Bench_Item, BENCH_RING_SIZE> ring;
+    Bench_Item item{0};
+    for (auto _ : state) {
+        ring.push(Bench_Item{0});
+        benchmark::DoNotOptimize(ring.pop(item));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Spsc_Push_Pop);
+
+/**
+ * @brief One producer, one consumer through the lock-free ring buffer, once per wait strategy.
+ *
+ * @details The consumer uses wait_peek(), so the wait strategy decides how it sleeps between items.
+*/
+template <typename Wait_Strategy>
+static void BM_Spsc_1P1C(benchmark::State& state) {
+    auto ring = std::make_unique<Spsc_Ring_Buffer<Bench_Item, BENCH_RING_SIZE, DROP_NEWEST, Wait_Strategy>>();
+    std::atomic<bool> done{false};
+    Latency latency;
+
+    std::thread consumer([&]() {
+        while (!done.load(std::memory_order_acquire) || !ring->empty()) {
+            Bench_Item* item = ring->wait_peek(std::chrono::milliseconds(THREAD_SLEEP_MS));
+            if (item == nullptr)
+                continue;
+            latency.record(*item);
+            ring->release();
+        }
+    });
+
+    for (auto _ : state) {
+        while (!ring->push(Bench_Item{now_ns()}))
+            cpu_relax();
+    }
+    done.store(true, std::memory_order_release);
+    consumer.join();
+
+    state.SetItemsProcessed(state.iterations());
+    latency.report(state);
+}
+BENCHMARK_TEMPLATE(BM_Spsc_1P1C, Busy_Spin_Wait)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Spsc_1P1C, Yielding_Wait)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Spsc_1P1C, Blocking_Wait)->UseRealTime();
+
+/**
+ * @brief One producer, N consumers through the broadcast ring buffer, once per wait strategy.
+ *
+ * @details Every consumer reads every item, the range argument is the number of consumers. Items per second counts
+ * items pushed, not items read.
+*/
+template <typename Wait_Strategy>
+static void BM_Broadcast_1PNC(benchmark::State& state) {
+    using Ring = Broadcast_Ring_Buffer<Bench_Item, BENCH_RING_SIZE, ANALYSIS_STAGE_COUNT, DROP_NEWEST, Wait_Strategy>;
+    auto ring = std::make_unique<Ring>();
+    const size_t consumer_count = static_cast<size_t>(state.range(0));
+    std::atomic<bool> done{false};
+    std::atomic<size_t> pushed{0};
+    std::vector<Latency> latencies(consumer_count);
+    std::vector<std::thread> consumers;
+
+    for (size_t i = 0; i < consumer_count; ++i) {
+        const size_t id = ring->register_consumer();
+        consumers.emplace_back([&, id]() {
+            size_t read = 0;
+            while (!done.load(std::memory_order_acquire) || read != pushed.load(std::memory_order_relaxed)) {
+                if (ring->wait_peek(id, std::chrono::milliseconds(THREAD_SLEEP_MS)) == nullptr)
+                    continue;
+                Slot_Runs<const Bench_Item> items = ring->peek_n(id, BENCH_RING_SIZE);
+                for (size_t j = 0; j < items.size(); ++j)
+                    latencies[id].record(items[j]);
+                read += items.size();
+                ring->release_n(id, items.size());
+            }
+        });
+    }
+
+    for (auto _ : state) {
+        while (!ring->push(Bench_Item{now_ns()}))
+            cpu_relax();
+    }
+    pushed.store(static_cast<size_t>(state.iterations()), std::memory_order_relaxed);
+    done.store(true, std::memory_order_release);
+    for (std::thread& consumer : consumers)
+        consumer.join();
+
+    Latency latency;
+    for (const Latency& consumer_latency : latencies)
+        latency.merge(consumer_latency);
+    state.SetItemsProcessed(state.iterations());
+    latency.report(state);
+}
+BENCHMARK_TEMPLATE(BM_Broadcast_1PNC, Busy_Spin_Wait)->RangeMultiplier(2)->Range(1, ANALYSIS_STAGE_COUNT)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Broadcast_1PNC, Yielding_Wait)->RangeMultiplier(2)->Range(1, ANALYSIS_STAGE_COUNT)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Broadcast_1PNC, Blocking_Wait)->RangeMultiplier(2)->Range(1, ANALYSIS_STAGE_COUNT)->UseRealTime();
+
+/**
+ * @brief Claim, fill and commit a preallocated half segment, then read it in place, the capture hop's steady state.
+*/
+static void BM_Spsc_Audio_Segment_Claim_Commit(benchmark::State& state) {
+    Spsc_Ring_Buffer<Audio_Segment, AUDIO_BUFFER_SIZE, CAPTURE_OVERFLOW_POLICY> ring{Audio_Segment(SAMPLES_PER_HALF_SEGMENT)};
+    for (auto _ : state) {
+        Audio_Segment* slot = ring.claim();
+        slot->get_audio()[0] = 1.0f;
+        ring.commit();
+        benchmark::DoNotOptimize(ring.peek()->get_audio()[0]);
+        ring.release();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Spsc_Audio_Segment_Claim_Commit);
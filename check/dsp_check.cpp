@@ -0,0 +1,353 @@
+#include "aligned_samples_tsrt.h"
+#include "constants_config_tsrt.h"
+#include "dsp_kernels_tsrt.h"
+#include "exceptions_tsrt.h"
+#include "fft_tsrt.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+// DSP checks
+// Every vector instruction set's kernels against the scalar kernels, and the real FFT run with every instruction set's
+// kernels against a naive DFT in double precision. Instruction sets the CPU does not support are skipped, as in the
+// benchmarks. Exits with a failure if any result is further off than its tolerance.
+
+static constexpr double PI = 3.14159265358979323846;
+
+// The denoiser's and voice activity detector's 256, a half segment and the log mel frame's 400, a segment's 800, and
+// sizes between them that cover every radix the plans use: 160 = 2 * 4^2 * 5, 480 = 2 * 4^2 * 3 * 5, 512 = 2 * 4^4 and
+// 1600 = 2 * 4^2 * 2 * 5^2
+static const std::vector<size_t> FFT_CHECK_SIZES = {160, DENOISE_FRAME_SAMPLES, SAMPLES_PER_HALF_SEGMENT, 480, 512, SAMPLES_PER_SEGMENT, 1600};
+
+// Counts for the kernels that take any buffer and count, around vector widths and the tails after whole vectors
+static const std::vector<size_t> UNALIGNED_COUNTS = {1, 7, 15, 16, 17, 33, 255, 401, 1603};
+
+// Whole SIMD_FLOATS blocks, for the kernels that take aligned buffers
+constexpr size_t ALIGNED_COUNT = SAMPLES_PER_SEGMENT;
+
+using Samples = std::unique_ptr<float[], Aligned_Samples_Deleter>;
+
+static size_t failures = 0;
+
+/**
+ * @brief Prints a check's result and counts it if it failed.
+ *
+ * @param isa The instruction set checked.
+ * @param check What was checked.
+ * @param worst The largest error found, as a share of its tolerance, above 1 fails.
+*/
+static void report(const char* isa, const char* check, double worst) {
+    const bool passed = worst <= 1.0;
+    if (!passed)
+        ++failures;
+    std::printf("%-8s %-24s %s (worst %.3g of tolerance)\n", isa, check, passed ? "ok" : "FAILED", worst);
+}
+
+/**
+ * @brief How far a result is off, as a share of its tolerance, relative to scale or absolute when scale is below 1.
+*/
+static double off_by(double actual, double expected, double tolerance, double scale) {
+    const double error = std::fabs(actual - expected);
+    if (std::isnan(error))
+        return INFINITY;
+    return error / (tolerance * std::max(1.0, scale));
+}
+
+/**
+ * @brief The largest off_by() of the values, each relative to its expected value.
+*/
+static double worst_of(const float* actual, const float* expected, size_t count, double tolerance) {
+    double worst = 0.0;
+    for (size_t i = 0; i < count; ++i)
+        worst = std::max(worst, off_by(actual[i], expected[i], tolerance, std::fabs(expected[i])));
+    return worst;
+}
+
+static void fill(float* values, size_t count, float low, float high, std::mt19937& generator) {
+    std::uniform_real_distribution<float> distribution(low, high);
+    for (size_t i = 0; i < count; ++i)
+        values[i] = distribution(generator);
+}
+
+static Samples make_samples(size_t count) {
+    return Samples(allocate_aligned_samples(count));
+}
+
+/**
+ * @brief multiply(), multiply_add(), power_spectrum() and log_floor(), on aligned buffers.
+*/
+static void check_element_wise(const Dsp_Kernels& scalar, const Dsp_Kernels& kernels, std::mt19937& generator) {
+    Samples a = make_samples(2 * ALIGNED_COUNT);
+    Samples b = make_samples(2 * ALIGNED_COUNT);
+    Samples expected = make_samples(2 * ALIGNED_COUNT);
+    Samples actual = make_samples(2 * ALIGNED_COUNT);
+    fill(a.get(), 2 * ALIGNED_COUNT, -1.0f, 1.0f, generator);
+    fill(b.get(), 2 * ALIGNED_COUNT, -1.0f, 1.0f, generator);
+
+    scalar.multiply(expected.get(), a.get(), b.get(), ALIGNED_COUNT);
+    kernels.multiply(actual.get(), a.get(), b.get(), ALIGNED_COUNT);
+    report(kernels.name, "multiply", worst_of(actual.get(), expected.get(), ALIGNED_COUNT, 1e-6));
+
+    fill(expected.get(), ALIGNED_COUNT, -1.0f, 1.0f, generator);
+    std::copy(expected.get(), expected.get() + ALIGNED_COUNT, actual.get());
+    scalar.multiply_add(expected.get(), a.get(), b.get(), ALIGNED_COUNT);
+    kernels.multiply_add(actual.get(), a.get(), b.get(), ALIGNED_COUNT);
+    report(kernels.name, "multiply_add", worst_of(actual.get(), expected.get(), ALIGNED_COUNT, 1e-6));
+
+    // a as ALIGNED_COUNT interleaved complex bins
+    scalar.power_spectrum(expected.get(), a.get(), ALIGNED_COUNT);
+    kernels.power_spectrum(actual.get(), a.get(), ALIGNED_COUNT);
+    report(kernels.name, "power_spectrum", worst_of(actual.get(), expected.get(), ALIGNED_COUNT, 1e-6));
+
+    // powers across the range the analyses see, with silent and negative values that are floored
+    std::uniform_real_distribution<float> exponent(-12.0f, 6.0f);
+    for (size_t i = 0; i < ALIGNED_COUNT; ++i)
+        expected[i] = i % 16 == 0 ? 0.0f : i % 16 == 1 ? -1.0f : std::pow(10.0f, exponent(generator));
+    std::copy(expected.get(), expected.get() + ALIGNED_COUNT, actual.get());
+    scalar.log_floor(expected.get(), ALIGNED_COUNT, 1e-10f);
+    kernels.log_floor(actual.get(), ALIGNED_COUNT, 1e-10f);
+    report(kernels.name, "log_floor", worst_of(actual.get(), expected.get(), ALIGNED_COUNT, 2e-5));
+}
+
+/**
+ * @brief spectral_subtract() over a run of frames, so the noise estimates rise and fall.
+*/
+static void check_spectral_subtract(const Dsp_Kernels& scalar, const Dsp_Kernels& kernels, std::mt19937& generator) {
+    constexpr size_t bins = DENOISE_FRAME_SAMPLES;
+    const Spectral_Subtraction params{1e-6f, 0.01f, 0.9f, 0.5f, 2.0f};
+    Samples frame = make_samples(2 * bins);
+    Samples expected = make_samples(2 * bins);
+    Samples actual = make_samples(2 * bins);
+    Samples expected_noise = make_samples(bins);
+    Samples actual_noise = make_samples(bins);
+    std::fill(expected_noise.get(), expected_noise.get() + bins, params.noise_floor);
+    std::fill(actual_noise.get(), actual_noise.get() + bins, params.noise_floor);
+
+    double worst = 0.0;
+    for (size_t i = 0; i < 16; ++i) {
+        // louder and quieter frames, with a silent bin
+        const float level = i % 4 == 3 ? 0.01f : 1.0f;
+        fill(frame.get(), 2 * bins, -level, level, generator);
+        frame[2 * (i % bins)] = 0.0f;
+        frame[2 * (i % bins) + 1] = 0.0f;
+        std::copy(frame.get(), frame.get() + 2 * bins, expected.get());
+        std::copy(frame.get(), frame.get() + 2 * bins, actual.get());
+        scalar.spectral_subtract(expected.get(), expected_noise.get(), bins, params);
+        kernels.spectral_subtract(actual.get(), actual_noise.get(), bins, params);
+        worst = std::max(worst, worst_of(actual.get(), expected.get(), 2 * bins, 1e-5));
+        worst = std::max(worst, worst_of(actual_noise.get(), expected_noise.get(), bins, 1e-5));
+    }
+    report(kernels.name, "spectral_subtract", worst);
+}
+
+/**
+ * @brief energy_crossings(), log_power_sum() and dot(), off alignment and on counts that leave tails.
+*/
+static void check_reductions(const Dsp_Kernels& scalar, const Dsp_Kernels& kernels, std::mt19937& generator) {
+    double energy_worst = 0.0;
+    double crossings_worst = 0.0;
+    double power_worst = 0.0;
+    double log_power_worst = 0.0;
+    double dot_worst = 0.0;
+    for (const size_t count : UNALIGNED_COUNTS) {
+        // one float past the start so the loads are never vector aligned, and signed zeros, which cross by their sign bit
+        std::vector<float> a(count + 1);
+        std::vector<float> b(2 * count + 1);
+        fill(a.data(), a.size(), -1.0f, 1.0f, generator);
+        fill(b.data(), b.size(), -1.0f, 1.0f, generator);
+        a[count / 2] = -0.0f;
+        a[count] = 0.0f;
+        const float* samples = a.data() + 1;
+
+        float expected_energy, actual_energy;
+        size_t expected_crossings, actual_crossings;
+        scalar.energy_crossings(samples, count, expected_energy, expected_crossings);
+        kernels.energy_crossings(samples, count, actual_energy, actual_crossings);
+        energy_worst = std::max(energy_worst, off_by(actual_energy, expected_energy, 1e-5, expected_energy));
+        crossings_worst = std::max(crossings_worst, actual_crossings == expected_crossings ? 0.0 : INFINITY);
+
+        // b as count interleaved complex bins, some below the floor
+        const float* spectrum = b.data() + 1;
+        b[1] = 0.0f;
+        b[2] = 0.0f;
+        double log_scale = 0.0;
+        for (size_t i = 0; i < count; ++i)
+            log_scale += std::fabs(std::log2(std::max(spectrum[2 * i] * spectrum[2 * i] + spectrum[2 * i + 1] * spectrum[2 * i + 1], 1e-9f)));
+        float expected_power, actual_power, expected_log_power, actual_log_power;
+        scalar.log_power_sum(spectrum, count, 1e-9f, expected_power, expected_log_power);
+        kernels.log_power_sum(spectrum, count, 1e-9f, actual_power, actual_log_power);
+        power_worst = std::max(power_worst, off_by(actual_power, expected_power, 1e-5, expected_power));
+        // every log2 may be off by the polynomial's error, on top of the sum's rounding
+        log_power_worst = std::max(log_power_worst, off_by(actual_log_power, expected_log_power, 1e-5, log_scale + count));
+
+        double dot_scale = 0.0;
+        for (size_t i = 0; i < count; ++i)
+            dot_scale += std::fabs(samples[i] * b[i + 1]);
+        dot_worst = std::max(dot_worst, off_by(kernels.dot(samples, b.data() + 1, count), scalar.dot(samples, b.data() + 1, count), 1e-5, dot_scale));
+    }
+    report(kernels.name, "energy_crossings energy", energy_worst);
+    report(kernels.name, "energy_crossings count", crossings_worst);
+    report(kernels.name, "log_power_sum power", power_worst);
+    report(kernels.name, "log_power_sum log", log_power_worst);
+    report(kernels.name, "dot", dot_worst);
+}
+
+/**
+ * @brief biquad() over calls of varying length, so the state is carried across block boundaries and tails.
+*/
+static void check_biquad(const Dsp_Kernels& scalar, const Dsp_Kernels& kernels, std::mt19937& generator) {
+    // a band pass around 1 kHz, as the native preprocessor builds them
+    const double w0 = 2.0 * PI * 1000.0 / SAMPLE_RATE;
+    const double alpha = std::sin(w0) / (2.0 * 1000.0 / 800.0);
+    Biquad_Section expected_section;
+    Biquad_Section actual_section;
+    init_biquad_section(expected_section, alpha, 0.0, -alpha, 1.0 + alpha, -2.0 * std::cos(w0), 1.0 - alpha);
+    init_biquad_section(actual_section, alpha, 0.0, -alpha, 1.0 + alpha, -2.0 * std::cos(w0), 1.0 - alpha);
+
+    double worst = 0.0;
+    for (const size_t count : UNALIGNED_COUNTS) {
+        std::vector<float> expected(count + 1);
+        fill(expected.data(), expected.size(), -1.0f, 1.0f, generator);
+        std::vector<float> actual(expected);
+        scalar.biquad(expected_section, expected.data() + 1, count);
+        kernels.biquad(actual_section, actual.data() + 1, count);
+        worst = std::max(worst, worst_of(actual.data(), expected.data(), expected.size(), 1e-4));
+        worst = std::max(worst, off_by(actual_section.s1, expected_section.s1, 1e-4, std::fabs(expected_section.s1)));
+        worst = std::max(worst, off_by(actual_section.s2, expected_section.s2, 1e-4, std::fabs(expected_section.s2)));
+    }
+    report(kernels.name, "biquad", worst);
+}
+
+/**
+ * @brief fft_pass(), fft_split() and fft_merge() on every pass of every checked size's plan, from the same inputs.
+*/
+static void check_fft_kernels(const Dsp_Kernels& scalar, const Dsp_Kernels& kernels, std::mt19937& generator) {
+    double pass_worst = 0.0;
+    double split_worst = 0.0;
+    double merge_worst = 0.0;
+    for (const size_t size : FFT_CHECK_SIZES) {
+        const std::shared_ptr<const Fft_Plan> plan = get_fft_plan(size);
+        const size_t n = size / 2;
+        std::vector<float> input(2 * n + 2);
+        std::vector<float> expected(2 * n + 2);
+        std::vector<float> actual(2 * n + 2);
+
+        for (const Fft_Pass& pass : plan->get_passes()) {
+            fill(input.data(), 2 * n, -1.0f, 1.0f, generator);
+            // every butterfly, then a range that starts and ends off a vector's worth of them
+            for (const size_t first : {size_t{0}, pass.m / 3}) {
+                const size_t last = first == 0 ? pass.m : pass.m - pass.m / 4;
+                std::fill(expected.begin(), expected.end(), 0.0f);
+                std::fill(actual.begin(), actual.end(), 0.0f);
+                scalar.fft_pass(pass, first, last, input.data(), expected.data());
+                kernels.fft_pass(pass, first, last, input.data(), actual.data());
+                pass_worst = std::max(pass_worst, worst_of(actual.data(), expected.data(), 2 * n, 1e-5));
+            }
+        }
+
+        fill(input.data(), 2 * n + 2, -1.0f, 1.0f, generator);
+        std::fill(expected.begin(), expected.end(), 0.0f);
+        std::fill(actual.begin(), actual.end(), 0.0f);
+        scalar.fft_split(expected.data(), input.data(), plan->get_split_twiddles(), n, 1, n);
+        kernels.fft_split(actual.data(), input.data(), plan->get_split_twiddles(), n, 1, n);
+        split_worst = std::max(split_worst, worst_of(actual.data(), expected.data(), 2 * n + 2, 1e-5));
+
+        std::fill(expected.begin(), expected.end(), 0.0f);
+        std::fill(actual.begin(), actual.end(), 0.0f);
+        scalar.fft_merge(expected.data(), input.data(), plan->get_split_twiddles(), n, 1, n);
+        kernels.fft_merge(actual.data(), input.data(), plan->get_split_twiddles(), n, 1, n);
+        merge_worst = std::max(merge_worst, worst_of(actual.data(), expected.data(), 2 * n, 1e-5));
+    }
+    report(kernels.name, "fft_pass", pass_worst);
+    report(kernels.name, "fft_split", split_worst);
+    report(kernels.name, "fft_merge", merge_worst);
+}
+
+/**
+ * @brief Real_Fft's forward and inverse transforms against a naive DFT, for every checked size.
+ *
+ * @details Errors are relative to the largest value of the result, a transform's error spreads over all of it.
+*/
+static void check_real_fft(const Dsp_Kernels& kernels, std::mt19937& generator) {
+    double forward_worst = 0.0;
+    double inverse_worst = 0.0;
+    for (const size_t size : FFT_CHECK_SIZES) {
+        Real_Fft fft(size, kernels);
+        const size_t bins = size / 2 + 1;
+
+        std::vector<float> samples(size);
+        std::vector<float> spectrum(2 * bins);
+        fill(samples.data(), size, -1.0f, 1.0f, generator);
+        fft.forward(spectrum.data(), samples.data());
+        std::vector<double> reference(2 * bins);
+        double peak = 0.0;
+        for (size_t k = 0; k < bins; ++k) {
+            double re = 0.0, im = 0.0;
+            for (size_t t = 0; t < size; ++t) {
+                // reduced mod size so the angle stays exact for large k * t
+                const double angle = -2.0 * PI * static_cast<double>((k * t) % size) / size;
+                re += samples[t] * std::cos(angle);
+                im += samples[t] * std::sin(angle);
+            }
+            reference[2 * k] = re;
+            reference[2 * k + 1] = im;
+            peak = std::max(peak, std::hypot(re, im));
+        }
+        for (size_t i = 0; i < 2 * bins; ++i)
+            forward_worst = std::max(forward_worst, off_by(spectrum[i], reference[i], 1e-5, peak));
+
+        // the imaginary parts of the first and last bins are set, the inverse must ignore them
+        fill(spectrum.data(), 2 * bins, -1.0f, 1.0f, generator);
+        const float scale = 1.0f / size;
+        fft.inverse(samples.data(), spectrum.data(), scale);
+        std::vector<double> expected(size);
+        peak = 0.0;
+        for (size_t t = 0; t < size; ++t) {
+            double sum = spectrum[0] + (t % 2 == 0 ? 1.0 : -1.0) * spectrum[2 * (bins - 1)];
+            for (size_t k = 1; k + 1 < bins; ++k) {
+                const double angle = 2.0 * PI * static_cast<double>((k * t) % size) / size;
+                sum += 2.0 * (spectrum[2 * k] * std::cos(angle) - spectrum[2 * k + 1] * std::sin(angle));
+            }
+            expected[t] = sum * scale;
+            peak = std::max(peak, std::fabs(expected[t]));
+        }
+        for (size_t t = 0; t < size; ++t)
+            inverse_worst = std::max(inverse_worst, off_by(samples[t], expected[t], 1e-5, peak));
+    }
+    report(kernels.name, "Real_Fft forward", forward_worst);
+    report(kernels.name, "Real_Fft inverse", inverse_worst);
+}
+
+int main() {
+    try {
+        const Dsp_Kernels& scalar = *get_dsp_kernels(DSP_SCALAR);
+        for (size_t isa = DSP_SCALAR; isa < DSP_ISA_COUNT; ++isa) {
+            const Dsp_Kernels* kernels = get_dsp_kernels(static_cast<dsp_isa>(isa));
+            if (kernels == nullptr) {
+                std::printf("instruction set %zu not supported, skipped\n", isa);
+                continue;
+            }
+            // the same inputs for every instruction set
+            std::mt19937 generator(SAMPLE_RATE);
+            if (isa != DSP_SCALAR) {
+                check_element_wise(scalar, *kernels, generator);
+                check_spectral_subtract(scalar, *kernels, generator);
+                check_reductions(scalar, *kernels, generator);
+                check_biquad(scalar, *kernels, generator);
+                check_fft_kernels(scalar, *kernels, generator);
+            }
+            check_real_fft(*kernels, generator);
+        }
+    } catch (const Tsrt_Exception& e) {
+        std::printf("%s\n", e.what());
+        return EXIT_FAILURE;
+    }
+
+    std::printf("%zu checks failed\n", failures);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
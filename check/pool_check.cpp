@@ -0,0 +1,267 @@
+#include "aligned_samples_tsrt.h"
+#include "constants_config_tsrt.h"
+#include "exceptions_tsrt.h"
+#include "segment_pool_tsrt.h"
+#include "segment_view_tsrt.h"
+#include "wait_strategy_tsrt.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <set>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Segment pool and segment view checks
+// Growing a pool chunk by chunk up to its max_chunks and past it, and handing out every buffer of every chunk exactly
+// once. The pools are small local ones, not the half segment pool, whose chunk table spans SEGMENT_POOL_MAX_SESSIONS.
+// Then the reference counts of shared windows, their pins going back to the pool, and the writer being held back by a
+// pinned window, on samples of a local buffer rather than a session's sample ring.
+// Exits with a failure if any check fails, run under a sanitizer to also catch writes past the chunk tables and views
+// outliving their pins.
+
+constexpr size_t CHECK_CHUNK_CAPACITY = 4;
+constexpr size_t CHECK_MAX_CHUNKS = 3;
+constexpr size_t CHECK_PIN_CAPACITY = 2;
+constexpr size_t CHECK_RING_CAPACITY = 4 * WINDOW_LENGTH;
+constexpr size_t CHECK_THREADS = 4;
+constexpr size_t CHECK_THREAD_COPIES = 100000;
+constexpr uint64_t NO_SAMPLE = std::numeric_limits<uint64_t>::max();
+
+static size_t failures = 0;
+
+/**
+ * @brief Prints a check's result and counts it if it failed.
+ *
+ * @param check What was checked.
+ * @param passed Whether the check passed.
+*/
+static void report(const char* check, bool passed) {
+    if (!passed)
+        ++failures;
+    std::printf("%-48s %s\n", check, passed ? "ok" : "FAILED");
+}
+
+/**
+ * @brief Grows a pool one chunk at a time, then asks for more chunks than its table has.
+*/
+static void check_reserve() {
+    Segment_Pool pool(SAMPLES_PER_HALF_SEGMENT, CHECK_CHUNK_CAPACITY, CHECK_MAX_CHUNKS);
+    report("empty pool has no buffers", pool.get_stats().capacity == 0 && pool.acquire() == Free_List::EMPTY);
+
+    bool grew = true;
+    for (size_t chunks = 1; chunks <= CHECK_MAX_CHUNKS; ++chunks)
+        grew = grew && pool.reserve(chunks) && pool.get_stats().capacity == chunks * CHECK_CHUNK_CAPACITY;
+    report("reserve grows up to max_chunks", grew);
+
+    report("reserve past max_chunks fails", !pool.reserve(CHECK_MAX_CHUNKS + 1));
+    report("reserve far past max_chunks fails", !pool.reserve(2 * CHECK_MAX_CHUNKS));
+    report("failed reserve keeps the capacity", pool.get_stats().capacity == CHECK_MAX_CHUNKS * CHECK_CHUNK_CAPACITY);
+    report("reserve below the chunk count succeeds", pool.reserve(1));
+}
+
+/**
+ * @brief Takes every buffer of a full grown pool, checks they are distinct, aligned and writable, then returns them.
+*/
+static void check_acquire() {
+    Segment_Pool pool(SAMPLES_PER_HALF_SEGMENT, CHECK_CHUNK_CAPACITY, CHECK_MAX_CHUNKS);
+    pool.reserve(CHECK_MAX_CHUNKS + 1);
+
+    std::vector<uint32_t> indices;
+    std::set<const float*> buffers;
+    bool aligned = true;
+    for (uint32_t index = pool.acquire(); index != Free_List::EMPTY; index = pool.acquire()) {
+        float* buffer = pool.get_buffer(index);
+        aligned = aligned && reinterpret_cast<uintptr_t>(buffer) % SAMPLE_ALIGNMENT == 0;
+        // the whole padded length is the holder's to write
+        for (size_t i = 0; i < padded_samples(SAMPLES_PER_HALF_SEGMENT); ++i)
+            buffer[i] = static_cast<float>(index);
+        indices.push_back(index);
+        buffers.insert(buffer);
+    }
+    report("every buffer is handed out once", indices.size() == CHECK_MAX_CHUNKS * CHECK_CHUNK_CAPACITY &&
+                                                  buffers.size() == indices.size());
+    report("buffers are aligned", aligned);
+
+    bool intact = true;
+    for (const uint32_t index : indices)
+        intact = intact && pool.get_buffer(index)[0] == static_cast<float>(index);
+    report("buffers do not overlap", intact);
+
+    const Segment_Pool_Stats stats = pool.get_stats();
+    report("exhaustion is counted", stats.in_use == indices.size() && stats.exhausted == 1);
+
+    for (const uint32_t index : indices)
+        pool.release(index);
+    const uint32_t again = pool.acquire();
+    report("released buffers are handed out again", again != Free_List::EMPTY && pool.get_stats().in_use == 1);
+    pool.release(again);
+}
+
+/**
+ * @brief Counts the wakes of a writer held back by a pinned window.
+*/
+struct Counting_Wake : Wake_Target {
+    std::atomic<size_t> wakes{0};
+
+    void wake() noexcept override {
+        wakes.fetch_add(1, std::memory_order_relaxed);
+    }
+};
+
+/**
+ * @brief The session's check before it writes samples, see Session_tsrt::push_audio_samples().
+ *
+ * @param pins The session's pins.
+ * @param oldest_window The first sample of the oldest window not released yet, NO_SAMPLE if there is none.
+ * @param sample_index The first sample to write.
+ * @param count The number of samples to write.
+ * @return bool Whether the writer holds the samples back.
+*/
+static bool writer_held_back(const Window_Pins& pins, uint64_t oldest_window, uint64_t sample_index, size_t count) {
+    const uint64_t oldest_sample = pins.oldest_pinned(oldest_window);
+    return oldest_sample != NO_SAMPLE && sample_index + count > oldest_sample + CHECK_RING_CAPACITY;
+}
+
+/**
+ * @brief Copies, moves and slices a shared window and checks the pin's reference count after each.
+*/
+static void check_view_refs() {
+    std::vector<float> samples(WINDOW_LENGTH);
+    Window_Pins pins(CHECK_PIN_CAPACITY);
+
+    Segment_View view = pins.pin(Sample_View{samples.data(), samples.size()}, WINDOW_HOP);
+    report("a shared window has one reference", !view.empty() && view.use_count() == 1);
+
+    {
+        Segment_View copy(view);
+        report("copying adds a reference", view.use_count() == 2 && copy == view);
+        Segment_View assigned;
+        assigned = copy;
+        report("copy assignment adds a reference", view.use_count() == 3 && assigned == view);
+    }
+    report("dropping copies takes their references", view.use_count() == 1);
+
+    Segment_View moved(std::move(view));
+    report("moving keeps the reference count", moved.use_count() == 1 && view.empty() && view.use_count() == 0);
+    view = std::move(moved);
+    report("move assignment keeps the reference count", view.use_count() == 1);
+
+    {
+        const Segment_View slice = view.slice(WINDOW_HOP, WINDOW_HOP);
+        report("a slice shares the pin", view.use_count() == 2 && slice.use_count() == 2);
+        report("a slice sees its part of the window", slice.get_samples().data == samples.data() + WINDOW_HOP &&
+                                                          slice.get_size() == WINDOW_HOP &&
+                                                          slice.get_start_sample() == 2 * WINDOW_HOP);
+        const Segment_View nested = slice.slice(1, 1);
+        report("a slice of a slice shares the pin", view.use_count() == 3 && nested.get_start_sample() == 2 * WINDOW_HOP + 1);
+    }
+    report("dropping slices takes their references", view.use_count() == 1);
+
+    bool threw = false;
+    try {
+        view.slice(WINDOW_HOP, WINDOW_HOP + 1);
+    } catch (const Tsrt_Exception&) {
+        threw = true;
+    }
+    report("a slice past the end throws", threw);
+    threw = false;
+    try {
+        view.slice(WINDOW_LENGTH + 1, 0);
+    } catch (const Tsrt_Exception&) {
+        threw = true;
+    }
+    report("a slice starting past the end throws", threw);
+    report("an empty slice at the end fits", view.slice(WINDOW_LENGTH, 0).get_size() == 0);
+    report("failed slices take no references", view.use_count() == 1);
+}
+
+/**
+ * @brief Shares every pin, then drops the views and checks the pins go back to the pool and wake the writer.
+*/
+static void check_view_release() {
+    std::vector<float> samples(WINDOW_LENGTH);
+    const Sample_View window{samples.data(), samples.size()};
+    Window_Pins pins(CHECK_PIN_CAPACITY);
+    Counting_Wake writer;
+    pins.set_release_target(&writer);
+
+    Segment_View first = pins.pin(window, 0);
+    Segment_View second = pins.pin(window, WINDOW_HOP);
+    report("an exhausted pool shares an empty view", pins.pin(window, WINDOW_LENGTH).empty() &&
+                                                         pins.get_stats().exhausted == 1);
+
+    Segment_View copy(first);
+    first = Segment_View();
+    report("a pin with views left stays held", pins.get_stats().in_use == 2 && writer.wakes.load() == 0);
+    copy = Segment_View();
+    report("the last view hands its pin back", pins.get_stats().in_use == 1 && writer.wakes.load() == 1);
+    report("a pin handed back is shared again", !pins.pin(window, WINDOW_LENGTH).empty());
+    report("every last view wakes the writer", writer.wakes.load() == 2);
+
+    // every thread copies and drops views of the same pin, the pin goes back once, after the last view
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < CHECK_THREADS; ++i) {
+        threads.emplace_back([&second]() {
+            for (size_t copies = 0; copies < CHECK_THREAD_COPIES; ++copies) {
+                Segment_View copy(second);
+                Segment_View slice = copy.slice(0, WINDOW_HOP);
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+    report("views copied across threads keep the count", second.use_count() == 1 && pins.get_stats().in_use == 1 &&
+                                                            writer.wakes.load() == 2);
+    second = Segment_View();
+    report("every pin is back after the last views", pins.get_stats().in_use == 0 && writer.wakes.load() == 3);
+}
+
+/**
+ * @brief Checks the writer does not overwrite a window shared past its release until its last view drops.
+*/
+static void check_view_holds_writer() {
+    std::vector<float> samples(CHECK_RING_CAPACITY);
+    Window_Pins pins(CHECK_PIN_CAPACITY);
+    const uint64_t start = WINDOW_HOP;
+    // the write that would overwrite the window's first sample
+    const uint64_t overwrite = start + CHECK_RING_CAPACITY - WINDOW_HOP + 1;
+
+    report("nothing pinned holds nothing back", pins.oldest_pinned(NO_SAMPLE) == NO_SAMPLE &&
+                                                    !writer_held_back(pins, NO_SAMPLE, overwrite, WINDOW_HOP));
+
+    Segment_View slice;
+    {
+        // the window is shared before its release, then released, only the pin holds its samples now
+        const Segment_View view = pins.pin(Sample_View{samples.data() + start, WINDOW_LENGTH}, start);
+        slice = view.slice(WINDOW_HOP, WINDOW_HOP);
+    }
+    report("a shared window is the oldest pinned", pins.oldest_pinned(NO_SAMPLE) == start);
+    report("an older unreleased window comes first", pins.oldest_pinned(0) == 0);
+    report("a view holds the writer back", writer_held_back(pins, NO_SAMPLE, overwrite, WINDOW_HOP));
+    report("writes short of the view go ahead", !writer_held_back(pins, NO_SAMPLE, overwrite - 1, WINDOW_HOP));
+
+    slice = Segment_View();
+    report("dropping the last view lets the writer on", pins.oldest_pinned(NO_SAMPLE) == NO_SAMPLE &&
+                                                            !writer_held_back(pins, NO_SAMPLE, overwrite, WINDOW_HOP));
+}
+
+int main() {
+    try {
+        check_reserve();
+        check_acquire();
+        check_view_refs();
+        check_view_release();
+        check_view_holds_writer();
+    } catch (const Tsrt_Exception& e) {
+        std::printf("%s\n", e.what());
+        return EXIT_FAILURE;
+    }
+
+    std::printf("%zu checks failed\n", failures);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,119 @@
+#ifndef aligned_samples_tsrt_h
+#define aligned_samples_tsrt_h
+
+#include "constants_config_tsrt.h"
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+
+/**
+ * @brief Rounds a sample count up to a whole number of SIMD_FLOATS blocks.
+ *
+ * @param count The number of samples.
+ * @return The padded number of samples.
+*/
+constexpr size_t padded_samples(const size_t count) noexcept {
+    return (count + SIMD_FLOATS - 1) / SIMD_FLOATS * SIMD_FLOATS;
+}
+
+/**
+ * @brief Tells the compiler that a pointer is aligned to Alignment bytes.
+ *
+ * @details std::assume_aligned is C++20, this is the same hint for C++17 compilers that support it.
+ *
+ * @tparam Alignment The alignment in bytes.
+ * @param samples The pointer.
+ * @return The same pointer.
+*/
+template <size_t Alignment>
+inline float* assume_aligned(float* samples) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<float*>(__builtin_assume_aligned(samples, Alignment));
+#else
+    return samples;
+#endif
+}
+
+/**
+ * @brief A buffer of samples whose start is aligned to Alignment bytes and whose length is padded to whole Alignment blocks.
+ *
+ * @details The guarantee is part of the type, so a kernel taking Aligned_Samples<SAMPLE_ALIGNMENT> can use aligned loads
+ * and stores and run its vector loop over get_padded_size() with no scalar tail.
+ * @details The padding past get_size() is scratch space. Its contents are unspecified, kernels may read and write it freely.
+ *
+ * @tparam Alignment The alignment in bytes, a power of two and a multiple of sizeof(float).
+ * @param samples The first sample.
+ * @param size The number of samples.
+*/
+template <size_t Alignment = SAMPLE_ALIGNMENT>
+class Aligned_Samples {
+
+private:
+    float* samples;
+    size_t size;
+
+    static_assert(Alignment != 0 && (Alignment & (Alignment - 1)) == 0, "Alignment must be a power of two");
+    static_assert(Alignment % sizeof(float) == 0, "Alignment must be a whole number of samples");
+
+public:
+    static constexpr size_t alignment = Alignment;
+    static constexpr size_t block_samples = Alignment / sizeof(float);
+
+    Aligned_Samples(float* samples, size_t size) noexcept : samples(samples), size(size) {}
+
+    float* get() const noexcept {
+        return assume_aligned<Alignment>(samples);
+    }
+
+    size_t get_size() const noexcept {
+        return size;
+    }
+
+    size_t get_padded_size() const noexcept {
+        return (size + block_samples - 1) / block_samples * block_samples;
+    }
+};
+
+/**
+ * @brief Allocates zeroed samples aligned to SAMPLE_ALIGNMENT and padded to whole SIMD_FLOATS blocks.
+ *
+ * @param count The number of samples, rounded up with padded_samples().
+ * @return float* The samples, free them with free_aligned_samples().
+ * @throw std::bad_alloc if the allocation fails.
+*/
+inline float* allocate_aligned_samples(const size_t count) {
+    const size_t bytes = padded_samples(count) * sizeof(float);
+    float* samples = static_cast<float*>(::operator new[](bytes, std::align_val_t(SAMPLE_ALIGNMENT)));
+    std::memset(samples, 0, bytes);
+    return samples;
+}
+
+/**
+ * @brief Allocates like allocate_aligned_samples(), but returns nullptr instead of throwing.
+*/
+inline float* allocate_aligned_samples(const size_t count, const std::nothrow_t&) noexcept {
+    const size_t bytes = padded_samples(count) * sizeof(float);
+    float* samples = static_cast<float*>(::operator new[](bytes, std::align_val_t(SAMPLE_ALIGNMENT), std::nothrow));
+    if (samples != nullptr)
+        std::memset(samples, 0, bytes);
+    return samples;
+}
+
+/**
+ * @brief Frees samples allocated with allocate_aligned_samples().
+*/
+inline void free_aligned_samples(float* samples) noexcept {
+    ::operator delete[](samples, std::align_val_t(SAMPLE_ALIGNMENT));
+}
+
+/**
+ * @brief unique_ptr deleter for allocate_aligned_samples().
+*/
+struct Aligned_Samples_Deleter {
+    void operator()(float* samples) const noexcept {
+        free_aligned_samples(samples);
+    }
+};
+
+#endif // aligned_samples_tsrt_h
@@ -0,0 +1,147 @@
+#ifndef audio_file_tsrt_h
+#define audio_file_tsrt_h
+
+#include "audio_source_tsrt.h"
+#include "audio_tsrt.h"
+#include "constants_config_tsrt.h"
+#include "exceptions_tsrt.h"
+#include "preprocessor_tsrt.h"
+#include "status_codes_tsrt.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavfilter/avfilter.h>
+#include <libavformat/avformat.h>
+#include <libavutil/avutil.h>
+}
+
+/**
+ * @brief A deleter for AVFormatContext
+ *
+ * @param format_context AVFormatContext to be closed
+*/
+void format_context_deleter(AVFormatContext* format_context);
+
+/**
+ * @brief A deleter for AVCodecContext
+ *
+ * @param codec_context AVCodecContext to be cleaned up
+*/
+void codec_context_deleter(AVCodecContext* codec_context);
+
+/**
+ * @brief A deleter for AVPacket
+ *
+ * @param packet AVPacket to be cleaned up
+*/
+void packet_deleter(AVPacket* packet);
+
+/**
+ * @brief Decodes an audio file into SAMPLE_RATE mono float samples.
+ *
+ * Demuxes and decodes the best audio stream of any file FFmpeg can open, then converts it with an
+ * aresample and aformat filter graph, so the samples match what the input device delivers. Samples are
+ * read as fast as the caller asks for them, there is no real-time pacing, so a recording is transcribed
+ * as fast as the pipeline can take it.
+ * As an Audio_Source it is not live, the pipeline is never given more than it can take, so no audio is dropped.
+ *
+ * @param samples_read The number of converted samples returned so far.
+*/
+class Audio_File_tsrt : public Pull_Audio_Source {
+
+private:
+
+    std::unique_ptr<AVFormatContext, decltype(&format_context_deleter)> format_context;
+    std::unique_ptr<AVCodecContext, decltype(&codec_context_deleter)> codec_context;
+    std::unique_ptr<AVPacket, decltype(&packet_deleter)> packet;
+    std::unique_ptr<AVFrame, decltype(&avframe_deleter)> decoded_frame;
+    std::unique_ptr<AVFrame, decltype(&avframe_deleter)> converted_frame;
+    std::unique_ptr<AVFilterGraph, decltype(&avfilter_graph_deleter)> avfilter_graph;
+    AVFilterContext* src_ctx;
+    AVFilterContext* sink_ctx;
+    int stream_index;
+    // samples of converted_frame already returned
+    int converted_offset;
+    bool demuxer_drained;
+    bool decoder_drained;
+    bool finished;
+    uint64_t samples_read;
+
+    /**
+     * @brief Open the file, find its best audio stream and open a decoder for it
+     *
+     * @throw tsrt_exception
+    */
+    void init_decoder(const std::string& path);
+
+    /**
+     * @brief Initialize the AVFilterGraph converting decoded frames to SAMPLE_RATE mono float
+     *
+     * @throw tsrt_exception
+    */
+    void init_avfilter_graph();
+
+    /**
+     * @brief Demux, decode and convert until the next converted frame is available
+     *
+     * @return bool False once the whole file has been converted.
+     * @throw tsrt_exception
+    */
+    bool next_converted_frame();
+
+public:
+
+    /**
+     * @brief Construct a new Audio_File_tsrt object
+     *
+     * @param path The path or URL of the file to decode.
+     * @throw tsrt_exception if the file can not be opened or has no decodable audio stream.
+    */
+    explicit Audio_File_tsrt(const std::string& path);
+
+    Audio_File_tsrt(const Audio_File_tsrt&) = delete;
+    Audio_File_tsrt& operator=(const Audio_File_tsrt&) = delete;
+
+    /**
+     * @brief Read the next samples of the file
+     *
+     * @param destination A buffer for at least count samples.
+     * @param count The number of samples to read.
+     * @return size_t The number of samples read, less than count only at the end of the file.
+     * @throw tsrt_exception if demuxing, decoding or converting fails.
+    */
+    size_t read_samples(float* destination, size_t count) override;
+
+    /**
+     * @brief Check if every sample of the file has been read
+     *
+     * @return bool
+    */
+    bool at_end() const noexcept;
+
+    /**
+     * @brief Get the number of samples read so far
+     *
+     * @return uint64_t
+    */
+    uint64_t get_samples_read() const noexcept;
+
+    /**
+     * @brief Get the duration of the audio read so far
+     *
+     * @return std::chrono::duration<double>
+    */
+    std::chrono::duration<double> get_duration_read() const noexcept;
+
+    bool is_live() const noexcept override;
+
+    const char* get_name() const noexcept override;
+};
+
+#endif // audio_file_tsrt_h
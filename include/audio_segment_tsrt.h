@@ -1,49 +1,64 @@
 #ifndef audio_segment_tsrt_h
 #define audio_segment_tsrt_h
 
+#include "aligned_samples_tsrt.h"
 #include "constants_config_tsrt.h"
 #include "exceptions_tsrt.h"
+#include "segment_pool_tsrt.h"
 #include "status_codes_tsrt.h"
 
+#include <algorithm>
 #include <chrono>
+#include <cstdint>
 #include <memory>
 
 /**
  * @brief Represents an audio segment.
  * 
- * Audio_Segment is a wrapper for a float array of audio samples. It also contains a timestamp.
+ * Audio_Segment is a wrapper for a float array of audio samples. It also carries its position on the
+ * capture timeline, the absolute index of its first sample and its sequence number, see Sample_Clock.
+ * Half segment sized buffers come from the Segment_Pool and go back to it when the segment
+ * is destroyed, other sizes are allocated on the heap.
+ * The audio array is aligned to SAMPLE_ALIGNMENT and padded to whole SIMD_FLOATS blocks, see Aligned_Samples.
+ * The midpoint is aligned too whenever half the size is a whole number of blocks, which
+ * SAMPLES_PER_SEGMENT is checked to be at compile time.
  * 
  * @param audio A float array of audio samples.
  * @param midpoint A pointer to the midpoint of the audio array.
- * @param timestamp The timestamp of the segment.
+ * @param sample_index The absolute index of the segment's first sample.
+ * @param sequence The segment's sequence number.
  * @param size The size of the audio array.
 */
 class Audio_Segment {
 
 private:
-    std::unique_ptr<float[]> audio;
+    Sample_Buffer audio;
     float* midpoint;
-    std::chrono::time_point<std::chrono::system_clock> timestamp;
+    uint64_t sample_index;
+    uint64_t sequence;
     size_t size;
 
     // Private swap method
     void swap(Audio_Segment& other) noexcept {
         std::swap(audio, other.audio);
-        std::swap(timestamp, other.timestamp);
+        std::swap(midpoint, other.midpoint);
+        std::swap(sample_index, other.sample_index);
+        std::swap(sequence, other.sequence);
         std::swap(size, other.size);
     }
 
 public:
 
-    Audio_Segment() : audio(nullptr), midpoint(nullptr), timestamp(std::chrono::system_clock::now()), size(0) {}
+    Audio_Segment() : audio(nullptr), midpoint(nullptr), sample_index(0), sequence(0), size(0) {}
 
-    Audio_Segment(size_t size) : audio(std::make_unique<float[]>(size)), midpoint(audio.get() + size / 2), timestamp(std::chrono::system_clock::now()), size(size) {}
+    Audio_Segment(size_t size) : audio(allocate_samples(size)), midpoint(audio.get() + size / 2), sample_index(0), sequence(0), size(size) {}
 
     // Copy constructor
     Audio_Segment(const Audio_Segment& other) : 
-        audio(std::make_unique<float[]>(other.size)),
+        audio(allocate_samples(other.size)),
         midpoint(audio.get() + other.size / 2),
-        timestamp(other.timestamp),
+        sample_index(other.sample_index),
+        sequence(other.sequence),
         size(other.size) {
         std::copy(other.audio.get(), other.audio.get() + other.size, audio.get());
     }
@@ -52,7 +67,8 @@ public:
     Audio_Segment(Audio_Segment&& other) noexcept : 
         audio(std::move(other.audio)),
         midpoint(other.midpoint),
-        timestamp(other.timestamp),
+        sample_index(other.sample_index),
+        sequence(other.sequence),
         size(other.size) {
     }
 
@@ -73,40 +89,60 @@ public:
 
     // Equality comparison operator
     bool operator==(const Audio_Segment& other) const noexcept {
-        return this->timestamp == other.timestamp;
+        return this->sample_index == other.sample_index && this->sequence == other.sequence;
     }
 
-    void reset_audio() noexcept {
-        audio = std::make_unique<float[]>(size);
+    // allocates, so not for real time threads
+    void reset_audio() {
+        audio = allocate_samples(size);
         midpoint = audio.get() + size / 2;
     }
 
     float* get_audio() const noexcept {
-        return audio.get();
+        return assume_aligned<SAMPLE_ALIGNMENT>(audio.get());
     }
 
     float* get_midpoint() const noexcept {
         return midpoint;
     }
 
-    void set_timestamp(std::chrono::time_point<std::chrono::system_clock> timestamp) noexcept {
-        this->timestamp = timestamp;
+    Aligned_Samples<SAMPLE_ALIGNMENT> get_aligned_audio() const noexcept {
+        return Aligned_Samples<SAMPLE_ALIGNMENT>(audio.get(), size);
     }
 
-    std::chrono::time_point<std::chrono::system_clock> get_timestamp() const noexcept {
-        return timestamp;
+    // Only aligned when size / 2 is a multiple of SIMD_FLOATS, e.g. SAMPLES_PER_SEGMENT
+    Aligned_Samples<SAMPLE_ALIGNMENT> get_aligned_midpoint() const noexcept {
+        return Aligned_Samples<SAMPLE_ALIGNMENT>(midpoint, size - size / 2);
+    }
+
+    void set_position(uint64_t sample_index, uint64_t sequence) noexcept {
+        this->sample_index = sample_index;
+        this->sequence = sequence;
+    }
+
+    uint64_t get_sample_index() const noexcept {
+        return sample_index;
+    }
+
+    uint64_t get_sequence() const noexcept {
+        return sequence;
     }
 
     size_t get_size() const noexcept {
         return size;
     }
 
+    size_t get_padded_size() const noexcept {
+        return padded_samples(size);
+    }
+
     void lazy_initialize(size_t size) {
         if (size == 0)
             throw Tsrt_Exception(INVALID_ARGUMENT, "Audio segment size must be greater than 0.", std::chrono::system_clock::now(), __FILE__, __LINE__);
-        audio = std::make_unique<float[]>(size);
+        audio = allocate_samples(size);
         midpoint = audio.get() + size / 2;
-        timestamp = std::chrono::system_clock::now();
+        sample_index = 0;
+        sequence = 0;
         this->size = size;
     }
 };
@@ -0,0 +1,191 @@
+#ifndef audio_source_tsrt_h
+#define audio_source_tsrt_h
+
+#include "audio_segment_tsrt.h"
+#include "constants_config_tsrt.h"
+#include "exceptions_tsrt.h"
+#include "sample_clock_tsrt.h"
+#include "spsc_ring_buffer_tsrt.h"
+#include "status_codes_tsrt.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/**
+ * @brief Counters kept by an audio source.
+ *
+ * @param samples The number of samples produced, including ones dropped because the capture ring buffer was full.
+ * @param dropped_segments The number of half segments dropped because the capture ring buffer was full.
+ * @param input_overflows The number of times the source itself lost audio, e.g. a device overflow.
+ * @param mean_input_latency The mean time from audio being available to it being produced, 0 if not measured.
+ * @param max_input_latency The longest time from audio being available to it being produced, 0 if not measured.
+*/
+struct Source_Stats {
+    uint64_t samples;
+    uint64_t dropped_segments;
+    uint64_t input_overflows;
+    std::chrono::nanoseconds mean_input_latency;
+    std::chrono::nanoseconds max_input_latency;
+};
+
+/**
+ * @brief Where the pipeline's audio comes from.
+ *
+ * @details A source produces half segments of SAMPLE_RATE mono float samples into the capture ring buffer, each positioned
+ * on the capture timeline, and anchors the Sample_Clock when it starts. Its session starts and stops it as the session's
+ * recording flag changes and calls produce() in a loop while it runs, unless a callback of the source's own produces,
+ * see Session_tsrt.
+ * @details Live sources are paced by something outside the pipeline, e.g. a device, and drop audio when the ring buffer
+ * is full like capture always has. Other sources wait for room instead, so the pipeline runs as fast as its slowest stage.
+*/
+class Audio_Source {
+
+public:
+
+    virtual ~Audio_Source() = default;
+
+    /**
+     * @brief Starts producing into the given ring buffer.
+     *
+     * @details Resuming after a stop leaves a gap of at least one half segment in the timeline.
+     *
+     * @param ring The capture ring buffer, the source is its only producer.
+     * @param clock The clock mapping the capture timeline to wall clock time, anchored here.
+     * @return tsrt_status_code
+    */
+    virtual tsrt_status_code start(Capture_Ring_Buffer& ring, Sample_Clock& clock) = 0;
+
+    /**
+     * @brief Stops producing.
+     *
+     * @return tsrt_status_code
+    */
+    virtual tsrt_status_code stop() = 0;
+
+    /**
+     * @brief Produces the next audio into the ring buffer.
+     *
+     * @details Called in a loop while the source is started, returns within about THREAD_SLEEP_MS so the caller can
+     * notice the session stopping. A source that is not live is only called by the input task when the ring buffer has
+     * room, so it never waits there, on a recording thread it waits for the input task to release a slot, see
+     * Spsc_Ring_Buffer::wait_for_space(). Never called on a callback driven source.
+     *
+     * @return bool False once the source has no more audio.
+    */
+    virtual bool produce() = 0;
+
+    /**
+     * @brief Checks if the source is paced from outside the pipeline and drops audio when it falls behind.
+     *
+     * @return bool
+    */
+    virtual bool is_live() const noexcept = 0;
+
+    /**
+     * @brief Checks if produce() may block on a writer outside the pipeline, e.g. a pipe, for longer than THREAD_SLEEP_MS.
+     *
+     * @details Such a source is run by a recording thread of its own like a live source, so a slow writer only holds up
+     * its own session, but it still waits for room rather than dropping audio.
+     *
+     * @return bool
+    */
+    virtual bool may_block() const noexcept {
+        return false;
+    }
+
+    /**
+     * @brief Checks if a callback of the source's own, e.g. a device's, produces into the ring buffer once started.
+     *
+     * @details Such a source needs no recording thread and produce() is never called, the session only starts and
+     * stops it. Each commit wakes the session, see Wake_Target, without scheduling its task on the callback's thread.
+     *
+     * @return bool
+    */
+    virtual bool is_callback_driven() const noexcept {
+        return false;
+    }
+
+    /**
+     * @brief Gets the name of the source, for logging.
+     *
+     * @return const char*
+    */
+    virtual const char* get_name() const noexcept = 0;
+
+    /**
+     * @brief Gets the source's counters.
+     *
+     * @return Source_Stats
+    */
+    virtual Source_Stats get_stats() const noexcept = 0;
+};
+
+/**
+ * @brief An audio source its session reads samples from.
+ *
+ * @details Implements the ring buffer side of Audio_Source once, so implementations only provide read_samples(). Each half
+ * segment is read straight into a preallocated slot claimed from the ring buffer. When the ring buffer is full a live
+ * source reads into a spare segment so it keeps up with its pacing and the segment is dropped, any other source waits
+ * for room. The last segment of a finite source is padded with silence.
+ *
+ * @param ring The capture ring buffer, nullptr while stopped.
+ * @param overflow_segment Read into when a live source has to drop a segment, allocated on the first start().
+ * @param sequence The sequence number of the next segment.
+ * @param finished Set once read_samples() returned less than was asked for.
+*/
+class Pull_Audio_Source : public Audio_Source {
+
+private:
+    Capture_Ring_Buffer* ring;
+    Audio_Segment overflow_segment;
+    uint64_t sequence;
+    bool finished;
+    uint64_t samples;
+    uint64_t dropped_segments;
+
+protected:
+
+    Pull_Audio_Source();
+
+    /**
+     * @brief Reads the next samples, blocking until they are available.
+     *
+     * @param destination A buffer for at least count samples.
+     * @param count The number of samples to read.
+     * @return size_t The number of samples read, less than count only at the end of the source.
+    */
+    virtual size_t read_samples(float* destination, size_t count) = 0;
+
+public:
+
+    tsrt_status_code start(Capture_Ring_Buffer& ring, Sample_Clock& clock) override;
+
+    tsrt_status_code stop() override;
+
+    bool produce() override;
+
+    Source_Stats get_stats() const noexcept override;
+};
+
+/**
+ * @brief Creates an audio source from a command line style spec.
+ *
+ * @details The specs are "portaudio" for the default input device, "portaudio:<index>" for another input device,
+ * "pcm:<path>" for raw SAMPLE_RATE mono float32 from a file or pipe, "-" standing for stdin, "tone:<hz>", "noise" and
+ * "loop:<path>" for a Synthetic_Source, and anything else is opened as an audio file with FFmpeg.
+ *
+ * @param spec The source to create.
+ * @param speed How many times real time a synthetic source runs at, 0 for as fast as possible.
+ * @param jitter The most a paced synthetic source delays each segment by, to mimic device scheduling.
+ * @param duration How much audio a synthetic source produces before it ends, 0 for no end.
+ * @return std::unique_ptr<Audio_Source>
+ * @throw Tsrt_Exception if the source can not be opened.
+*/
+std::unique_ptr<Audio_Source> make_audio_source(const std::string& spec, double speed = 0.0,
+                                                std::chrono::microseconds jitter = std::chrono::microseconds(0),
+                                                std::chrono::seconds duration = std::chrono::seconds(0));
+
+#endif // audio_source_tsrt_h
@@ -1,11 +1,17 @@
 #ifndef audio_tsrt_h
 #define audio_tsrt_h
 
+#include "audio_segment_tsrt.h"
+#include "audio_source_tsrt.h"
 #include "constants_config_tsrt.h"
 #include "exceptions_tsrt.h"
+#include "sample_clock_tsrt.h"
+#include "spsc_ring_buffer_tsrt.h"
 #include "status_codes_tsrt.h"
 
+#include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <exception>
 #include <functional>
 #include <iostream>
@@ -13,13 +19,6 @@
 #include <string>
 #include <portaudio.h>
 
-extern "C" {
-#include <libavcodec/avcodec.h>
-#include <libavfilter/avfilter.h>
-#include <libavformat/avformat.h>
-#include <libavutil/avutil.h>
-}
-
 /**
  * @brief A deleter for PortAudio
  * 
@@ -28,69 +27,100 @@ extern "C" {
 void stream_deleter(PaStream* stream);
 
 /**
- * @brief A deleter for AVFrame
- * 
- * @param avframe AVFrame to be cleaned up
-*/
-void avframe_deleter(AVFrame* avframe);
-
-/**
- * @brief A deleter for AVFilterGraph
+ * @brief Counters kept by the capture callback.
  * 
- * @param avfilter_graph AVFilterGraph to be cleaned up
+ * @param callbacks The number of device buffers delivered.
+ * @param samples The number of samples delivered, including dropped ones.
+ * @param input_overflows The number of callbacks PortAudio flagged with paInputOverflow, i.e. samples lost by the device.
+ * @param dropped_segments The number of half segments dropped because the capture ring buffer was full.
+ * @param mean_input_latency The mean time from a buffer being sampled by the ADC to its callback running, over the
+ * callbacks the host reported the ADC time for, 0 if it reported none.
+ * @param max_input_latency The longest time from a buffer being sampled by the ADC to its callback running, 0 if the host
+ * reported no ADC time.
 */
-void avfilter_graph_deleter(AVFilterGraph* avfilter_graph);
+struct Capture_Stats {
+    uint64_t callbacks;
+    uint64_t samples;
+    uint64_t input_overflows;
+    uint64_t dropped_segments;
+    std::chrono::nanoseconds mean_input_latency;
+    std::chrono::nanoseconds max_input_latency;
+};
 
 class Audio_tsrt {
 
 private:
 
     std::unique_ptr<PaStream, decltype(&stream_deleter)> stream;
-    std::unique_ptr<AVFrame, decltype(&avframe_deleter)> avframe_filter;
-    std::unique_ptr<AVFilterGraph, decltype(&avfilter_graph_deleter)> avfilter_graph;
-    // ctx's outside of init_avfilter_graph() because preprocess_audio() reads them
-    // the other filters contexts are not needed outside of init_avfilter_graph()
-    AVFilterContext* src_ctx;
-    AVFilterContext* sink_ctx;
+    PaDeviceIndex device;
+
+    // capture callback state, only touched by the callback while the stream runs and by start_capture() while it does not
+    Capture_Ring_Buffer* capture_ring;
+    Sample_Clock* capture_clock;
+    Audio_Segment* capture_segment;
+    size_t capture_fill;
+    uint64_t capture_sequence;
+    bool anchor_pending;
+
+    // written by the callback only, read by anyone
+    std::atomic<uint64_t> capture_callbacks;
+    std::atomic<uint64_t> captured_samples;
+    std::atomic<uint64_t> input_overflows;
+    std::atomic<uint64_t> dropped_segments;
+    std::atomic<uint64_t> input_latency_callbacks; // callbacks the host reported the ADC time for
+    std::atomic<int64_t> input_latency_total_ns;
+    std::atomic<int64_t> input_latency_max_ns;
 
     /**
-     * @brief Construct a new Audio_tsrt object
-     * 
-     * Initializes PortAudio, finds an input device, opens a stream, and initializes FFmpeg.
+     * @brief Initialize PortAudio and open a stream on the input device
      * 
      * @throw tsrt_exception
     */
-    Audio_tsrt();
+    void open_stream();
 
     /**
-     * @brief Initialize the AVFrames for the AVFilterGraph
+     * @brief The PortAudio stream callback, forwards to capture_audio().
+     * 
+     * @param user_data The Audio_tsrt instance.
+     * @return int paContinue
     */
-    void init_avframe();
+    static int capture_callback(const void* input, void* output, unsigned long frame_count,
+                                const PaStreamCallbackTimeInfo* time_info, PaStreamCallbackFlags status_flags, void* user_data);
 
     /**
-     * @brief Initialize the AVFilterGraph
-    */
-    void init_avfilter_graph();
-    
-    /**
-     * @brief Initialize PortAudio
+     * @brief Copies one device buffer into the capture ring buffer.
      * 
-     * @throw tsrt_exception
+     * Runs on PortAudio's real-time thread, so it never locks or allocates. A commit only counts the session's wake, a
+     * session it finds parked is scheduled by the engine's waker thread, which the commit posts, see Session_tsrt.
+     * Device buffers of any size are gathered into half segments claimed from the capture ring buffer,
+     * each committed with its position on the capture timeline once it is full. If the ring buffer is
+     * full the samples are dropped up to the next half segment boundary, which still advances the timeline.
+     * 
+     * @param input The interleaved samples, nullptr if the device delivered none.
+     * @param frame_count The number of samples.
+     * @param time_info The ADC time of the first sample and the stream time of the callback.
+     * @param status_flags PortAudio's status flags for the buffer.
     */
-    void handle_ffmpeg_errors(std::function<int()> bound_func, const std::string& error_context, std::string file, int line);
+    void capture_audio(const float* input, unsigned long frame_count, const PaStreamCallbackTimeInfo* time_info,
+                       PaStreamCallbackFlags status_flags) noexcept;
+
+public:
 
     /**
-     * @brief Initialize PortAudio
+     * @brief Construct a new Audio_tsrt object
      * 
-     * @throw tsrt_exception
+     * The input device is only opened when a stream is first started, so hosts without one can construct it.
+     * Each instance captures from its own device, one per session.
+     * 
+     * @param device The PortAudio index of the input device, paNoDevice for the default input device.
     */
-    static void ffmpeg_log_callback(void* ptr, int level, const char* fmt, va_list vargs);
-
-public:
+    explicit Audio_tsrt(PaDeviceIndex device = paNoDevice);
 
     /**
      * @brief Start the audio stream
      * 
+     * Opens the input device the first time.
+     * 
      * @return tsrt_status_code 
     */
     tsrt_status_code start_stream();
@@ -103,42 +133,88 @@ public:
     tsrt_status_code stop_stream();
 
     /**
-     * @brief Read in the next audio segment
+     * @brief Start the audio stream, capturing into the given ring buffer from the PortAudio callback
      * 
-     * @param segment A pointer to a buffer to store the audio segment
-     * @return tsrt_status_code 
+     * Must only be called while the stream is stopped. Opens the input device the first time. The clock is anchored to the ADC time of the first
+     * buffer captured. Resuming after a stop leaves a gap of at least one half segment in the timeline.
+     * 
+     * @param ring The capture ring buffer, the callback is its only producer.
+     * @param clock The clock mapping the capture timeline to wall clock time.
+     * @return tsrt_status_code INVALID_OPERATION if built with CAPTURE_MODE set to CAPTURE_BLOCKING.
+     * @throw tsrt_exception
     */
-    tsrt_status_code read_audio_segment(float* segment, int segment_size);
+    tsrt_status_code start_capture(Capture_Ring_Buffer& ring, Sample_Clock& clock);
 
     /**
-     * @brief Preprocess the audio segment with FFmpeg
+     * @brief Get the capture callback's counters
      * 
-     * @param segment A pointer to a buffer containing the audio segment
-     * @return tsrt_status_code
+     * @return Capture_Stats
     */
-    tsrt_status_code preprocess_audio_segment(float* segment);
+    Capture_Stats get_capture_stats() const noexcept;
 
     /**
-     * @brief Check if the audio stream is running
+     * @brief Read in the next audio segment
      * 
-     * @return bool
+     * Only available when built with CAPTURE_MODE set to CAPTURE_BLOCKING.
+     * 
+     * @param segment A pointer to a buffer to store the audio segment
+     * @return tsrt_status_code 
     */
-    bool is_streaming() const noexcept;
+    tsrt_status_code read_audio_segment(float* segment, int segment_size);
 
     /**
-     * @brief Get the instance of Audio_tsrt
-     * 
-     * Exists to enforce singleton pattern.
+     * @brief Check if the audio stream is running
      * 
-     * @return Audio_tsrt& 
+     * @return bool
     */
-    static Audio_tsrt& get_instance();
+    bool is_streaming() const noexcept;
 
-    // delete copy and move constructors and assign operators to enforce singleton pattern
+    // the PortAudio callback holds a pointer to the instance, it must never move
     Audio_tsrt(Audio_tsrt const&) = delete;        // copy constructor
     Audio_tsrt(Audio_tsrt&&) = delete;             // move constructor
     void operator=(Audio_tsrt const&) = delete;    // copy assignment operator
     void operator=(Audio_tsrt&&) = delete;         // move assignment operator
 };
 
-#endif
\ No newline at end of file
+/**
+ * @brief An input device as an Audio_Source.
+ * 
+ * Live, the device paces capture and audio is dropped when the pipeline falls behind. With CAPTURE_MODE set to
+ * CAPTURE_CALLBACK the device buffers are copied into the capture ring buffer by Audio_tsrt's PortAudio callback, the
+ * source is callback driven and its session runs no recording thread for it. With CAPTURE_BLOCKING the recording thread
+ * reads each half segment with Pa_ReadStream.
+*/
+class Portaudio_Source : public Pull_Audio_Source {
+
+private:
+    std::unique_ptr<Audio_tsrt> audio_tsrt;
+
+protected:
+
+    size_t read_samples(float* destination, size_t count) override;
+
+public:
+
+    /**
+     * @brief Construct a new Portaudio_Source object
+     * 
+     * @param device The PortAudio index of the input device, paNoDevice for the default input device.
+    */
+    explicit Portaudio_Source(PaDeviceIndex device = paNoDevice);
+
+    tsrt_status_code start(Capture_Ring_Buffer& ring, Sample_Clock& clock) override;
+
+    tsrt_status_code stop() override;
+
+    bool produce() override;
+
+    bool is_live() const noexcept override;
+
+    bool is_callback_driven() const noexcept override;
+
+    const char* get_name() const noexcept override;
+
+    Source_Stats get_stats() const noexcept override;
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef audio_window_tsrt_h
+#define audio_window_tsrt_h
+
+#include "constants_config_tsrt.h"
+#include "sample_ring_tsrt.h"
+#include "segment_view_tsrt.h"
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief A read only view of a window's log mel features.
+ *
+ * @param data The first frame's row, each row MEL_BANDS log energies padded to MEL_ROW_FLOATS and aligned to
+ * SAMPLE_ALIGNMENT, the frames one after the other in timeline order.
+ * @param frames The number of frames, MEL_FRAMES_PER_WINDOW.
+*/
+struct Feature_View {
+    const float* data;
+    size_t frames;
+};
+
+/**
+ * @brief Represents a window of preprocessed audio handed to the analysis stages.
+ * 
+ * Audio_Window does not own its samples, they are a view into the engine's Sample_Ring and stay valid until every
+ * analysis stage has released the window. Overlapping windows share the same samples, nothing is copied. A stage that
+ * needs the samples after it released the window shares them first, see share().
+ * 
+ * @param samples A view of the window's samples.
+ * @param features The log mel features of the frames inside the window, computed once for every analysis stage and
+ * shared with the overlapping windows, a view into the session's Log_Mel_Extractor valid as long as the samples.
+ * @param start_sample The absolute index of the window's first sample on the capture timeline, see Sample_Clock.
+ * @param sequence The window's sequence number, a gap means windows were dropped.
+ * @param speech Whether voice activity detection found speech in the window, analyses that only make sense on speech
+ * skip the window if not.
+ * @param pins The session's pool of pins, see share().
+*/
+struct Audio_Window {
+    Sample_View samples;
+    Feature_View features;
+    uint64_t start_sample;
+    uint64_t sequence;
+    bool speech;
+    Window_Pins* pins;
+
+    /**
+     * @brief Shares the window's samples past its release.
+     *
+     * @details Must be called before the window is released from the audio ring buffer.
+     *
+     * @return Segment_View A reference counted view of the samples, empty if the session's pins are exhausted.
+    */
+    Segment_View share() const noexcept {
+        return pins != nullptr ? pins->pin(samples, start_sample) : Segment_View();
+    }
+};
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef batch_tsrt_h
+#define batch_tsrt_h
+
+#include "constants_config_tsrt.h"
+#include "exceptions_tsrt.h"
+#include "preprocessing_chain_tsrt.h"
+#include "status_codes_tsrt.h"
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The outcome of transcribing one file in batch mode.
+ *
+ * @param input The file transcribed.
+ * @param output The script written for it.
+ * @param status SUCCESS, or why the file failed.
+ * @param audio The duration of the audio in the file.
+ * @param latency The wall clock time from starting the file to its script being written.
+ * @param windows The number of analysis windows in the script.
+*/
+struct Batch_Result {
+    std::string input;
+    std::string output;
+    tsrt_status_code status;
+    std::chrono::duration<double> audio;
+    std::chrono::duration<double> latency;
+    size_t windows;
+};
+
+/**
+ * @brief Reads a batch list, one input path per line.
+ *
+ * @details Blank lines and lines starting with # are skipped.
+ *
+ * @param list_path The list to read.
+ * @return std::vector<std::string> The input paths.
+ * @throw Tsrt_Exception if the list can not be read.
+*/
+std::vector<std::string> read_batch_list(const std::string& list_path);
+
+/**
+ * @brief Gets where the script for an input is written.
+ *
+ * @details Under an output directory the input's relative path is kept, so files of the same name in different
+ * directories get scripts of their own. An absolute input, or one that leads out of the working directory, keeps its
+ * absolute path less the root.
+ *
+ * @param input The input path.
+ * @param output_dir The directory scripts are written to, empty to write each next to its input.
+ * @return std::string The input's path, under output_dir if there is one, with a .tsrt.tsv extension.
+*/
+std::string batch_output_path(const std::string& input, const std::string& output_dir);
+
+/**
+ * @brief Transcribes one file as a tbb::parallel_pipeline.
+ *
+ * @details The file is cut into chunks of BATCH_CHUNK_SAMPLES, with at most BATCH_TOKENS_PER_FILE in flight. Decoding and
+ * preprocessing are serial in order, since the decoder and the file's own filter graph carry state from one chunk to the
+ * next. The filter graph delays its output, so a chunk holds the filtered audio that came out while its samples went in,
+ * and one last chunk without input flushes the delay out. Each chunk starts with the filtered tail of the one before,
+ * so windows spanning the boundary are complete. The end of the file is padded to whole half segments, windows that
+ * start in the padding are left out and the last window ends at the file's last sample.
+ * The analyses of a chunk's windows do not depend on other chunks and run in parallel. Writing the script is serial in
+ * order again, so each file's script is in timeline order.
+ *
+ * @param input The file to transcribe.
+ * @param output Where to write its script.
+ * @param preprocessor_config The template the file's preprocessing chain is built from.
+ * @return Batch_Result Never throws, a failure is reported in the status.
+*/
+Batch_Result transcribe_file(const std::string& input, const std::string& output, const Preprocessor_Config& preprocessor_config) noexcept;
+
+/**
+ * @brief Transcribes many files at once.
+ *
+ * @details Files are spread over every TBB worker with tbb::parallel_for_each, each running its own pipeline, so the
+ * workers steal chunks from whichever files have work and every core stays busy. A file failing does not stop the batch.
+ * Each file builds its own preprocessing chain from the one config, so the files share no preprocessing state.
+ * Inputs whose scripts would be written to the same path, e.g. the same file listed twice, fail with INVALID_ARGUMENT
+ * before anything runs, all but the first of them.
+ *
+ * @param inputs The files to transcribe.
+ * @param output_dir The directory scripts are written to, empty to write each next to its input.
+ * @param preprocessor_config The template every file's preprocessing chain is built from.
+ * @return std::vector<Batch_Result> One result per input, in input order.
+*/
+std::vector<Batch_Result> run_batch(const std::vector<std::string>& inputs, const std::string& output_dir, const Preprocessor_Config& preprocessor_config = Preprocessor_Config());
+
+#endif // batch_tsrt_h
@@ -0,0 +1,429 @@
+#ifndef broadcast_ring_buffer_tsrt_h
+#define broadcast_ring_buffer_tsrt_h
+
+#include "audio_window_tsrt.h"
+#include "constants_config_tsrt.h"
+#include "exceptions_tsrt.h"
+#include "ring_buffer_tsrt.h"
+#include "status_codes_tsrt.h"
+#include "wait_strategy_tsrt.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+/**
+ * @brief A lock-free single producer, multiple consumer broadcast ring buffer.
+ *
+ * @details Every registered consumer sees every element. The producer owns a single head sequence and each consumer owns
+ * its own read cursor, each on its own cache line. Consumers read elements in place through peek() and hand the slot back
+ * with release(), so all consumers share the same memory instead of receiving copies.
+ * @details A slot can only be reused once the slowest consumer has released it. The producer caches the slowest cursor and
+ * only rescans the consumer cursors when the cached value says the buffer is full. It then rejects the new element, blocks
+ * until the slowest consumer catches up or overwrites the oldest element, see overflow_policy.
+ * @details To overwrite, the producer moves every consumer a full buffer behind past the oldest slot, see Tail_Cursor. A
+ * consumer holds the slots it peeked until it releases them, if one holds the oldest slot the new element is rejected
+ * instead. If a consumer starts holding it while the others are moved, only the others lose it.
+ * @details Dropped and overwritten elements are counted by the producer. The high water occupancy, as seen by the slowest consumer, is sampled
+ * whenever a consumer reloads head.
+ *
+ * @note Exactly one thread may use the producer side (claim(), commit(), push()). Each consumer id may only be used by one thread.
+ * @note Consumers must be registered before the producer starts pushing.
+ *
+ * @tparam T The type of the elements stored in the buffer.
+ * @tparam Size The capacity of the buffer. Must be greater than 0. Used to compile time check for size being power of 2.
+ * @tparam MaxConsumers The maximum number of consumers that can be registered.
+ * @tparam Overflow What claim() and push() do when the buffer is full.
+ * @tparam Wait_Strategy How wait_peek(), a consumer task about to park and a blocked producer wait for the other side,
+ * see wait_strategy_tsrt.h.
+ */
+template <typename T, size_t Size = 1, size_t MaxConsumers = 1, overflow_policy Overflow = DROP_NEWEST, typename Wait_Strategy = Pipeline_Wait_Strategy>
+class Broadcast_Ring_Buffer {
+private:
+    // Written by the producer, read by the consumers
+    struct alignas(CACHE_LINE_SIZE) Producer_Cursor {
+        std::atomic<size_t> head{0};
+        size_t cached_min_tail{0};
+        std::atomic<size_t> dropped{0};
+        std::atomic<size_t> overwritten{0};
+    };
+
+    // Written by one consumer, read by the producer, which also moves it to overwrite
+    struct alignas(CACHE_LINE_SIZE) Consumer_Cursor {
+        Tail_Cursor<Overflow == OVERWRITE_OLDEST> tail;
+        size_t cached_head{0};
+    };
+
+    Producer_Cursor producer;
+    std::array<Consumer_Cursor, MaxConsumers> consumers;
+    alignas(CACHE_LINE_SIZE) Wait_Strategy waiter;
+    alignas(CACHE_LINE_SIZE) std::conditional_t<Overflow == BLOCK_PRODUCER, Wait_Strategy, std::nullptr_t> space_waiter;
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> high_water{0};
+    size_t consumer_count;
+    std::unique_ptr<T[]> buffer;
+
+    static_assert(Size > 0, "Ring buffer size must be greater than 0");
+    static_assert(MaxConsumers > 0, "Broadcast ring buffer must allow at least one consumer");
+    static_assert(std::atomic<size_t>::is_always_lock_free, "Broadcast_Ring_Buffer requires lock free size_t atomics");
+
+    /**
+     * @brief Wraps the given counter around the buffer.
+     *
+     * @details If the buffer size is a power of two, it uses the bitwise and optimization.
+     *
+     * @param index The counter to wrap around the buffer.
+     * @return The wrapped index.
+    */
+    size_t wrap_index(const size_t index) const noexcept {
+        if constexpr (is_power_of_two(Size))
+            return index & (Size - 1);
+        else
+            return index % Size;
+    }
+
+    /**
+     * @brief Finds the cursor of the slowest registered consumer.
+     *
+     * @param head The current head, returned when no consumers are registered.
+     * @return The smallest consumer tail.
+    */
+    size_t min_tail(const size_t head) const noexcept {
+        size_t slowest = head;
+        for (size_t i = 0; i < consumer_count; ++i) {
+            const size_t tail = consumers[i].tail.load(std::memory_order_acquire);
+            if (tail < slowest)
+                slowest = tail;
+        }
+        return slowest;
+    }
+
+    /**
+     * @brief Rescans the consumer cursors and checks if there is a free slot, blocking for one or evicting the oldest element
+     * if the overflow policy says to.
+     *
+     * @param head The producer's head.
+     * @return True if the slot at head is free.
+    */
+    bool wait_for_room(const size_t head) noexcept(Overflow != BLOCK_PRODUCER) {
+        auto has_room = [&]() {
+            producer.cached_min_tail = min_tail(head);
+            return head - producer.cached_min_tail != Size;
+        };
+
+        if constexpr (Overflow == BLOCK_PRODUCER) {
+            return space_waiter.wait(has_room, std::chrono::milliseconds(PRODUCER_BLOCK_TIMEOUT_MS));
+        } else if constexpr (Overflow == OVERWRITE_OLDEST) {
+            if (has_room())
+                return true;
+            const size_t oldest = head - Size;
+            // a consumer reading the oldest element keeps it, checked first so the others do not lose it for nothing
+            for (size_t i = 0; i < consumer_count; ++i) {
+                if (consumers[i].tail.load(std::memory_order_acquire) == oldest && consumers[i].tail.held())
+                    return false;
+            }
+            bool evicted = false;
+            for (size_t i = 0; i < consumer_count; ++i)
+                evicted |= consumers[i].tail.evict(oldest);
+            if (evicted)
+                producer.overwritten.store(producer.overwritten.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return has_room();
+        } else {
+            return has_room();
+        }
+    }
+
+    /**
+     * @brief Gets the number of values a consumer can read from the given tail, reloading head when the cached one says
+     * there are fewer than wanted.
+     *
+     * @param cursor The consumer's cursor.
+     * @param tail The consumer's tail.
+     * @param wanted The number of values the consumer wants.
+     * @return The number of readable values, at most wanted.
+    */
+    size_t readable(Consumer_Cursor& cursor, const size_t tail, const size_t wanted) noexcept {
+        // the producer may have evicted past the cached head
+        if (cursor.cached_head < tail + wanted) {
+            cursor.cached_head = producer.head.load(std::memory_order_acquire);
+            if (cursor.cached_head == tail)
+                return 0;
+            update_high_water(high_water, cursor.cached_head - tail);
+        }
+        return std::min(wanted, cursor.cached_head - tail);
+    }
+
+public:
+    Broadcast_Ring_Buffer() : consumer_count(0), buffer(std::make_unique<T[]>(Size)) {}
+
+    /**
+     * @brief Constructs the ring buffer with every slot preallocated as a copy of the prototype.
+     *
+     * @details Used with claim() and commit() so the producer writes into storage allocated up front.
+     *
+     * @param prototype The value every slot is copied from.
+    */
+    explicit Broadcast_Ring_Buffer(const T& prototype) : consumer_count(0), buffer(std::make_unique<T[]>(Size)) {
+        for (size_t i = 0; i < Size; ++i)
+            buffer[i] = prototype;
+    }
+
+    // Copy and move are deleted because the cursors are shared between threads
+    Broadcast_Ring_Buffer(const Broadcast_Ring_Buffer&) = delete;
+    Broadcast_Ring_Buffer& operator=(const Broadcast_Ring_Buffer&) = delete;
+    Broadcast_Ring_Buffer(Broadcast_Ring_Buffer&&) = delete;
+    Broadcast_Ring_Buffer& operator=(Broadcast_Ring_Buffer&&) = delete;
+
+    /**
+     * @brief Registers a new consumer.
+     *
+     * @details The consumer starts reading at the next element pushed.
+     *
+     * @note Not thread safe, must be called before the producer starts pushing.
+     *
+     * @return The id the consumer passes to peek() and release().
+     * @throw Tsrt_Exception if MaxConsumers consumers are already registered.
+    */
+    size_t register_consumer() {
+        if (consumer_count == MaxConsumers)
+            throw Tsrt_Exception(OUT_OF_RANGE_ERROR, "Broadcast ring buffer consumer limit reached", std::chrono::system_clock::now(), __FILE__, __LINE__);
+
+        const size_t head = producer.head.load(std::memory_order_relaxed);
+        consumers[consumer_count].tail.reset(head);
+        consumers[consumer_count].cached_head = head;
+        return consumer_count++;
+    }
+
+    /**
+     * @brief Claims the next free slot for writing in place.
+     *
+     * @details Producer side only. The slot is not visible to the consumers until commit() is called.
+     *
+     * @return A pointer to the claimed slot, or nullptr if the slowest consumer is a full buffer behind and the element has to be dropped.
+     * With OVERWRITE_OLDEST the slot of the oldest element, which the consumers no longer see, when the buffer is full.
+    */
+    T* claim() noexcept(Overflow != BLOCK_PRODUCER) {
+        const size_t head = producer.head.load(std::memory_order_relaxed);
+        if (head - producer.cached_min_tail == Size && !wait_for_room(head)) {
+            producer.dropped.store(producer.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        return &buffer[wrap_index(head)];
+    }
+
+    /**
+     * @brief Publishes the slot returned by the last claim() to every consumer.
+     *
+     * @details Producer side only.
+    */
+    void commit() noexcept {
+        // stamped before the store, so a consumer seeing the new head measures from this publish
+        waiter.stamp_publish();
+        producer.head.store(producer.head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        waiter.notify();
+    }
+
+    /**
+     * @brief Pushes the given value to the ring buffer.
+     *
+     * @details Producer side only.
+     *
+     * @param value The value to push to the ring buffer.
+     * @return True if the value was pushed, possibly over the oldest value, false if the slowest consumer was a full buffer
+     * behind and the value was dropped.
+    */
+    bool push(T value) noexcept(Overflow != BLOCK_PRODUCER) {
+        T* slot = claim();
+        if (slot == nullptr)
+            return false;
+
+        *slot = std::move(value);
+        commit();
+        return true;
+    }
+
+    /**
+     * @brief Gets the oldest value that at least one consumer has not released yet.
+     *
+     * @details Producer side only. Rescans the consumer cursors, so it is meant to be called once per batch of pushes,
+     * e.g. to check that memory the values refer to is no longer in use before reusing it.
+     *
+     * @return A pointer to the oldest unreleased value, or nullptr if every consumer has released everything.
+    */
+    const T* oldest_unreleased() noexcept {
+        const size_t head = producer.head.load(std::memory_order_relaxed);
+        producer.cached_min_tail = min_tail(head);
+        if (producer.cached_min_tail == head)
+            return nullptr;
+        return &buffer[wrap_index(producer.cached_min_tail)];
+    }
+
+    /**
+     * @brief Gets the number of values that can be pushed before the slowest consumer is a full buffer behind.
+     *
+     * @details Producer side only. Rescans the consumer cursors, so it is meant to be called once per batch of pushes,
+     * e.g. to hold a batch back rather than drop part of it.
+     *
+     * @return The number of free slots.
+    */
+    size_t free_slots() noexcept {
+        const size_t head = producer.head.load(std::memory_order_relaxed);
+        producer.cached_min_tail = min_tail(head);
+        return Size - (head - producer.cached_min_tail);
+    }
+
+    /**
+     * @brief Gets the next unread value for the given consumer without removing it.
+     *
+     * @details The value stays valid, and is not overwritten by the producer, until the consumer calls release().
+     *
+     * @param consumer The id returned by register_consumer().
+     * @return A pointer to the next value, or nullptr if the consumer has read everything pushed so far.
+    */
+    const T* peek(const size_t consumer) noexcept {
+        Consumer_Cursor& cursor = consumers[consumer];
+        const auto [tail, count] = cursor.tail.hold([&](const size_t from) { return readable(cursor, from, 1); });
+        if (count == 0)
+            return nullptr;
+        return &buffer[wrap_index(tail)];
+    }
+
+    /**
+     * @brief Gets up to max_count unread values for the given consumer without removing them.
+     *
+     * @details Lets a consumer that fell behind catch up, or batch its work, with one acquire load. The values stay valid
+     * until the consumer calls release_n().
+     *
+     * @param consumer The id returned by register_consumer().
+     * @param max_count The maximum number of values to get.
+     * @return The values in at most two contiguous runs, empty if the consumer has read everything pushed so far.
+    */
+    Slot_Runs<const T> peek_n(const size_t consumer, const size_t max_count) noexcept {
+        Consumer_Cursor& cursor = consumers[consumer];
+        const auto [tail, count] = cursor.tail.hold([&](const size_t from) { return readable(cursor, from, max_count); });
+        const size_t start = wrap_index(tail);
+        const size_t first_size = std::min(count, Size - start);
+        return Slot_Runs<const T>{&buffer[start], first_size, &buffer[0], count - first_size};
+    }
+
+    /**
+     * @brief Marks the first count values returned by the last peek_n() as read by the given consumer.
+     *
+     * @param consumer The id returned by register_consumer().
+     * @param count The number of values to release.
+    */
+    void release_n(const size_t consumer, const size_t count) noexcept {
+        Consumer_Cursor& cursor = consumers[consumer];
+        if constexpr (Overflow == BLOCK_PRODUCER)
+            space_waiter.stamp_publish();
+        cursor.tail.release(count);
+        if constexpr (Overflow == BLOCK_PRODUCER)
+            space_waiter.notify();
+    }
+
+    /**
+     * @brief Gets the next unread value for the given consumer, waiting for the producer if there is none.
+     *
+     * @details Wakes as soon as the producer commits, how depends on Wait_Strategy.
+     *
+     * @param consumer The id returned by register_consumer().
+     * @param timeout The longest time to wait.
+     * @return A pointer to the next value, or nullptr if the timeout expired.
+    */
+    const T* wait_peek(const size_t consumer, const std::chrono::nanoseconds timeout) {
+        const T* slot = nullptr;
+        waiter.wait([&]() { return (slot = peek(consumer)) != nullptr; }, timeout);
+        return slot;
+    }
+
+    /**
+     * @brief Has every commit() wake the given consumer task, for consumers run as tasks rather than by a waiting thread.
+     *
+     * @details Must be called before the producer starts, see Wake_Target.
+     *
+     * @param target The consumer's task, nullptr for none.
+    */
+    void set_wake_target(Wake_Target* target) noexcept {
+        waiter.set_wake_target(target);
+    }
+
+    /**
+     * @brief Keeps a consumer task that ran out of work on its worker for a while before it parks.
+     *
+     * @details Consumer side only. How long depends on Wait_Strategy, a blocking one parks at once.
+     *
+     * @param ready Predicate checking if the task has been woken.
+     * @return True if ready() returned true, false to park.
+    */
+    template <typename Predicate>
+    bool linger(Predicate ready) noexcept {
+        return waiter.linger(ready);
+    }
+
+    /**
+     * @brief Records the time from the last commit() to now as a wakeup, for a consumer task a commit resumed.
+     *
+     * @details Consumer side only.
+    */
+    void record_wakeup() noexcept {
+        waiter.record_wakeup();
+    }
+
+    /**
+     * @brief Marks the value returned by the last peek() as read by the given consumer.
+     *
+     * @param consumer The id returned by register_consumer().
+    */
+    void release(const size_t consumer) noexcept {
+        Consumer_Cursor& cursor = consumers[consumer];
+        if constexpr (Overflow == BLOCK_PRODUCER)
+            space_waiter.stamp_publish();
+        cursor.tail.release(1);
+        if constexpr (Overflow == BLOCK_PRODUCER)
+            space_waiter.notify();
+    }
+
+    /**
+     * @brief Gets the number of registered consumers.
+     *
+     * @return The number of registered consumers.
+    */
+    size_t get_consumer_count() const noexcept {
+        return consumer_count;
+    }
+
+    /**
+     * @brief Gets the overwritten and dropped element counts and high water occupancy.
+     *
+     * @return Ring_Buffer_Stats
+    */
+    Ring_Buffer_Stats get_stats() const noexcept {
+        return Ring_Buffer_Stats{producer.overwritten.load(std::memory_order_relaxed), producer.dropped.load(std::memory_order_relaxed),
+                                 high_water.load(std::memory_order_relaxed)};
+    }
+
+    /**
+     * @brief Gets how long consumers took to wake up after a commit.
+     *
+     * @return Wakeup_Latency
+    */
+    Wakeup_Latency get_wakeup_latency() const noexcept {
+        return waiter.get_wakeup_latency();
+    }
+
+    /**
+     * @brief Gets the size of the ring buffer.
+     *
+     * @return The size of the ring buffer.
+    */
+    size_t get_size() const noexcept {
+        return Size;
+    }
+};
+
+template class Broadcast_Ring_Buffer<Audio_Window, AUDIO_BUFFER_SIZE, ANALYSIS_STAGE_COUNT, ANALYSIS_OVERFLOW_POLICY>;
+
+#endif // broadcast_ring_buffer_tsrt_h
@@ -5,6 +5,28 @@
 
 // General constants
 #define THREAD_SLEEP_MS 5
+constexpr size_t CACHE_LINE_SIZE = 64; // bytes, used to keep cursors written by different threads apart
+constexpr size_t SAMPLE_ALIGNMENT = 64; // bytes, one AVX-512 vector, sample buffers start and are padded to this
+constexpr size_t SIMD_FLOATS = SAMPLE_ALIGNMENT / sizeof(float); // samples per aligned block
+
+// Pipeline wait strategies, select one at build time with -DPIPELINE_WAIT_STRATEGY=<strategy>
+#define WAIT_BUSY_SPIN 0 // lowest wakeup latency, burns a core per waiting stage
+#define WAIT_YIELD 1     // spins briefly, then yields the core between checks
+#define WAIT_BLOCK 2     // parks on a condition variable, no CPU while idle
+#define WAIT_SLEEP 3     // spins briefly, then sleeps WAIT_SLEEP_US between checks, the producer never locks
+#ifndef PIPELINE_WAIT_STRATEGY
+#define PIPELINE_WAIT_STRATEGY WAIT_BLOCK
+#endif
+constexpr size_t WAIT_SPIN_ITERATIONS = 64; // spins before yielding or checking the clock, use power of 2
+constexpr int WAIT_SLEEP_US = 500; // bounds the wakeup latency of WAIT_SLEEP
+constexpr int WAIT_LINGER_US = 50; // how long WAIT_BUSY_SPIN and WAIT_YIELD keep a consumer task that ran dry on its worker before it parks
+
+// Capture modes, select one at build time with -DCAPTURE_MODE=<mode>
+#define CAPTURE_BLOCKING 0 // a recording thread blocks in Pa_ReadStream for every half segment
+#define CAPTURE_CALLBACK 1 // the PortAudio callback copies each device buffer straight into the capture ring buffer
+#ifndef CAPTURE_MODE
+#define CAPTURE_MODE CAPTURE_CALLBACK
+#endif
 
 // Audio constants
 constexpr int SAMPLE_RATE = 16000;
@@ -13,17 +35,101 @@ constexpr int MS_PER_SEC = 1000;
 constexpr float MS_PER_SEC_F = 1000.0f;
 constexpr int SAMPLES_PER_SEGMENT = SAMPLE_RATE / MS_PER_SEC * SEGMENT_DURATION; // maintain this ordering of operations to avoid truncation
 constexpr int SAMPLES_PER_HALF_SEGMENT = SAMPLES_PER_SEGMENT / 2;
+static_assert(SAMPLES_PER_HALF_SEGMENT % SIMD_FLOATS == 0, "Half segments must be whole SIMD blocks so segment midpoints stay aligned");
 
 // Ring buffer constants
+// What a producer does when its ring buffer is full
+enum overflow_policy {
+    OVERWRITE_OLDEST, // lossy, the oldest unread element is replaced, or the newest discarded while a consumer reads the oldest
+    DROP_NEWEST,      // lossy, the element being pushed is discarded
+    BLOCK_PRODUCER,   // backpressure, the producer waits up to PRODUCER_BLOCK_TIMEOUT_MS, then drops the newest
+};
 constexpr size_t AUDIO_BUFFER_SIZE = 16; // half segments of audio, use power of 2 for faster wrap around case
+constexpr size_t ANALYSIS_STAGE_COUNT = 4; // speech recognition, diarization, speaker identification, emotion recognition
+constexpr size_t ANALYSIS_MAX_BATCH = AUDIO_BUFFER_SIZE; // windows an analysis stage takes from its queue at once
+constexpr int PRODUCER_BLOCK_TIMEOUT_MS = SEGMENT_DURATION / 2; // one half segment, after that the next one is due
+constexpr overflow_policy CAPTURE_OVERFLOW_POLICY = DROP_NEWEST;  // recording -> preprocessing
+constexpr overflow_policy ANALYSIS_OVERFLOW_POLICY = DROP_NEWEST; // preprocessing -> analysis stages
+
+// Session constants
+constexpr size_t SESSION_POLL_SEGMENTS = 4; // half segments a session takes per poll, bounds how long it holds a worker
+
+// Segment pool constants
+// The pool grows by one chunk per session opened, buffers for every half segment slot in the capture ring buffer,
+// the recorder's overflow segment and headroom for popped copies. Nothing in the pipeline holds full segments, windows
+// are views into the sample ring, so they are not pooled
+constexpr size_t HALF_SEGMENT_POOL_CHUNK = 4 * AUDIO_BUFFER_SIZE;
+constexpr size_t SEGMENT_POOL_MAX_SESSIONS = 4096; // sessions the pool grows for, bounds the chunk table, more fall back to the heap
+
+// Analysis window constants
+// Windows are views into the sample ring, any overlap ratio is just a different hop
+constexpr size_t WINDOW_LENGTH = SAMPLES_PER_SEGMENT;
+constexpr size_t WINDOW_HOP = SAMPLES_PER_HALF_SEGMENT; // 50% overlap
+static_assert(WINDOW_HOP % SIMD_FLOATS == 0, "Window hop must be whole SIMD blocks so every window view starts aligned");
+// Every window queued in the audio ring buffer, the window being filled and one incoming half segment
+constexpr size_t SAMPLE_RING_CAPACITY = WINDOW_LENGTH + AUDIO_BUFFER_SIZE * WINDOW_HOP + SAMPLES_PER_HALF_SEGMENT;
+constexpr size_t WINDOW_PIN_CAPACITY = ANALYSIS_STAGE_COUNT * AUDIO_BUFFER_SIZE; // windows a session's analyses can share past their release at once
 
-// AVLib filter graph constants
+// Batch mode constants
+constexpr size_t BATCH_CHUNK_HALF_SEGMENTS = 40; // half segments per pipeline token, 1 second of audio
+constexpr size_t BATCH_CHUNK_SAMPLES = BATCH_CHUNK_HALF_SEGMENTS * SAMPLES_PER_HALF_SEGMENT;
+constexpr size_t BATCH_TOKENS_PER_FILE = 4; // chunks of one file in flight at once, bounds memory per file
+
+// Synthetic audio source constants, fixed seeds keep runs repeatable
+constexpr float SYNTHETIC_AMPLITUDE = 0.5f;
+constexpr unsigned int SYNTHETIC_NOISE_SEED = 16000;
+constexpr unsigned int SYNTHETIC_JITTER_SEED = 800;
+
+// AVLib filter graph constants, the default preprocessing chain, see Preprocessor_Config
 constexpr const char* SRC_SAMPLE_FMT = "flt";
 constexpr const char* SRC_CHANNEL_LAYOUT = "mono";
 constexpr int BANDPASS_F = 1700;
-constexpr int BANDPASS_W = 3100;
+constexpr int BANDPASS_W = 3100; // Hz, the band is BANDPASS_F +- BANDPASS_W / 2
 constexpr float AFFTDN_NR = 0.3f;
 constexpr int AFFTDN_NF = -50;
+// Input segments the filter graph may hold on to at once, the capture ring buffer and many times the graph's delay
+constexpr size_t PREPROCESS_MAX_HELD_INPUTS = 2 * AUDIO_BUFFER_SIZE;
+constexpr int PREPROCESS_SPEC_POLL_MS = 1000; // how often the file given with --preprocess-file is checked for a new chain
+
+// Native preprocessing constants, see Native_Preprocessor_tsrt
+constexpr size_t BIQUAD_BLOCK_SAMPLES = SIMD_FLOATS; // samples a vectorized biquad computes at once, the widest vector
+constexpr size_t DENOISE_FRAME_SAMPLES = 256; // STFT frame of the spectral denoiser, 16 ms, also the delay it adds
+constexpr size_t DENOISE_HOP_SAMPLES = DENOISE_FRAME_SAMPLES / 2; // 50% overlap, the sqrt Hann windows then sum to one
+constexpr size_t DENOISE_BINS = DENOISE_FRAME_SAMPLES / 2 + 1;
+constexpr float DENOISE_NOISE_RISE = 0.995f; // per frame smoothing of the noise estimate under speech, slow so speech is not learnt as noise
+constexpr float DENOISE_NOISE_FALL = 0.9f; // per frame smoothing of the noise estimate when the spectrum drops below it
+constexpr float DENOISE_OVERSUBTRACTION = 3.0f; // the estimate settles near the noise's lower quantiles, this scales it back up to its mean
+constexpr float DENOISE_BYPASS_SNR_DB = 25.0f; // a denoiser stops filtering once its SNR estimate is above this, the spec's bypass option
+constexpr float DENOISE_BYPASS_HYSTERESIS_DB = 6.0f; // and filters again once the estimate drops this far below it
+constexpr size_t DENOISE_BYPASS_HOLD_HOPS = 125; // 1 s, the least time between switches, so the denoiser does not flap
+constexpr float DENOISE_SNR_NOISE_RISE_DB = 0.025f; // per hop the noise level creeps up by, 3 dB a second, it drops to any quieter hop at once
+constexpr float DENOISE_SNR_LEVEL_FALL_DB = 0.01f; // per hop the signal level decays by, 1.25 dB a second, it rises to any louder hop at once
+static_assert(DENOISE_FRAME_SAMPLES % SIMD_FLOATS == 0, "Denoiser frames must be whole SIMD blocks");
+
+// Voice activity detection constants, see Voice_Activity_Detector
+constexpr size_t VAD_FRAME_SAMPLES = 256; // 16 ms, frames are classified one after the other, without overlap
+constexpr int VAD_LOW_HZ = 200;   // spectral flatness is measured over the speech band, inside the default band pass
+constexpr int VAD_HIGH_HZ = 3200;
+constexpr float VAD_MIN_ENERGY_DB = -60.0f; // dBFS, quieter frames are never speech, also where the noise estimate starts
+constexpr float VAD_ENERGY_MARGIN_DB = 9.0f; // how far above the noise estimate a frame must be to be speech
+constexpr float VAD_NOISE_RISE_DB = 0.05f; // per frame the noise estimate creeps up by, 3 dB a second, it drops to any quieter frame at once
+constexpr float VAD_FLATNESS_MAX = 0.3f; // voiced speech is harmonic, white noise has a flatness of 1
+constexpr float VAD_CROSSING_RATE_MAX = 0.12f; // zero crossings per sample, voice is dominated by its low formants, hiss and band passed noise cross more often
+constexpr size_t VAD_HANGOVER_FRAMES = 20; // 320 ms, frames after speech still counted as speech so word endings and short pauses are kept
+static_assert(VAD_FRAME_SAMPLES % SIMD_FLOATS == 0, "Voice activity frames must be whole SIMD blocks");
+
+// Log mel feature constants, see Log_Mel_Extractor
+constexpr size_t MEL_FRAME_SAMPLES = 400; // 25 ms STFT frames, as speech models expect
+constexpr size_t MEL_FFT_SAMPLES = MEL_FRAME_SAMPLES; // the FFT takes the frame as is, see Fft_Plan, no zero padding
+constexpr size_t MEL_HOP_SAMPLES = 80;    // 5 ms, a divisor of WINDOW_HOP so every window starts on a frame
+constexpr size_t MEL_BANDS = 40;
+constexpr size_t MEL_ROW_FLOATS = (MEL_BANDS + SIMD_FLOATS - 1) / SIMD_FLOATS * SIMD_FLOATS; // a frame's bands, padded to whole SIMD blocks
+constexpr int MEL_LOW_HZ = 20;
+constexpr int MEL_HIGH_HZ = SAMPLE_RATE / 2;
+constexpr float MEL_LOG_FLOOR = 1e-10f; // the least band energy the log is taken of, so silence is finite
+constexpr size_t MEL_FRAMES_PER_WINDOW = (WINDOW_LENGTH - MEL_FRAME_SAMPLES) / MEL_HOP_SAMPLES + 1; // the frames inside a window
+static_assert(WINDOW_HOP % MEL_HOP_SAMPLES == 0, "Windows must start on a frame, so overlapping windows share their frames");
+static_assert(MEL_FRAME_SAMPLES % SIMD_FLOATS == 0 && MEL_FRAME_SAMPLES <= MEL_FFT_SAMPLES, "Mel frames must be whole SIMD blocks that fit the FFT");
 
 // Speaker ID constants
 constexpr int VOCAL_EMBEDDINGS_SIZE = 512;
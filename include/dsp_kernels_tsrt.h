@@ -0,0 +1,160 @@
+#ifndef dsp_kernels_tsrt_h
+#define dsp_kernels_tsrt_h
+
+#include "constants_config_tsrt.h"
+
+#include <cstddef>
+
+// Instruction sets the DSP kernels are built for, the best one the CPU supports is picked at startup
+enum dsp_isa {
+    DSP_SCALAR,
+    DSP_AVX2,   // AVX2 and FMA, 8 samples per vector
+    DSP_AVX512, // AVX-512F, 16 samples per vector
+};
+constexpr size_t DSP_ISA_COUNT = 3;
+
+/**
+ * @brief One second order section of an IIR filter, in transposed direct form II, with its state.
+ *
+ * @details A biquad's recursion is serial, so the vector kernels do not vectorize it sample by sample. The output of a
+ * block of BIQUAD_BLOCK_SAMPLES samples is linear in the block's inputs and the two state values it starts from, so it is
+ * precomputed as a matrix of responses: response[k] is the block's output for a unit input at sample k, response[
+ * BIQUAD_BLOCK_SAMPLES] and response[BIQUAD_BLOCK_SAMPLES + 1] its output for a unit state. A block is then one
+ * broadcast multiply add per input and state, and a narrower vector uses the leading rows and columns.
+ *
+ * @param response The block response matrix, filled by init_biquad_section().
+ * @param b0, b1, b2 The feed forward coefficients, normalized by a0.
+ * @param a1, a2 The feedback coefficients, normalized by a0.
+ * @param s1, s2 The state carried from one call to the next.
+*/
+struct alignas(SAMPLE_ALIGNMENT) Biquad_Section {
+    float response[BIQUAD_BLOCK_SAMPLES + 2][BIQUAD_BLOCK_SAMPLES];
+    float b0, b1, b2;
+    float a1, a2;
+    float s1, s2;
+};
+
+/**
+ * @brief Sets a section's coefficients, clears its state and precomputes its block response matrix.
+ *
+ * @param section The section.
+ * @param b0, b1, b2, a0, a1, a2 The coefficients, as in H(z) = (b0 + b1 z^-1 + b2 z^-2) / (a0 + a1 z^-1 + a2 z^-2).
+*/
+void init_biquad_section(Biquad_Section& section, double b0, double b1, double b2, double a0, double a1, double a2) noexcept;
+
+/**
+ * @brief The parameters of spectral subtraction, per bin of an unnormalized spectrum.
+ *
+ * @param noise_floor The lowest the noise estimate goes, in power.
+ * @param min_gain_squared The most a bin is attenuated, as a squared gain.
+ * @param noise_rise The smoothing of the noise estimate when a bin's power is above it.
+ * @param noise_fall The smoothing of the noise estimate when a bin's power is below it.
+ * @param oversubtraction How many times the noise estimate is subtracted.
+*/
+struct Spectral_Subtraction {
+    float noise_floor;
+    float min_gain_squared;
+    float noise_rise;
+    float noise_fall;
+    float oversubtraction;
+};
+
+/**
+ * @brief One pass of a mixed radix Stockham FFT, see Fft_Plan.
+ *
+ * @details A pass of a transform of n = radix * m complex values at stride s, n * s the transform's size, runs a
+ * butterfly for every p < m: for every q < s it reads radix values m * s apart, x[q + s * (p + j * m)] for j < radix,
+ * takes their DFT and multiplies output k by w^(p * k), w = exp(-2 pi i / n), writing it to y[q + s * (radix * p + k)].
+ * The next pass is one of m at stride s * radix, and after the last, of 1, y holds the transform in order.
+ * @details The s values of a butterfly's run share its twiddles and are contiguous, so the vector kernels run over q
+ * where the runs are at least a vector long, the later passes, and over the runs of neighbouring butterflies where they
+ * are shorter, the first passes.
+ *
+ * @param radix 2, 3, 4 or 5.
+ * @param m The butterflies, n / radix, also the distance between the inputs of one in runs.
+ * @param stride s.
+ * @param twiddles w^(p * k) as interleaved complex values, a row of m for each k from 1, at twiddles + 2 * ((k - 1) * m + p).
+*/
+struct Fft_Pass {
+    size_t radix;
+    size_t m;
+    size_t stride;
+    const float* twiddles;
+};
+
+// log2(1 + t) ~ t * (c0 + c1 t + ... + c5 t^5) for t in [0, 1), a least squares fit within 5e-6, how the vector kernels
+// take the log2 of a mantissa
+constexpr float LOG2_POLYNOMIAL[6] = {1.44251696f, -0.71789728f, 0.45688866f, -0.27735293f, 0.12190201f, -0.02606180f};
+constexpr float LN_2 = 0.693147180559945f;
+
+// The roots of unity the radix 3 and 5 FFT butterflies are built from, cos and sin of 2 pi / 3, 2 pi / 5 and 4 pi / 5
+constexpr float FFT_SIN_2PI_3 = 0.866025403784439f;
+constexpr float FFT_COS_2PI_5 = 0.309016994374947f;
+constexpr float FFT_SIN_2PI_5 = 0.951056516295154f;
+constexpr float FFT_COS_4PI_5 = -0.809016994374947f;
+constexpr float FFT_SIN_4PI_5 = 0.587785252292473f;
+
+/**
+ * @brief The DSP kernels built for one instruction set.
+ *
+ * @details Buffers passed to multiply(), multiply_add(), spectral_subtract(), power_spectrum() and log_floor() are
+ * aligned to SAMPLE_ALIGNMENT and their counts are whole SIMD_FLOATS blocks, see Aligned_Samples. biquad() takes any
+ * buffer and count, it runs in place on segment memory, and so do energy_crossings(), log_power_sum() and dot(), which
+ * only read. fft_pass(), fft_split() and fft_merge() take any buffers of interleaved complex values, the input and output must not
+ * overlap.
+ * @details The vector kernels approximate logarithms with a polynomial, within 1e-5 of the scalar kernels' std::log2
+ * and std::log.
+ *
+ * @param name The instruction set's name, for logging and benchmarks.
+ * @param biquad Filters samples in place through one section, carrying its state.
+ * @param multiply Sets destination[i] = a[i] * b[i].
+ * @param multiply_add Sets accumulator[i] += a[i] * b[i].
+ * @param spectral_subtract Updates noise[i] from the power of interleaved complex bin i of spectrum and attenuates the bin.
+ * @param energy_crossings Sums the squares of the samples and counts the sign changes between neighbouring samples.
+ * @param log_power_sum Sums the power of interleaved complex bins and the log2 of the power, each power at least floor.
+ * @param power_spectrum Sets power[i] to the power of interleaved complex bin i of spectrum.
+ * @param dot Returns the sum of a[i] * b[i].
+ * @param log_floor Sets values[i] to the natural log of values[i], at least floor.
+ * @param fft_pass Runs the butterflies from first to last of one pass of an FFT, from input to output.
+ * @param fft_split Sets bins first to last of a real FFT's spectrum, 0 < first and last <= n, from the complex FFT Z of
+ * its n even and odd sample pairs and the twiddles exp(-2 pi i k / 2n), see Real_Fft.
+ * @param fft_merge Sets Z[k] for k from first to last, 0 < first and last <= n, conjugated, from the spectrum and twiddles.
+*/
+struct Dsp_Kernels {
+    const char* name;
+    void (*biquad)(Biquad_Section& section, float* samples, size_t count);
+    void (*multiply)(float* destination, const float* a, const float* b, size_t count);
+    void (*multiply_add)(float* accumulator, const float* a, const float* b, size_t count);
+    void (*spectral_subtract)(float* spectrum, float* noise, size_t bins, const Spectral_Subtraction& params);
+    void (*energy_crossings)(const float* samples, size_t count, float& energy, size_t& crossings);
+    void (*log_power_sum)(const float* spectrum, size_t bins, float floor, float& power, float& log_power);
+    void (*power_spectrum)(float* power, const float* spectrum, size_t bins);
+    float (*dot)(const float* a, const float* b, size_t count);
+    void (*log_floor)(float* values, size_t count, float floor);
+    void (*fft_pass)(const Fft_Pass& pass, size_t first, size_t last, const float* input, float* output);
+    void (*fft_split)(float* spectrum, const float* z, const float* twiddles, size_t n, size_t first, size_t last);
+    void (*fft_merge)(float* z, const float* spectrum, const float* twiddles, size_t n, size_t first, size_t last);
+};
+
+/**
+ * @brief Gets the kernels for an instruction set.
+ *
+ * @param isa The instruction set.
+ * @return const Dsp_Kernels* nullptr if they were not built for this target or the CPU does not support them.
+*/
+const Dsp_Kernels* get_dsp_kernels(dsp_isa isa) noexcept;
+
+/**
+ * @brief Gets the widest instruction set the kernels were built for that the CPU supports, detected once.
+ *
+ * @return dsp_isa
+*/
+dsp_isa best_dsp_isa() noexcept;
+
+// Each instruction set's kernels live in a translation unit of their own, built with the flags for it, so nothing else
+// is compiled for a CPU that may not have it. These return nullptr when the target has no such instruction set.
+const Dsp_Kernels* scalar_dsp_kernels() noexcept;
+const Dsp_Kernels* avx2_dsp_kernels() noexcept;
+const Dsp_Kernels* avx512_dsp_kernels() noexcept;
+
+#endif // dsp_kernels_tsrt_h
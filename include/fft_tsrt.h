@@ -0,0 +1,138 @@
+#ifndef fft_tsrt_h
+#define fft_tsrt_h
+
+#include "aligned_samples_tsrt.h"
+#include "dsp_kernels_tsrt.h"
+#include "exceptions_tsrt.h"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief The precomputed passes and twiddles of a real FFT of one size, shared by every Real_Fft of that size.
+ *
+ * @details A real transform of N samples is a complex transform of n = N / 2, the even samples as the real parts and the
+ * odd ones as the imaginary parts, split into the N / 2 + 1 bins afterwards. The complex transform is a mixed radix
+ * Stockham FFT, radix 4 passes first, then 2, 3 and 5, so any N whose half has no other prime factor is planned, the
+ * engine's 400 and 800 sample frames as well as powers of two. Stockham passes go from one buffer to the other with the
+ * output in order, there is no bit reversal, and each pass's twiddles are laid out a row per k so neighbouring
+ * butterflies' are contiguous, see Fft_Pass.
+ * @details A plan is immutable once built, any number of threads may use it at once.
+*/
+class Fft_Plan {
+
+private:
+    using Samples = std::unique_ptr<float[], Aligned_Samples_Deleter>;
+
+    size_t size;
+    std::vector<Fft_Pass> passes;
+    Samples twiddles;       // every pass's twiddles, one after the other
+    Samples split_twiddles; // exp(-2 pi i k / N) for k <= N / 2, interleaved
+
+public:
+
+    /**
+     * @brief Construct a new Fft_Plan object, see get_fft_plan() for a shared one
+     *
+     * @param size The number of real samples N.
+     * @throw tsrt_exception if N is odd or its half has a prime factor other than 2, 3 and 5.
+    */
+    explicit Fft_Plan(size_t size);
+
+    Fft_Plan(const Fft_Plan&) = delete;
+    Fft_Plan& operator=(const Fft_Plan&) = delete;
+
+    size_t get_size() const noexcept;
+
+    /**
+     * @brief Get the passes of the complex transform of N / 2, in the order they run
+     *
+     * @return const std::vector<Fft_Pass>& Empty for N = 2.
+    */
+    const std::vector<Fft_Pass>& get_passes() const noexcept;
+
+    /**
+     * @brief Get the twiddles the complex transform is split into real bins with
+     *
+     * @return const float* exp(-2 pi i k / N) for k from 0 to N / 2, interleaved.
+    */
+    const float* get_split_twiddles() const noexcept;
+};
+
+/**
+ * @brief Get the plan for a size from the plan cache, building it the first time
+ *
+ * @details The cache is shared by every thread and guarded by a lock, plans are built once per size and kept for the
+ * life of the process. Get them at setup, not per frame.
+ *
+ * @param size The number of real samples N.
+ * @return std::shared_ptr<const Fft_Plan>
+ * @throw tsrt_exception if there is no plan for the size, see Fft_Plan.
+*/
+std::shared_ptr<const Fft_Plan> get_fft_plan(size_t size);
+
+/**
+ * @brief The forward and inverse FFT of real frames of one size, run with the kernels of one instruction set.
+ *
+ * @details Spectra are N / 2 + 1 interleaved complex bins, unnormalized, the layout and scale of FFmpeg's real av_tx, so
+ * a forward then inverse transform scaled by 1 / N gives the frame back.
+ * @details The plan is shared, the buffers the passes run through are the instance's own, so an instance must only be
+ * used by one thread at a time.
+*/
+class Real_Fft {
+
+private:
+    using Samples = std::unique_ptr<float[], Aligned_Samples_Deleter>;
+
+    const Dsp_Kernels* kernels;
+    std::shared_ptr<const Fft_Plan> plan;
+    Samples first;  // the buffers the passes go back and forth between, N / 2 complex values each
+    Samples second;
+
+    /**
+     * @brief Run the complex transform's passes
+     *
+     * @param input The N / 2 complex values, left as they are unless they are one of the buffers.
+     * @param to The buffer the first pass writes, the passes alternate between it and other.
+     * @param other The other buffer.
+     * @return const float* The buffer the transform ended up in, input if there are no passes.
+    */
+    const float* transform(const float* input, float* to, float* other) noexcept;
+
+public:
+
+    /**
+     * @brief Construct a new Real_Fft object
+     *
+     * @param size The number of real samples N, see Fft_Plan for the sizes planned.
+     * @param kernels The kernels the passes are run with, see get_dsp_kernels().
+     * @throw tsrt_exception if there is no plan for the size.
+    */
+    explicit Real_Fft(size_t size, const Dsp_Kernels& kernels = *get_dsp_kernels(best_dsp_isa()));
+
+    Real_Fft(const Real_Fft&) = delete;
+    Real_Fft& operator=(const Real_Fft&) = delete;
+
+    /**
+     * @brief Transform a frame into its spectrum
+     *
+     * @param spectrum The N / 2 + 1 bins, any alignment.
+     * @param samples The N samples, any alignment, not modified.
+    */
+    void forward(float* spectrum, const float* samples) noexcept;
+
+    /**
+     * @brief Transform a spectrum back into a frame
+     *
+     * @param samples The N samples, any alignment.
+     * @param spectrum The N / 2 + 1 bins, any alignment, not modified. The imaginary parts of the first and last bins
+     * are ignored.
+     * @param scale What the samples are scaled by, 1 / N for the frame the spectrum was computed from.
+    */
+    void inverse(float* samples, const float* spectrum, float scale) noexcept;
+
+    size_t get_size() const noexcept;
+};
+
+#endif // fft_tsrt_h
@@ -0,0 +1,111 @@
+#ifndef log_mel_tsrt_h
+#define log_mel_tsrt_h
+
+#include "aligned_samples_tsrt.h"
+#include "audio_window_tsrt.h"
+#include "constants_config_tsrt.h"
+#include "dsp_kernels_tsrt.h"
+#include "exceptions_tsrt.h"
+#include "fft_tsrt.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Computes the log mel features of a stream once, for every analysis and every window that overlaps.
+ *
+ * @details Frames of MEL_FRAME_SAMPLES start every MEL_HOP_SAMPLES and each is transformed as soon as its last sample
+ * arrives: Hann windowed, transformed with the in-tree FFT, its power spectrum summed into MEL_BANDS triangular mel bands
+ * between MEL_LOW_HZ and MEL_HIGH_HZ and the log taken, all with the kernels of one instruction set. A window's
+ * features are the rows of the frames inside it, so the frames of the half two windows share are computed once and the
+ * analyses read the same matrix rather than each running an STFT of its own.
+ * @details Rows are kept in a ring of frames, every row written twice, once past the end, so the rows of any window
+ * are contiguous without copying. The ring holds a sample ring's worth of frames, rows stay valid as long as the
+ * samples they were computed from.
+ * @details An instance is one stream's, it must only be used by one thread at a time.
+*/
+class Log_Mel_Extractor {
+
+private:
+    using Samples = std::unique_ptr<float[], Aligned_Samples_Deleter>;
+
+    // A mel band's triangle, its weights for the bins from first_bin on
+    struct Mel_Band {
+        size_t first_bin;
+        size_t bins;
+        size_t weights; // the offset of its weights in band_weights
+    };
+
+    const Dsp_Kernels* kernels;
+    Real_Fft fft;
+    std::vector<Mel_Band> bands;
+    std::vector<float> band_weights;
+    Samples window;
+    Samples input;       // the last frame of samples, filling at its end
+    Samples frame;       // the windowed frame being transformed
+    Samples spectrum;    // interleaved complex bins, padded to whole SIMD blocks
+    Samples power;
+    Samples rows;        // the ring of rows, 2 * capacity of them
+    size_t capacity;     // frames in the ring
+    size_t fill;         // samples of the frame received
+    uint64_t frames;     // the frames computed, the next one goes in row frames % capacity
+    uint64_t origin;     // the sample index frame origin_frame starts at, frames start every MEL_HOP_SAMPLES from it
+    uint64_t origin_frame;
+
+    /**
+     * @brief Transform the frame in input into the next row, once it is full
+    */
+    void compute_frame() noexcept;
+
+public:
+
+    /**
+     * @brief Construct a new Log_Mel_Extractor object
+     *
+     * @param samples The samples rows must stay valid for, the capacity of the sample ring windows are views into.
+     * @param kernels The kernels the features are computed with, see get_dsp_kernels().
+     * @throw tsrt_exception if the FFT can not be set up.
+    */
+    explicit Log_Mel_Extractor(size_t samples, const Dsp_Kernels& kernels = *get_dsp_kernels(best_dsp_isa()));
+
+    Log_Mel_Extractor(const Log_Mel_Extractor&) = delete;
+    Log_Mel_Extractor& operator=(const Log_Mel_Extractor&) = delete;
+
+    /**
+     * @brief Continue the stream at a sample index after a gap
+     *
+     * The frame being filled is dropped, frames start every MEL_HOP_SAMPLES from the index on.
+     *
+     * @param sample_index The absolute index of the next sample processed.
+    */
+    void restart(uint64_t sample_index) noexcept;
+
+    /**
+     * @brief Compute the frames the samples complete
+     *
+     * @param samples The samples that follow the ones processed before, any alignment.
+     * @param count The number of samples, any size.
+    */
+    void process(const float* samples, size_t count) noexcept;
+
+    /**
+     * @brief Get the features of a window
+     *
+     * The samples up to the window's end must have been processed.
+     *
+     * @param start_sample The absolute index of the window's first sample, a whole number of hops from the last restart.
+     * @return Feature_View The rows of the MEL_FRAMES_PER_WINDOW frames inside the window.
+    */
+    Feature_View view(uint64_t start_sample) const noexcept;
+
+    /**
+     * @brief Get the number of frames computed
+     *
+     * @return uint64_t
+    */
+    uint64_t get_frames() const noexcept;
+};
+
+#endif // log_mel_tsrt_h
@@ -0,0 +1,230 @@
+#ifndef native_preprocessor_tsrt_h
+#define native_preprocessor_tsrt_h
+
+#include "aligned_samples_tsrt.h"
+#include "constants_config_tsrt.h"
+#include "dsp_kernels_tsrt.h"
+#include "exceptions_tsrt.h"
+#include "fft_tsrt.h"
+#include "preprocessing_chain_tsrt.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief One stage of a native chain, run in place on a stream in chunks of any size.
+*/
+class Native_Stage {
+
+public:
+
+    virtual ~Native_Stage() = default;
+
+    /**
+     * @brief Filter samples in place
+     *
+     * @param samples The samples, any alignment, replaced with the output get_latency() earlier on the stream's timeline.
+     * @param count The number of samples.
+    */
+    virtual void process(float* samples, size_t count) noexcept = 0;
+
+    /**
+     * @brief Get the delay the stage adds
+     *
+     * @return size_t The delay in samples.
+    */
+    virtual size_t get_latency() const noexcept = 0;
+};
+
+/**
+ * @brief Biquad sections run in place one after the other.
+ *
+ * @details Each section keeps its state, so a stream can be filtered in chunks of any size.
+*/
+class Biquad_Cascade : public Native_Stage {
+
+private:
+    const Dsp_Kernels* kernels;
+    std::vector<Biquad_Section> sections;
+
+public:
+
+    /**
+     * @brief Construct an empty Biquad_Cascade, which passes samples through
+     *
+     * @param kernels The kernels the sections are run with.
+    */
+    explicit Biquad_Cascade(const Dsp_Kernels& kernels);
+
+    /**
+     * @brief Append a band pass section, the same as FFmpeg's bandpass filter with width_type=h
+     *
+     * @param frequency The centre frequency in Hz.
+     * @param width The width of the band in Hz.
+    */
+    void add_bandpass(double frequency, double width);
+
+    // through every section, without delay
+    void process(float* samples, size_t count) noexcept override;
+
+    size_t get_latency() const noexcept override;
+};
+
+/**
+ * @brief An STFT spectral subtraction denoiser run in place.
+ *
+ * @details Frames of DENOISE_FRAME_SAMPLES overlap by half and are windowed with a sqrt Hann window before and after
+ * filtering, so the frames sum back to the input where nothing is attenuated. A running noise estimate per bin follows
+ * the spectrum down quickly and up slowly, never below the noise floor, and each bin is attenuated by the share of its
+ * power the estimate accounts for, at most by the noise reduction, the way afftdn's nr and nf settings work.
+ * @details A running SNR estimate, see Snr_Bypass, decides whether a frame is filtered at all. A bypassed frame skips the
+ * FFT and is only windowed twice, which sums back to the input, and the half overlap crossfades every switch. The noise
+ * estimate per bin is not updated while bypassed.
+ * @details Output is delayed by DENOISE_FRAME_SAMPLES, the first ones are silence.
+*/
+class Spectral_Denoiser : public Native_Stage {
+
+private:
+    using Samples = std::unique_ptr<float[], Aligned_Samples_Deleter>;
+
+    const Dsp_Kernels* kernels;
+    Real_Fft fft;
+    Spectral_Subtraction params;
+    Samples window;
+    Samples bypass_window; // the window squared, a bypassed frame is windowed before and after at once
+    Samples input;    // the last frame of input, the newest hop filling at its end
+    Samples frame;    // the frame being filtered
+    Samples spectrum; // interleaved complex bins, padded to whole SIMD blocks
+    Samples noise;    // the noise estimate per bin
+    Samples overlap;  // filtered frames overlap added
+    Samples output;   // the hop of output being handed out
+    size_t fill;      // samples of the newest hop received
+    Snr_Bypass bypass;
+
+    /**
+     * @brief Filter the frame in input and overlap add it, once a hop of input has been received
+    */
+    void process_frame() noexcept;
+
+public:
+
+    /**
+     * @brief Construct a new Spectral_Denoiser object
+     *
+     * @param kernels The kernels the frames are filtered with.
+     * @param reduction_db The most a bin is attenuated by, in dB, as afftdn's nr.
+     * @param floor_db The noise floor, in dBFS, as afftdn's nf.
+     * @param bypass_db The SNR estimate in dB above which frames are passed through unfiltered, infinity to never.
+     * @throw tsrt_exception if the FFT can not be set up.
+    */
+    Spectral_Denoiser(const Dsp_Kernels& kernels, float reduction_db, float floor_db, float bypass_db = DENOISE_BYPASS_SNR_DB);
+
+    void process(float* samples, size_t count) noexcept override;
+
+    // DENOISE_FRAME_SAMPLES
+    size_t get_latency() const noexcept override;
+
+    /**
+     * @brief Get how many frames were filtered and how many bypassed
+     *
+     * @return Denoise_Stats
+    */
+    Denoise_Stats get_stats() const noexcept;
+};
+
+/**
+ * @brief The built in alternative to the FFmpeg filter graph.
+ *
+ * @details The native stages of a Preprocessor_Config, band passes as vectorized biquads and spectral subtraction
+ * denoisers following afftdn's nr and nf, run in order in place on segment memory with the kernels of one instruction
+ * set. Consecutive band passes share one Biquad_Cascade. No frames are allocated or queued and the delay is fixed,
+ * get_latency() samples, whatever size the chunks pushed are.
+ * @details As a Preprocessing_Chain a push filters the input in place and the output is a view into it, shifted back by
+ * the delay, so each input is released once its output has been pulled. The delay is counted on the samples pushed, a
+ * gap in the sample indices is not kept in the delayed output. The silence the stages start with is not output, and a
+ * flush filters a delay of silence to push out the end of the stream.
+ * @details Like Preprocessor_tsrt an instance is one stream's, it must only be used by one thread at a time.
+*/
+class Native_Preprocessor_tsrt : public Preprocessing_Chain {
+
+private:
+    const Dsp_Kernels* kernels;
+    std::vector<std::unique_ptr<Native_Stage>> stages;
+    std::vector<const Spectral_Denoiser*> denoisers; // the denoising stages, for their stats
+    uint64_t latency;
+
+    uint64_t first_index;  // the index of the first sample pushed
+    uint64_t next_index;   // the index after the last sample pushed
+    bool started;
+    bool flushed;
+    Filtered_Audio output; // the output of the last push or the flush, until pulled
+    bool output_ready;
+    bool output_pulled;    // the output was pulled, its input is released by the next pull or flush
+    uint64_t handed_inputs; // the inputs whose output was pulled or who had none
+    std::vector<float> tail;
+    std::atomic<uint64_t> inputs_pushed;
+    std::atomic<uint64_t> inputs_released;
+
+    /**
+     * @brief Set the output to the filtered samples, less the ones before the start of the stream
+     *
+     * @param samples The filtered samples.
+     * @param count The number of samples.
+     * @param sample_index The index of the first sample as it went in.
+    */
+    void set_output(const float* samples, size_t count, uint64_t sample_index) noexcept;
+
+    /**
+     * @brief Release the inputs handed out, once the output pulled is no longer being looked at
+    */
+    void release_inputs() noexcept;
+
+public:
+
+    /**
+     * @brief Construct a new Native_Preprocessor_tsrt object
+     *
+     * @param config The template the stages are built from, only read during construction.
+     * @param kernels The kernels to run, see get_dsp_kernels().
+     * @throw tsrt_exception if the FFT can not be set up.
+    */
+    explicit Native_Preprocessor_tsrt(const Preprocessor_Config& config = Preprocessor_Config(),
+                                      const Dsp_Kernels& kernels = *get_dsp_kernels(best_dsp_isa()));
+
+    Native_Preprocessor_tsrt(const Native_Preprocessor_tsrt&) = delete;
+    Native_Preprocessor_tsrt& operator=(const Native_Preprocessor_tsrt&) = delete;
+
+    /**
+     * @brief Preprocess samples in place, outside of the chain's push and pull
+     *
+     * @param samples The samples, replaced with the preprocessed samples get_latency() earlier on the stream's timeline.
+     * @param count The number of samples, any size.
+    */
+    void preprocess(float* samples, size_t count) noexcept;
+
+    // also throws if the output of the last push has not been pulled
+    uint64_t push_audio(float* samples, size_t count, uint64_t sample_index) override;
+
+    bool pull_audio(Filtered_Audio& filtered) override;
+
+    void flush() override;
+
+    bool input_released(uint64_t input) const noexcept override;
+
+    uint64_t get_latency() const noexcept override;
+
+    // the frames of every denoising stage, summed
+    Denoise_Stats get_denoise_stats() const noexcept override;
+
+    /**
+     * @brief Get the name of the instruction set the kernels were built for
+     *
+     * @return const char*
+    */
+    const char* get_isa_name() const noexcept;
+};
+
+#endif // native_preprocessor_tsrt_h
@@ -0,0 +1,56 @@
+#ifndef pcm_source_tsrt_h
+#define pcm_source_tsrt_h
+
+#include "audio_source_tsrt.h"
+#include "constants_config_tsrt.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+/**
+ * @brief Reads raw SAMPLE_RATE mono float32 samples in native byte order from a file, pipe or stdin.
+ *
+ * @details E.g. `ffmpeg -i call.wav -f f32le -ac 1 -ar 16000 - | transScriptRT pcm:-`. Reads block until the writer
+ * catches up, so the source is not live, a writer faster than the pipeline is held back by the pipe rather than losing
+ * audio. Anything but a regular file may block for as long as the writer takes, so it is read on a recording thread of
+ * its own rather than by the workers polling every session. There is no header, resampling or format conversion.
+ *
+ * @param file The stream samples are read from.
+ * @param owned Whether the stream is closed with the source, false for stdin.
+ * @param blocking Whether the stream is a pipe, stdin or anything else that is not a regular file.
+*/
+class Pcm_Source : public Pull_Audio_Source {
+
+private:
+    std::FILE* file;
+    bool owned;
+    bool blocking;
+
+protected:
+
+    size_t read_samples(float* destination, size_t count) override;
+
+public:
+
+    /**
+     * @brief Construct a new Pcm_Source object
+     *
+     * @param path The file or named pipe to read, "-" for stdin.
+     * @throw Tsrt_Exception if the file can not be opened.
+    */
+    explicit Pcm_Source(const std::string& path);
+
+    ~Pcm_Source() override;
+
+    Pcm_Source(const Pcm_Source&) = delete;
+    Pcm_Source& operator=(const Pcm_Source&) = delete;
+
+    bool is_live() const noexcept override;
+
+    bool may_block() const noexcept override;
+
+    const char* get_name() const noexcept override;
+};
+
+#endif // pcm_source_tsrt_h
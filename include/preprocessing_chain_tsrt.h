@@ -0,0 +1,249 @@
+#ifndef preprocessing_chain_tsrt_h
+#define preprocessing_chain_tsrt_h
+
+#include "constants_config_tsrt.h"
+#include "exceptions_tsrt.h"
+#include "status_codes_tsrt.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief A run of filtered samples pulled from a preprocessing chain.
+ *
+ * @param samples A view into the chain's output, valid until the next pull_audio() or flush().
+ * @param count The number of samples.
+ * @param sample_index The absolute index of the first sample on the timeline the input was pushed on.
+*/
+struct Filtered_Audio {
+    const float* samples;
+    size_t count;
+    uint64_t sample_index;
+};
+
+// What runs a preprocessing chain
+enum preprocessing_backend {
+    PREPROCESS_FFMPEG, // an FFmpeg filter graph, see Preprocessor_tsrt
+    PREPROCESS_NATIVE, // the built in SIMD stages, see Native_Preprocessor_tsrt
+};
+
+// The stages the native backend has
+enum native_stage_type {
+    NATIVE_BANDPASS,
+    NATIVE_DENOISE,
+};
+
+/**
+ * @brief One stage of a native chain.
+ *
+ * @param type The stage.
+ * @param frequency The centre of a band pass, in Hz.
+ * @param width The width of a band pass, in Hz.
+ * @param reduction The most a denoiser attenuates, in dB, afftdn's nr.
+ * @param floor The noise floor of a denoiser, in dBFS, afftdn's nf.
+ * @param bypass The SNR estimate in dB above which a denoiser passes audio through unfiltered, see Spectral_Denoiser.
+*/
+struct Native_Stage_Config {
+    native_stage_type type;
+    double frequency;
+    double width;
+    float reduction;
+    float floor;
+    float bypass;
+};
+
+/**
+ * @brief How much of a chain's audio its denoisers filtered.
+ *
+ * @param frames The hops of DENOISE_HOP_SAMPLES the denoisers took in.
+ * @param bypassed The hops passed through unfiltered because the audio was clean enough.
+*/
+struct Denoise_Stats {
+    uint64_t frames;
+    uint64_t bypassed;
+};
+
+/**
+ * @brief Decides from a running SNR estimate whether a denoiser is worth running, for either backend.
+ *
+ * @details Each hop of DENOISE_HOP_SAMPLES has its level taken in dBFS, at least the noise floor. A noise level drops to
+ * any quieter hop at once and creeps up DENOISE_SNR_NOISE_RISE_DB a hop, a signal level rises to any louder hop at once
+ * and decays DENOISE_SNR_LEVEL_FALL_DB a hop, and their difference is the SNR estimate. Above the bypass threshold, a
+ * clean feed or speech far above the noise, the denoiser is bypassed until the estimate drops
+ * DENOISE_BYPASS_HYSTERESIS_DB below it, and at least DENOISE_BYPASS_HOLD_HOPS pass between switches so it does not flap.
+ * @details An instance is one denoiser's, it must only be used by one thread at a time.
+*/
+class Snr_Bypass {
+
+private:
+    float floor_db;
+    float bypass_db;
+    float noise_db;    // the running noise and signal levels in dBFS
+    float level_db;
+    bool bypassed;
+    size_t held_hops;  // hops since the last switch, up to DENOISE_BYPASS_HOLD_HOPS
+    double hop_energy; // the sum of squares of the hop process() is filling
+    size_t hop_fill;
+    Denoise_Stats stats;
+
+public:
+
+    /**
+     * @brief Construct a new Snr_Bypass object, not bypassed
+     *
+     * @param floor_db The denoiser's noise floor in dBFS, quieter hops count as this level.
+     * @param bypass_db The SNR estimate in dB above which the denoiser is bypassed, infinity to never.
+    */
+    Snr_Bypass(float floor_db, float bypass_db);
+
+    /**
+     * @brief Update the estimate with one hop and switch the bypass if it crossed a threshold
+     *
+     * @param power The hop's mean power, the mean of its squared samples.
+    */
+    void update(float power) noexcept;
+
+    /**
+     * @brief Update the estimate with the hops samples complete
+     *
+     * @param samples The samples that follow the ones processed before, any alignment.
+     * @param count The number of samples, any size.
+    */
+    void process(const float* samples, size_t count) noexcept;
+
+    bool is_bypassed() const noexcept;
+
+    /**
+     * @brief Get how many hops were seen and how many of them bypassed
+     *
+     * @return Denoise_Stats
+    */
+    Denoise_Stats get_stats() const noexcept;
+};
+
+/**
+ * @brief The template every stream's preprocessing chain is built from.
+ *
+ * Only values, no FFmpeg state, so one config is the template for any number of streams and each builds its own chain
+ * from a copy of it. The default is the band pass and denoiser of constants_config_tsrt.h on the FFmpeg backend, for
+ * the native backend the same two stages.
+ *
+ * @param backend What runs the chain.
+ * @param spec The spec the config was parsed from, for logging.
+ * @param filters The FFmpeg filter chain between the source and the sink, as for ffmpeg's -af.
+ * @param stages The native stages, in order.
+*/
+struct Preprocessor_Config {
+    preprocessing_backend backend;
+    std::string spec;
+    std::string filters;
+    std::vector<Native_Stage_Config> stages;
+
+    Preprocessor_Config();
+};
+
+/**
+ * @brief Parses a preprocessing chain from a runtime spec.
+ *
+ * @details The specs are "ffmpeg:<filters>" for an FFmpeg filter chain, e.g. "ffmpeg:highpass=f=200,afftdn=nr=12",
+ * and "native:<stage>[,<stage>...]" for native stages, each "bandpass=f=<Hz>:w=<Hz>" or
+ * "denoise=nr=<dB>:nf=<dBFS>:bypass=<dB>", any option left out keeping its default, bypass=inf never bypasses. A spec without a prefix is an FFmpeg filter chain. The FFmpeg filters are only
+ * checked once a graph is built from them.
+ *
+ * @param spec The chain.
+ * @return Preprocessor_Config
+ * @throw Tsrt_Exception if a native stage or option is unknown or a value is not a number.
+*/
+Preprocessor_Config parse_preprocessor_spec(const std::string& spec);
+
+/**
+ * @brief A stream's preprocessing, whichever backend runs it.
+ *
+ * @details Audio goes in and comes out without copies. A pushed buffer stays the chain's until input_released() says
+ * otherwise, and filtered audio is pulled as views the chain owns. A chain delays its output and what comes out need not
+ * line up with what went in, so it is drained after every push and what is still inside at the end of a stream is
+ * flushed out. Sample indices carry through, a chain's output is on the timeline its input was pushed on.
+ * @details A chain is one stream's, it must only be used by one thread at a time, in the stream's order, except for
+ * input_released().
+*/
+class Preprocessing_Chain {
+
+public:
+
+    virtual ~Preprocessing_Chain() = default;
+
+    /**
+     * @brief Push samples into the chain without copying them
+     *
+     * The chain may filter the samples in place and hold on to them past this call, so the buffer must not be written
+     * or freed until input_released() returns true. Drain the chain with pull_audio() after every push.
+     *
+     * @param samples A buffer of count samples, at least SAMPLE_ALIGNMENT aligned.
+     * @param count The number of samples.
+     * @param sample_index The absolute index of the first sample.
+     * @return uint64_t The input's id, ids count up from 0.
+     * @throw tsrt_exception if the chain can not take the input, or after a flush.
+    */
+    virtual uint64_t push_audio(float* samples, size_t count, uint64_t sample_index) = 0;
+
+    /**
+     * @brief Pull the next run of filtered samples
+     *
+     * Call until it returns false. Releases the run pulled before.
+     *
+     * @param filtered Set to a view into the chain's output, valid until the next pull_audio() or flush().
+     * @return bool False once the chain needs more input, or is empty after a flush.
+     * @throw tsrt_exception if the chain fails.
+    */
+    virtual bool pull_audio(Filtered_Audio& filtered) = 0;
+
+    /**
+     * @brief Signal the end of the stream, so the samples the chain delayed can be pulled
+     *
+     * Nothing can be pushed after a flush. Releases the run pulled before.
+     *
+     * @throw tsrt_exception if the chain fails.
+    */
+    virtual void flush() = 0;
+
+    /**
+     * @brief Check if the chain is done with an input
+     *
+     * Safe to call from any thread.
+     *
+     * @param input The id push_audio() returned.
+     * @return bool Whether the input's samples may be written or freed.
+    */
+    virtual bool input_released(uint64_t input) const noexcept = 0;
+
+    /**
+     * @brief Get the algorithmic latency the chain adds to the stream
+     *
+     * @return uint64_t The latency in samples, SAMPLE_RATE per second.
+    */
+    virtual uint64_t get_latency() const noexcept = 0;
+
+    /**
+     * @brief Get how many frames the chain's denoisers filtered and how many they passed through
+     *
+     * @return Denoise_Stats Zero for a chain without a denoiser, native or afftdn.
+    */
+    virtual Denoise_Stats get_denoise_stats() const noexcept = 0;
+};
+
+/**
+ * @brief Builds a stream's preprocessing chain.
+ *
+ * @details Building an FFmpeg graph parses and configures every filter, build chains ahead of when they are needed
+ * rather than on a thread moving audio.
+ *
+ * @param config The template the chain is built from, only read during the call.
+ * @return std::unique_ptr<Preprocessing_Chain>
+ * @throw Tsrt_Exception if the chain can not be built.
+*/
+std::unique_ptr<Preprocessing_Chain> make_preprocessing_chain(const Preprocessor_Config& config);
+
+#endif // preprocessing_chain_tsrt_h
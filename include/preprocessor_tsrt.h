@@ -0,0 +1,155 @@
+#ifndef preprocessor_tsrt_h
+#define preprocessor_tsrt_h
+
+#include "constants_config_tsrt.h"
+#include "exceptions_tsrt.h"
+#include "preprocessing_chain_tsrt.h"
+#include "status_codes_tsrt.h"
+
+#include <array>
+#include <atomic>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+extern "C" {
+#include <libavfilter/avfilter.h>
+#include <libavutil/avutil.h>
+#include <libavutil/frame.h>
+}
+
+/**
+ * @brief A deleter for AVFrame
+ *
+ * @param avframe AVFrame to be cleaned up
+*/
+void avframe_deleter(AVFrame* avframe);
+
+/**
+ * @brief A deleter for AVFilterGraph
+ *
+ * @param avfilter_graph AVFilterGraph to be cleaned up
+*/
+void avfilter_graph_deleter(AVFilterGraph* avfilter_graph);
+
+/**
+ * @brief Throws a Tsrt_Exception with FFmpeg's description of the error if the call fails
+ *
+ * @param bound_func The FFmpeg call, returning a negative error code on failure.
+ * @param error_context What the call was doing, prefixed to the error.
+ * @throw tsrt_exception
+*/
+void handle_ffmpeg_errors(std::function<int()> bound_func, const std::string& error_context, std::string file, int line);
+
+/**
+ * @brief The FFmpeg filter graph audio is preprocessed with.
+ *
+ * Each instance owns its graph and filter state, built from the filters of a Preprocessor_Config, so every stream that
+ * is preprocessed, e.g. each session or each file of a batch, gets its own and they can run on different threads at the
+ * same time with nothing shared. The graph runs its filters on the calling thread only, FFmpeg starts no threads for it,
+ * so hundreds of graphs spread over a TBB pool rather than each bringing a pool of its own. An instance is not thread
+ * safe, it must only be used by one thread at a time, in the stream's order, except for input_released().
+ *
+ * A pushed buffer is wrapped in an AVBuffer rather than copied into a frame, so filters that can work in place do, and
+ * filtered audio is pulled as views into the sink's frames. The filters must keep the audio SAMPLE_RATE mono float.
+ *
+ * If the graph has afftdn filters, a Snr_Bypass fed the input as it is pushed switches them off with their timeline
+ * enable command while the audio is clean, and on again once it is not. A disabled afftdn passes its input through but
+ * keeps analysing it, so its noise profile is current when it comes back.
+*/
+class Preprocessor_tsrt : public Preprocessing_Chain {
+
+private:
+
+    std::unique_ptr<AVFrame, decltype(&avframe_deleter)> input_frame;
+    std::unique_ptr<AVFrame, decltype(&avframe_deleter)> output_frame;
+    std::unique_ptr<AVFilterGraph, decltype(&avfilter_graph_deleter)> avfilter_graph;
+    // ctx's outside of init_avfilter_graph() because push_audio() and pull_audio() read them
+    // the other filters contexts are not needed outside of init_avfilter_graph()
+    AVFilterContext* src_ctx;
+    AVFilterContext* sink_ctx;
+    AVRational sink_time_base;
+
+    // set while the graph holds the input with the same id modulo PREPROCESS_MAX_HELD_INPUTS, cleared by FFmpeg
+    std::array<std::atomic<bool>, PREPROCESS_MAX_HELD_INPUTS> inputs_held;
+    std::atomic<uint64_t> inputs_pushed;
+    uint64_t samples_pushed;
+    uint64_t samples_pulled;
+    uint64_t pulled_end;
+    uint64_t max_latency;
+    bool flushed;
+    std::unique_ptr<Snr_Bypass> bypass; // drives the afftdn filters, nullptr if the graph has none
+
+    /**
+     * @brief Allocate the AVFrames audio is pushed and pulled through
+    */
+    void init_avframes();
+
+    /**
+     * @brief Initialize the AVFilterGraph
+     *
+     * @param config The filters, linked between the source and the sink.
+    */
+    void init_avfilter_graph(const Preprocessor_Config& config);
+
+    /**
+     * @brief Routes FFmpeg's warnings and errors to the logger
+    */
+    static void ffmpeg_log_callback(void* ptr, int level, const char* fmt, va_list vargs);
+
+    /**
+     * @brief Called by FFmpeg once the last reference to a pushed buffer is gone
+     *
+     * @param opaque The input's flag in inputs_held.
+     * @param data The pushed samples, owned by the caller.
+    */
+    static void release_input(void* opaque, uint8_t* data);
+
+public:
+
+    /**
+     * @brief Construct a new Preprocessor_tsrt object
+     *
+     * @param config The template the graph is built from, only read during construction.
+     * @throw tsrt_exception if the filter graph can not be built.
+    */
+    explicit Preprocessor_tsrt(const Preprocessor_Config& config = Preprocessor_Config());
+
+    Preprocessor_tsrt(const Preprocessor_tsrt&) = delete;
+    Preprocessor_tsrt& operator=(const Preprocessor_tsrt&) = delete;
+
+    // also throws if the graph still holds the input PREPROCESS_MAX_HELD_INPUTS before this one
+    uint64_t push_audio(float* samples, size_t count, uint64_t sample_index) override;
+
+    bool pull_audio(Filtered_Audio& filtered) override;
+
+    void flush() override;
+
+    bool input_released(uint64_t input) const noexcept override;
+
+    /**
+     * @brief Get the number of samples pushed that have not been pulled yet
+     *
+     * Right after the sink is drained this is the delay the graph adds.
+     *
+     * @return uint64_t
+    */
+    uint64_t get_pending_samples() const noexcept;
+
+    /**
+     * @brief Get the algorithmic latency the graph adds to the stream
+     *
+     * The most samples pushed but not yet pulled once the sink was drained, 0 until the first drain.
+     *
+     * @return uint64_t The latency in samples, SAMPLE_RATE per second.
+    */
+    uint64_t get_latency() const noexcept override;
+
+    // the hops the afftdn filters were bypassed for, zero if the graph has none
+    Denoise_Stats get_denoise_stats() const noexcept override;
+};
+
+#endif // preprocessor_tsrt_h
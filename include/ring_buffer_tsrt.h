@@ -1,14 +1,9 @@
 #ifndef ring_buffer_tsrt_h
 #define ring_buffer_tsrt_h
 
-#include "audio_segment_tsrt.h"
-#include "constants_config_tsrt.h"
-
+#include <atomic>
 #include <cstddef>
-#include <memory>
-#include <mutex>
-#include <optional>
-#include <type_traits>
+#include <utility>
 
 /**
  * @brief Checks if the given size is a power of two.
@@ -23,130 +18,162 @@ constexpr bool is_power_of_two(size_t Size) noexcept {
 }
 
 /**
- * @brief A ring buffer that can be used to store audio segments.
+ * @brief Counters describing how a ring buffer has coped with its load.
  * 
- * @details This class is a ring buffer that can be used to store audio segments. It can be used in a thread safe manner or not.
- * @details If the buffer size is a power of two, it can benefit the bitwise and wrap around optimization.
+ * @param overwritten The number of elements overwritten before they were read.
+ * @param dropped The number of elements rejected because the buffer was full.
+ * @param high_water The highest number of unread elements observed in the buffer.
+*/
+struct Ring_Buffer_Stats {
+    size_t overwritten;
+    size_t dropped;
+    size_t high_water;
+};
+
+/**
+ * @brief Raises a high water mark shared between threads.
  * 
- * @tparam T The type of the elements stored in the buffer.
- * @tparam ThreadSafe Whether or not the buffer should be thread safe.
- * @tparam Size The size of the buffer. Must be greater than 0. Used to compile time check for size being power of 2.
- */
-template <typename T, bool ThreadSafe = false, size_t Size = 1>
-class Ring_Buffer {
+ * @param high_water The high water mark to raise.
+ * @param occupancy The occupancy just observed.
+*/
+inline void update_high_water(std::atomic<size_t>& high_water, const size_t occupancy) noexcept {
+    size_t current = high_water.load(std::memory_order_relaxed);
+    while (occupancy > current && !high_water.compare_exchange_weak(current, occupancy, std::memory_order_relaxed)) {}
+}
+
+/**
+ * @brief A consumer's read cursor in a lock-free ring buffer, which the producer may also move under OVERWRITE_OLDEST.
+ *
+ * @details Without overwrites only the consumer writes the cursor and it is a plain monotonically increasing counter.
+ * @details With overwrites the counter is kept shifted left by one, the low bit marks that the consumer holds the slots
+ * from the cursor on, i.e. peeked them and did not release them yet. The consumer sets the bit with a compare and swap
+ * before it reads and the producer evicts the oldest slot with a compare and swap that expects the bit clear, so a slot
+ * is never overwritten while it is being read. While the bit is set only the consumer writes the cursor.
+ *
+ * @tparam Overwrite Whether the producer may evict the oldest slot.
+*/
+template <bool Overwrite>
+class Tail_Cursor {
 private:
-    std::unique_ptr<T[]> buffer;
-    size_t head;
-    size_t tail;
-    std::conditional_t<ThreadSafe, std::mutex, std::nullptr_t> mutex;
+    static constexpr size_t SHIFT = Overwrite ? 1 : 0;
+    static constexpr size_t HELD = Overwrite ? 1 : 0;
 
-    static_assert(Size > 0, "Ring buffer size must be greater than 0");
+    std::atomic<size_t> word{0};
+
+public:
 
     /**
-     * @brief Wraps the given index around the buffer.
-     * 
-     * @details If the buffer size is a power of two, it uses the bitwise and optimization.
-     * 
-     * @param index The index to wrap around the buffer.
-     * @return The wrapped index.
+     * @brief Gets the tail.
+     *
+     * @param order The memory order of the load.
+     * @return The tail.
     */
-    size_t wrap_index(const size_t index) const {
-        if constexpr (is_power_of_two(Size))
-            return index & (Size - 1);
-        else
-            return index % Size;
-    }
-
-public:
-    Ring_Buffer() noexcept : head(0), tail(0) {
-        buffer = std::make_unique<T[]>(Size);
+    size_t load(const std::memory_order order) const noexcept {
+        return word.load(order) >> SHIFT;
     }
 
-    // Move constructor, do not move the mutex
-    Ring_Buffer(Ring_Buffer&& other) noexcept 
-    : buffer(std::move(other.buffer)), head(other.head), tail(other.tail) {}
-
-    // Move assignment, do not move the mutex
-    Ring_Buffer& operator=(Ring_Buffer&& other) noexcept {
-        if (this != &other) {
-            buffer = std::move(other.buffer);
-            head = other.head;
-            tail = other.tail;
-        }
-        return *this;
+    /**
+     * @brief Sets the tail, releasing any held slots.
+     *
+     * @note Not thread safe, neither side may be running.
+     *
+     * @param tail The tail.
+    */
+    void reset(const size_t tail) noexcept {
+        word.store(tail << SHIFT, std::memory_order_relaxed);
     }
 
-    // Copy constructor and assignment operator are deleted because the mutex cannot be copied
-    Ring_Buffer(const Ring_Buffer&) = delete;
-    Ring_Buffer& operator=(const Ring_Buffer&) = delete;
-
     /**
-     * @brief Pushes the given value to the ring buffer.
-     * 
-     * This function checks if the data type is trivially copyable. If it is, it uses memcpy to copy the value to the buffer.
-     * Otherwise, it uses the move constructor to move the value to the buffer.
-     * 
-     * @param value The value to push to the ring buffer.
+     * @brief Gets the tail and, if there is anything to read from it, holds it against eviction.
+     *
+     * @details Consumer side only. Without overwrites this is a relaxed load. With them readable() is called again
+     * whenever the producer evicted a slot meanwhile.
+     *
+     * @param readable Called with the tail, returns the number of slots the consumer can read from it.
+     * @return The tail, and the number of readable slots, nothing is held if it is 0.
     */
-    void push(T value) noexcept {
-        if constexpr (ThreadSafe)
-            std::lock_guard<std::mutex> lock(mutex);
-
-        // Lazy initialize the audio segment because size is not known at compile time
-        // and pushing calls the default constructor, so no way to pass the size directly
-        if constexpr (std::is_same<T, Audio_Segment>::value)
-            buffer[head].lazy_initialize(value.get_size());
-
-        if constexpr (std::is_trivially_copyable<T>::value)
-            std::memcpy(&buffer[head], &value, sizeof(T));
-        else
-            buffer[head] = std::move(value);
-
-        head = wrap_index(head + 1);
-        if (head == tail)
-            tail = wrap_index(tail + 1);
+    template <typename Readable>
+    std::pair<size_t, size_t> hold(Readable readable) noexcept {
+        if constexpr (!Overwrite) {
+            const size_t tail = word.load(std::memory_order_relaxed);
+            return {tail, readable(tail)};
+        } else {
+            size_t current = word.load(std::memory_order_acquire);
+            for (;;) {
+                const size_t count = readable(current >> SHIFT);
+                // acquire, so reading the slots can not start before they are held
+                if (count == 0 || (current & HELD) != 0 ||
+                    word.compare_exchange_weak(current, current | HELD, std::memory_order_acquire, std::memory_order_acquire))
+                    return {current >> SHIFT, count};
+            }
+        }
     }
 
     /**
-     * @brief Pops the first value from the ring buffer.
-     * 
-     * @return The first value from the ring buffer.
+     * @brief Hands count held slots back to the producer.
+     *
+     * @details Consumer side only. With overwrites the slots must have been held with hold().
+     *
+     * @param count The number of slots.
     */
-    std::optional<T> pop() noexcept {
-        if constexpr (ThreadSafe)
-            std::lock_guard<std::mutex> lock(mutex);
-
-        if (head == tail)
-            return std::nullopt;
-
-        T value = std::move(buffer[tail]);
-        tail = wrap_index(tail + 1);
-        return value;
+    void release(const size_t count) noexcept {
+        if constexpr (!Overwrite) {
+            word.store(word.load(std::memory_order_relaxed) + count, std::memory_order_release);
+        } else if (count != 0) {
+            // the held bit keeps the producer off the cursor, so a plain store both advances it and clears the bit
+            word.store(((word.load(std::memory_order_relaxed) >> SHIFT) + count) << SHIFT, std::memory_order_release);
+        }
     }
 
     /**
-     * @brief Gets the size of the ring buffer.
-     * 
-     * @return The size of the ring buffer.
+     * @brief Checks if the consumer holds the slots from the tail on.
+     *
+     * @return Always false without overwrites.
     */
-    size_t get_size() const noexcept {
-        return Size;
+    bool held() const noexcept {
+        return (word.load(std::memory_order_acquire) & HELD) != 0;
     }
 
     /**
-     * @brief Resets the head and tail ptrs to 0.
-     * 
-     * @details This function resets the head and tail ptrs to 0. It does not clear the data in the buffer.
+     * @brief Evicts the oldest slot, moving the tail past it, unless the consumer holds it.
+     *
+     * @details Producer side only.
      *
-     * @note This function is not thread safe.
+     * @param tail The tail the producer expects, a full buffer behind its head.
+     * @return True if the slot was evicted, false if the consumer holds it or moved the tail meanwhile.
     */
-    void clear() noexcept {
-        head = 0;
-        tail = 0;
+    bool evict(const size_t tail) noexcept {
+        static_assert(Overwrite, "Only a cursor of an overwriting ring buffer can be evicted");
+        size_t expected = tail << SHIFT;
+        // acquire so the consumer's reads of the slot before it last released it happen before it is overwritten
+        return word.compare_exchange_strong(expected, (tail + 1) << SHIFT, std::memory_order_acq_rel, std::memory_order_relaxed);
     }
 };
 
-template class Ring_Buffer<std::chrono::system_clock::time_point, false, AUDIO_BUFFER_SIZE>;
-template class Ring_Buffer<Audio_Segment, true, AUDIO_BUFFER_SIZE>;
+/**
+ * @brief A batch of consecutive ring buffer slots, split in at most two contiguous runs.
+ * 
+ * @details The second run starts at the beginning of the buffer when the batch wraps around, otherwise it is empty.
+ * 
+ * @param first The first contiguous run of slots.
+ * @param first_size The number of slots in the first run.
+ * @param second The second contiguous run of slots.
+ * @param second_size The number of slots in the second run.
+*/
+template <typename T>
+struct Slot_Runs {
+    T* first;
+    size_t first_size;
+    T* second;
+    size_t second_size;
+
+    size_t size() const noexcept {
+        return first_size + second_size;
+    }
+
+    T& operator[](const size_t index) const noexcept {
+        return index < first_size ? first[index] : second[index - first_size];
+    }
+};
 
 #endif // ring_buffer_tsrt_h
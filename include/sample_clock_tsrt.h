@@ -0,0 +1,70 @@
+#ifndef sample_clock_tsrt_h
+#define sample_clock_tsrt_h
+
+#include "constants_config_tsrt.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * @brief Maps absolute sample indices on the capture timeline to wall clock time.
+ *
+ * @details Every segment and window is identified by the index of its first sample since capture started, and by a
+ * sequence number. Both are plain integers counted by the recorder, so the hot path never reads a clock and results
+ * from different stages can be joined on them exactly.
+ * @details The clock is anchored once, when the input stream starts, by pairing the next sample index with the wall
+ * clock. From then on a sample's time is the anchor plus its distance from the anchor at SAMPLE_RATE, which is immune to
+ * scheduling jitter and NTP steps. Re-anchoring, e.g. when recording resumes, moves the mapping for every index.
+ *
+ * @note anchor() may be called from one thread while any thread calls time_of().
+*/
+class Sample_Clock {
+
+private:
+    // wall clock time of sample index 0, in nanoseconds since the system clock's epoch
+    std::atomic<int64_t> origin_ns{0};
+
+    static int64_t samples_to_ns(uint64_t samples) noexcept {
+        return static_cast<int64_t>(samples / SAMPLE_RATE) * 1000000000 +
+               static_cast<int64_t>(samples % SAMPLE_RATE) * 1000000000 / SAMPLE_RATE;
+    }
+
+public:
+
+    /**
+     * @brief Anchors the given sample index to the current wall clock time.
+     *
+     * @param sample_index The index of the next sample to be captured.
+    */
+    void anchor(uint64_t sample_index) noexcept {
+        anchor(sample_index, std::chrono::system_clock::now());
+    }
+
+    /**
+     * @brief Anchors the given sample index to the wall clock time it was captured at.
+     *
+     * @details Used when the device reports when a buffer was sampled, e.g. PortAudio's inputBufferAdcTime, so the
+     * timeline does not include the input latency.
+     *
+     * @param sample_index The index of the sample captured at the given time.
+     * @param at The wall clock time the sample was captured.
+    */
+    void anchor(uint64_t sample_index, std::chrono::system_clock::time_point at) noexcept {
+        const int64_t at_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(at.time_since_epoch()).count();
+        origin_ns.store(at_ns - samples_to_ns(sample_index), std::memory_order_release);
+    }
+
+    /**
+     * @brief Gets the wall clock time of the given sample.
+     *
+     * @param sample_index The absolute sample index.
+     * @return std::chrono::system_clock::time_point
+    */
+    std::chrono::system_clock::time_point time_of(uint64_t sample_index) const noexcept {
+        const int64_t ns = origin_ns.load(std::memory_order_acquire) + samples_to_ns(sample_index);
+        return std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(ns)));
+    }
+};
+
+#endif // sample_clock_tsrt_h
@@ -0,0 +1,203 @@
+#ifndef sample_ring_tsrt_h
+#define sample_ring_tsrt_h
+
+#include "constants_config_tsrt.h"
+#include "exceptions_tsrt.h"
+#include "status_codes_tsrt.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief A read-only view of contiguous audio samples.
+ *
+ * @param data The first sample.
+ * @param size The number of samples.
+*/
+struct Sample_View {
+    const float* data;
+    size_t size;
+};
+
+/**
+ * @brief A single producer ring of audio samples that hands out contiguous views of any window.
+ *
+ * @details The ring's pages are mapped twice, back to back, so a window that wraps around the end of the ring is still
+ * contiguous in memory. Writers and readers never have to split a run at the wrap point, and windows are read in place
+ * with no copies. Where a double mapping is not available the ring falls back to a heap buffer of twice the capacity and
+ * mirrors every write into the second half, which keeps the same interface at the cost of one extra copy per write.
+ * @details Samples are addressed by their absolute sample index since the ring was created, which skip() keeps in step
+ * with the capture timeline across gaps. The ring starts on a page
+ * boundary, so a view whose start is a multiple of SIMD_FLOATS is aligned to SAMPLE_ALIGNMENT.
+ *
+ * @note One thread may write. Any number of threads may read committed samples, it is up to them to stop reading a
+ * window before it is overwritten, i.e. before get_write_index() passes its start plus get_capacity().
+*/
+class Sample_Ring {
+
+private:
+    float* samples;
+    size_t capacity;
+    bool mirrored;
+    std::atomic<uint64_t> write_index;
+
+    /**
+     * @brief Maps the ring's pages twice, back to back.
+     *
+     * @param bytes The size of one mapping, a multiple of the page size.
+     * @return True if the double mapping was created.
+    */
+    bool map_double(size_t bytes) noexcept;
+
+    /**
+     * @brief Copies the count samples just written at the given ring offset into the other half of the mirrored buffer.
+    */
+    void mirror(size_t offset, size_t count) noexcept;
+
+public:
+
+    /**
+     * @brief Construct a new Sample_Ring object
+     *
+     * @param min_capacity The minimum number of samples the ring holds, rounded up to whole pages.
+     * @throw Tsrt_Exception if the memory can not be allocated.
+    */
+    explicit Sample_Ring(size_t min_capacity);
+
+    ~Sample_Ring();
+
+    // Copy and move are deleted because views point into the mapping
+    Sample_Ring(const Sample_Ring&) = delete;
+    Sample_Ring& operator=(const Sample_Ring&) = delete;
+    Sample_Ring(Sample_Ring&&) = delete;
+    Sample_Ring& operator=(Sample_Ring&&) = delete;
+
+    /**
+     * @brief Gets the contiguous region the next count samples are written to.
+     *
+     * @details Writer only. The samples are not visible to readers until commit_write() is called.
+     *
+     * @param count The number of samples about to be written, at most get_capacity().
+     * @return float* The first sample of the region.
+    */
+    float* write_region(size_t count) noexcept;
+
+    /**
+     * @brief Publishes the count samples written to the last write_region().
+     *
+     * @details Writer only.
+    */
+    void commit_write(size_t count) noexcept;
+
+    /**
+     * @brief Copies samples into the ring and publishes them.
+     *
+     * @details Writer only.
+     *
+     * @param source The samples to write.
+     * @param count The number of samples, at most get_capacity().
+    */
+    void write(const float* source, size_t count) noexcept;
+
+    /**
+     * @brief Moves the write index past count samples without writing them, e.g. over a gap in the audio.
+     *
+     * @details Writer only. The skipped samples hold stale data and must not be viewed.
+     *
+     * @param count The number of samples to skip.
+    */
+    void skip(uint64_t count) noexcept;
+
+    /**
+     * @brief Gets a contiguous view of committed samples.
+     *
+     * @param start The absolute index of the first sample.
+     * @param length The number of samples, at most get_capacity().
+     * @return Sample_View
+    */
+    Sample_View view(uint64_t start, size_t length) const noexcept;
+
+    /**
+     * @brief Gets the absolute index one past the last committed sample.
+     *
+     * @return uint64_t
+    */
+    uint64_t get_write_index() const noexcept;
+
+    /**
+     * @brief Gets the number of samples the ring holds before they are overwritten.
+     *
+     * @return size_t
+    */
+    size_t get_capacity() const noexcept;
+
+    /**
+     * @brief Checks if the ring is double mapped rather than mirrored.
+     *
+     * @return bool
+    */
+    bool is_double_mapped() const noexcept;
+};
+
+/**
+ * @brief Walks a Sample_Ring in windows of a fixed length and hop.
+ *
+ * @details Windows overlap when hop is less than length. E.g. SAMPLES_PER_SEGMENT with a hop of SAMPLES_PER_HALF_SEGMENT
+ * gives 50% overlap, any other overlap ratio is just a different hop.
+ *
+ * @param length The number of samples in a window.
+ * @param hop The number of samples between the starts of consecutive windows.
+ * @param next_start The absolute index of the next window's first sample.
+*/
+class Window_Cursor {
+
+private:
+    size_t length;
+    size_t hop;
+    uint64_t next_start;
+
+public:
+
+    Window_Cursor(size_t length, size_t hop, uint64_t start = 0) noexcept : length(length), hop(hop), next_start(start) {}
+
+    /**
+     * @brief Starts over at the given sample, e.g. after a gap in the audio.
+     *
+     * @param start The absolute index of the next window's first sample.
+    */
+    void restart(uint64_t start) noexcept {
+        next_start = start;
+    }
+
+    /**
+     * @brief Checks if the next window has been fully written up to the given write index.
+     *
+     * @param write_index The absolute index one past the last written sample.
+     * @return bool
+    */
+    bool ready(uint64_t write_index) const noexcept {
+        return next_start + length <= write_index;
+    }
+
+    /**
+     * @brief Gets the absolute index of the next window's first sample and moves past it.
+     *
+     * @return uint64_t
+    */
+    uint64_t advance() noexcept {
+        const uint64_t start = next_start;
+        next_start += hop;
+        return start;
+    }
+
+    size_t get_length() const noexcept {
+        return length;
+    }
+
+    size_t get_hop() const noexcept {
+        return hop;
+    }
+};
+
+#endif // sample_ring_tsrt_h
@@ -1,33 +1,57 @@
 #ifndef script_engine_tsrt_h
 #define script_engine_tsrt_h
 
-#include "audio_tsrt.h"
-#include "audio_segment_tsrt.h"
+#include "audio_source_tsrt.h"
 #include "constants_config_tsrt.h"
 #include "exceptions_tsrt.h"
-#include "ring_buffer_tsrt.h"
+#include "preprocessing_chain_tsrt.h"
+#include "session_tsrt.h"
 #include "speaker_id_tsrt.h"
 #include "status_codes_tsrt.h"
+#include "wake_semaphore_tsrt.h"
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <memory>
+#include <mutex>
+#include <new>
 #include <string>
+#include <thread>
 #include <tbb/tbb.h>
 #include <tbb/scalable_allocator.h>
+#include <utility>
 #include <vector>
 
 /**
  * @brief Represents the main engine of the application.
  *
- * Script_Engine manages the state of the engine, including audio ring buffer
- * and speakers vector. The audio ring buffer stores audio segments for analysis,
- * and the speakers vector stores speakers for identification.
+ * Script_Engine hosts any number of independent sessions, one per audio stream, see Session_tsrt. Each session has
+ * its own filter graph, queues, timeline and script, so streams never see each other's audio. What is expensive
+ * to hold more than once is the engine's and shared by every session: the enabled analyses and their models, the
+ * speakers vector storing speakers for identification, and the TBB arena every session's tasks run in. The engine also
+ * holds the preprocessor config, a template each session builds its own preprocessing chain from when it is opened,
+ * and can swap a new chain into every open session while they run.
  *
  * @param speech_recognition Flag indicating whether speech recognition is enabled.
  * @param speaker_diarization Flag indicating whether speaker diarization is enabled.
  * @param speaker_identification Flag indicating whether speaker identification is enabled.
  * @param emotion_recognition Flag indicating whether emotion recognition is enabled.
+ * @param arena The workers every session's tasks run on.
+ * @param running_sessions The sessions started and not stopped yet.
+ * @param tasks The session tasks queued or running in the arena, so they can be waited for.
+ * @param tasks_in_flight How many of them there are.
+ * @param idle Notified once no session runs and no task is in flight, or the engine stops, guarded by idle_mutex.
+ * @param preprocessor_config The template of the chains of sessions opened from now on, guarded by sessions_mutex.
+ * @param sessions Every session opened, indexed by id, guarded by sessions_mutex.
+ * @param wakes_deferred Set when a session task could not be allocated and its wake was left to the waker thread.
+ * @param waker_thread Schedules the input tasks of sessions a device callback woke, and the tasks that could not be
+ * allocated when they were woken, parked on waker in between, see Session_tsrt::schedule_deferred_wake().
+ * @param waker Posted when a device callback leaves a wake to the engine, a wake is deferred or the engine is
+ * destroyed, only the waker thread waits on it.
+ * @param waker_running Cleared when the engine is destroyed, the waker thread then returns.
  */
 class Script_Engine {
 
@@ -36,17 +60,127 @@ private:
     bool speech_recognition;
     bool speaker_identification;
     bool emotion_recognition;
-    bool running;
-    bool recording;
+    std::atomic<bool> running;
     std::vector<Speaker_ID, tbb::scalable_allocator<Speaker_ID>> speakers;
-    Ring_Buffer<Audio_Segment, true, AUDIO_BUFFER_SIZE> audio_buffer;
+    tbb::task_arena arena;
+    tbb::task_group tasks;
+    std::atomic<size_t> running_sessions;
+    std::atomic<size_t> tasks_in_flight;
+    std::mutex idle_mutex;
+    std::condition_variable idle;
+    mutable std::mutex sessions_mutex;
+    Preprocessor_Config preprocessor_config;
+    std::vector<std::unique_ptr<Session_tsrt>> sessions;
+    std::atomic<bool> wakes_deferred;
+    Wake_Semaphore waker;
+    std::atomic<bool> waker_running;
+    std::thread waker_thread;
 
     /**
      * @brief Default constructor.
      * 
     */
     Script_Engine();
-    
+
+    /**
+     * @brief Destroy the Script_Engine object, stopping every session and waiting for their tasks first.
+    */
+    ~Script_Engine();
+
+    // sessions schedule their tasks and report starting and stopping through the private members below
+    friend class Session_tsrt;
+
+    /**
+     * @brief Runs a session's task in the engine's arena.
+     *
+     * @details Never blocks, but allocates the task and may wake a worker, so it must not be called from a device
+     * callback, the waker thread schedules for those. run_sessions() does not return while a task is queued or running.
+     *
+     * @param task The task, must not throw.
+     * @return True if the task was queued, false if it could not be allocated, nothing is queued then and the caller
+     * leaves the wake to the waker thread, see defer_wake().
+    */
+    template <typename Task>
+    bool enqueue_task(Task&& task) noexcept {
+        tasks_in_flight.fetch_add(1);
+        try {
+            tbb::task_handle handle = tasks.defer([this, task = std::forward<Task>(task)]() {
+                task();
+                if (tasks_in_flight.fetch_sub(1) == 1)
+                    notify_if_idle();
+            });
+            arena.enqueue(std::move(handle));
+        } catch (const std::bad_alloc&) {
+            if (tasks_in_flight.fetch_sub(1) == 1)
+                notify_if_idle();
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Unparks the waker thread to schedule a session's wake whose task could not be allocated.
+     *
+     * @details The session keeps the wake pending, see Session_tsrt::schedule_deferred_wake(), the waker retries every
+     * WAIT_SLEEP_US until the task is queued.
+    */
+    void defer_wake() noexcept;
+
+    /**
+     * @brief Unparks the waker thread to schedule a session's input task a device callback woke.
+     *
+     * @details Only posts waker, so it is safe to call from the device's real-time callback.
+    */
+    void wake_waker() noexcept;
+
+    /**
+     * @brief Waits for every session task queued or running, helping run them.
+    */
+    void wait_for_tasks();
+
+    /**
+     * @brief Stops every session, waits for their tasks and closes them.
+     *
+     * @details The caller holds sessions_mutex.
+    */
+    void close_sessions();
+
+    /**
+     * @brief Counts a session starting.
+    */
+    void session_started() noexcept;
+
+    /**
+     * @brief Counts a session stopping.
+    */
+    void session_stopped() noexcept;
+
+    /**
+     * @brief Schedules every session's task a device callback, or a failed allocation, left to the engine.
+     *
+     * @details The caller holds sessions_mutex.
+    */
+    void schedule_deferred_wakes() noexcept;
+
+    /**
+     * @brief The waker thread, parks on waker and schedules every deferred wake each time it is posted. A pass that
+     * could not allocate a task again backs off for WAIT_SLEEP_US before the next, so running out of memory does not
+     * spin it.
+    */
+    void waker_loop() noexcept;
+
+    /**
+     * @brief Checks if no session runs, or the engine has stopped, and no task is in flight.
+     *
+     * @return bool
+    */
+    bool is_idle() const noexcept;
+
+    /**
+     * @brief Wakes run_sessions() if the engine is idle.
+    */
+    void notify_if_idle() noexcept;
+
 public:
     /**
      * @brief Starts the engine.
@@ -56,27 +190,85 @@ public:
     /**
      * @brief Stops the engine.
      * 
-     * Stopping the engine terminates all running threads.
+     * Stopping the engine stops every session, run_sessions() then returns.
      */
     void stop_engine() noexcept;
 
     /**
-     * @brief Starts recording.
+     * @brief Opens a session transcribing one audio stream.
+     * 
+     * The session is not started, so backpressure can still be enabled on it. Sessions may be opened while others run,
+     * a session runs in the engine's arena as soon as it is started. The analyses enabled on the engine are the ones the
+     * session runs.
+     * 
+     * @param audio_source Where the session's audio comes from.
+     * @param script_path Where to write the session's script, empty to write none.
+     * @return Session_tsrt& The session, owned by the engine for its whole life.
+     * @throw Tsrt_Exception if the session's filter graph can not be built or its script can not be opened.
      */
-    void start_recording() noexcept;
+    Session_tsrt& open_session(std::unique_ptr<Audio_Source> audio_source, const std::string& script_path = "");
 
     /**
-     * @brief Stops recording.
+     * @brief Gets a session by id.
+     * 
+     * @param id The id of the session, see Session_tsrt::get_id().
+     * @return Session_tsrt& The session.
+     * @throw Tsrt_Exception if there is no session with that id.
      */
-    void stop_recording() noexcept;
+    Session_tsrt& get_session(size_t id);
 
     /**
-     * @brief Pushes an audio segment to the audio ring buffer.
+     * @brief Returns the number of sessions opened.
      * 
-     * @param segment The audio segment to push to the audio ring buffer.
+     * @return size_t The number of sessions, running or not.
      */
-    void push_to_audio_buffer(Audio_Segment&& segment) noexcept;
-    
+    size_t get_session_count() const noexcept;
+
+    /**
+     * @brief Waits until every running session has stopped or the engine is stopped, then closes every session.
+     * 
+     * Sessions run as tasks in the engine's arena, woken by their ring buffers, see Session_tsrt, nothing polls them, so
+     * the calling thread just sleeps until the last one stops. A session that fails is logged and stopped, the others
+     * carry on. Every session is stopped and its tasks finished before the sessions are closed.
+     */
+    void run_sessions();
+
+    /**
+     * @brief Returns the TBB arena shared by every session.
+     * 
+     * @return tbb::task_arena& The engine's arena.
+     */
+    tbb::task_arena& get_arena() noexcept;
+
+    /**
+     * @brief Sets the template the preprocessing chains of sessions opened from now on are built from.
+     *
+     * Sessions already open keep the chain they were built with, see swap_preprocessing().
+     *
+     * @param config The preprocessor config, copied.
+     */
+    void set_preprocessor_config(const Preprocessor_Config& config);
+
+    /**
+     * @brief Swaps a new preprocessing chain into every open session, without stopping them or dropping audio.
+     *
+     * Every session's chain is built on the calling thread first, so the workers polling the sessions never build one,
+     * then each session swaps its chain in at its next half segment boundary, see Session_tsrt::swap_preprocessing().
+     * The config also becomes the template for sessions opened from now on. If any chain can not be built nothing is
+     * swapped.
+     *
+     * @param config The preprocessor config, e.g. from parse_preprocessor_spec().
+     * @throw Tsrt_Exception if a chain can not be built.
+     */
+    void swap_preprocessing(const Preprocessor_Config& config);
+
+    /**
+     * @brief Returns the template sessions' preprocessing chains are built from.
+     *
+     * @return Preprocessor_Config A copy of the config.
+     */
+    Preprocessor_Config get_preprocessor_config() const;
+
     /**
      * @brief Adds a speaker to the speakers vector.
      * 
@@ -176,13 +368,6 @@ public:
      */
     bool is_running() const noexcept;
 
-    /**
-     * @brief Returns whether the engine is recording.
-     * 
-     * @return bool Whether the engine is recording.
-     */
-    bool is_recording() const noexcept;
-
     /**
      * @brief Returns a const reference to the speakers vector.
      * 
@@ -0,0 +1,259 @@
+#ifndef segment_pool_tsrt_h
+#define segment_pool_tsrt_h
+
+#include "aligned_samples_tsrt.h"
+#include "constants_config_tsrt.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+
+/**
+ * @brief Snapshot of a Segment_Pool's usage.
+ *
+ * @param capacity The number of buffers in the pool.
+ * @param in_use The number of buffers currently held by segments.
+ * @param high_water The most buffers held at once.
+ * @param exhausted The number of allocations that found the pool empty and went to the heap instead.
+*/
+struct Segment_Pool_Stats {
+    size_t capacity;
+    size_t in_use;
+    size_t high_water;
+    size_t exhausted;
+};
+
+/**
+ * @brief A growable, lock-free stack of free slot indices, the bookkeeping behind Segment_Pool and Window_Pins.
+ *
+ * @details Slots come in chunks of equal size, add_chunk() links a new chunk's slots onto the stack and slot i lives at
+ * offset i % chunk capacity of chunk i / chunk capacity. The chunk table is allocated up front, so a chunk never moves.
+ * @details The head is tagged with a counter so a slot that is taken and returned between a load and a compare and
+ * swap can not corrupt the stack. pop() and push() never allocate, lock or make a syscall, so any thread may use them,
+ * also while a chunk is being added.
+ * @details Counts slots in use, their high water mark and pops that found the stack empty.
+*/
+class Free_List {
+
+public:
+    static constexpr uint32_t EMPTY = std::numeric_limits<uint32_t>::max(); // returned by pop() when every slot is in use
+
+private:
+    std::unique_ptr<std::unique_ptr<std::atomic<uint32_t>[]>[]> next_free;
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> head;
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> in_use;
+    std::atomic<size_t> high_water;
+    std::atomic<size_t> exhausted;
+    std::atomic<uint32_t> chunk_count;
+    uint32_t chunk_capacity;
+    uint32_t max_chunks;
+
+public:
+
+    /**
+     * @brief Construct a new Free_List object without any slots, add_chunk() adds them.
+     *
+     * @param chunk_capacity The number of slots each chunk adds.
+     * @param max_chunks The most chunks the stack can grow to.
+     * @throw Tsrt_Exception if a size is 0, the slots would not fit in 32 bit indices, or the chunk table can not be allocated.
+    */
+    Free_List(size_t chunk_capacity, size_t max_chunks);
+
+    // Copy and move are deleted because other threads may be using the stack
+    Free_List(const Free_List&) = delete;
+    Free_List& operator=(const Free_List&) = delete;
+    Free_List(Free_List&&) = delete;
+    Free_List& operator=(Free_List&&) = delete;
+
+    /**
+     * @brief Takes a free slot.
+     *
+     * @return uint32_t The slot index, or EMPTY if every slot is in use.
+    */
+    uint32_t pop() noexcept;
+
+    /**
+     * @brief Returns a slot taken with pop().
+     *
+     * @param index The slot index.
+    */
+    void push(uint32_t index) noexcept;
+
+    /**
+     * @brief Adds a chunk of free slots, numbered on from the last chunk's.
+     *
+     * @details Allocates, so it is not for real time threads. Calls must not overlap, pop() and push() may run meanwhile.
+     *
+     * @return bool false if the stack already has max_chunks chunks.
+     * @throw Tsrt_Exception if the chunk's links can not be allocated.
+    */
+    bool add_chunk();
+
+    uint32_t get_chunk_capacity() const noexcept {
+        return chunk_capacity;
+    }
+
+    uint32_t get_chunk_count() const noexcept {
+        return chunk_count.load(std::memory_order_acquire);
+    }
+
+    uint32_t get_max_chunks() const noexcept {
+        return max_chunks;
+    }
+
+    /**
+     * @brief Gets the usage and exhaustion counters.
+     *
+     * @return Segment_Pool_Stats
+    */
+    Segment_Pool_Stats get_stats() const noexcept;
+};
+
+/**
+ * @brief A growable, lock-free pool of equally sized sample buffers.
+ *
+ * @details Buffers are carved out of slabs of one chunk each, reserve() allocates slabs until the pool has enough chunks.
+ * Buffers start on a SAMPLE_ALIGNMENT boundary and are padded to whole SIMD_FLOATS blocks, so they are laid out back to
+ * back at padded_samples(buffer_size) within a slab. Free buffers are tracked by a Free_List, so acquire(), get_buffer()
+ * and release() never allocate, lock or make a syscall and any thread may use them, also while the pool grows.
+ * @details Recycled buffers are not cleared, the previous holder's samples are still in them.
+ *
+ * @note Audio_Segment allocates through the pool returned by for_size() and hands its buffer back when it is destroyed,
+ * so half segments never touch the heap in steady state. The engine reserves a chunk of the pool for every session it
+ * opens. Exhaustion is counted rather than fatal.
+*/
+class Segment_Pool {
+
+private:
+    std::unique_ptr<std::unique_ptr<float[], Aligned_Samples_Deleter>[]> slabs;
+    Free_List free_list;
+    std::mutex grow_mutex;
+    size_t buffer_size;
+    size_t buffer_stride;
+
+public:
+
+    /**
+     * @brief Construct a new Segment_Pool object without any buffers, reserve() adds them.
+     *
+     * @param buffer_size The number of samples in each buffer.
+     * @param chunk_capacity The number of buffers in each chunk.
+     * @param max_chunks The most chunks the pool can grow to.
+     * @throw Tsrt_Exception if a size is 0 or too large, or the slab table can not be allocated.
+    */
+    Segment_Pool(size_t buffer_size, size_t chunk_capacity, size_t max_chunks);
+
+    // Copy and move are deleted because segments point into the slabs
+    Segment_Pool(const Segment_Pool&) = delete;
+    Segment_Pool& operator=(const Segment_Pool&) = delete;
+    Segment_Pool(Segment_Pool&&) = delete;
+    Segment_Pool& operator=(Segment_Pool&&) = delete;
+
+    /**
+     * @brief Grows the pool to at least the given number of chunks, or as close to it as max_chunks allows.
+     *
+     * @details Allocates, so it is not for real time threads. Buffers held meanwhile stay where they are.
+     *
+     * @param chunks The number of chunks.
+     * @return bool false if the pool could not grow that far because of max_chunks.
+     * @throw Tsrt_Exception if a slab can not be allocated.
+    */
+    bool reserve(size_t chunks);
+
+    /**
+     * @brief Takes a free buffer from the pool.
+     *
+     * @return uint32_t The buffer's index, or Free_List::EMPTY if the pool is exhausted.
+    */
+    uint32_t acquire() noexcept;
+
+    /**
+     * @brief Gets a buffer taken with acquire().
+     *
+     * @param index The buffer's index.
+     * @return float* The buffer.
+    */
+    float* get_buffer(uint32_t index) const noexcept;
+
+    /**
+     * @brief Returns a buffer taken with acquire() to the pool.
+     *
+     * @param index The buffer's index.
+    */
+    void release(uint32_t index) noexcept;
+
+    /**
+     * @brief Gets the number of samples in each buffer.
+     *
+     * @return size_t
+    */
+    size_t get_buffer_size() const noexcept;
+
+    /**
+     * @brief Gets the pool's usage and exhaustion counters.
+     *
+     * @return Segment_Pool_Stats
+    */
+    Segment_Pool_Stats get_stats() const noexcept;
+
+    /**
+     * @brief Gets the pool of half segment buffers, SAMPLES_PER_HALF_SEGMENT samples each.
+     *
+     * @return Segment_Pool&
+    */
+    static Segment_Pool& half_segments();
+
+    /**
+     * @brief Gets the pool whose buffers hold exactly the given number of samples.
+     *
+     * @param size The number of samples.
+     * @return Segment_Pool* The pool, or nullptr if no pool serves that size.
+    */
+    static Segment_Pool* for_size(size_t size);
+
+    /**
+     * @brief Grows the half segment pool to one chunk per session.
+     *
+     * @param sessions The number of sessions open.
+     * @return bool false if the pool reached its max_chunks first, sessions past it may allocate on the heap.
+     * @throw Tsrt_Exception if a slab can not be allocated.
+    */
+    static bool reserve_sessions(size_t sessions);
+};
+
+/**
+ * @brief Deleter for sample buffers that hands pooled buffers back to their pool and deletes the rest.
+ *
+ * @param pool The pool the buffer came from, or nullptr if it was allocated on the heap.
+ * @param index The buffer's index in the pool.
+*/
+struct Sample_Deleter {
+    Segment_Pool* pool = nullptr;
+    uint32_t index = 0;
+
+    void operator()(float* buffer) const noexcept {
+        if (pool != nullptr)
+            pool->release(index);
+        else
+            free_aligned_samples(buffer);
+    }
+};
+
+using Sample_Buffer = std::unique_ptr<float[], Sample_Deleter>;
+
+/**
+ * @brief Allocates a sample buffer, from the matching pool when there is one and it is not exhausted.
+ *
+ * @details Either way the buffer is aligned to SAMPLE_ALIGNMENT and padded to whole SIMD_FLOATS blocks.
+ * @details Heap buffers are zero initialised, pooled buffers are not.
+ *
+ * @param size The number of samples.
+ * @return Sample_Buffer A buffer that finds its way back to where it came from when it is destroyed.
+ * @throw std::bad_alloc if the pool can not serve the size and the heap allocation fails.
+*/
+Sample_Buffer allocate_samples(size_t size);
+
+#endif // segment_pool_tsrt_h
@@ -0,0 +1,238 @@
+#ifndef segment_view_tsrt_h
+#define segment_view_tsrt_h
+
+#include "constants_config_tsrt.h"
+#include "sample_ring_tsrt.h"
+#include "segment_pool_tsrt.h"
+#include "wait_strategy_tsrt.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+class Window_Pins;
+
+/**
+ * @brief One window's samples shared past the window's release, the block every view of it counts its references in.
+ *
+ * @param refs The number of views of the pin, 0 while it is free.
+ * @param index The pin's slot in its Window_Pins.
+ * @param pins The pool the pin goes back to.
+ * @param samples The window's samples in the session's Sample_Ring.
+ * @param length The number of samples.
+ * @param start_sample The absolute index of the first sample, read by the session's writer while the pin is held.
+*/
+struct Window_Pin {
+    std::atomic<uint32_t> refs{0};
+    uint32_t index{0};
+    Window_Pins* pins{nullptr};
+    const float* samples{nullptr};
+    size_t length{0};
+    std::atomic<uint64_t> start_sample{0};
+};
+
+/**
+ * @brief An immutable, reference counted view of a window's samples in a session's Sample_Ring.
+ *
+ * @details An Audio_Window is only valid until its analysis stage releases it. A stage that needs the audio for longer
+ * shares the window instead, see Audio_Window::share(), which pins its samples so the session does not overwrite them.
+ * Copying a view only bumps the pin's intrusive atomic reference count, so any number of stages can hold the same audio
+ * together and nothing is copied.
+ * @details slice() gives a view of part of the window that shares the same pin. When the last view of a pin is destroyed
+ * the pin goes back to its Window_Pins and the samples to the session's writer, so sharing never allocates.
+ * @details Views never hand out mutable samples. A slice is only aligned when its offset is a multiple of SIMD_FLOATS.
+ *
+ * @note Views hold the session back like an analysis stage that does not release its windows, once the writer would
+ * overwrite their samples it drops audio, or holds it back with backpressure. They must be dropped before the session
+ * is closed.
+ *
+ * @param pin The shared pin, nullptr for an empty view.
+ * @param offset The first sample of the view within the window.
+ * @param length The number of samples in the view.
+*/
+class Segment_View {
+
+private:
+    Window_Pin* pin;
+    size_t offset;
+    size_t length;
+
+    friend class Window_Pins;
+
+    Segment_View(Window_Pin* pin, size_t offset, size_t length) noexcept : pin(pin), offset(offset), length(length) {}
+
+    /**
+     * @brief Drops this view's reference, handing the pin back to its pool if it was the last.
+    */
+    void release() noexcept;
+
+    void swap(Segment_View& other) noexcept {
+        std::swap(pin, other.pin);
+        std::swap(offset, other.offset);
+        std::swap(length, other.length);
+    }
+
+public:
+
+    Segment_View() noexcept : pin(nullptr), offset(0), length(0) {}
+
+    // Copy constructor, O(1), shares the pin
+    Segment_View(const Segment_View& other) noexcept : pin(other.pin), offset(other.offset), length(other.length) {
+        if (pin != nullptr)
+            pin->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Move constructor
+    Segment_View(Segment_View&& other) noexcept : pin(other.pin), offset(other.offset), length(other.length) {
+        other.pin = nullptr;
+        other.offset = 0;
+        other.length = 0;
+    }
+
+    // Copy assignment operator
+    Segment_View& operator=(const Segment_View& other) noexcept {
+        Segment_View temp(other);
+        swap(temp);
+        return *this;
+    }
+
+    // Move assignment operator
+    Segment_View& operator=(Segment_View&& other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    ~Segment_View() {
+        release();
+    }
+
+    // Equality comparison operator, views are equal if they see the same samples of the same pin
+    bool operator==(const Segment_View& other) const noexcept {
+        return pin == other.pin && offset == other.offset && length == other.length;
+    }
+
+    /**
+     * @brief Gets a view of part of this view, sharing the same pin.
+     *
+     * @param offset The first sample of the slice, relative to this view.
+     * @param length The number of samples in the slice.
+     * @return Segment_View The slice.
+     * @throw Tsrt_Exception if the slice does not fit in this view.
+    */
+    Segment_View slice(size_t offset, size_t length) const;
+
+    /**
+     * @brief Gets the view's samples.
+     *
+     * @return Sample_View Empty for an empty view.
+    */
+    Sample_View get_samples() const noexcept {
+        return pin != nullptr ? Sample_View{pin->samples + offset, length} : Sample_View{nullptr, 0};
+    }
+
+    /**
+     * @brief Gets the absolute index of the view's first sample on the capture timeline, see Sample_Clock.
+     *
+     * @return uint64_t 0 for an empty view.
+    */
+    uint64_t get_start_sample() const noexcept {
+        return pin != nullptr ? pin->start_sample.load(std::memory_order_relaxed) + offset : 0;
+    }
+
+    size_t get_size() const noexcept {
+        return length;
+    }
+
+    /**
+     * @brief Gets the number of views sharing this view's pin.
+     *
+     * @return size_t 0 for an empty view.
+    */
+    size_t use_count() const noexcept {
+        return pin != nullptr ? pin->refs.load(std::memory_order_relaxed) : 0;
+    }
+
+    bool empty() const noexcept {
+        return pin == nullptr;
+    }
+};
+
+/**
+ * @brief A fixed capacity, lock-free pool of the pins a session's windows are shared with, see Segment_View.
+ *
+ * @details Free pins are tracked by a Free_List, so pin() and the release of the last view never allocate, lock or make
+ * a syscall, and any thread may use them. The session's writer checks oldest_pinned() before it overwrites samples.
+ * @details Exhaustion is counted rather than fatal, pin() then returns an empty view.
+*/
+class Window_Pins {
+
+private:
+    std::unique_ptr<Window_Pin[]> pins;
+    Free_List free_list;
+    size_t capacity;
+    Wake_Target* release_target;
+
+    friend class Segment_View;
+
+    /**
+     * @brief Takes back a pin whose last view was destroyed and wakes the release target.
+    */
+    void release(Window_Pin& pin) noexcept;
+
+public:
+
+    /**
+     * @brief Construct a new Window_Pins object
+     *
+     * @param capacity The most windows shared at once.
+     * @throw Tsrt_Exception if capacity is 0 or the pins can not be allocated.
+    */
+    explicit Window_Pins(size_t capacity);
+
+    // Copy and move are deleted because views point into the pins
+    Window_Pins(const Window_Pins&) = delete;
+    Window_Pins& operator=(const Window_Pins&) = delete;
+    Window_Pins(Window_Pins&&) = delete;
+    Window_Pins& operator=(Window_Pins&&) = delete;
+
+    /**
+     * @brief Has the release of every pin's last view wake the given task, e.g. a writer held back by the pin.
+     *
+     * @details Must be called before any window is shared, the target is read without synchronisation.
+     *
+     * @param target The task, nullptr for none.
+    */
+    void set_release_target(Wake_Target* target) noexcept;
+
+    /**
+     * @brief Pins a window's samples.
+     *
+     * @details The caller must hold the window, i.e. not have released it from the audio ring buffer yet.
+     *
+     * @param samples The window's samples.
+     * @param start_sample The absolute index of the window's first sample.
+     * @return Segment_View A view of the whole window, empty if every pin is held.
+    */
+    Segment_View pin(const Sample_View& samples, uint64_t start_sample) noexcept;
+
+    /**
+     * @brief Gets the first sample of the oldest window a view holds.
+     *
+     * @details Writer side. Scans the pins, so it is meant to be called once per batch of writes.
+     *
+     * @param none Returned if it is older than every pinned window, or nothing is pinned.
+     * @return uint64_t
+    */
+    uint64_t oldest_pinned(uint64_t none) const noexcept;
+
+    /**
+     * @brief Gets the pool's usage and exhaustion counters.
+     *
+     * @return Segment_Pool_Stats
+    */
+    Segment_Pool_Stats get_stats() const noexcept;
+};
+
+#endif // segment_view_tsrt_h
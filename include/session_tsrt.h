@@ -0,0 +1,574 @@
+#ifndef session_tsrt_h
+#define session_tsrt_h
+
+#include "audio_source_tsrt.h"
+#include "audio_window_tsrt.h"
+#include "broadcast_ring_buffer_tsrt.h"
+#include "constants_config_tsrt.h"
+#include "exceptions_tsrt.h"
+#include "log_mel_tsrt.h"
+#include "preprocessing_chain_tsrt.h"
+#include "sample_clock_tsrt.h"
+#include "sample_ring_tsrt.h"
+#include "segment_view_tsrt.h"
+#include "spsc_ring_buffer_tsrt.h"
+#include "status_codes_tsrt.h"
+#include "voice_activity_tsrt.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class Script_Engine;
+
+// The analyses a session runs on every window
+enum analysis_stage {
+    SPEECH_RECOGNITION,
+    SPEAKER_DIARIZATION,
+    SPEAKER_IDENTIFICATION,
+    EMOTION_RECOGNITION,
+};
+
+/**
+ * @brief What voice activity detection saved a session.
+ *
+ * @param windows The windows published to the analysis stages.
+ * @param speech_windows The windows tagged as speech.
+ * @param analysed The analyses run, one per window and stage.
+ * @param skipped The analyses skipped because their window was not speech.
+*/
+struct Voice_Activity_Stats {
+    uint64_t windows;
+    uint64_t speech_windows;
+    uint64_t analysed;
+    uint64_t skipped;
+};
+
+/**
+ * @brief One audio stream transcribed by the engine.
+ *
+ * A session owns everything that belongs to its stream: the audio source, the capture ring buffer, its own FFmpeg filter
+ * graph, the sample ring and timeline, the audio ring buffer its analyses read windows from, and its script. The
+ * analyses, their models and the known speakers are the engine's and are shared by every session.
+ *
+ * Sessions do not have threads of their own, they run as tasks in the engine's shared TBB arena, so many streams share
+ * the cores of one machine. The input task runs the source if it is run here, preprocesses what it captured and
+ * publishes windows, and each analysis is a task of its own reading the audio ring buffer, so a session's analyses run
+ * in parallel. Nothing polls: a task that runs dry lingers as the ring buffer's wait strategy says and then parks, and
+ * is scheduled again by the next commit into the ring buffer it reads, see Wake_Target, or by whatever else it waits
+ * for, the recording flag, a chain to swap in, an analysis releasing windows, the session stopping. A task that did
+ * work queues itself behind the other sessions' tasks rather than looping, so no session holds a worker.
+ *
+ * A callback driven source, e.g. a device in CAPTURE_CALLBACK mode, needs no thread, the input task starts and stops it.
+ * Its commits run on the device's real-time thread, which must not allocate a task or wake a worker, so they only count
+ * the wake, and one finding the input task parked posts the engine's waker thread to schedule it, see
+ * schedule_deferred_wake(). A live source whose produce() waits for its pacing, and a source reading a pipe
+ * that waits on its writer, are run by a recording thread of the session's own, which only copies audio into the
+ * capture ring buffer. A worker never blocks on a session's input.
+ *
+ * @param id The session's id, its index in the engine.
+ * @param engine The engine hosting the session.
+ * @param audio_source Where the session's audio comes from.
+ * @param capture_ring Half segments from the source waiting to be preprocessed.
+ * @param preprocessor The session's own preprocessing chain, built from the engine's template config and only used by
+ * the input task. A chain handed to swap_preprocessing() takes its place at the next
+ * half segment boundary.
+ * @param backpressure Flag indicating whether audio is held back rather than dropped when analysis falls behind.
+ * @param voice_activity Tags every window published as speech or not, speech recognition, speaker identification and
+ * emotion recognition skip the windows that are not, diarization sees them all to place speaker turns.
+ * @param mel_features The log mel features of every window published, computed once for all of the analyses.
+ * @param window_pins The pins of windows an analysis shared past their release, the writer does not overwrite them.
+ * @param analyses The analysis stages registered as readers of the audio ring buffer, with their consumer ids.
+ * @param callback_driven Whether the source is callback driven, so its commits must not schedule the input task.
+ * @param input_wakes The wakes of the input task not yet seen by it, the task is scheduled while it is above 0.
+ * @param input_wake_deferred Set by a callback's commit that found the input task parked, or when the task could not
+ * be allocated, whoever schedules the task next clears it.
+ * @param analysis_wakes The same for every analysis task, indexed like analyses.
+ * @param analysis_wake_deferred Set when an analysis task could not be allocated, indexed like analyses.
+ * @param script The session's script, not open if no script path was given.
+*/
+class Session_tsrt {
+
+private:
+
+    struct Analysis_Consumer {
+        analysis_stage stage;
+        size_t consumer;
+    };
+
+    // wakes the input task on every half segment the source commits, a callback's commit only counts the wake
+    struct Input_Wake : Wake_Target {
+        Session_tsrt& session;
+
+        explicit Input_Wake(Session_tsrt& session) : session(session) {}
+
+        void wake() noexcept override;
+    };
+
+    // wakes the input task when the last view of a shared window drops, the writer may be held back by it
+    struct Pin_Wake : Wake_Target {
+        Session_tsrt& session;
+
+        explicit Pin_Wake(Session_tsrt& session) : session(session) {}
+
+        void wake() noexcept override;
+    };
+
+    // wakes every analysis task on every window published
+    struct Analysis_Wake : Wake_Target {
+        Session_tsrt& session;
+
+        explicit Analysis_Wake(Session_tsrt& session) : session(session) {}
+
+        void wake() noexcept override;
+    };
+
+    size_t id;
+    Script_Engine& engine;
+    std::unique_ptr<Audio_Source> audio_source;
+    bool callback_driven;
+    std::unique_ptr<Capture_Ring_Buffer> capture_ring;
+    std::unique_ptr<Preprocessing_Chain> preprocessor;
+    bool backpressure;
+    std::atomic<bool> running;
+    std::atomic<bool> recording;
+    std::atomic<bool> input_finished;
+    Sample_Clock sample_clock;
+    Sample_Ring sample_ring;
+    Window_Cursor window_cursor;
+    uint64_t window_sequence;
+    Broadcast_Ring_Buffer<Audio_Window, AUDIO_BUFFER_SIZE, ANALYSIS_STAGE_COUNT, ANALYSIS_OVERFLOW_POLICY> audio_buffer;
+    Voice_Activity_Detector voice_activity;
+    Log_Mel_Extractor mel_features;
+    Window_Pins window_pins;
+    std::vector<Analysis_Consumer> analyses;
+    Input_Wake input_wake;
+    Pin_Wake pin_wake;
+    Analysis_Wake analysis_wake;
+    std::atomic<uint64_t> input_wakes;
+    std::atomic<bool> input_wake_deferred;
+    // set by every commit into the capture ring buffer, so a resumed input task knows a publish woke it
+    std::atomic<bool> capture_published;
+    std::array<std::atomic<uint64_t>, ANALYSIS_STAGE_COUNT> analysis_wakes;
+    std::array<std::atomic<bool>, ANALYSIS_STAGE_COUNT> analysis_wake_deferred;
+    std::ofstream script;
+    std::thread recording_thread;
+    // steady clock ticks, read by get_elapsed() on any thread while start() and stop() write them
+    std::atomic<std::chrono::steady_clock::rep> started;
+    std::atomic<std::chrono::steady_clock::rep> finished;
+
+    // recorder state, only touched by whoever produces, the recording thread if there is one, else the input task
+    bool streaming;
+    bool err_on_last_iteration;
+
+    // preprocessing state, half segments at the head of the capture ring buffer are the filter graph's until it
+    // releases them, so fed_segments of them have been pushed, the oldest as input oldest_fed_input
+    size_t fed_segments;
+    uint64_t oldest_fed_input;
+    // filtered audio pulled from the graph but held back by backpressure, a view into the graph's frame
+    Filtered_Audio filtered;
+    bool filtered_pending;
+    bool preprocessor_flushed;
+    // a chain built off the hot path waiting to be swapped in, guarded by next_preprocessor_mutex, the flag is only
+    // there so the input task does not take the mutex
+    std::mutex next_preprocessor_mutex;
+    std::unique_ptr<Preprocessing_Chain> next_preprocessor;
+    std::atomic<bool> preprocessor_swap_pending;
+    std::atomic<uint64_t> preprocessor_swaps;
+    // frames the chains returned with a timestamp before samples already written
+    std::atomic<uint64_t> pts_regressions;
+    // the frames denoised by the chains swapped out, only touched by the input task
+    Denoise_Stats retired_denoising;
+    // written by the session's tasks, read by anyone for reporting
+    std::atomic<uint64_t> published_windows;
+    std::atomic<uint64_t> speech_windows;
+    std::atomic<uint64_t> analysed_windows;
+    std::atomic<uint64_t> skipped_windows;
+    std::atomic<uint64_t> denoised_frames;
+    std::atomic<uint64_t> bypassed_frames;
+
+    /**
+     * @brief Starts or stops the source as the recording flag changes.
+     *
+     * @return bool Whether it tried to, a failed attempt is retried by the next call.
+     * @throw Tsrt_Exception on consecutive errors starting or stopping the source.
+    */
+    bool follow_recording();
+
+    /**
+     * @brief Starts or stops the source as the recording flag changes and has it produce once while it runs.
+     *
+     * @return bool False once the source has no more audio.
+     * @throw Tsrt_Exception on consecutive errors starting or stopping the source.
+    */
+    bool record();
+
+    /**
+     * @brief Checks if the source is run by a recording thread of the session's own rather than by the input task.
+     *
+     * @return bool Whether the source is live or its produce() may block, and it is not callback driven.
+    */
+    bool records_on_thread() const noexcept;
+
+    /**
+     * @brief Schedules the input task unless it already is, see input_wakes, or a wake a callback left to the engine.
+    */
+    void wake_input() noexcept;
+
+    /**
+     * @brief Schedules an analysis task unless it already is, see analysis_wakes, or a wake left to the engine.
+     *
+     * @param index The analysis' index in analyses.
+    */
+    void wake_analysis(size_t index) noexcept;
+
+    /**
+     * @brief Queues the input task, or leaves the wake to the engine's waker thread if the task can not be allocated.
+    */
+    void schedule_input() noexcept;
+
+    /**
+     * @brief Queues an analysis task, or leaves the wake to the engine's waker thread if the task can not be allocated.
+     *
+     * @param index The analysis' index in analyses.
+    */
+    void schedule_analysis(size_t index) noexcept;
+
+    /**
+     * @brief The input task, calls poll() until it runs dry, then lingers and parks. Logs and stops the session if it fails.
+     *
+     * @param parked Whether a wake scheduled it rather than its own previous run.
+    */
+    void run_input(bool parked) noexcept;
+
+    /**
+     * @brief An analysis task, analyses batches of windows until it runs dry, then lingers and parks.
+     *
+     * @param index The analysis' index in analyses.
+     * @param parked Whether a wake scheduled it rather than its own previous run.
+    */
+    void run_analysis(size_t index, bool parked) noexcept;
+
+    /**
+     * @brief Moves the input forward as far as it can without waiting.
+     *
+     * Starts and stops the source as the recording flag changes unless a recording thread does, has a source run here
+     * produce, and preprocesses what it captured into windows for the analyses. Once the source has no more audio and
+     * everything has been analysed the session stops. Once the session has stopped, stops a source it started.
+     *
+     * @return bool Whether any work was done.
+     * @throw Tsrt_Exception if the stream fails, the session is stopped first.
+    */
+    bool poll();
+
+    /**
+     * @brief Runs a live or blocking source until the session stops or the source runs out of audio.
+    */
+    void recording_loop() noexcept;
+
+    /**
+     * @brief Pushes the filtered audio pulled last into the sample ring.
+     *
+     * @details Goes in half segment pieces so frames larger than the sample ring fit, a frame that starts before the
+     * samples already written is trimmed to what follows them and counted as a timestamp regression. Pieces dropped
+     * because an analysis stage is too far behind are gone, as with push_audio_samples().
+     *
+     * @return bool false if backpressure held a piece back, filtered then starts at that piece.
+    */
+    bool push_filtered();
+
+    /**
+     * @brief Pushes up to SESSION_POLL_SEGMENTS half segments from the capture ring buffer into the filter graph and
+     * every frame it filters into the sample ring.
+     *
+     * @details The sink is drained before each push. Half segments are released from the capture ring buffer once the
+     * graph is done with them, and once the source has finished the graph is flushed so its delay comes out too. A
+     * chain waiting to be swapped in stops the pushes, the current one is flushed and drained, and the new one takes
+     * over from the next half segment, so no audio is dropped or published twice.
+     *
+     * @return bool Whether any audio moved.
+     * @throw Tsrt_Exception if the filter graph fails.
+    */
+    bool preprocess();
+
+    /**
+     * @brief Releases the half segments at the head of the capture ring buffer the filter graph is done with.
+    */
+    void release_preprocessed();
+
+    /**
+     * @brief Updates the denoising counters from the chains swapped out and the current one.
+    */
+    void count_denoising() noexcept;
+
+    /**
+     * @brief Runs one analysis on a batch of windows.
+     *
+     * Windows that are not speech are skipped by every analysis but diarization.
+     *
+     * @param stage The analysis to run.
+     * @param windows The windows, valid until they are released.
+    */
+    void analyse(analysis_stage stage, const Slot_Runs<const Audio_Window>& windows);
+
+    /**
+     * @brief Appends a line per window to the script.
+     *
+     * @param windows The windows, in timeline order.
+    */
+    void write_script(const Slot_Runs<const Audio_Window>& windows);
+
+public:
+
+    /**
+     * @brief Construct a new Session_tsrt object
+     *
+     * Registers a reader of the audio ring buffer for every analysis enabled on the engine.
+     *
+     * @param id The session's id.
+     * @param engine The engine hosting the session.
+     * @param preprocessor_config The template the session's filter graph is built from.
+     * @param audio_source Where the session's audio comes from.
+     * @param script_path Where to write the session's script, empty to write none.
+     * @throw Tsrt_Exception if the filter graph can not be built or the script can not be opened.
+    */
+    Session_tsrt(size_t id, Script_Engine& engine, const Preprocessor_Config& preprocessor_config, std::unique_ptr<Audio_Source> audio_source, const std::string& script_path);
+
+    /**
+     * @brief Destroy the Session_tsrt object, stopping and closing it first.
+    */
+    ~Session_tsrt();
+
+    /**
+     * @brief Starts the session recording.
+     *
+     * Starts the recording thread if the source is live or may block and is not callback driven, otherwise the source
+     * is run by the input task, which is scheduled here. A session runs once: starting it again while it runs only
+     * resumes recording, starting it once it has stopped throws.
+     *
+     * @throw Tsrt_Exception INVALID_OPERATION if the session has already stopped.
+    */
+    void start();
+
+    /**
+     * @brief Stops the session.
+     *
+     * Safe to call from any thread, more than once. The input task is woken to stop a source it started, the recording
+     * thread notices within THREAD_SLEEP_MS, or once a read blocked on a pipe returns, and stops the source, and the
+     * engine closes the session once its tasks are done.
+    */
+    void stop() noexcept;
+
+    /**
+     * @brief Waits for the recording thread, stops the source and flushes the script.
+     *
+     * Must only be called once the session has stopped and its tasks are done, the engine does so once its sessions have
+     * stopped. Safe to call more than once.
+    */
+    void close() noexcept;
+
+    /**
+     * @brief Schedules the input task if a callback's commit found it parked and nothing has scheduled it since, and
+     * every task whose wake was left to the engine because it could not be allocated.
+     *
+     * Called by the engine's waker thread, and by the engine before it waits for the session's tasks, never by the
+     * callback itself.
+    */
+    void schedule_deferred_wake() noexcept;
+
+    /**
+     * @brief Starts recording.
+    */
+    void start_recording() noexcept;
+
+    /**
+     * @brief Stops recording, the source is stopped until recording starts again.
+    */
+    void stop_recording() noexcept;
+
+    /**
+     * @brief Appends preprocessed samples to the sample ring and publishes every window they complete.
+     *
+     * Windows are WINDOW_LENGTH samples long and start every WINDOW_HOP samples. They are views into the
+     * sample ring, so overlapping windows share their samples and nothing is copied or allocated.
+     * Samples still referenced by a window an analysis stage has not released, or by a view of a window shared
+     * past its release, are never overwritten, the chunk is dropped instead. The sample ring follows the capture timeline, so a chunk that does not
+     * start where the last one ended, because audio was dropped upstream or here, starts windowing over.
+     *
+     * With backpressure enabled the chunk is also held back if publishing its windows would drop any,
+     * so the caller can retry it once the analysis stages catch up and no audio is lost.
+     *
+     * Voice activity detection and log mel feature extraction run on the samples as they are appended, each window is
+     * tagged as speech or not from the frames up to its end and carries a view of the features of the frames inside it.
+     *
+     * @param samples The samples to append.
+     * @param count The number of samples.
+     * @param sample_index The absolute index of the first sample on the capture timeline.
+     * @return tsrt_status_code TRY_AGAIN if the slowest analysis stage is too far behind and the samples were not written,
+     * INVALID_ARGUMENT if count is larger than the sample ring or sample_index goes backwards.
+    */
+    tsrt_status_code push_audio_samples(const float* samples, size_t count, uint64_t sample_index) noexcept;
+
+    /**
+     * @brief Checks if every analysis stage has released every window published so far.
+     *
+     * Must only be called by the thread that pushes audio samples.
+     *
+     * @return bool Whether the analysis stages have caught up.
+    */
+    bool audio_drained() noexcept;
+
+    /**
+     * @brief Enables backpressure.
+     *
+     * One time operation, for input that can wait, e.g. a file, where losing audio is worse than falling behind.
+     * push_audio_samples() then returns TRY_AGAIN instead of dropping windows when an analysis stage is a full
+     * buffer behind. Calling while the session is running returns a tsrt_status_code of INVALID_OPERATION.
+     *
+     * @return tsrt_status_code The status code of the operation.
+    */
+    tsrt_status_code enable_backpressure() noexcept;
+
+    /**
+     * @brief Returns whether backpressure is enabled.
+     *
+     * @return bool Whether backpressure is enabled.
+    */
+    bool backpressure_enabled() const noexcept;
+
+    /**
+     * @brief Returns the session's id.
+     *
+     * @return size_t
+    */
+    size_t get_id() const noexcept;
+
+    /**
+     * @brief Returns the session's audio source.
+     *
+     * @return const Audio_Source&
+    */
+    const Audio_Source& get_audio_source() const noexcept;
+
+    /**
+     * @brief Returns the clock that maps sample indices on the session's timeline to wall clock time.
+     *
+     * The source anchors it when it starts, everyone else only reads it.
+     *
+     * @return Sample_Clock& The session's sample clock.
+    */
+    Sample_Clock& get_sample_clock() noexcept;
+
+    /**
+     * @brief Returns how many segments the capture ring buffer dropped and its high water occupancy.
+     *
+     * @return Ring_Buffer_Stats The overflow counters of the capture ring buffer.
+    */
+    Ring_Buffer_Stats get_capture_buffer_stats() const noexcept;
+
+    /**
+     * @brief Returns how many windows the audio ring buffer dropped and its high water occupancy.
+     *
+     * @return Ring_Buffer_Stats The overflow counters of the audio ring buffer.
+    */
+    Ring_Buffer_Stats get_audio_buffer_stats() const noexcept;
+
+    /**
+     * @brief Returns how long the input task took to resume after the source committed a half segment it was parked or
+     * lingering for.
+     *
+     * @return Wakeup_Latency The capture ring buffer's wakeup latency.
+    */
+    Wakeup_Latency get_capture_wakeup_latency() const noexcept;
+
+    /**
+     * @brief Returns how long the analysis tasks took to resume after a window they were parked or lingering for was
+     * published.
+     *
+     * @return Wakeup_Latency The audio ring buffer's wakeup latency.
+    */
+    Wakeup_Latency get_audio_wakeup_latency() const noexcept;
+
+    /**
+     * @brief Returns the latency the session's preprocessing chain adds.
+     *
+     * @return uint64_t The latency in samples, see Preprocessing_Chain::get_latency().
+    */
+    uint64_t get_preprocessing_latency() const noexcept;
+
+    /**
+     * @brief Hands the session a new preprocessing chain, swapped in at the next half segment boundary.
+     *
+     * @details Build the chain with make_preprocessing_chain() on the calling thread, never in a session task. The
+     * input task, woken here, flushes the chain it replaces and publishes everything it delayed first. A chain handed over
+     * before the last one was swapped in replaces it. Thread safe.
+     *
+     * @param chain The chain, for this session only.
+     * @throw Tsrt_Exception if chain is nullptr.
+    */
+    void swap_preprocessing(std::unique_ptr<Preprocessing_Chain> chain);
+
+    /**
+     * @brief Returns how many chains have been swapped in.
+     *
+     * @return uint64_t
+    */
+    uint64_t get_preprocessing_swaps() const noexcept;
+
+    /**
+     * @brief Returns how many filtered frames started before the samples already written and were trimmed.
+     *
+     * @details Above 0 means a filter in the chain moves timestamps back, see parse_preprocessor_spec().
+     *
+     * @return uint64_t
+    */
+    uint64_t get_pts_regressions() const noexcept;
+
+    /**
+     * @brief Returns how many windows were speech and how many analyses skipping the others saved.
+     *
+     * @return Voice_Activity_Stats
+    */
+    Voice_Activity_Stats get_voice_activity_stats() const noexcept;
+
+    /**
+     * @brief Returns how many frames the session's denoisers took in and how many they bypassed as clean.
+     *
+     * @return Denoise_Stats Summed over every chain swapped in.
+    */
+    Denoise_Stats get_denoise_stats() const noexcept;
+
+    /**
+     * @brief Returns the wall clock time from the session starting to it stopping, or to now while it runs.
+     *
+     * @return std::chrono::duration<double>
+    */
+    std::chrono::duration<double> get_elapsed() const noexcept;
+
+    /**
+     * @brief Returns whether the session is running.
+     *
+     * @return bool Whether the session is running.
+    */
+    bool is_running() const noexcept;
+
+    /**
+     * @brief Returns whether the session is recording.
+     *
+     * @return bool Whether the session is recording.
+    */
+    bool is_recording() const noexcept;
+
+    Session_tsrt(const Session_tsrt&) = delete;
+    Session_tsrt& operator=(const Session_tsrt&) = delete;
+};
+
+#endif // session_tsrt_h
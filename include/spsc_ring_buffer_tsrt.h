@@ -0,0 +1,417 @@
+#ifndef spsc_ring_buffer_tsrt_h
+#define spsc_ring_buffer_tsrt_h
+
+#include "audio_segment_tsrt.h"
+#include "constants_config_tsrt.h"
+#include "ring_buffer_tsrt.h"
+#include "wait_strategy_tsrt.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @brief A lock-free single producer, single consumer ring buffer.
+ *
+ * @details Head and tail are monotonically increasing atomic counters that are only ever written by one side.
+ * @details The producer publishes a slot with a release store to head and the consumer frees a slot with a release store to tail,
+ * so neither side ever takes a lock or makes a syscall.
+ * @details Each side keeps its cursor and a cached copy of the opposite cursor on its own cache line. The opposite cursor is only
+ * reloaded when the cached value says the buffer is full (producer) or empty (consumer), so in steady state the two threads do not
+ * share any cache lines other than the slot being handed over.
+ * @details A full buffer rejects the new element, blocks the producer or overwrites the oldest element, see overflow_policy.
+ * To overwrite, the producer moves the consumer's cursor past the oldest slot, see Tail_Cursor. The consumer holds the slots
+ * it peeked until it releases them, if it holds the oldest one the new element is rejected instead.
+ * @details Dropped and overwritten elements are counted by the producer. The high water occupancy is sampled by the consumer whenever it
+ * reloads head, which is exact at that moment and costs nothing extra.
+ *
+ * @note Exactly one thread may use the producer side (claim(), commit(), push()) and exactly one thread may use the
+ * consumer side (peek(), release(), pop()).
+ *
+ * @tparam T The type of the elements stored in the buffer.
+ * @tparam Size The capacity of the buffer. Must be greater than 0. Used to compile time check for size being power of 2.
+ * @tparam Overflow What claim() and push() do when the buffer is full.
+ * @tparam Wait_Strategy How wait_peek(), a consumer task about to park and a blocked producer wait for the other side,
+ * see wait_strategy_tsrt.h. A producer calling wait_for_space() under another overflow policy waits with
+ * Pipeline_Wait_Strategy, it is never the real-time callback.
+ */
+template <typename T, size_t Size = 1, overflow_policy Overflow = DROP_NEWEST, typename Wait_Strategy = Pipeline_Wait_Strategy>
+class Spsc_Ring_Buffer {
+private:
+    // Written by the producer, read by the consumer
+    struct alignas(CACHE_LINE_SIZE) Producer_Cursor {
+        std::atomic<size_t> head{0};
+        size_t cached_tail{0};
+        std::atomic<size_t> dropped{0};
+        std::atomic<size_t> overwritten{0};
+    };
+
+    // Written by the consumer, read by the producer, which also moves it to overwrite
+    struct alignas(CACHE_LINE_SIZE) Consumer_Cursor {
+        Tail_Cursor<Overflow == OVERWRITE_OLDEST> tail;
+        size_t cached_head{0};
+        std::atomic<size_t> high_water{0};
+    };
+
+    Producer_Cursor producer;
+    Consumer_Cursor consumer;
+    alignas(CACHE_LINE_SIZE) Wait_Strategy waiter;
+    alignas(CACHE_LINE_SIZE) std::conditional_t<Overflow == BLOCK_PRODUCER, Wait_Strategy, Pipeline_Wait_Strategy> space_waiter;
+    std::unique_ptr<T[]> buffer;
+
+    static_assert(Size > 0, "Ring buffer size must be greater than 0");
+    static_assert(std::atomic<size_t>::is_always_lock_free, "Spsc_Ring_Buffer requires lock free size_t atomics");
+
+    /**
+     * @brief Wraps the given counter around the buffer.
+     *
+     * @details If the buffer size is a power of two, it uses the bitwise and optimization.
+     *
+     * @param index The counter to wrap around the buffer.
+     * @return The wrapped index.
+    */
+    size_t wrap_index(const size_t index) const noexcept {
+        if constexpr (is_power_of_two(Size))
+            return index & (Size - 1);
+        else
+            return index % Size;
+    }
+
+    /**
+     * @brief Reloads tail and checks if there is a free slot, blocking for one or evicting the oldest element if the overflow
+     * policy says to.
+     *
+     * @param head The producer's head.
+     * @return True if the slot at head is free.
+    */
+    bool wait_for_room(const size_t head) noexcept(Overflow != BLOCK_PRODUCER) {
+        auto has_room = [&]() {
+            producer.cached_tail = consumer.tail.load(std::memory_order_acquire);
+            return head - producer.cached_tail != Size;
+        };
+
+        if constexpr (Overflow == BLOCK_PRODUCER) {
+            return space_waiter.wait(has_room, std::chrono::milliseconds(PRODUCER_BLOCK_TIMEOUT_MS));
+        } else if constexpr (Overflow == OVERWRITE_OLDEST) {
+            if (has_room())
+                return true;
+            // fails if the consumer holds the oldest element, or just released it, then the reload sees the room
+            if (consumer.tail.evict(head - Size)) {
+                producer.overwritten.store(producer.overwritten.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                producer.cached_tail = head - Size + 1;
+                return true;
+            }
+            return has_room();
+        } else {
+            return has_room();
+        }
+    }
+
+    /**
+     * @brief Gets the number of values the consumer can read from the given tail, reloading head when the cached one says
+     * there are fewer than wanted.
+     *
+     * @param tail The consumer's tail.
+     * @param wanted The number of values the consumer wants.
+     * @return The number of readable values, at most wanted.
+    */
+    size_t readable(const size_t tail, const size_t wanted) noexcept {
+        // the producer may have evicted past the cached head
+        if (consumer.cached_head < tail + wanted) {
+            consumer.cached_head = producer.head.load(std::memory_order_acquire);
+            if (consumer.cached_head == tail)
+                return 0;
+            update_high_water(consumer.high_water, consumer.cached_head - tail);
+        }
+        return std::min(wanted, consumer.cached_head - tail);
+    }
+
+public:
+    Spsc_Ring_Buffer() : buffer(std::make_unique<T[]>(Size)) {}
+
+    /**
+     * @brief Constructs the ring buffer with every slot preallocated as a copy of the prototype.
+     *
+     * @details Used with claim() and commit() so the producer writes into storage allocated up front.
+     *
+     * @param prototype The value every slot is copied from.
+    */
+    explicit Spsc_Ring_Buffer(const T& prototype) : buffer(std::make_unique<T[]>(Size)) {
+        for (size_t i = 0; i < Size; ++i)
+            buffer[i] = prototype;
+    }
+
+    // Copy and move are deleted because the cursors are shared between two threads
+    Spsc_Ring_Buffer(const Spsc_Ring_Buffer&) = delete;
+    Spsc_Ring_Buffer& operator=(const Spsc_Ring_Buffer&) = delete;
+    Spsc_Ring_Buffer(Spsc_Ring_Buffer&&) = delete;
+    Spsc_Ring_Buffer& operator=(Spsc_Ring_Buffer&&) = delete;
+
+    /**
+     * @brief Claims the next free slot for writing in place.
+     *
+     * @details Producer side only. The slot is not visible to the consumer until commit() is called. Never allocates, a
+     * slot always holds storage, pop() swaps rather than moves it out.
+     *
+     * @return A pointer to the claimed slot, or nullptr if the buffer is full and the element has to be dropped. With
+     * OVERWRITE_OLDEST the slot of the oldest element, which the consumer no longer sees, when the buffer is full.
+    */
+    T* claim() noexcept(Overflow != BLOCK_PRODUCER) {
+        const size_t head = producer.head.load(std::memory_order_relaxed);
+        if (head - producer.cached_tail == Size && !wait_for_room(head)) {
+            producer.dropped.store(producer.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        return &buffer[wrap_index(head)];
+    }
+
+    /**
+     * @brief Publishes the slot returned by the last claim() to the consumer.
+     *
+     * @details Producer side only.
+    */
+    void commit() noexcept {
+        // stamped before the store, so a consumer seeing the new head measures from this publish
+        waiter.stamp_publish();
+        producer.head.store(producer.head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        waiter.notify();
+    }
+
+    /**
+     * @brief Pushes the given value to the ring buffer.
+     *
+     * @details Producer side only.
+     *
+     * @param value The value to push to the ring buffer.
+     * @return True if the value was pushed, possibly over the oldest value, false if the buffer was full and the value was dropped.
+    */
+    bool push(T value) noexcept(Overflow != BLOCK_PRODUCER) {
+        T* slot = claim();
+        if (slot == nullptr)
+            return false;
+
+        *slot = std::move(value);
+        commit();
+        return true;
+    }
+
+    /**
+     * @brief Gets the oldest value for reading or modifying in place.
+     *
+     * @details Consumer side only. The slot is not reused, or overwritten, by the producer until release() is called.
+     *
+     * @return A pointer to the oldest value, or nullptr if the buffer is empty.
+    */
+    T* peek() noexcept {
+        const auto [tail, count] = consumer.tail.hold([&](const size_t from) { return readable(from, 1); });
+        if (count == 0)
+            return nullptr;
+        return &buffer[wrap_index(tail)];
+    }
+
+    /**
+     * @brief Gets up to max_count of the oldest values for reading or modifying in place.
+     *
+     * @details Consumer side only. The slots are not reused, or overwritten, by the producer until release_n() is called.
+     *
+     * @param max_count The maximum number of values to get.
+     * @return The values in at most two contiguous runs, empty if the buffer is empty.
+    */
+    Slot_Runs<T> peek_n(const size_t max_count) noexcept {
+        const auto [tail, count] = consumer.tail.hold([&](const size_t from) { return readable(from, max_count); });
+        const size_t start = wrap_index(tail);
+        const size_t first_size = std::min(count, Size - start);
+        return Slot_Runs<T>{&buffer[start], first_size, &buffer[0], count - first_size};
+    }
+
+    /**
+     * @brief Hands the first count slots returned by the last peek_n() back to the producer.
+     *
+     * @details Consumer side only.
+     *
+     * @param count The number of slots to release.
+    */
+    void release_n(const size_t count) noexcept {
+        space_waiter.stamp_publish();
+        consumer.tail.release(count);
+        space_waiter.notify();
+    }
+
+    /**
+     * @brief Gets the oldest value, waiting for the producer if the buffer is empty.
+     *
+     * @details Consumer side only. Wakes as soon as the producer commits, how depends on Wait_Strategy.
+     *
+     * @param timeout The longest time to wait.
+     * @return A pointer to the oldest value, or nullptr if the timeout expired.
+    */
+    T* wait_peek(const std::chrono::nanoseconds timeout) {
+        T* slot = nullptr;
+        waiter.wait([&]() { return (slot = peek()) != nullptr; }, timeout);
+        return slot;
+    }
+
+    /**
+     * @brief Has every commit() wake the given consumer task, for consumers run as tasks rather than by a waiting thread.
+     *
+     * @details Must be called before the producer starts, see Wake_Target.
+     *
+     * @param target The consumer's task, nullptr for none.
+    */
+    void set_wake_target(Wake_Target* target) noexcept {
+        waiter.set_wake_target(target);
+    }
+
+    /**
+     * @brief Keeps a consumer task that ran out of work on its worker for a while before it parks.
+     *
+     * @details Consumer side only. How long depends on Wait_Strategy, a blocking one parks at once.
+     *
+     * @param ready Predicate checking if the task has been woken.
+     * @return True if ready() returned true, false to park.
+    */
+    template <typename Predicate>
+    bool linger(Predicate ready) noexcept {
+        return waiter.linger(ready);
+    }
+
+    /**
+     * @brief Records the time from the last commit() to now as a wakeup, for a consumer task a commit resumed.
+     *
+     * @details Consumer side only.
+    */
+    void record_wakeup() noexcept {
+        waiter.record_wakeup();
+    }
+
+    /**
+     * @brief Hands the slot returned by the last peek() back to the producer.
+     *
+     * @details Consumer side only.
+    */
+    void release() noexcept {
+        space_waiter.stamp_publish();
+        consumer.tail.release(1);
+        space_waiter.notify();
+    }
+
+    /**
+     * @brief Pops the first value from the ring buffer into the given value.
+     *
+     * @details Consumer side only. The value and the slot are swapped, so the slot keeps the storage handed in and the
+     * producer never has to allocate it again, see claim().
+     *
+     * @param value Where the first value goes, its old contents are left in the slot.
+     * @return True if a value was popped, false if the buffer is empty.
+    */
+    bool pop(T& value) noexcept {
+        static_assert(std::is_nothrow_swappable<T>::value, "pop() swaps the slot with the value, which must not throw");
+        T* slot = peek();
+        if (slot == nullptr)
+            return false;
+
+        using std::swap;
+        swap(value, *slot);
+        release();
+        return true;
+    }
+
+    /**
+     * @brief Checks if the ring buffer is empty.
+     *
+     * @details Only a snapshot when called from the producer side.
+     *
+     * @return True if the ring buffer holds no elements.
+    */
+    bool empty() const noexcept {
+        return consumer.tail.load(std::memory_order_acquire) == producer.head.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Gets the number of values that can be pushed before the buffer is full.
+     *
+     * @details Producer side only, e.g. to only produce when the value will neither be dropped nor waited for.
+     *
+     * @return The number of free slots.
+    */
+    size_t free_slots() noexcept {
+        const size_t head = producer.head.load(std::memory_order_relaxed);
+        producer.cached_tail = consumer.tail.load(std::memory_order_acquire);
+        return Size - (head - producer.cached_tail);
+    }
+
+    /**
+     * @brief Waits until a slot is free, for a producer that would rather wait for the consumer than have claim() drop.
+     *
+     * @details Producer side only. Woken by the consumer's release(), how depends on the space waiter's strategy.
+     *
+     * @param timeout The longest time to wait.
+     * @return True if a slot is free, false if the timeout expired.
+    */
+    bool wait_for_space(const std::chrono::nanoseconds timeout) {
+        const size_t head = producer.head.load(std::memory_order_relaxed);
+        return space_waiter.wait([&]() {
+            producer.cached_tail = consumer.tail.load(std::memory_order_acquire);
+            return head - producer.cached_tail != Size;
+        }, timeout);
+    }
+
+    /**
+     * @brief Gets the overwritten and dropped element counts and high water occupancy.
+     *
+     * @return Ring_Buffer_Stats
+    */
+    Ring_Buffer_Stats get_stats() const noexcept {
+        return Ring_Buffer_Stats{producer.overwritten.load(std::memory_order_relaxed), producer.dropped.load(std::memory_order_relaxed),
+                                 consumer.high_water.load(std::memory_order_relaxed)};
+    }
+
+    /**
+     * @brief Gets how long consumers took to wake up after a commit.
+     *
+     * @return Wakeup_Latency
+    */
+    Wakeup_Latency get_wakeup_latency() const noexcept {
+        return waiter.get_wakeup_latency();
+    }
+
+    /**
+     * @brief Gets the size of the ring buffer.
+     *
+     * @return The size of the ring buffer.
+    */
+    size_t get_size() const noexcept {
+        return Size;
+    }
+
+    /**
+     * @brief Resets the head and tail counters to 0.
+     *
+     * @details This function resets the head and tail counters to 0. It does not clear the data in the buffer.
+     *
+     * @note This function is not thread safe, neither side may be running.
+    */
+    void clear() noexcept {
+        producer.head.store(0, std::memory_order_relaxed);
+        producer.cached_tail = 0;
+        consumer.tail.reset(0);
+        consumer.cached_head = 0;
+    }
+};
+
+template class Spsc_Ring_Buffer<Audio_Segment, AUDIO_BUFFER_SIZE, CAPTURE_OVERFLOW_POLICY, Capture_Wait_Strategy>;
+
+/**
+ * @brief The ring buffer between capture and preprocessing.
+*/
+using Capture_Ring_Buffer = Spsc_Ring_Buffer<Audio_Segment, AUDIO_BUFFER_SIZE, CAPTURE_OVERFLOW_POLICY, Capture_Wait_Strategy>;
+
+static_assert(CAPTURE_MODE != CAPTURE_CALLBACK || CAPTURE_OVERFLOW_POLICY != BLOCK_PRODUCER,
+              "The PortAudio callback must never block, use DROP_NEWEST for CAPTURE_OVERFLOW_POLICY");
+
+#endif // spsc_ring_buffer_tsrt_h
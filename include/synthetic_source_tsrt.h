@@ -0,0 +1,89 @@
+#ifndef synthetic_source_tsrt_h
+#define synthetic_source_tsrt_h
+
+#include "audio_source_tsrt.h"
+#include "constants_config_tsrt.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+/**
+ * @brief The signals a Synthetic_Source can generate.
+*/
+enum synthetic_waveform {
+    SYNTHETIC_TONE,  // a sine wave
+    SYNTHETIC_NOISE, // uniform white noise
+    SYNTHETIC_LOOP,  // recorded samples played over and over
+};
+
+/**
+ * @brief Generates deterministic audio so the pipeline can run without an input device.
+ *
+ * @details The same arguments always give the same samples, noise and jitter come from fixed seeds, so end to end runs
+ * are repeatable. With a speed of 0 audio is generated as fast as the pipeline takes it. Otherwise each half segment is
+ * held back until it would have been captured at speed times real time, plus a random delay of up to jitter to mimic how
+ * late a device's buffers arrive, and the source is live, dropping audio when the pipeline falls behind. How late each
+ * segment is produced compared to when it was due is reported as the input latency.
+ *
+ * @param waveform The signal to generate.
+ * @param frequency The frequency of a tone in Hz.
+ * @param loop The samples a loop plays.
+ * @param speed How many times real time the source runs at, 0 for as fast as possible.
+ * @param jitter The most each segment is delayed by when paced.
+ * @param max_samples The number of samples generated before the source ends, 0 for no end.
+*/
+class Synthetic_Source : public Pull_Audio_Source {
+
+private:
+    synthetic_waveform waveform;
+    double frequency;
+    std::vector<float> loop;
+    double speed;
+    std::chrono::microseconds jitter;
+    uint64_t max_samples;
+    uint64_t generated;
+    std::mt19937 noise_rng;
+    std::mt19937 jitter_rng;
+    std::chrono::steady_clock::time_point pace_origin;
+    uint64_t paced_reads;
+    int64_t latency_total_ns;
+    int64_t latency_max_ns;
+
+    /**
+     * @brief Sleeps until the samples up to the given index are due and records how late they are.
+    */
+    void pace(uint64_t end_sample);
+
+protected:
+
+    size_t read_samples(float* destination, size_t count) override;
+
+public:
+
+    /**
+     * @brief Construct a new Synthetic_Source object
+     *
+     * @param waveform The signal to generate.
+     * @param frequency The frequency of a tone in Hz, ignored otherwise.
+     * @param loop The samples a loop plays, ignored otherwise.
+     * @param speed How many times real time the source runs at, 0 for as fast as possible.
+     * @param jitter The most each segment is delayed by when paced.
+     * @param duration How much audio is generated before the source ends, 0 for no end.
+     * @throw Tsrt_Exception if a loop has no samples or speed is negative.
+    */
+    Synthetic_Source(synthetic_waveform waveform, double frequency, std::vector<float> loop, double speed,
+                     std::chrono::microseconds jitter, std::chrono::seconds duration);
+
+    tsrt_status_code start(Capture_Ring_Buffer& ring, Sample_Clock& clock) override;
+
+    bool is_live() const noexcept override;
+
+    const char* get_name() const noexcept override;
+
+    Source_Stats get_stats() const noexcept override;
+};
+
+#endif // synthetic_source_tsrt_h
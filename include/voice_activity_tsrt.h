@@ -0,0 +1,106 @@
+#ifndef voice_activity_tsrt_h
+#define voice_activity_tsrt_h
+
+#include "aligned_samples_tsrt.h"
+#include "constants_config_tsrt.h"
+#include "dsp_kernels_tsrt.h"
+#include "exceptions_tsrt.h"
+#include "fft_tsrt.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/**
+ * @brief Tells speech from silence and noise in a stream of preprocessed audio.
+ *
+ * @details The stream is cut into frames of VAD_FRAME_SAMPLES and each frame is classified from three features, all
+ * computed with the kernels of one instruction set: its energy, its zero crossing rate and the spectral flatness of the
+ * speech band. A frame is speech if it is VAD_ENERGY_MARGIN_DB above the noise estimate and either harmonic, its
+ * flatness below VAD_FLATNESS_MAX, or low pitched, its crossing rate below VAD_CROSSING_RATE_MAX. The noise estimate
+ * follows the quietest frames, dropping to them at once and creeping up by VAD_NOISE_RISE_DB a frame.
+ * @details Speech is smoothed with a hangover, the VAD_HANGOVER_FRAMES after a speech frame count as speech too, so word
+ * endings and the pauses between words are kept. Until the noise estimate has risen to a noisy stream's floor its
+ * frames are speech, the detector errs towards analysing audio rather than skipping it.
+ * @details An instance is one stream's, it must only be used by one thread at a time.
+*/
+class Voice_Activity_Detector {
+
+private:
+    using Samples = std::unique_ptr<float[], Aligned_Samples_Deleter>;
+
+    const Dsp_Kernels* kernels;
+    Real_Fft fft;
+    float power_floor;    // the power of a bin of a frame at VAD_MIN_ENERGY_DB, so silence is not infinitely flat
+    Samples window;
+    Samples frame;        // the frame being filled
+    Samples spectrum;     // interleaved complex bins
+    size_t fill;          // samples of the frame received
+    uint64_t next_index;  // the index of the next sample on the stream's timeline
+    uint64_t speech_end;  // the index after the last frame classified as speech
+    float noise_db;
+    size_t hangover;      // frames still counted as speech after the last one that was
+    uint64_t frames;
+    uint64_t speech_frames;
+
+    /**
+     * @brief Classify the frame once it is full
+    */
+    void classify_frame() noexcept;
+
+public:
+
+    /**
+     * @brief Construct a new Voice_Activity_Detector object
+     *
+     * @param kernels The kernels the features are computed with, see get_dsp_kernels().
+     * @throw tsrt_exception if the FFT can not be set up.
+    */
+    explicit Voice_Activity_Detector(const Dsp_Kernels& kernels = *get_dsp_kernels(best_dsp_isa()));
+
+    Voice_Activity_Detector(const Voice_Activity_Detector&) = delete;
+    Voice_Activity_Detector& operator=(const Voice_Activity_Detector&) = delete;
+
+    /**
+     * @brief Continue the stream at a sample index after a gap
+     *
+     * The frame being filled is dropped, the noise estimate and the hangover carry on.
+     *
+     * @param sample_index The absolute index of the next sample processed.
+    */
+    void restart(uint64_t sample_index) noexcept;
+
+    /**
+     * @brief Classify the frames the samples complete
+     *
+     * @param samples The samples that follow the ones processed before, any alignment.
+     * @param count The number of samples, any size.
+    */
+    void process(const float* samples, size_t count) noexcept;
+
+    /**
+     * @brief Check if there was speech from a sample on
+     *
+     * Only frames already completed count, so a window is classified by processing up to its end first.
+     *
+     * @param sample_index The absolute index of the sample.
+     * @return bool Whether a frame classified as speech ends after the sample.
+    */
+    bool speech_since(uint64_t sample_index) const noexcept;
+
+    /**
+     * @brief Get the number of frames classified
+     *
+     * @return uint64_t
+    */
+    uint64_t get_frames() const noexcept;
+
+    /**
+     * @brief Get the number of frames classified as speech, hangover included
+     *
+     * @return uint64_t
+    */
+    uint64_t get_speech_frames() const noexcept;
+};
+
+#endif // voice_activity_tsrt_h
@@ -0,0 +1,414 @@
+#ifndef wait_strategy_tsrt_h
+#define wait_strategy_tsrt_h
+
+#include "constants_config_tsrt.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief Hints to the CPU that the calling thread is spinning.
+*/
+inline void cpu_relax() noexcept {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+/**
+ * @brief Snapshot of the time consumers took to wake up after a producer published.
+ *
+ * @param wakeups The number of waits that had to wait for a publish.
+ * @param mean The mean time from the publish to the consumer observing it.
+ * @param max The longest time from the publish to the consumer observing it.
+*/
+struct Wakeup_Latency {
+    size_t wakeups;
+    std::chrono::nanoseconds mean;
+    std::chrono::nanoseconds max;
+};
+
+/**
+ * @brief A consumer run as a task rather than by a thread waiting on its ring buffer.
+ *
+ * @details Registered on a ring buffer with set_wake_target(), it is woken by the producer after every publish. A task
+ * that runs out of work parks, ends rather than waits, and wake() schedules it again, so a consumer holds no thread
+ * while there is nothing to consume.
+*/
+class Wake_Target {
+public:
+    /**
+     * @brief Called by the producer after every publish, schedules the consumer's task if it is parked.
+     *
+     * @details Runs on the producer's thread, so it must be cheap while the task is scheduled, one atomic add. A target
+     * whose producer is a real-time callback must not schedule the task itself, see Session_tsrt.
+    */
+    virtual void wake() noexcept = 0;
+
+protected:
+    ~Wake_Target() = default;
+};
+
+/**
+ * @brief Shared bookkeeping for the wait strategies.
+ *
+ * @details The producer stamps every publish before making it visible, and a consumer that actually had to wait records
+ * the time from the last stamp to the moment it saw the data. Waits that find data immediately are not counted, they
+ * have no wakeup latency.
+ * @details The protocol for a producer is stamp_publish(), then the release store that publishes, then notify(). The
+ * release store carries the stamp with it, so a consumer that sees the publish also sees its stamp and never measures
+ * from the publish before.
+ * @details A consumer run as a task is woken through its Wake_Target at the end of every notify(). When it runs out of
+ * work it calls linger() before it parks, and records its wakeup with record_wakeup() when a publish wakes it.
+*/
+class Wait_Strategy_Base {
+private:
+    Wake_Target* wake_target{nullptr};
+    std::atomic<int64_t> last_publish_ns{0};
+    std::atomic<uint64_t> wakeups{0};
+    std::atomic<uint64_t> total_latency_ns{0};
+    std::atomic<uint64_t> max_latency_ns{0};
+
+    static int64_t now_ns() noexcept {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+protected:
+    /**
+     * @brief Wakes the consumer's task if there is one, called at the end of every notify().
+    */
+    void wake_consumer() noexcept {
+        if (wake_target != nullptr)
+            wake_target->wake();
+    }
+
+public:
+    /**
+     * @brief Records the time from the last publish to now as a wakeup.
+     *
+     * @details Called by wait() when it had to wait, and by a consumer task resumed by a publish.
+    */
+    void record_wakeup() noexcept {
+        const int64_t latency = now_ns() - last_publish_ns.load(std::memory_order_relaxed);
+        if (latency < 0)
+            return;
+
+        wakeups.fetch_add(1, std::memory_order_relaxed);
+        total_latency_ns.fetch_add(static_cast<uint64_t>(latency), std::memory_order_relaxed);
+        uint64_t max = max_latency_ns.load(std::memory_order_relaxed);
+        while (static_cast<uint64_t>(latency) > max &&
+               !max_latency_ns.compare_exchange_weak(max, static_cast<uint64_t>(latency), std::memory_order_relaxed)) {}
+    }
+
+    /**
+     * @brief Has every notify() wake the given consumer task.
+     *
+     * @details Must be called before the producer starts, the target is read without synchronisation.
+     *
+     * @param target The consumer's task, nullptr for none.
+    */
+    void set_wake_target(Wake_Target* target) noexcept {
+        wake_target = target;
+    }
+
+    /**
+     * @brief Called by the producer right before the release store that publishes.
+    */
+    void stamp_publish() noexcept {
+        last_publish_ns.store(now_ns(), std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Gets the wakeup latency recorded so far.
+     *
+     * @return Wakeup_Latency
+    */
+    Wakeup_Latency get_wakeup_latency() const noexcept {
+        const uint64_t count = wakeups.load(std::memory_order_relaxed);
+        const uint64_t total = total_latency_ns.load(std::memory_order_relaxed);
+        return Wakeup_Latency{
+            static_cast<size_t>(count),
+            std::chrono::nanoseconds(count == 0 ? 0 : total / count),
+            std::chrono::nanoseconds(max_latency_ns.load(std::memory_order_relaxed))
+        };
+    }
+};
+
+/**
+ * @brief Waits by spinning on the ready condition.
+ *
+ * @details Lowest wakeup latency, but burns a full core per waiting thread. Only for deployments with a core to spare per stage.
+*/
+class Busy_Spin_Wait : public Wait_Strategy_Base {
+public:
+    /**
+     * @brief Called by the producer after publishing, a waiting thread polls, only a consumer task needs waking.
+    */
+    void notify() noexcept {
+        wake_consumer();
+    }
+
+    /**
+     * @brief Keeps a consumer task that ran out of work spinning on its worker for up to WAIT_LINGER_US before it parks.
+     *
+     * @param ready Predicate checking if the task has been woken.
+     * @return True if ready() returned true, false to park.
+    */
+    template <typename Predicate>
+    bool linger(Predicate ready) noexcept {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(WAIT_LINGER_US);
+        for (size_t spins = 1; !ready(); ++spins) {
+            if ((spins & (WAIT_SPIN_ITERATIONS - 1)) == 0 && std::chrono::steady_clock::now() >= deadline)
+                return false;
+            cpu_relax();
+        }
+        return true;
+    }
+
+    /**
+     * @brief Waits until ready() returns true or the timeout expires.
+     *
+     * @param ready Predicate checking if there is something to consume.
+     * @param timeout The longest time to wait.
+     * @return True if ready() returned true, false on timeout.
+    */
+    template <typename Predicate>
+    bool wait(Predicate ready, const std::chrono::nanoseconds timeout) noexcept {
+        if (ready())
+            return true;
+
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        for (size_t spins = 1; !ready(); ++spins) {
+            // the clock is only read every so often to keep the spin tight
+            if ((spins & (WAIT_SPIN_ITERATIONS - 1)) == 0 && std::chrono::steady_clock::now() >= deadline)
+                return false;
+            cpu_relax();
+        }
+        record_wakeup();
+        return true;
+    }
+};
+
+/**
+ * @brief Waits by spinning for a short while and then yielding the core between checks.
+ *
+ * @details Close to busy spin latency while the producer is keeping up, and leaves the core to other threads otherwise.
+*/
+class Yielding_Wait : public Wait_Strategy_Base {
+public:
+    /**
+     * @brief Called by the producer after publishing, a waiting thread polls, only a consumer task needs waking.
+    */
+    void notify() noexcept {
+        wake_consumer();
+    }
+
+    /**
+     * @brief Keeps a consumer task that ran out of work spinning briefly, then yielding its worker for up to
+     * WAIT_LINGER_US before it parks.
+     *
+     * @param ready Predicate checking if the task has been woken.
+     * @return True if ready() returned true, false to park.
+    */
+    template <typename Predicate>
+    bool linger(Predicate ready) noexcept {
+        for (size_t spins = 0; spins < WAIT_SPIN_ITERATIONS; ++spins) {
+            if (ready())
+                return true;
+            cpu_relax();
+        }
+
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(WAIT_LINGER_US);
+        while (!ready()) {
+            if (std::chrono::steady_clock::now() >= deadline)
+                return false;
+            std::this_thread::yield();
+        }
+        return true;
+    }
+
+    /**
+     * @brief Waits until ready() returns true or the timeout expires.
+     *
+     * @param ready Predicate checking if there is something to consume.
+     * @param timeout The longest time to wait.
+     * @return True if ready() returned true, false on timeout.
+    */
+    template <typename Predicate>
+    bool wait(Predicate ready, const std::chrono::nanoseconds timeout) noexcept {
+        if (ready())
+            return true;
+
+        for (size_t spins = 0; spins < WAIT_SPIN_ITERATIONS; ++spins) {
+            cpu_relax();
+            if (ready()) {
+                record_wakeup();
+                return true;
+            }
+        }
+
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (!ready()) {
+            if (std::chrono::steady_clock::now() >= deadline)
+                return false;
+            std::this_thread::yield();
+        }
+        record_wakeup();
+        return true;
+    }
+};
+
+/**
+ * @brief Waits by parking the thread on a condition variable.
+ *
+ * @details Waiting threads use no CPU. The producer only takes the mutex and makes the wake syscall when a consumer is
+ * actually parked, so a producer that never outruns its consumers stays lock free.
+*/
+class Blocking_Wait : public Wait_Strategy_Base {
+private:
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::atomic<size_t> waiters{0};
+
+public:
+    /**
+     * @brief Called by the producer after publishing.
+    */
+    void notify() noexcept {
+        // pairs with the fence in wait(), either the waiter sees the publish or the producer sees the waiter
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_relaxed) != 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            condition.notify_all();
+        }
+        wake_consumer();
+    }
+
+    /**
+     * @brief A consumer task that ran out of work parks at once, the producer's notify() wakes it.
+     *
+     * @return False, always park.
+    */
+    template <typename Predicate>
+    bool linger(Predicate) noexcept {
+        return false;
+    }
+
+    /**
+     * @brief Waits until ready() returns true or the timeout expires.
+     *
+     * @param ready Predicate checking if there is something to consume.
+     * @param timeout The longest time to wait.
+     * @return True if ready() returned true, false on timeout.
+    */
+    template <typename Predicate>
+    bool wait(Predicate ready, const std::chrono::nanoseconds timeout) {
+        if (ready())
+            return true;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        waiters.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const bool is_ready = condition.wait_for(lock, timeout, ready);
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+        lock.unlock();
+
+        if (is_ready)
+            record_wakeup();
+        return is_ready;
+    }
+};
+
+/**
+ * @brief Waits by spinning for a short while and then sleeping WAIT_SLEEP_US between checks.
+ *
+ * @details Waiting threads are never woken, notify() only wakes a consumer task if one is registered and the producer's
+ * other cost is the relaxed clock store in stamp_publish(), so it is safe to use from a real-time audio callback where
+ * taking a mutex is not. Waiting threads use almost no CPU, at the cost of up to WAIT_SLEEP_US wakeup latency.
+*/
+class Sleeping_Wait : public Wait_Strategy_Base {
+public:
+    /**
+     * @brief Called by the producer after publishing, a waiting thread polls, only a consumer task needs waking.
+    */
+    void notify() noexcept {
+        wake_consumer();
+    }
+
+    /**
+     * @brief Keeps a consumer task that ran out of work spinning briefly before it parks, it never sleeps on a worker.
+     *
+     * @param ready Predicate checking if the task has been woken.
+     * @return True if ready() returned true, false to park.
+    */
+    template <typename Predicate>
+    bool linger(Predicate ready) noexcept {
+        for (size_t spins = 0; spins < WAIT_SPIN_ITERATIONS; ++spins) {
+            if (ready())
+                return true;
+            cpu_relax();
+        }
+        return false;
+    }
+
+    /**
+     * @brief Waits until ready() returns true or the timeout expires.
+     *
+     * @param ready Predicate checking if there is something to consume.
+     * @param timeout The longest time to wait.
+     * @return True if ready() returned true, false on timeout.
+    */
+    template <typename Predicate>
+    bool wait(Predicate ready, const std::chrono::nanoseconds timeout) noexcept {
+        if (ready())
+            return true;
+
+        for (size_t spins = 0; spins < WAIT_SPIN_ITERATIONS; ++spins) {
+            cpu_relax();
+            if (ready()) {
+                record_wakeup();
+                return true;
+            }
+        }
+
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (!ready()) {
+            if (std::chrono::steady_clock::now() >= deadline)
+                return false;
+            std::this_thread::sleep_for(std::chrono::microseconds(WAIT_SLEEP_US));
+        }
+        record_wakeup();
+        return true;
+    }
+};
+
+/**
+ * @brief The wait strategy used by the pipeline ring buffers, selected with PIPELINE_WAIT_STRATEGY.
+*/
+using Pipeline_Wait_Strategy = std::conditional_t<PIPELINE_WAIT_STRATEGY == WAIT_BUSY_SPIN, Busy_Spin_Wait,
+                               std::conditional_t<PIPELINE_WAIT_STRATEGY == WAIT_YIELD, Yielding_Wait,
+                               std::conditional_t<PIPELINE_WAIT_STRATEGY == WAIT_SLEEP, Sleeping_Wait, Blocking_Wait>>>;
+
+/**
+ * @brief The wait strategy used by the capture ring buffer.
+ *
+ * @details In CAPTURE_CALLBACK mode the producer is the PortAudio callback, which must never block, so Blocking_Wait
+ * is replaced by Sleeping_Wait there. The other strategies never block the producer. Either way the session consuming
+ * is a task, woken through its Wake_Target, and parks as soon as it runs dry unless the strategy lingers.
+*/
+using Capture_Wait_Strategy = std::conditional_t<CAPTURE_MODE == CAPTURE_CALLBACK && PIPELINE_WAIT_STRATEGY == WAIT_BLOCK,
+                                                 Sleeping_Wait, Pipeline_Wait_Strategy>;
+
+#endif // wait_strategy_tsrt_h
@@ -0,0 +1,65 @@
+#ifndef wake_semaphore_tsrt_h
+#define wake_semaphore_tsrt_h
+
+#include "exceptions_tsrt.h"
+#include "status_codes_tsrt.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <semaphore.h>
+#endif
+
+/**
+ * @brief A counting semaphore one thread parks on until another posts it.
+ *
+ * @details post() neither allocates nor takes a lock, sem_post is async-signal safe, so a device's real-time callback
+ * may post. The semaphore is the operating system's: unnamed where sem_init works, named and unlinked straight away on
+ * Apple, whose sem_init is not implemented, and a Win32 semaphore on Windows.
+ *
+ * @param semaphore The operating system's semaphore.
+*/
+class Wake_Semaphore {
+
+private:
+#if defined(__APPLE__)
+    sem_t* semaphore;
+#elif defined(__unix__)
+    sem_t semaphore;
+#else
+    void* semaphore;
+#endif
+
+public:
+    /**
+     * @brief Creates the semaphore with a count of 0.
+     *
+     * @throws Tsrt_Exception RUNTIME_ERROR if the operating system can not create it.
+    */
+    Wake_Semaphore();
+
+    /**
+     * @brief Destroys the semaphore, nothing may be waiting on it.
+    */
+    ~Wake_Semaphore();
+
+    Wake_Semaphore(const Wake_Semaphore&) = delete;
+    Wake_Semaphore& operator=(const Wake_Semaphore&) = delete;
+
+    /**
+     * @brief Adds one to the count, waking a waiter. Real-time safe.
+    */
+    void post() noexcept;
+
+    /**
+     * @brief Waits until the count is above 0, then takes one.
+    */
+    void wait() noexcept;
+
+    /**
+     * @brief Takes one if the count is above 0, never blocks.
+     *
+     * @return True if one was taken.
+    */
+    bool try_wait() noexcept;
+};
+
+#endif
@@ -0,0 +1,226 @@
+#include "audio_file_tsrt.h"
+#include "audio_tsrt.h"
+#include "constants_config_tsrt.h"
+#include "exceptions_tsrt.h"
+#include "status_codes_tsrt.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <string>
+extern "C" {
+#include <libavfilter/buffersink.h>
+#include <libavfilter/buffersrc.h>
+#include <libavutil/channel_layout.h>
+#include <libavutil/samplefmt.h>
+}
+
+/**
+ * @brief Throws a Tsrt_Exception with FFmpeg's description of the error if ret is negative.
+*/
+static void check_ffmpeg_error(int ret, const std::string& error_context, const std::string& file, int line) {
+    if (ret < 0) {
+        char err_buf[AV_ERROR_MAX_STRING_SIZE];
+        av_make_error_string(err_buf, AV_ERROR_MAX_STRING_SIZE, ret);
+        throw Tsrt_Exception(RUNTIME_ERROR, error_context + ": " + err_buf, std::chrono::system_clock::now(), file, line);
+    }
+}
+
+void format_context_deleter(AVFormatContext* format_context) {
+    if (format_context != nullptr)
+        avformat_close_input(&format_context);
+}
+
+void codec_context_deleter(AVCodecContext* codec_context) {
+    if (codec_context != nullptr)
+        avcodec_free_context(&codec_context);
+}
+
+void packet_deleter(AVPacket* packet) {
+    if (packet != nullptr)
+        av_packet_free(&packet);
+}
+
+Audio_File_tsrt::Audio_File_tsrt(const std::string& path) :
+    format_context{nullptr, format_context_deleter},
+    codec_context{nullptr, codec_context_deleter},
+    packet{nullptr, packet_deleter},
+    decoded_frame{nullptr, avframe_deleter},
+    converted_frame{nullptr, avframe_deleter},
+    avfilter_graph{nullptr, avfilter_graph_deleter},
+    src_ctx{nullptr},
+    sink_ctx{nullptr},
+    stream_index{-1},
+    converted_offset{0},
+    demuxer_drained{false},
+    decoder_drained{false},
+    finished{false},
+    samples_read{0} {
+
+    init_decoder(path);
+    init_avfilter_graph();
+
+    packet.reset(av_packet_alloc());
+    decoded_frame.reset(av_frame_alloc());
+    converted_frame.reset(av_frame_alloc());
+    if (!packet || !decoded_frame || !converted_frame)
+        throw Tsrt_Exception(INSUFFICIENT_MEMORY, "Error allocating memory for decoding " + path, std::chrono::system_clock::now(), __FILE__, __LINE__);
+}
+
+void Audio_File_tsrt::init_decoder(const std::string& path) {
+    AVFormatContext* raw_format_context = nullptr;
+    int ret = avformat_open_input(&raw_format_context, path.c_str(), nullptr, nullptr);
+    if (ret < 0) {
+        char err_buf[AV_ERROR_MAX_STRING_SIZE];
+        av_make_error_string(err_buf, AV_ERROR_MAX_STRING_SIZE, ret);
+        throw Tsrt_Exception(IO_ERROR, "Error opening " + path + ": " + err_buf, std::chrono::system_clock::now(), __FILE__, __LINE__);
+    }
+    format_context.reset(raw_format_context);
+    check_ffmpeg_error(avformat_find_stream_info(format_context.get(), nullptr), "Error reading stream info of " + path, __FILE__, __LINE__);
+
+    const AVCodec* decoder = nullptr;
+    stream_index = av_find_best_stream(format_context.get(), AVMEDIA_TYPE_AUDIO, -1, -1, &decoder, 0);
+    if (stream_index < 0 || decoder == nullptr)
+        throw Tsrt_Exception(INVALID_ARGUMENT, "Error: No decodable audio stream in " + path, std::chrono::system_clock::now(), __FILE__, __LINE__);
+
+    codec_context.reset(avcodec_alloc_context3(decoder));
+    if (!codec_context)
+        throw Tsrt_Exception(INSUFFICIENT_MEMORY, "Error allocating memory for codec_context", std::chrono::system_clock::now(), __FILE__, __LINE__);
+    check_ffmpeg_error(avcodec_parameters_to_context(codec_context.get(), format_context->streams[stream_index]->codecpar), "Error copying codec parameters", __FILE__, __LINE__);
+    // decoded frames keep their packets' timestamps, in the stream's time base
+    codec_context->pkt_timebase = format_context->streams[stream_index]->time_base;
+    check_ffmpeg_error(avcodec_open2(codec_context.get(), decoder, nullptr), "Error opening decoder", __FILE__, __LINE__);
+}
+
+void Audio_File_tsrt::init_avfilter_graph() {
+    avfilter_graph.reset(avfilter_graph_alloc());
+    if (avfilter_graph == nullptr) {
+        throw Tsrt_Exception(INSUFFICIENT_MEMORY, "Error allocating memory for avfilter_graph", std::chrono::system_clock::now(), __FILE__, __LINE__);
+    }
+
+    AVFilterContext *aresample_ctx = nullptr, *aformat_ctx = nullptr;
+
+    // some decoders leave the layout unspecified, assume the default for the channel count
+    AVChannelLayout channel_layout = codec_context->ch_layout;
+    if (channel_layout.order == AV_CHANNEL_ORDER_UNSPEC)
+        av_channel_layout_default(&channel_layout, channel_layout.nb_channels);
+    char layout_name[64];
+    av_channel_layout_describe(&channel_layout, layout_name, sizeof(layout_name));
+
+    const AVFilter *src = avfilter_get_by_name("abuffer");
+    std::ostringstream src_args;
+    // the time base of the decoded frames' pts, not 1/sample_rate, or every pts reaching aresample is mislabelled
+    const AVRational time_base = codec_context->pkt_timebase;
+    src_args << "time_base=" << time_base.num << "/" << time_base.den << ":sample_rate=" << codec_context->sample_rate
+             << ":sample_fmt=" << av_get_sample_fmt_name(static_cast<AVSampleFormat>(codec_context->sample_fmt))
+             << ":channel_layout=" << layout_name;
+    check_ffmpeg_error(avfilter_graph_create_filter(&src_ctx, src, "src", src_args.str().c_str(), nullptr, avfilter_graph.get()), "Error creating source filter", __FILE__, __LINE__);
+
+    const AVFilter *aresample = avfilter_get_by_name("aresample");
+    std::ostringstream aresample_args;
+    aresample_args << SAMPLE_RATE;
+    check_ffmpeg_error(avfilter_graph_create_filter(&aresample_ctx, aresample, "aresample", aresample_args.str().c_str(), nullptr, avfilter_graph.get()), "Error creating aresample filter", __FILE__, __LINE__);
+
+    // downmixes to mono and converts to packed float
+    const AVFilter *aformat = avfilter_get_by_name("aformat");
+    std::ostringstream aformat_args;
+    aformat_args << "sample_fmts=" << SRC_SAMPLE_FMT << ":sample_rates=" << SAMPLE_RATE << ":channel_layouts=" << SRC_CHANNEL_LAYOUT;
+    check_ffmpeg_error(avfilter_graph_create_filter(&aformat_ctx, aformat, "aformat", aformat_args.str().c_str(), nullptr, avfilter_graph.get()), "Error creating aformat filter", __FILE__, __LINE__);
+
+    const AVFilter *sink = avfilter_get_by_name("abuffersink");
+    check_ffmpeg_error(avfilter_graph_create_filter(&sink_ctx, sink, "sink", nullptr, nullptr, avfilter_graph.get()), "Error creating sink filter", __FILE__, __LINE__);
+
+    check_ffmpeg_error(avfilter_link(src_ctx, 0, aresample_ctx, 0), "Error linking filters", __FILE__, __LINE__);
+    check_ffmpeg_error(avfilter_link(aresample_ctx, 0, aformat_ctx, 0), "Error linking filters", __FILE__, __LINE__);
+    check_ffmpeg_error(avfilter_link(aformat_ctx, 0, sink_ctx, 0), "Error linking filters", __FILE__, __LINE__);
+    check_ffmpeg_error(avfilter_graph_config(avfilter_graph.get(), nullptr), "Error configuring filter graph", __FILE__, __LINE__);
+
+    // frames of one half segment, so most reads are a single copy
+    av_buffersink_set_frame_size(sink_ctx, SAMPLES_PER_HALF_SEGMENT);
+}
+
+bool Audio_File_tsrt::next_converted_frame() {
+    av_frame_unref(converted_frame.get());
+    converted_offset = 0;
+
+    while (true) {
+        int ret = av_buffersink_get_frame(sink_ctx, converted_frame.get());
+        if (ret >= 0)
+            return true;
+        if (ret == AVERROR_EOF)
+            return false;
+        check_ffmpeg_error(ret == AVERROR(EAGAIN) ? 0 : ret, "Error getting frame from filter", __FILE__, __LINE__);
+
+        // the filter graph needs another decoded frame
+        ret = avcodec_receive_frame(codec_context.get(), decoded_frame.get());
+        if (ret >= 0) {
+            check_ffmpeg_error(av_buffersrc_add_frame_flags(src_ctx, decoded_frame.get(), 0), "Error adding frame to filter", __FILE__, __LINE__);
+            continue;
+        }
+        if (ret == AVERROR_EOF) {
+            // flushes the resampler's delay out of the graph, the sink returns AVERROR_EOF once it is drained
+            if (decoder_drained)
+                return false;
+            decoder_drained = true;
+            check_ffmpeg_error(av_buffersrc_add_frame_flags(src_ctx, nullptr, 0), "Error flushing filter", __FILE__, __LINE__);
+            continue;
+        }
+        check_ffmpeg_error(ret == AVERROR(EAGAIN) ? 0 : ret, "Error decoding frame", __FILE__, __LINE__);
+
+        // the decoder needs another packet
+        if (demuxer_drained)
+            return false;
+        ret = av_read_frame(format_context.get(), packet.get());
+        if (ret == AVERROR_EOF) {
+            demuxer_drained = true;
+            check_ffmpeg_error(avcodec_send_packet(codec_context.get(), nullptr), "Error flushing decoder", __FILE__, __LINE__);
+            continue;
+        }
+        check_ffmpeg_error(ret, "Error reading packet", __FILE__, __LINE__);
+        if (packet->stream_index == stream_index)
+            ret = avcodec_send_packet(codec_context.get(), packet.get());
+        av_packet_unref(packet.get());
+        // a corrupt packet is skipped rather than ending the file
+        if (ret == AVERROR_INVALIDDATA)
+            continue;
+        check_ffmpeg_error(ret, "Error sending packet to decoder", __FILE__, __LINE__);
+    }
+}
+
+size_t Audio_File_tsrt::read_samples(float* destination, size_t count) {
+    size_t read = 0;
+    while (read < count && !finished) {
+        if (converted_offset == converted_frame->nb_samples && !next_converted_frame()) {
+            finished = true;
+            break;
+        }
+
+        const size_t available = static_cast<size_t>(converted_frame->nb_samples - converted_offset);
+        const size_t to_copy = std::min(count - read, available);
+        std::memcpy(destination + read, reinterpret_cast<const float*>(converted_frame->data[0]) + converted_offset, to_copy * sizeof(float));
+        converted_offset += static_cast<int>(to_copy);
+        read += to_copy;
+    }
+    samples_read += read;
+    return read;
+}
+
+bool Audio_File_tsrt::at_end() const noexcept {
+    return finished;
+}
+
+uint64_t Audio_File_tsrt::get_samples_read() const noexcept {
+    return samples_read;
+}
+
+std::chrono::duration<double> Audio_File_tsrt::get_duration_read() const noexcept {
+    return std::chrono::duration<double>(static_cast<double>(samples_read) / SAMPLE_RATE);
+}
+
+bool Audio_File_tsrt::is_live() const noexcept {
+    return false;
+}
+
+const char* Audio_File_tsrt::get_name() const noexcept {
+    return "file";
+}
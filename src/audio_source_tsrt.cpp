@@ -0,0 +1,123 @@
+#include "audio_source_tsrt.h"
+#include "audio_file_tsrt.h"
+#include "audio_tsrt.h"
+#include "constants_config_tsrt.h"
+#include "exceptions_tsrt.h"
+#include "pcm_source_tsrt.h"
+#include "status_codes_tsrt.h"
+#include "synthetic_source_tsrt.h"
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+Pull_Audio_Source::Pull_Audio_Source() :
+    ring{nullptr},
+    overflow_segment(),
+    sequence{0},
+    finished{false},
+    samples{0},
+    dropped_segments{0} {}
+
+tsrt_status_code Pull_Audio_Source::start(Capture_Ring_Buffer& ring, Sample_Clock& clock) {
+    this->ring = &ring;
+    // allocated here rather than with the source, by now the session's chunk of the segment pool is reserved
+    if (overflow_segment.get_size() == 0)
+        overflow_segment = Audio_Segment(SAMPLES_PER_HALF_SEGMENT);
+    // resuming leaves a one segment gap in the timeline so no window spans the pause
+    if (sequence != 0)
+        ++sequence;
+    // the only clock read, the next sample read starts now
+    clock.anchor(sequence * SAMPLES_PER_HALF_SEGMENT);
+    return SUCCESS;
+}
+
+tsrt_status_code Pull_Audio_Source::stop() {
+    ring = nullptr;
+    return SUCCESS;
+}
+
+bool Pull_Audio_Source::produce() {
+    if (finished)
+        return false;
+    if (ring == nullptr)
+        return true;
+
+    Audio_Segment* audio_segment = ring->claim();
+    const bool claimed = audio_segment != nullptr;
+    if (!claimed) {
+        // nothing paces a finite source, wait for the input task to release a slot rather than drop audio, a stop is
+        // still noticed within THREAD_SLEEP_MS
+        if (!is_live()) {
+            ring->wait_for_space(std::chrono::milliseconds(THREAD_SLEEP_MS));
+            return true;
+        }
+        audio_segment = &overflow_segment;
+    }
+
+    const size_t read = read_samples(audio_segment->get_audio(), SAMPLES_PER_HALF_SEGMENT);
+    if (read < SAMPLES_PER_HALF_SEGMENT) {
+        finished = true;
+        if (read == 0)
+            return false;
+        std::memset(audio_segment->get_audio() + read, 0, (SAMPLES_PER_HALF_SEGMENT - read) * sizeof(float));
+    }
+    samples += read;
+
+    // dropped segments still advance the timeline so downstream stages see the gap
+    audio_segment->set_position(sequence * SAMPLES_PER_HALF_SEGMENT, sequence);
+    ++sequence;
+    if (claimed)
+        ring->commit();
+    else
+        ++dropped_segments;
+    return !finished;
+}
+
+Source_Stats Pull_Audio_Source::get_stats() const noexcept {
+    return Source_Stats{samples, dropped_segments, 0, std::chrono::nanoseconds(0), std::chrono::nanoseconds(0)};
+}
+
+std::unique_ptr<Audio_Source> make_audio_source(const std::string& spec, double speed, std::chrono::microseconds jitter,
+                                                std::chrono::seconds duration) {
+    auto argument = [&](const std::string& prefix) { return spec.substr(prefix.size()); };
+    auto starts_with = [&](const std::string& prefix) { return spec.compare(0, prefix.size(), prefix) == 0; };
+
+    if (spec == "portaudio")
+        return std::make_unique<Portaudio_Source>();
+    if (starts_with("portaudio:")) {
+        PaDeviceIndex device = paNoDevice;
+        try {
+            device = std::stoi(argument("portaudio:"));
+        } catch (const std::exception&) {
+            throw Tsrt_Exception(INVALID_ARGUMENT, "Invalid input device index: " + spec, std::chrono::system_clock::now(), __FILE__, __LINE__);
+        }
+        return std::make_unique<Portaudio_Source>(device);
+    }
+    if (starts_with("pcm:"))
+        return std::make_unique<Pcm_Source>(argument("pcm:"));
+    if (starts_with("tone:")) {
+        double frequency = 0.0;
+        try {
+            frequency = std::stod(argument("tone:"));
+        } catch (const std::exception&) {
+            throw Tsrt_Exception(INVALID_ARGUMENT, "Invalid tone frequency: " + spec, std::chrono::system_clock::now(), __FILE__, __LINE__);
+        }
+        return std::make_unique<Synthetic_Source>(SYNTHETIC_TONE, frequency, std::vector<float>(), speed, jitter, duration);
+    }
+    if (spec == "noise")
+        return std::make_unique<Synthetic_Source>(SYNTHETIC_NOISE, 0.0, std::vector<float>(), speed, jitter, duration);
+    if (starts_with("loop:")) {
+        // decoded once up front, so looping never touches the file again
+        Audio_File_tsrt recording(argument("loop:"));
+        std::vector<float> loop;
+        float chunk[SAMPLES_PER_HALF_SEGMENT];
+        size_t read;
+        while ((read = recording.read_samples(chunk, SAMPLES_PER_HALF_SEGMENT)) > 0)
+            loop.insert(loop.end(), chunk, chunk + read);
+        return std::make_unique<Synthetic_Source>(SYNTHETIC_LOOP, 0.0, std::move(loop), speed, jitter, duration);
+    }
+    return std::make_unique<Audio_File_tsrt>(spec);
+}
@@ -3,91 +3,12 @@
 #include "exceptions_tsrt.h"
 #include "status_codes_tsrt.h"
 
+#include <algorithm>
+#include <cstring>
 #include <functional>
 #include <memory>
 #include <sstream>
 #include <string>
-extern "C" {
-#include <libavutil/log.h>
-#include <libavfilter/avfilter.h>
-#include <libavutil/frame.h>
-#include <libavfilter/buffersrc.h>
-#include <libavfilter/buffersink.h>
-}
-
-void avframe_deleter(AVFrame* avframe) {
-    if (avframe != nullptr)
-        av_frame_free(&avframe);
-}
-
-void Audio_tsrt::init_avframe() {
-    avframe_filter.reset(av_frame_alloc());
-    if (!avframe_filter) {
-        throw Tsrt_Exception(INSUFFICIENT_MEMORY, "Error allocating memory for avframe_filter", std::chrono::system_clock::now(), __FILE__, __LINE__);
-    }
-
-    // avframe.channels and avframe.channel_layout are apparently deprecated
-    // but it doesn't work with the what the documentation says to use instead
-    avframe_filter->channels = 1;
-    avframe_filter->channel_layout = AV_CH_LAYOUT_MONO;
-    avframe_filter->format = AV_SAMPLE_FMT_FLT;
-    avframe_filter->sample_rate = SAMPLE_RATE;
-    avframe_filter->nb_samples = SAMPLES_PER_HALF_SEGMENT;
-}
-
-void Audio_tsrt::handle_ffmpeg_errors(std::function<int()> bound_func, const std::string& error_context, std::string file, int line) {
-    int ret = bound_func();
-    if (ret < 0) {
-        char err_buf[AV_ERROR_MAX_STRING_SIZE];
-        av_make_error_string(err_buf, AV_ERROR_MAX_STRING_SIZE, ret);
-        throw Tsrt_Exception(RUNTIME_ERROR, error_context + ": " + err_buf, std::chrono::system_clock::now(), file, line);
-    }
-}
-
-void Audio_tsrt::ffmpeg_log_callback(void* ptr, int level, const char* fmt, va_list vargs) {
-    static char message[8192]; // if this is ever used by multiple threads, this will need to be made thread-safe. As of now it's fine.
-    vsnprintf(message, sizeof(message), fmt, vargs);
-    if (level > AV_LOG_WARNING)
-        log_error(RUNTIME_ERROR, std::string("ffmpeg: ") + message, std::chrono::system_clock::now(), __FILE__, __LINE__);
-}
-
-void avfilter_graph_deleter(AVFilterGraph* avfilter_graph) {
-    if (avfilter_graph != nullptr)
-        avfilter_graph_free(&avfilter_graph);
-}
-
-void Audio_tsrt::init_avfilter_graph() {
-    avfilter_graph.reset(avfilter_graph_alloc());
-    if (avfilter_graph == nullptr) {
-        throw Tsrt_Exception(INSUFFICIENT_MEMORY, "Error allocating memory for avfilter_graph", std::chrono::system_clock::now(), __FILE__, __LINE__);
-    }
-
-    AVFilterContext *bandpass_ctx = nullptr, *afftdn_ctx = nullptr;
-
-    const AVFilter *src = avfilter_get_by_name("abuffer");
-    std::ostringstream src_args;
-    src_args << "sample_rate=" << SAMPLE_RATE << ":sample_fmt=" << SRC_SAMPLE_FMT << ":channel_layout=" << SRC_CHANNEL_LAYOUT;
-    handle_ffmpeg_errors([&]() -> int { return avfilter_graph_create_filter(&src_ctx, src, "src", src_args.str().c_str(), nullptr, avfilter_graph.get()); }, "Error creating source filter", __FILE__, __LINE__);
-
-    const AVFilter *bandpass = avfilter_get_by_name("bandpass");
-    std::ostringstream bandpass_args;
-    bandpass_args << "f=" << BANDPASS_F << ":w=" << BANDPASS_W;
-    handle_ffmpeg_errors([&]() -> int { return avfilter_graph_create_filter(&bandpass_ctx, bandpass, "bandpass", bandpass_args.str().c_str(), nullptr, avfilter_graph.get()); }, "Error creating bandpass filter", __FILE__, __LINE__);
-
-    const AVFilter *afftdn = avfilter_get_by_name("afftdn");
-    std::ostringstream afftdn_args;
-    afftdn_args << "nr=" << AFFTDN_NR << ":nf=" << AFFTDN_NF;
-    handle_ffmpeg_errors([&]() -> int { return avfilter_graph_create_filter(&afftdn_ctx, afftdn, "afftdn", afftdn_args.str().c_str(), nullptr, avfilter_graph.get()); }, "Error creating afftdn filter", __FILE__, __LINE__);
-
-    const AVFilter *sink = avfilter_get_by_name("abuffersink");
-    handle_ffmpeg_errors([&]() -> int { return avfilter_graph_create_filter(&sink_ctx, sink, "sink", nullptr, nullptr, avfilter_graph.get()); }, "Error creating sink filter", __FILE__, __LINE__);
-
-    handle_ffmpeg_errors([&]() -> int { return avfilter_link(src_ctx, 0, bandpass_ctx, 0); }, "Error linking filters", __FILE__, __LINE__);
-    handle_ffmpeg_errors([&]() -> int { return avfilter_link(bandpass_ctx, 0, afftdn_ctx, 0); }, "Error linking filters", __FILE__, __LINE__);
-    handle_ffmpeg_errors([&]() -> int { return avfilter_link(afftdn_ctx, 0, sink_ctx, 0); }, "Error linking filters", __FILE__, __LINE__);
-    
-    avfilter_graph_config(avfilter_graph.get(), nullptr);
-}
 
 void stream_deleter(PaStream* stream) {
     PaError paStatus;
@@ -104,20 +25,64 @@ void stream_deleter(PaStream* stream) {
         log_error(IO_ERROR, Pa_GetErrorText(paStatus), std::chrono::system_clock::now(), __FILE__, __LINE__);
 };
 
-Audio_tsrt::Audio_tsrt() :
+namespace {
+
+/**
+ * @brief Terminates PortAudio when it goes out of scope unless released, so a failure between Pa_Initialize() and
+ * handing the stream to stream_deleter does not leak the initialisation.
+*/
+class Pa_Initialize_Guard {
+private:
+    bool armed{true};
+
+public:
+    Pa_Initialize_Guard() = default;
+    Pa_Initialize_Guard(const Pa_Initialize_Guard&) = delete;
+    Pa_Initialize_Guard& operator=(const Pa_Initialize_Guard&) = delete;
+
+    ~Pa_Initialize_Guard() {
+        if (!armed)
+            return;
+        const PaError paStatus = Pa_Terminate();
+        if (paStatus != paNoError)
+            log_error(IO_ERROR, Pa_GetErrorText(paStatus), std::chrono::system_clock::now(), __FILE__, __LINE__);
+    }
+
+    void release() noexcept {
+        armed = false;
+    }
+};
+
+} // namespace
+
+Audio_tsrt::Audio_tsrt(PaDeviceIndex device) :
     stream{nullptr, stream_deleter},
-    avframe_filter{nullptr, avframe_deleter},
-    avfilter_graph{nullptr, avfilter_graph_deleter},
-    src_ctx{nullptr},
-    sink_ctx{nullptr} {
+    device{device},
+    capture_ring{nullptr},
+    capture_clock{nullptr},
+    capture_segment{nullptr},
+    capture_fill{0},
+    capture_sequence{0},
+    anchor_pending{false},
+    capture_callbacks{0},
+    captured_samples{0},
+    input_overflows{0},
+    dropped_segments{0},
+    input_latency_callbacks{0},
+    input_latency_total_ns{0},
+    input_latency_max_ns{0} {
+
+}
 
+void Audio_tsrt::open_stream() {
     PaError paStatus;
     paStatus = Pa_Initialize();
     if (paStatus != paNoError)
         throw Tsrt_Exception(RUNTIME_ERROR, Pa_GetErrorText(paStatus), std::chrono::system_clock::now(), __FILE__, __LINE__);
-    
+    Pa_Initialize_Guard initialized;
+
     PaStreamParameters input_parameters;
-    input_parameters.device = Pa_GetDefaultInputDevice();
+    input_parameters.device = device == paNoDevice ? Pa_GetDefaultInputDevice() : device;
     if (input_parameters.device == paNoDevice)
         throw Tsrt_Exception(IO_ERROR, "Error: No default input device", std::chrono::system_clock::now(), __FILE__, __LINE__);
     const PaDeviceInfo* input_devicefo = Pa_GetDeviceInfo(input_parameters.device);
@@ -130,17 +95,23 @@ Audio_tsrt::Audio_tsrt() :
     input_parameters.hostApiSpecificStreamInfo = nullptr;
 
     PaStream* raw_stream;
+#if CAPTURE_MODE == CAPTURE_CALLBACK
+    // let the host pick its natural buffer size, the callback gathers whatever it gets into half segments
+    paStatus = Pa_OpenStream(&raw_stream, &input_parameters, nullptr, SAMPLE_RATE, paFramesPerBufferUnspecified, paNoFlag, capture_callback, this);
+#else
     paStatus = Pa_OpenStream(&raw_stream, &input_parameters, nullptr, SAMPLE_RATE, SAMPLES_PER_HALF_SEGMENT, paNoFlag, nullptr, nullptr);
+#endif
     if (paStatus != paNoError)
         throw Tsrt_Exception(IO_ERROR, Pa_GetErrorText(paStatus), std::chrono::system_clock::now(), __FILE__, __LINE__);
+    // stream_deleter terminates PortAudio from here on
     stream.reset(raw_stream);
-
-    init_avfilter_graph();
-    init_avframe();
-    av_log_set_callback(ffmpeg_log_callback);
+    initialized.release();
 }
 
 tsrt_status_code Audio_tsrt::start_stream() {
+    if (!stream)
+        open_stream();
+
     PaError paStatus;
     paStatus = Pa_StartStream(stream.get());
     if (paStatus != paNoError)
@@ -149,6 +120,9 @@ tsrt_status_code Audio_tsrt::start_stream() {
 }
 
 tsrt_status_code Audio_tsrt::stop_stream() {
+    if (!stream)
+        return SUCCESS;
+
     PaError paStatus;
     paStatus = Pa_StopStream(stream.get());
     if (paStatus != paNoError)
@@ -156,6 +130,104 @@ tsrt_status_code Audio_tsrt::stop_stream() {
     return SUCCESS;
 }
 
+tsrt_status_code Audio_tsrt::start_capture(Capture_Ring_Buffer& ring, Sample_Clock& clock) {
+#if CAPTURE_MODE == CAPTURE_CALLBACK
+    capture_ring = &ring;
+    capture_clock = &clock;
+    // a half segment cut short by the last stop is discarded, its sequence number is left as the gap
+    // otherwise resuming leaves a one segment gap in the timeline so no window spans the pause
+    if (capture_sequence != 0 || capture_fill != 0)
+        ++capture_sequence;
+    capture_segment = nullptr;
+    capture_fill = 0;
+    anchor_pending = true;
+    return start_stream();
+#else
+    (void)ring;
+    (void)clock;
+    return INVALID_OPERATION;
+#endif
+}
+
+int Audio_tsrt::capture_callback(const void* input, void* output, unsigned long frame_count,
+                                 const PaStreamCallbackTimeInfo* time_info, PaStreamCallbackFlags status_flags, void* user_data) {
+    (void)output;
+    static_cast<Audio_tsrt*>(user_data)->capture_audio(static_cast<const float*>(input), frame_count, time_info, status_flags);
+    return paContinue;
+}
+
+void Audio_tsrt::capture_audio(const float* input, unsigned long frame_count, const PaStreamCallbackTimeInfo* time_info,
+                               PaStreamCallbackFlags status_flags) noexcept {
+    // single writer, so plain load and store instead of read-modify-write
+    capture_callbacks.store(capture_callbacks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    captured_samples.store(captured_samples.load(std::memory_order_relaxed) + frame_count, std::memory_order_relaxed);
+    if (status_flags & paInputOverflow)
+        input_overflows.store(input_overflows.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    // inputBufferAdcTime is 0 on hosts that do not report it, those callbacks are left out of the latency statistics
+    const bool adc_time_known = time_info != nullptr && time_info->inputBufferAdcTime > 0.0;
+    const int64_t input_latency_ns = adc_time_known ?
+        static_cast<int64_t>((time_info->currentTime - time_info->inputBufferAdcTime) * 1e9) : 0;
+    if (adc_time_known) {
+        input_latency_callbacks.store(input_latency_callbacks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        input_latency_total_ns.store(input_latency_total_ns.load(std::memory_order_relaxed) + input_latency_ns, std::memory_order_relaxed);
+        if (input_latency_ns > input_latency_max_ns.load(std::memory_order_relaxed))
+            input_latency_max_ns.store(input_latency_ns, std::memory_order_relaxed);
+    }
+
+    // the first sample of the first buffer was captured input_latency_ns ago
+    if (anchor_pending) {
+        capture_clock->anchor(capture_sequence * SAMPLES_PER_HALF_SEGMENT + capture_fill,
+                              std::chrono::system_clock::now() - std::chrono::nanoseconds(input_latency_ns));
+        anchor_pending = false;
+    }
+
+    size_t remaining = frame_count;
+    while (remaining > 0) {
+        if (capture_fill == 0)
+            capture_segment = capture_ring->claim();
+
+        const size_t count = std::min(remaining, static_cast<size_t>(SAMPLES_PER_HALF_SEGMENT) - capture_fill);
+        if (capture_segment != nullptr) {
+            float* destination = capture_segment->get_audio() + capture_fill;
+            if (input != nullptr)
+                std::memcpy(destination, input, count * sizeof(float));
+            else
+                std::memset(destination, 0, count * sizeof(float));
+        }
+        if (input != nullptr)
+            input += count;
+        capture_fill += count;
+        remaining -= count;
+
+        if (capture_fill == SAMPLES_PER_HALF_SEGMENT) {
+            if (capture_segment != nullptr) {
+                capture_segment->set_position(capture_sequence * SAMPLES_PER_HALF_SEGMENT, capture_sequence);
+                capture_ring->commit();
+            } else {
+                dropped_segments.store(dropped_segments.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            }
+            // dropped segments still advance the timeline so downstream stages see the gap
+            ++capture_sequence;
+            capture_fill = 0;
+            capture_segment = nullptr;
+        }
+    }
+}
+
+Capture_Stats Audio_tsrt::get_capture_stats() const noexcept {
+    const uint64_t measured = input_latency_callbacks.load(std::memory_order_relaxed);
+    const int64_t total_ns = input_latency_total_ns.load(std::memory_order_relaxed);
+    return Capture_Stats{
+        capture_callbacks.load(std::memory_order_relaxed),
+        captured_samples.load(std::memory_order_relaxed),
+        input_overflows.load(std::memory_order_relaxed),
+        dropped_segments.load(std::memory_order_relaxed),
+        std::chrono::nanoseconds(measured == 0 ? 0 : total_ns / static_cast<int64_t>(measured)),
+        std::chrono::nanoseconds(input_latency_max_ns.load(std::memory_order_relaxed))
+    };
+}
+
 tsrt_status_code Audio_tsrt::read_audio_segment(float* segment, int segment_size) {
     PaError paStatus;
     paStatus = Pa_ReadStream(stream.get(), segment, segment_size);
@@ -164,24 +236,59 @@ tsrt_status_code Audio_tsrt::read_audio_segment(float* segment, int segment_size
     return SUCCESS;
 }
 
-tsrt_status_code Audio_tsrt::preprocess_audio_segment(float* segment) {
-    int ret_code;
+bool Audio_tsrt::is_streaming() const noexcept {
+    return stream && Pa_IsStreamActive(stream.get()) == 1;
+}
 
-    avframe_filter->data[0] = reinterpret_cast<uint8_t*>(segment);
-    handle_ffmpeg_errors([&]() -> int { return av_buffersrc_add_frame_flags(src_ctx, avframe_filter.get(), AV_BUFFERSRC_FLAG_PUSH); }, "Error adding frame to filter", __FILE__, __LINE__);
-    /*
-    The current filters being used will always return a frame, so this is not necessary.
-    However, if the filters are changed, this will need to be revised.
-    */
+Portaudio_Source::Portaudio_Source(PaDeviceIndex device) : audio_tsrt(std::make_unique<Audio_tsrt>(device)) {}
 
-    return SUCCESS;
+tsrt_status_code Portaudio_Source::start(Capture_Ring_Buffer& ring, Sample_Clock& clock) {
+#if CAPTURE_MODE == CAPTURE_CALLBACK
+    return audio_tsrt->start_capture(ring, clock);
+#else
+    tsrt_status_code status = audio_tsrt->start_stream();
+    if (status != SUCCESS)
+        return status;
+    return Pull_Audio_Source::start(ring, clock);
+#endif
 }
 
-bool Audio_tsrt::is_streaming() const noexcept {
-    return Pa_IsStreamActive(stream.get());
+tsrt_status_code Portaudio_Source::stop() {
+    Pull_Audio_Source::stop();
+    return audio_tsrt->stop_stream();
+}
+
+bool Portaudio_Source::produce() {
+#if CAPTURE_MODE == CAPTURE_CALLBACK
+    // never called, the callback does the work
+    return true;
+#else
+    return Pull_Audio_Source::produce();
+#endif
 }
 
-Audio_tsrt& Audio_tsrt::get_instance() {
-    static Audio_tsrt instance;
-    return instance;
-}
\ No newline at end of file
+size_t Portaudio_Source::read_samples(float* destination, size_t count) {
+    audio_tsrt->read_audio_segment(destination, static_cast<int>(count));
+    return count;
+}
+
+bool Portaudio_Source::is_live() const noexcept {
+    return true;
+}
+
+bool Portaudio_Source::is_callback_driven() const noexcept {
+    return CAPTURE_MODE == CAPTURE_CALLBACK;
+}
+
+const char* Portaudio_Source::get_name() const noexcept {
+    return "portaudio";
+}
+
+Source_Stats Portaudio_Source::get_stats() const noexcept {
+#if CAPTURE_MODE == CAPTURE_CALLBACK
+    const Capture_Stats stats = audio_tsrt->get_capture_stats();
+    return Source_Stats{stats.samples, stats.dropped_segments, stats.input_overflows, stats.mean_input_latency, stats.max_input_latency};
+#else
+    return Pull_Audio_Source::get_stats();
+#endif
+}
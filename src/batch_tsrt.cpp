@@ -0,0 +1,266 @@
+#include "batch_tsrt.h"
+#include "audio_file_tsrt.h"
+#include "audio_segment_tsrt.h"
+#include "constants_config_tsrt.h"
+#include "exceptions_tsrt.h"
+#include "logger_tsrt.h"
+#include "preprocessing_chain_tsrt.h"
+#include "status_codes_tsrt.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+#include <tbb/parallel_for_each.h>
+#include <tbb/parallel_pipeline.h>
+
+namespace {
+
+// the most samples a chunk repeats from the one before, the start of the first window not whole in it onwards, so a
+// window spanning the boundary is whole in the later chunk however much the filter graph delayed its output
+constexpr size_t BATCH_MAX_HISTORY_SAMPLES = WINDOW_LENGTH - 1;
+
+/**
+ * @brief One analysis window's line of the script.
+ *
+ * @param sequence The window's sequence number.
+ * @param start_sample The absolute index of the window's first sample.
+ * @param end_sample The absolute index after the window's last sample of the file, short of WINDOW_LENGTH at its end.
+*/
+struct Window_Result {
+    uint64_t sequence;
+    uint64_t start_sample;
+    uint64_t end_sample;
+};
+
+/**
+ * @brief A pipeline token, one chunk of a file.
+ *
+ * @details Chunks are allocated once per file and reused, see transcribe_file().
+ *
+ * @param input The chunk's decoded samples, the filter graph's until it releases them.
+ * @param input_start The absolute index of input[0].
+ * @param input_size The number of samples in input, 0 for the last chunk that only flushes the filter graph.
+ * @param samples_end The absolute index after the last sample read from the file so far, the padding after it is not
+ * audio.
+ * @param last_input The id of the last half segment pushed from input into the filter graph.
+ * @param pushed Set once input went into the filter graph, so last_input is valid.
+ * @param flush Set on the chunk after the end of the file.
+ * @param audio The previous chunk's filtered tail followed by what the filter graph returned for this chunk.
+ * @param start_sample The absolute index of audio[0].
+ * @param history The number of samples repeated from the previous chunk.
+ * @param first_window The absolute index of the first window's first sample, the first window not whole in the chunk before.
+ * @param results The script lines of the windows that end in this chunk.
+*/
+struct Batch_Chunk {
+    Audio_Segment input;
+    uint64_t input_start;
+    size_t input_size;
+    uint64_t samples_end;
+    uint64_t last_input;
+    bool pushed;
+    bool flush;
+    std::vector<float> audio;
+    uint64_t start_sample;
+    size_t history;
+    uint64_t first_window;
+    std::vector<Window_Result> results;
+
+    Batch_Chunk() : input(BATCH_CHUNK_SAMPLES), input_start(0), input_size(0), samples_end(0), last_input(0), pushed(false), flush(false),
+                    start_sample(0), history(0), first_window(0) {
+        audio.reserve(BATCH_MAX_HISTORY_SAMPLES + BATCH_CHUNK_SAMPLES);
+        results.reserve(BATCH_CHUNK_SAMPLES / WINDOW_HOP + 1);
+    }
+};
+
+} // namespace
+
+std::vector<std::string> read_batch_list(const std::string& list_path) {
+    std::ifstream list(list_path);
+    if (!list)
+        throw Tsrt_Exception(IO_ERROR, "Error opening batch list " + list_path, std::chrono::system_clock::now(), __FILE__, __LINE__);
+
+    std::vector<std::string> inputs;
+    std::string line;
+    while (std::getline(list, line)) {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.empty() || line[0] == '#')
+            continue;
+        inputs.push_back(line);
+    }
+    return inputs;
+}
+
+std::string batch_output_path(const std::string& input, const std::string& output_dir) {
+    std::filesystem::path output(input);
+    if (!output_dir.empty()) {
+        std::filesystem::path relative = output.lexically_normal();
+        // ".." would write outside the output directory, the absolute path stands in for the relative one
+        if (relative.is_absolute() || (!relative.empty() && *relative.begin() == "..")) {
+            std::error_code error;
+            const std::filesystem::path absolute = std::filesystem::absolute(relative, error);
+            relative = error ? relative.filename() : absolute.lexically_normal().relative_path();
+        }
+        output = std::filesystem::path(output_dir) / relative;
+    }
+    output += ".tsrt.tsv";
+    return output.string();
+}
+
+Batch_Result transcribe_file(const std::string& input, const std::string& output, const Preprocessor_Config& preprocessor_config) noexcept {
+    Batch_Result result{input, output, SUCCESS, std::chrono::duration<double>(0), std::chrono::duration<double>(0), 0};
+    const auto started = std::chrono::steady_clock::now();
+
+    try {
+        Audio_File_tsrt audio_file(input);
+        // this file's own preprocessing chain, only ever used by the serial in order preprocessing filter
+        std::unique_ptr<Preprocessing_Chain> preprocessor = make_preprocessing_chain(preprocessor_config);
+        // the input's directories under the output directory, a failure shows as the script failing to open
+        const std::filesystem::path output_parent = std::filesystem::path(output).parent_path();
+        std::error_code error;
+        if (!output_parent.empty())
+            std::filesystem::create_directories(output_parent, error);
+        std::ofstream script(output);
+        if (!script)
+            throw Tsrt_Exception(IO_ERROR, "Error opening " + output, std::chrono::system_clock::now(), __FILE__, __LINE__);
+        script << "sequence\tstart_s\tend_s\tspeaker\temotion\ttext\n";
+
+        // at most BATCH_TOKENS_PER_FILE chunks are in flight and they leave the pipeline in order, so by the time chunk
+        // i is decoded chunk i - BATCH_TOKENS_PER_FILE is done, the spare slot gives the filter graph a chunk's time to
+        // release the input of chunk i - BATCH_TOKENS_PER_FILE - 1, which it held for at most its delay
+        std::vector<Batch_Chunk> chunks(BATCH_TOKENS_PER_FILE + 1);
+        std::vector<float> tail;
+        tail.reserve(BATCH_MAX_HISTORY_SAMPLES);
+        uint64_t chunk_count = 0;
+        uint64_t decoded = 0;
+        uint64_t filtered = 0;
+        uint64_t next_window_start = 0;
+        bool end_of_file = false;
+
+        tbb::parallel_pipeline(BATCH_TOKENS_PER_FILE,
+            tbb::make_filter<void, Batch_Chunk*>(tbb::filter_mode::serial_in_order,
+                [&](tbb::flow_control& control) -> Batch_Chunk* {
+                    if (end_of_file) {
+                        control.stop();
+                        return nullptr;
+                    }
+                    Batch_Chunk* chunk = &chunks[chunk_count++ % chunks.size()];
+                    if (chunk->pushed && !preprocessor->input_released(chunk->last_input))
+                        throw Tsrt_Exception(RUNTIME_ERROR, "Error reusing a chunk the filter graph still holds", std::chrono::system_clock::now(), __FILE__, __LINE__);
+                    chunk->pushed = false;
+
+                    const size_t read = audio_file.read_samples(chunk->input.get_audio(), BATCH_CHUNK_SAMPLES);
+                    // whole half segments for the filter graph, the end of the file is padded with silence
+                    const size_t padded = (read + SAMPLES_PER_HALF_SEGMENT - 1) / SAMPLES_PER_HALF_SEGMENT * SAMPLES_PER_HALF_SEGMENT;
+                    std::memset(chunk->input.get_audio() + read, 0, (padded - read) * sizeof(float));
+                    chunk->input_start = decoded;
+                    chunk->input_size = padded;
+                    chunk->samples_end = decoded + read;
+                    decoded += padded;
+                    // a short read is the end of the file, the chunk flushes the filter graph after its samples
+                    chunk->flush = read < BATCH_CHUNK_SAMPLES;
+                    end_of_file = chunk->flush;
+                    return chunk;
+                }) &
+            tbb::make_filter<Batch_Chunk*, Batch_Chunk*>(tbb::filter_mode::serial_in_order,
+                [&](Batch_Chunk* chunk) -> Batch_Chunk* {
+                    chunk->audio.assign(tail.begin(), tail.end());
+                    chunk->history = tail.size();
+                    chunk->start_sample = filtered - chunk->history;
+
+                    // the sink is drained after every push, what comes out is copied once, to make the chunk contiguous
+                    Filtered_Audio filtered_audio;
+                    const auto drain = [&]() {
+                        while (preprocessor->pull_audio(filtered_audio))
+                            chunk->audio.insert(chunk->audio.end(), filtered_audio.samples, filtered_audio.samples + filtered_audio.count);
+                    };
+                    for (size_t offset = 0; offset < chunk->input_size; offset += SAMPLES_PER_HALF_SEGMENT) {
+                        chunk->last_input = preprocessor->push_audio(chunk->input.get_audio() + offset, SAMPLES_PER_HALF_SEGMENT, chunk->input_start + offset);
+                        chunk->pushed = true;
+                        drain();
+                    }
+                    if (chunk->flush) {
+                        preprocessor->flush();
+                        drain();
+                    }
+                    filtered += chunk->audio.size() - chunk->history;
+
+                    // the filter graph's delay leaves the chunk's end anywhere between hops, the next chunk repeats
+                    // everything from the first window that is not whole yet, so no window falls between two chunks
+                    chunk->first_window = next_window_start;
+                    while (next_window_start + WINDOW_LENGTH <= filtered)
+                        next_window_start += WINDOW_HOP;
+                    const size_t tail_size = static_cast<size_t>(filtered - next_window_start);
+                    tail.assign(chunk->audio.end() - tail_size, chunk->audio.end());
+                    return chunk;
+                }) &
+            tbb::make_filter<Batch_Chunk*, Batch_Chunk*>(tbb::filter_mode::parallel,
+                [&](Batch_Chunk* chunk) -> Batch_Chunk* {
+                    chunk->results.clear();
+                    // windows start on whole hops of the timeline, each is taken by the first chunk it is whole in,
+                    // only the last chunk has padding, windows made of nothing else are not audio of the file
+                    const uint64_t end = chunk->start_sample + chunk->audio.size();
+                    for (uint64_t start = chunk->first_window; start + WINDOW_LENGTH <= end && start < chunk->samples_end; start += WINDOW_HOP) {
+                        // speech recognition, diarization, speaker identification and emotion recognition
+                        // run on chunk->audio.data() + (start - chunk->start_sample) here once they exist
+                        chunk->results.push_back(Window_Result{start / WINDOW_HOP, start, std::min<uint64_t>(start + WINDOW_LENGTH, chunk->samples_end)});
+                    }
+                    return chunk;
+                }) &
+            tbb::make_filter<Batch_Chunk*, void>(tbb::filter_mode::serial_in_order,
+                [&](Batch_Chunk* chunk) {
+                    for (const Window_Result& window : chunk->results) {
+                        script << window.sequence << '\t'
+                               << static_cast<double>(window.start_sample) / SAMPLE_RATE << '\t'
+                               << static_cast<double>(window.end_sample) / SAMPLE_RATE << "\t\t\t\n";
+                    }
+                    result.windows += chunk->results.size();
+                }));
+
+        script.flush();
+        if (!script)
+            throw Tsrt_Exception(IO_ERROR, "Error writing " + output, std::chrono::system_clock::now(), __FILE__, __LINE__);
+        result.audio = audio_file.get_duration_read();
+    } catch (const Tsrt_Exception& e) {
+        result.status = e.get_status_code();
+        log_error(result.status, input + ": " + e.what(), std::chrono::system_clock::now(), __FILE__, __LINE__);
+    } catch (const std::exception& e) {
+        result.status = UNKNOWN_ERROR;
+        log_error(result.status, input + ": " + e.what(), std::chrono::system_clock::now(), __FILE__, __LINE__);
+    }
+
+    result.latency = std::chrono::steady_clock::now() - started;
+    return result;
+}
+
+std::vector<Batch_Result> run_batch(const std::vector<std::string>& inputs, const std::string& output_dir, const Preprocessor_Config& preprocessor_config) {
+    std::vector<Batch_Result> results(inputs.size());
+    std::vector<std::string> outputs(inputs.size());
+    std::vector<size_t> order;
+    order.reserve(inputs.size());
+    // files run at the same time, two writing the same script would interleave, the later inputs are rejected up front
+    std::unordered_map<std::string, size_t> claimed;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        outputs[i] = batch_output_path(inputs[i], output_dir);
+        const auto [first, inserted] = claimed.emplace(std::filesystem::path(outputs[i]).lexically_normal().string(), i);
+        if (inserted) {
+            order.push_back(i);
+            continue;
+        }
+        results[i] = Batch_Result{inputs[i], outputs[i], INVALID_ARGUMENT, std::chrono::duration<double>(0), std::chrono::duration<double>(0), 0};
+        log_error(INVALID_ARGUMENT, inputs[i] + ": its script " + outputs[i] + " is already written for " + inputs[first->second], std::chrono::system_clock::now(), __FILE__, __LINE__);
+    }
+
+    tbb::parallel_for_each(order.begin(), order.end(), [&](size_t i) {
+        results[i] = transcribe_file(inputs[i], outputs[i], preprocessor_config);
+    });
+    return results;
+}
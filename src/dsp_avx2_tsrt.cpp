@@ -0,0 +1,377 @@
+#include "dsp_kernels_tsrt.h"
+
+#include <cstddef>
+
+// Built with AVX2 and FMA enabled, see CMakeLists.txt, only ever called once best_dsp_isa() found them on the CPU.
+// Nothing but the kernels lives here, so no inline function from a shared header is compiled for AVX2 and then picked
+// by the linker for a caller on a CPU without it.
+#if defined(__AVX2__)
+
+#include <immintrin.h>
+
+namespace {
+
+constexpr size_t LANES = 8;
+constexpr size_t COMPLEX_LANES = LANES / 2; // interleaved complex values per vector
+
+void avx2_biquad(Biquad_Section& section, float* samples, size_t count) {
+    const float b1 = section.b1, b2 = section.b2, a1 = section.a1, a2 = section.a2;
+    float s1 = section.s1, s2 = section.s2;
+    size_t i = 0;
+    for (; i + LANES <= count; i += LANES) {
+        float* block = samples + i;
+        // the inputs' part does not wait for the state, only the last two multiply adds do
+        __m256 inputs = _mm256_mul_ps(_mm256_set1_ps(block[0]), _mm256_load_ps(section.response[0]));
+        for (size_t k = 1; k < LANES; ++k)
+            inputs = _mm256_fmadd_ps(_mm256_set1_ps(block[k]), _mm256_load_ps(section.response[k]), inputs);
+        __m256 outputs = _mm256_fmadd_ps(_mm256_set1_ps(s1), _mm256_load_ps(section.response[BIQUAD_BLOCK_SAMPLES]), inputs);
+        outputs = _mm256_fmadd_ps(_mm256_set1_ps(s2), _mm256_load_ps(section.response[BIQUAD_BLOCK_SAMPLES + 1]), outputs);
+
+        const float x6 = block[LANES - 2], x7 = block[LANES - 1];
+        _mm256_storeu_ps(block, outputs);
+        const float y6 = block[LANES - 2], y7 = block[LANES - 1];
+        s1 = b1 * x7 - a1 * y7 + b2 * x6 - a2 * y6;
+        s2 = b2 * x7 - a2 * y7;
+    }
+
+    const float b0 = section.b0;
+    for (; i < count; ++i) {
+        const float x = samples[i];
+        const float y = b0 * x + s1;
+        s1 = b1 * x - a1 * y + s2;
+        s2 = b2 * x - a2 * y;
+        samples[i] = y;
+    }
+    section.s1 = s1;
+    section.s2 = s2;
+}
+
+void avx2_multiply(float* destination, const float* a, const float* b, size_t count) {
+    for (size_t i = 0; i < count; i += LANES)
+        _mm256_store_ps(destination + i, _mm256_mul_ps(_mm256_load_ps(a + i), _mm256_load_ps(b + i)));
+}
+
+void avx2_multiply_add(float* accumulator, const float* a, const float* b, size_t count) {
+    for (size_t i = 0; i < count; i += LANES)
+        _mm256_store_ps(accumulator + i, _mm256_fmadd_ps(_mm256_load_ps(a + i), _mm256_load_ps(b + i), _mm256_load_ps(accumulator + i)));
+}
+
+void avx2_spectral_subtract(float* spectrum, float* noise, size_t bins, const Spectral_Subtraction& params) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 floor = _mm256_set1_ps(params.noise_floor);
+    const __m256 min_gain_squared = _mm256_set1_ps(params.min_gain_squared);
+    const __m256 rise = _mm256_set1_ps(params.noise_rise);
+    const __m256 fall = _mm256_set1_ps(params.noise_fall);
+    const __m256 oversubtraction = _mm256_set1_ps(params.oversubtraction);
+    for (size_t i = 0; i < bins; i += LANES) {
+        const __m256 low = _mm256_load_ps(spectrum + 2 * i);
+        const __m256 high = _mm256_load_ps(spectrum + 2 * i + LANES);
+        // hadd pairs within 128 bit lanes, giving bins 0 1 4 5 2 3 6 7, the 64 bit permute puts them in order
+        const __m256 pairs = _mm256_hadd_ps(_mm256_mul_ps(low, low), _mm256_mul_ps(high, high));
+        const __m256 power = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(pairs), _MM_SHUFFLE(3, 1, 2, 0)));
+
+        const __m256 previous = _mm256_load_ps(noise + i);
+        const __m256 smoothing = _mm256_blendv_ps(fall, rise, _mm256_cmp_ps(power, previous, _CMP_GT_OQ));
+        const __m256 estimate = _mm256_max_ps(_mm256_fmadd_ps(smoothing, _mm256_sub_ps(previous, power), power), floor);
+        _mm256_store_ps(noise + i, estimate);
+
+        const __m256 gain_squared = _mm256_max_ps(_mm256_fnmadd_ps(oversubtraction, _mm256_div_ps(estimate, power), one), min_gain_squared);
+        const __m256 gain = _mm256_sqrt_ps(gain_squared);
+        // each gain twice, once for the real and once for the imaginary part
+        const __m256 gain_low = _mm256_unpacklo_ps(gain, gain);
+        const __m256 gain_high = _mm256_unpackhi_ps(gain, gain);
+        _mm256_store_ps(spectrum + 2 * i, _mm256_mul_ps(low, _mm256_permute2f128_ps(gain_low, gain_high, 0x20)));
+        _mm256_store_ps(spectrum + 2 * i + LANES, _mm256_mul_ps(high, _mm256_permute2f128_ps(gain_low, gain_high, 0x31)));
+    }
+}
+
+float horizontal_sum(__m256 v) {
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+}
+
+// for positive normal x, the exponent plus the polynomial of the mantissa, see LOG2_POLYNOMIAL
+__m256 log2_ps(__m256 x) {
+    const __m256i bits = _mm256_castps_si256(x);
+    const __m256 exponent = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127)));
+    const __m256 mantissa = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007fffff)), _mm256_set1_epi32(0x3f800000)));
+    const __m256 t = _mm256_sub_ps(mantissa, _mm256_set1_ps(1.0f));
+    __m256 polynomial = _mm256_set1_ps(LOG2_POLYNOMIAL[5]);
+    for (int k = 4; k >= 0; --k)
+        polynomial = _mm256_fmadd_ps(polynomial, t, _mm256_set1_ps(LOG2_POLYNOMIAL[k]));
+    return _mm256_fmadd_ps(polynomial, t, exponent);
+}
+
+void avx2_energy_crossings(const float* samples, size_t count, float& energy, size_t& crossings) {
+    __m256 sum = _mm256_setzero_ps();
+    __m256i changes = _mm256_setzero_si256();
+    size_t i = 0;
+    // each sample is compared with the next, so the last vector needs one sample past it
+    for (; i + LANES < count; i += LANES) {
+        const __m256 x = _mm256_loadu_ps(samples + i);
+        const __m256 next = _mm256_loadu_ps(samples + i + 1);
+        sum = _mm256_fmadd_ps(x, x, sum);
+        // the sign bit of the xor is set where the signs differ, shifted down it counts one
+        changes = _mm256_add_epi32(changes, _mm256_srli_epi32(_mm256_castps_si256(_mm256_xor_ps(x, next)), 31));
+    }
+
+    float total = horizontal_sum(sum);
+    __m128i count_sum = _mm_add_epi32(_mm256_castsi256_si128(changes), _mm256_extracti128_si256(changes, 1));
+    count_sum = _mm_add_epi32(count_sum, _mm_shuffle_epi32(count_sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    count_sum = _mm_add_epi32(count_sum, _mm_shuffle_epi32(count_sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    size_t total_changes = static_cast<size_t>(_mm_cvtsi128_si32(count_sum));
+    // the rest by the scalar kernel, from the first sample not compared with the next
+    float tail_energy = 0.0f;
+    size_t tail_changes = 0;
+    scalar_dsp_kernels()->energy_crossings(samples + i, count - i, tail_energy, tail_changes);
+    energy = total + tail_energy;
+    crossings = total_changes + tail_changes;
+}
+
+void avx2_log_power_sum(const float* spectrum, size_t bins, float floor, float& power, float& log_power) {
+    const __m256 minimum = _mm256_set1_ps(floor);
+    __m256 power_sum = _mm256_setzero_ps();
+    __m256 log_sum = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + LANES <= bins; i += LANES) {
+        const __m256 low = _mm256_loadu_ps(spectrum + 2 * i);
+        const __m256 high = _mm256_loadu_ps(spectrum + 2 * i + LANES);
+        // the bins' order does not matter for sums, no permute needed after the hadd
+        const __m256 bin = _mm256_max_ps(_mm256_hadd_ps(_mm256_mul_ps(low, low), _mm256_mul_ps(high, high)), minimum);
+        power_sum = _mm256_add_ps(power_sum, bin);
+        log_sum = _mm256_add_ps(log_sum, log2_ps(bin));
+    }
+
+    float power_total = horizontal_sum(power_sum);
+    float log_total = horizontal_sum(log_sum);
+    float tail_power = 0.0f;
+    float tail_log = 0.0f;
+    scalar_dsp_kernels()->log_power_sum(spectrum + 2 * i, bins - i, floor, tail_power, tail_log);
+    power = power_total + tail_power;
+    log_power = log_total + tail_log;
+}
+
+void avx2_power_spectrum(float* power, const float* spectrum, size_t bins) {
+    for (size_t i = 0; i < bins; i += LANES) {
+        const __m256 low = _mm256_load_ps(spectrum + 2 * i);
+        const __m256 high = _mm256_load_ps(spectrum + 2 * i + LANES);
+        // hadd pairs within 128 bit lanes, giving bins 0 1 4 5 2 3 6 7, the 64 bit permute puts them in order
+        const __m256 pairs = _mm256_hadd_ps(_mm256_mul_ps(low, low), _mm256_mul_ps(high, high));
+        _mm256_store_ps(power + i, _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(pairs), _MM_SHUFFLE(3, 1, 2, 0))));
+    }
+}
+
+float avx2_dot(const float* a, const float* b, size_t count) {
+    __m256 sum = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + LANES <= count; i += LANES)
+        sum = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum);
+    return horizontal_sum(sum) + scalar_dsp_kernels()->dot(a + i, b + i, count - i);
+}
+
+void avx2_log_floor(float* values, size_t count, float floor) {
+    const __m256 minimum = _mm256_set1_ps(floor);
+    const __m256 ln_2 = _mm256_set1_ps(LN_2);
+    for (size_t i = 0; i < count; i += LANES)
+        _mm256_store_ps(values + i, _mm256_mul_ps(log2_ps(_mm256_max_ps(_mm256_load_ps(values + i), minimum)), ln_2));
+}
+
+// interleaved complex values times one complex value, broadcast as its real and imaginary parts, or times interleaved
+// complex values whose real and imaginary parts are duplicated into pairs
+__m256 complex_multiply(__m256 v, __m256 wr, __m256 wi) {
+    return _mm256_fmaddsub_ps(v, wr, _mm256_mul_ps(_mm256_shuffle_ps(v, v, 0xB1), wi));
+}
+
+// interleaved complex values conjugated, the sign of their imaginary parts flipped
+__m256 conjugate(__m256 v) {
+    return _mm256_xor_ps(v, _mm256_setr_ps(0.0f, -0.0f, 0.0f, -0.0f, 0.0f, -0.0f, 0.0f, -0.0f));
+}
+
+// interleaved complex values times -i, (re, im) to (im, -re)
+__m256 times_minus_i(__m256 v) {
+    return conjugate(_mm256_shuffle_ps(v, v, 0xB1));
+}
+
+// interleaved complex values in reverse order
+__m256 reverse_complex(__m256 v) {
+    return _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(v), 0x1B));
+}
+
+template <size_t Radix>
+void fft_butterfly(__m256 (&a)[Radix]) {
+    if constexpr (Radix == 2) {
+        const __m256 a0 = a[0];
+        a[0] = _mm256_add_ps(a0, a[1]);
+        a[1] = _mm256_sub_ps(a0, a[1]);
+    } else if constexpr (Radix == 3) {
+        const __m256 t1 = _mm256_add_ps(a[1], a[2]);
+        const __m256 t2 = _mm256_mul_ps(times_minus_i(_mm256_sub_ps(a[1], a[2])), _mm256_set1_ps(FFT_SIN_2PI_3));
+        const __m256 middle = _mm256_fnmadd_ps(_mm256_set1_ps(0.5f), t1, a[0]);
+        a[0] = _mm256_add_ps(a[0], t1);
+        a[1] = _mm256_add_ps(middle, t2);
+        a[2] = _mm256_sub_ps(middle, t2);
+    } else if constexpr (Radix == 4) {
+        const __m256 t0 = _mm256_add_ps(a[0], a[2]);
+        const __m256 t1 = _mm256_sub_ps(a[0], a[2]);
+        const __m256 t2 = _mm256_add_ps(a[1], a[3]);
+        const __m256 t3 = times_minus_i(_mm256_sub_ps(a[1], a[3]));
+        a[0] = _mm256_add_ps(t0, t2);
+        a[1] = _mm256_add_ps(t1, t3);
+        a[2] = _mm256_sub_ps(t0, t2);
+        a[3] = _mm256_sub_ps(t1, t3);
+    } else {
+        static_assert(Radix == 5, "The FFT passes are radix 2, 3, 4 or 5");
+        const __m256 cos_1 = _mm256_set1_ps(FFT_COS_2PI_5), cos_2 = _mm256_set1_ps(FFT_COS_4PI_5);
+        const __m256 sin_1 = _mm256_set1_ps(FFT_SIN_2PI_5), sin_2 = _mm256_set1_ps(FFT_SIN_4PI_5);
+        const __m256 t1 = _mm256_add_ps(a[1], a[4]);
+        const __m256 t2 = _mm256_add_ps(a[2], a[3]);
+        const __m256 t3 = _mm256_sub_ps(a[1], a[4]);
+        const __m256 t4 = _mm256_sub_ps(a[2], a[3]);
+        const __m256 b1 = _mm256_fmadd_ps(cos_2, t2, _mm256_fmadd_ps(cos_1, t1, a[0]));
+        const __m256 b2 = _mm256_fmadd_ps(cos_1, t2, _mm256_fmadd_ps(cos_2, t1, a[0]));
+        const __m256 d1 = times_minus_i(_mm256_fmadd_ps(sin_1, t3, _mm256_mul_ps(sin_2, t4)));
+        const __m256 d2 = times_minus_i(_mm256_fmsub_ps(sin_2, t3, _mm256_mul_ps(sin_1, t4)));
+        a[0] = _mm256_add_ps(a[0], _mm256_add_ps(t1, t2));
+        a[1] = _mm256_add_ps(b1, d1);
+        a[4] = _mm256_sub_ps(b1, d1);
+        a[2] = _mm256_add_ps(b2, d2);
+        a[3] = _mm256_sub_ps(b2, d2);
+    }
+}
+
+// the twiddles of the butterflies a vector holds the runs of, each repeated for its Run values
+template <size_t Run>
+__m256 run_twiddles(const float* twiddles) {
+    if constexpr (Run == 1)
+        return _mm256_loadu_ps(twiddles);
+    else
+        return _mm256_permutevar8x32_ps(_mm256_castps128_ps256(_mm_loadu_ps(twiddles)), _mm256_setr_epi32(0, 1, 0, 1, 2, 3, 2, 3));
+}
+
+// stores the runs of Run values a vector holds, the next run spacing complex values after the last
+template <size_t Run>
+void store_runs(float* output, size_t spacing, __m256 v) {
+    const __m128 low = _mm256_castps256_ps128(v);
+    const __m128 high = _mm256_extractf128_ps(v, 1);
+    if constexpr (Run == 1) {
+        _mm_storel_pi(reinterpret_cast<__m64*>(output), low);
+        _mm_storeh_pi(reinterpret_cast<__m64*>(output + 2 * spacing), low);
+        _mm_storel_pi(reinterpret_cast<__m64*>(output + 4 * spacing), high);
+        _mm_storeh_pi(reinterpret_cast<__m64*>(output + 6 * spacing), high);
+    } else {
+        _mm_storeu_ps(output, low);
+        _mm_storeu_ps(output + 2 * spacing, high);
+    }
+}
+
+// the butterflies from p on whose runs of Run values a vector holds, neighbours in the input but Radix runs apart in
+// the output, returns the first one left over
+template <size_t Radix, size_t Run>
+size_t avx2_fft_runs(const Fft_Pass& pass, size_t p, size_t last, const float* input, float* output) {
+    constexpr size_t group = COMPLEX_LANES / Run;
+    const size_t m = pass.m;
+    for (; p + group <= last; p += group) {
+        __m256 a[Radix];
+        for (size_t j = 0; j < Radix; ++j)
+            a[j] = _mm256_loadu_ps(input + 2 * Run * (p + j * m));
+        fft_butterfly<Radix>(a);
+        store_runs<Run>(output + 2 * Run * Radix * p, Run * Radix, a[0]);
+        for (size_t k = 1; k < Radix; ++k) {
+            const __m256 w = run_twiddles<Run>(pass.twiddles + 2 * ((k - 1) * m + p));
+            store_runs<Run>(output + 2 * Run * (Radix * p + k), Run * Radix, complex_multiply(a[k], _mm256_moveldup_ps(w), _mm256_movehdup_ps(w)));
+        }
+    }
+    return p;
+}
+
+template <size_t Radix>
+void avx2_fft_radix(const Fft_Pass& pass, size_t first, size_t last, const float* input, float* output) {
+    const size_t m = pass.m, s = pass.stride;
+    size_t p = first;
+    if (s % COMPLEX_LANES == 0) {
+        // a butterfly's runs are whole vectors with one twiddle each
+        for (; p < last; ++p) {
+            __m256 wr[Radix - 1], wi[Radix - 1];
+            for (size_t k = 0; k + 1 < Radix; ++k) {
+                wr[k] = _mm256_set1_ps(pass.twiddles[2 * (k * m + p)]);
+                wi[k] = _mm256_set1_ps(pass.twiddles[2 * (k * m + p) + 1]);
+            }
+            for (size_t q = 0; q < s; q += COMPLEX_LANES) {
+                __m256 a[Radix];
+                for (size_t j = 0; j < Radix; ++j)
+                    a[j] = _mm256_loadu_ps(input + 2 * (q + s * (p + j * m)));
+                fft_butterfly<Radix>(a);
+                float* y = output + 2 * (q + s * Radix * p);
+                _mm256_storeu_ps(y, a[0]);
+                for (size_t k = 1; k < Radix; ++k)
+                    _mm256_storeu_ps(y + 2 * s * k, complex_multiply(a[k], wr[k - 1], wi[k - 1]));
+            }
+        }
+    } else if (s == 1) {
+        p = avx2_fft_runs<Radix, 1>(pass, p, last, input, output);
+    } else if (s == 2) {
+        p = avx2_fft_runs<Radix, 2>(pass, p, last, input, output);
+    }
+    // the butterflies left over, or runs no vector kernel handles, by the scalar kernel
+    if (p < last)
+        scalar_dsp_kernels()->fft_pass(pass, p, last, input, output);
+}
+
+void avx2_fft_pass(const Fft_Pass& pass, size_t first, size_t last, const float* input, float* output) {
+    switch (pass.radix) {
+        case 2: avx2_fft_radix<2>(pass, first, last, input, output); break;
+        case 3: avx2_fft_radix<3>(pass, first, last, input, output); break;
+        case 4: avx2_fft_radix<4>(pass, first, last, input, output); break;
+        default: avx2_fft_radix<5>(pass, first, last, input, output); break;
+    }
+}
+
+void avx2_fft_split(float* spectrum, const float* z, const float* twiddles, size_t n, size_t first, size_t last) {
+    const __m256 half = _mm256_set1_ps(0.5f);
+    size_t k = first;
+    for (; k + COMPLEX_LANES <= last; k += COMPLEX_LANES) {
+        const __m256 values = _mm256_loadu_ps(z + 2 * k);
+        // Z[n - k] for the same k, conjugated
+        const __m256 mirror = conjugate(reverse_complex(_mm256_loadu_ps(z + 2 * (n - k - COMPLEX_LANES + 1))));
+        const __m256 even = _mm256_mul_ps(half, _mm256_add_ps(values, mirror));
+        const __m256 odd = _mm256_mul_ps(half, times_minus_i(_mm256_sub_ps(values, mirror)));
+        const __m256 w = _mm256_loadu_ps(twiddles + 2 * k);
+        _mm256_storeu_ps(spectrum + 2 * k, _mm256_add_ps(even, complex_multiply(odd, _mm256_moveldup_ps(w), _mm256_movehdup_ps(w))));
+    }
+    scalar_dsp_kernels()->fft_split(spectrum, z, twiddles, n, k, last);
+}
+
+void avx2_fft_merge(float* z, const float* spectrum, const float* twiddles, size_t n, size_t first, size_t last) {
+    size_t k = first;
+    for (; k + COMPLEX_LANES <= last; k += COMPLEX_LANES) {
+        const __m256 values = _mm256_loadu_ps(spectrum + 2 * k);
+        const __m256 mirror = conjugate(reverse_complex(_mm256_loadu_ps(spectrum + 2 * (n - k - COMPLEX_LANES + 1))));
+        const __m256 even = _mm256_add_ps(values, mirror);
+        // times conj(w^k), its imaginary part negated
+        const __m256 w = conjugate(_mm256_loadu_ps(twiddles + 2 * k));
+        const __m256 odd = complex_multiply(_mm256_sub_ps(values, mirror), _mm256_moveldup_ps(w), _mm256_movehdup_ps(w));
+        // even + i odd, i odd being -(-i odd)
+        _mm256_storeu_ps(z + 2 * k, conjugate(_mm256_sub_ps(even, times_minus_i(odd))));
+    }
+    scalar_dsp_kernels()->fft_merge(z, spectrum, twiddles, n, k, last);
+}
+
+const Dsp_Kernels kernels{"avx2", avx2_biquad, avx2_multiply, avx2_multiply_add, avx2_spectral_subtract,
+                          avx2_energy_crossings, avx2_log_power_sum, avx2_power_spectrum, avx2_dot, avx2_log_floor,
+                          avx2_fft_pass, avx2_fft_split, avx2_fft_merge};
+
+} // namespace
+
+const Dsp_Kernels* avx2_dsp_kernels() noexcept {
+    return &kernels;
+}
+
+#else
+
+const Dsp_Kernels* avx2_dsp_kernels() noexcept {
+    return nullptr;
+}
+
+#endif
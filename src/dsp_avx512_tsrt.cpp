@@ -0,0 +1,395 @@
+#include "dsp_kernels_tsrt.h"
+
+#include <cstddef>
+
+// Built with AVX-512F enabled, see CMakeLists.txt, only ever called once best_dsp_isa() found it on the CPU.
+// Nothing but the kernels lives here, so no inline function from a shared header is compiled for AVX-512 and then
+// picked by the linker for a caller on a CPU without it.
+#if defined(__AVX512F__)
+
+#include <immintrin.h>
+
+namespace {
+
+constexpr size_t LANES = 16;
+static_assert(LANES == BIQUAD_BLOCK_SAMPLES, "AVX-512 computes a whole biquad block per vector");
+constexpr size_t COMPLEX_LANES = LANES / 2; // interleaved complex values per vector
+
+void avx512_biquad(Biquad_Section& section, float* samples, size_t count) {
+    const float b1 = section.b1, b2 = section.b2, a1 = section.a1, a2 = section.a2;
+    float s1 = section.s1, s2 = section.s2;
+    size_t i = 0;
+    for (; i + LANES <= count; i += LANES) {
+        float* block = samples + i;
+        // the inputs' part does not wait for the state, only the last two multiply adds do
+        __m512 inputs = _mm512_mul_ps(_mm512_set1_ps(block[0]), _mm512_load_ps(section.response[0]));
+        for (size_t k = 1; k < LANES; ++k)
+            inputs = _mm512_fmadd_ps(_mm512_set1_ps(block[k]), _mm512_load_ps(section.response[k]), inputs);
+        __m512 outputs = _mm512_fmadd_ps(_mm512_set1_ps(s1), _mm512_load_ps(section.response[BIQUAD_BLOCK_SAMPLES]), inputs);
+        outputs = _mm512_fmadd_ps(_mm512_set1_ps(s2), _mm512_load_ps(section.response[BIQUAD_BLOCK_SAMPLES + 1]), outputs);
+
+        const float x14 = block[LANES - 2], x15 = block[LANES - 1];
+        _mm512_storeu_ps(block, outputs);
+        const float y14 = block[LANES - 2], y15 = block[LANES - 1];
+        s1 = b1 * x15 - a1 * y15 + b2 * x14 - a2 * y14;
+        s2 = b2 * x15 - a2 * y15;
+    }
+
+    const float b0 = section.b0;
+    for (; i < count; ++i) {
+        const float x = samples[i];
+        const float y = b0 * x + s1;
+        s1 = b1 * x - a1 * y + s2;
+        s2 = b2 * x - a2 * y;
+        samples[i] = y;
+    }
+    section.s1 = s1;
+    section.s2 = s2;
+}
+
+void avx512_multiply(float* destination, const float* a, const float* b, size_t count) {
+    for (size_t i = 0; i < count; i += LANES)
+        _mm512_store_ps(destination + i, _mm512_mul_ps(_mm512_load_ps(a + i), _mm512_load_ps(b + i)));
+}
+
+void avx512_multiply_add(float* accumulator, const float* a, const float* b, size_t count) {
+    for (size_t i = 0; i < count; i += LANES)
+        _mm512_store_ps(accumulator + i, _mm512_fmadd_ps(_mm512_load_ps(a + i), _mm512_load_ps(b + i), _mm512_load_ps(accumulator + i)));
+}
+
+void avx512_spectral_subtract(float* spectrum, float* noise, size_t bins, const Spectral_Subtraction& params) {
+    // gather the real and imaginary parts of 16 interleaved bins from two vectors, and interleave them back
+    const __m512i real_index = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+    const __m512i imaginary_index = _mm512_setr_epi32(1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31);
+    const __m512i low_index = _mm512_setr_epi32(0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23);
+    const __m512i high_index = _mm512_setr_epi32(8, 24, 9, 25, 10, 26, 11, 27, 12, 28, 13, 29, 14, 30, 15, 31);
+    const __m512 one = _mm512_set1_ps(1.0f);
+    const __m512 floor = _mm512_set1_ps(params.noise_floor);
+    const __m512 min_gain_squared = _mm512_set1_ps(params.min_gain_squared);
+    const __m512 rise = _mm512_set1_ps(params.noise_rise);
+    const __m512 fall = _mm512_set1_ps(params.noise_fall);
+    const __m512 oversubtraction = _mm512_set1_ps(params.oversubtraction);
+    for (size_t i = 0; i < bins; i += LANES) {
+        const __m512 low = _mm512_load_ps(spectrum + 2 * i);
+        const __m512 high = _mm512_load_ps(spectrum + 2 * i + LANES);
+        __m512 real = _mm512_permutex2var_ps(low, real_index, high);
+        __m512 imaginary = _mm512_permutex2var_ps(low, imaginary_index, high);
+        const __m512 power = _mm512_fmadd_ps(real, real, _mm512_mul_ps(imaginary, imaginary));
+
+        const __m512 previous = _mm512_load_ps(noise + i);
+        const __m512 smoothing = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(power, previous, _CMP_GT_OQ), fall, rise);
+        const __m512 estimate = _mm512_max_ps(_mm512_fmadd_ps(smoothing, _mm512_sub_ps(previous, power), power), floor);
+        _mm512_store_ps(noise + i, estimate);
+
+        const __m512 gain_squared = _mm512_max_ps(_mm512_fnmadd_ps(oversubtraction, _mm512_div_ps(estimate, power), one), min_gain_squared);
+        const __m512 gain = _mm512_sqrt_ps(gain_squared);
+        real = _mm512_mul_ps(real, gain);
+        imaginary = _mm512_mul_ps(imaginary, gain);
+        _mm512_store_ps(spectrum + 2 * i, _mm512_permutex2var_ps(real, low_index, imaginary));
+        _mm512_store_ps(spectrum + 2 * i + LANES, _mm512_permutex2var_ps(real, high_index, imaginary));
+    }
+}
+
+// for positive normal x, the exponent plus the polynomial of the mantissa, see LOG2_POLYNOMIAL
+__m512 log2_ps(__m512 x) {
+    const __m512i bits = _mm512_castps_si512(x);
+    const __m512 exponent = _mm512_cvtepi32_ps(_mm512_sub_epi32(_mm512_srli_epi32(bits, 23), _mm512_set1_epi32(127)));
+    const __m512 mantissa = _mm512_castsi512_ps(_mm512_or_si512(_mm512_and_si512(bits, _mm512_set1_epi32(0x007fffff)), _mm512_set1_epi32(0x3f800000)));
+    const __m512 t = _mm512_sub_ps(mantissa, _mm512_set1_ps(1.0f));
+    __m512 polynomial = _mm512_set1_ps(LOG2_POLYNOMIAL[5]);
+    for (int k = 4; k >= 0; --k)
+        polynomial = _mm512_fmadd_ps(polynomial, t, _mm512_set1_ps(LOG2_POLYNOMIAL[k]));
+    return _mm512_fmadd_ps(polynomial, t, exponent);
+}
+
+void avx512_energy_crossings(const float* samples, size_t count, float& energy, size_t& crossings) {
+    __m512 sum = _mm512_setzero_ps();
+    __m512i changes = _mm512_setzero_si512();
+    size_t i = 0;
+    // each sample is compared with the next, so the last vector needs one sample past it
+    for (; i + LANES < count; i += LANES) {
+        const __m512 x = _mm512_loadu_ps(samples + i);
+        const __m512 next = _mm512_loadu_ps(samples + i + 1);
+        sum = _mm512_fmadd_ps(x, x, sum);
+        // the sign bit of the xor is set where the signs differ, shifted down it counts one, AVX-512F has no float xor
+        changes = _mm512_add_epi32(changes, _mm512_srli_epi32(_mm512_xor_si512(_mm512_castps_si512(x), _mm512_castps_si512(next)), 31));
+    }
+
+    float total = _mm512_reduce_add_ps(sum);
+    size_t total_changes = static_cast<size_t>(_mm512_reduce_add_epi32(changes));
+    // the rest by the scalar kernel, from the first sample not compared with the next
+    float tail_energy = 0.0f;
+    size_t tail_changes = 0;
+    scalar_dsp_kernels()->energy_crossings(samples + i, count - i, tail_energy, tail_changes);
+    energy = total + tail_energy;
+    crossings = total_changes + tail_changes;
+}
+
+void avx512_log_power_sum(const float* spectrum, size_t bins, float floor, float& power, float& log_power) {
+    const __m512i real_index = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+    const __m512i imaginary_index = _mm512_setr_epi32(1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31);
+    const __m512 minimum = _mm512_set1_ps(floor);
+    __m512 power_sum = _mm512_setzero_ps();
+    __m512 log_sum = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + LANES <= bins; i += LANES) {
+        const __m512 low = _mm512_loadu_ps(spectrum + 2 * i);
+        const __m512 high = _mm512_loadu_ps(spectrum + 2 * i + LANES);
+        const __m512 real = _mm512_permutex2var_ps(low, real_index, high);
+        const __m512 imaginary = _mm512_permutex2var_ps(low, imaginary_index, high);
+        const __m512 bin = _mm512_max_ps(_mm512_fmadd_ps(real, real, _mm512_mul_ps(imaginary, imaginary)), minimum);
+        power_sum = _mm512_add_ps(power_sum, bin);
+        log_sum = _mm512_add_ps(log_sum, log2_ps(bin));
+    }
+
+    float power_total = _mm512_reduce_add_ps(power_sum);
+    float log_total = _mm512_reduce_add_ps(log_sum);
+    float tail_power = 0.0f;
+    float tail_log = 0.0f;
+    scalar_dsp_kernels()->log_power_sum(spectrum + 2 * i, bins - i, floor, tail_power, tail_log);
+    power = power_total + tail_power;
+    log_power = log_total + tail_log;
+}
+
+void avx512_power_spectrum(float* power, const float* spectrum, size_t bins) {
+    const __m512i real_index = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+    const __m512i imaginary_index = _mm512_setr_epi32(1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31);
+    for (size_t i = 0; i < bins; i += LANES) {
+        const __m512 low = _mm512_load_ps(spectrum + 2 * i);
+        const __m512 high = _mm512_load_ps(spectrum + 2 * i + LANES);
+        const __m512 real = _mm512_permutex2var_ps(low, real_index, high);
+        const __m512 imaginary = _mm512_permutex2var_ps(low, imaginary_index, high);
+        _mm512_store_ps(power + i, _mm512_fmadd_ps(real, real, _mm512_mul_ps(imaginary, imaginary)));
+    }
+}
+
+float avx512_dot(const float* a, const float* b, size_t count) {
+    __m512 sum = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + LANES <= count; i += LANES)
+        sum = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), sum);
+    return _mm512_reduce_add_ps(sum) + scalar_dsp_kernels()->dot(a + i, b + i, count - i);
+}
+
+void avx512_log_floor(float* values, size_t count, float floor) {
+    const __m512 minimum = _mm512_set1_ps(floor);
+    const __m512 ln_2 = _mm512_set1_ps(LN_2);
+    for (size_t i = 0; i < count; i += LANES)
+        _mm512_store_ps(values + i, _mm512_mul_ps(log2_ps(_mm512_max_ps(_mm512_load_ps(values + i), minimum)), ln_2));
+}
+
+// interleaved complex values times one complex value, broadcast as its real and imaginary parts, or times interleaved
+// complex values whose real and imaginary parts are duplicated into pairs
+__m512 complex_multiply(__m512 v, __m512 wr, __m512 wi) {
+    return _mm512_fmaddsub_ps(v, wr, _mm512_mul_ps(_mm512_shuffle_ps(v, v, 0xB1), wi));
+}
+
+// interleaved complex values conjugated, the sign of their imaginary parts flipped, AVX-512F has no float xor
+__m512 conjugate(__m512 v) {
+    return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(v), _mm512_set1_epi64(static_cast<long long>(1ull << 63))));
+}
+
+// interleaved complex values times -i, (re, im) to (im, -re)
+__m512 times_minus_i(__m512 v) {
+    return conjugate(_mm512_shuffle_ps(v, v, 0xB1));
+}
+
+// interleaved complex values in reverse order
+__m512 reverse_complex(__m512 v) {
+    return _mm512_castpd_ps(_mm512_permutexvar_pd(_mm512_setr_epi64(7, 6, 5, 4, 3, 2, 1, 0), _mm512_castps_pd(v)));
+}
+
+template <size_t Radix>
+void fft_butterfly(__m512 (&a)[Radix]) {
+    if constexpr (Radix == 2) {
+        const __m512 a0 = a[0];
+        a[0] = _mm512_add_ps(a0, a[1]);
+        a[1] = _mm512_sub_ps(a0, a[1]);
+    } else if constexpr (Radix == 3) {
+        const __m512 t1 = _mm512_add_ps(a[1], a[2]);
+        const __m512 t2 = _mm512_mul_ps(times_minus_i(_mm512_sub_ps(a[1], a[2])), _mm512_set1_ps(FFT_SIN_2PI_3));
+        const __m512 middle = _mm512_fnmadd_ps(_mm512_set1_ps(0.5f), t1, a[0]);
+        a[0] = _mm512_add_ps(a[0], t1);
+        a[1] = _mm512_add_ps(middle, t2);
+        a[2] = _mm512_sub_ps(middle, t2);
+    } else if constexpr (Radix == 4) {
+        const __m512 t0 = _mm512_add_ps(a[0], a[2]);
+        const __m512 t1 = _mm512_sub_ps(a[0], a[2]);
+        const __m512 t2 = _mm512_add_ps(a[1], a[3]);
+        const __m512 t3 = times_minus_i(_mm512_sub_ps(a[1], a[3]));
+        a[0] = _mm512_add_ps(t0, t2);
+        a[1] = _mm512_add_ps(t1, t3);
+        a[2] = _mm512_sub_ps(t0, t2);
+        a[3] = _mm512_sub_ps(t1, t3);
+    } else {
+        static_assert(Radix == 5, "The FFT passes are radix 2, 3, 4 or 5");
+        const __m512 cos_1 = _mm512_set1_ps(FFT_COS_2PI_5), cos_2 = _mm512_set1_ps(FFT_COS_4PI_5);
+        const __m512 sin_1 = _mm512_set1_ps(FFT_SIN_2PI_5), sin_2 = _mm512_set1_ps(FFT_SIN_4PI_5);
+        const __m512 t1 = _mm512_add_ps(a[1], a[4]);
+        const __m512 t2 = _mm512_add_ps(a[2], a[3]);
+        const __m512 t3 = _mm512_sub_ps(a[1], a[4]);
+        const __m512 t4 = _mm512_sub_ps(a[2], a[3]);
+        const __m512 b1 = _mm512_fmadd_ps(cos_2, t2, _mm512_fmadd_ps(cos_1, t1, a[0]));
+        const __m512 b2 = _mm512_fmadd_ps(cos_1, t2, _mm512_fmadd_ps(cos_2, t1, a[0]));
+        const __m512 d1 = times_minus_i(_mm512_fmadd_ps(sin_1, t3, _mm512_mul_ps(sin_2, t4)));
+        const __m512 d2 = times_minus_i(_mm512_fmsub_ps(sin_2, t3, _mm512_mul_ps(sin_1, t4)));
+        a[0] = _mm512_add_ps(a[0], _mm512_add_ps(t1, t2));
+        a[1] = _mm512_add_ps(b1, d1);
+        a[4] = _mm512_sub_ps(b1, d1);
+        a[2] = _mm512_add_ps(b2, d2);
+        a[3] = _mm512_sub_ps(b2, d2);
+    }
+}
+
+// the twiddles of the butterflies a vector holds the runs of, each repeated for its Run values
+template <size_t Run>
+__m512 run_twiddles(const float* twiddles) {
+    if constexpr (Run == 1)
+        return _mm512_loadu_ps(twiddles);
+    else if constexpr (Run == 2)
+        return _mm512_permutexvar_ps(_mm512_setr_epi32(0, 1, 0, 1, 2, 3, 2, 3, 4, 5, 4, 5, 6, 7, 6, 7), _mm512_castps256_ps512(_mm256_loadu_ps(twiddles)));
+    else
+        return _mm512_permutexvar_ps(_mm512_setr_epi32(0, 1, 0, 1, 0, 1, 0, 1, 2, 3, 2, 3, 2, 3, 2, 3), _mm512_castps128_ps512(_mm_loadu_ps(twiddles)));
+}
+
+// stores the runs of Run values a vector holds, the next run spacing complex values after the last
+template <size_t Run>
+void store_runs(float* output, size_t spacing, __m512 v) {
+    if constexpr (Run == 4) {
+        // AVX-512F extracts halves as doubles
+        _mm256_storeu_ps(output, _mm512_castps512_ps256(v));
+        _mm256_storeu_ps(output + 2 * spacing, _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(v), 1)));
+    } else {
+        const __m128 q0 = _mm512_castps512_ps128(v);
+        const __m128 q1 = _mm512_extractf32x4_ps(v, 1);
+        const __m128 q2 = _mm512_extractf32x4_ps(v, 2);
+        const __m128 q3 = _mm512_extractf32x4_ps(v, 3);
+        if constexpr (Run == 2) {
+            _mm_storeu_ps(output, q0);
+            _mm_storeu_ps(output + 2 * spacing, q1);
+            _mm_storeu_ps(output + 4 * spacing, q2);
+            _mm_storeu_ps(output + 6 * spacing, q3);
+        } else {
+            _mm_storel_pi(reinterpret_cast<__m64*>(output), q0);
+            _mm_storeh_pi(reinterpret_cast<__m64*>(output + 2 * spacing), q0);
+            _mm_storel_pi(reinterpret_cast<__m64*>(output + 4 * spacing), q1);
+            _mm_storeh_pi(reinterpret_cast<__m64*>(output + 6 * spacing), q1);
+            _mm_storel_pi(reinterpret_cast<__m64*>(output + 8 * spacing), q2);
+            _mm_storeh_pi(reinterpret_cast<__m64*>(output + 10 * spacing), q2);
+            _mm_storel_pi(reinterpret_cast<__m64*>(output + 12 * spacing), q3);
+            _mm_storeh_pi(reinterpret_cast<__m64*>(output + 14 * spacing), q3);
+        }
+    }
+}
+
+// the butterflies from p on whose runs of Run values a vector holds, neighbours in the input but Radix runs apart in
+// the output, returns the first one left over
+template <size_t Radix, size_t Run>
+size_t avx512_fft_runs(const Fft_Pass& pass, size_t p, size_t last, const float* input, float* output) {
+    constexpr size_t group = COMPLEX_LANES / Run;
+    const size_t m = pass.m;
+    for (; p + group <= last; p += group) {
+        __m512 a[Radix];
+        for (size_t j = 0; j < Radix; ++j)
+            a[j] = _mm512_loadu_ps(input + 2 * Run * (p + j * m));
+        fft_butterfly<Radix>(a);
+        store_runs<Run>(output + 2 * Run * Radix * p, Run * Radix, a[0]);
+        for (size_t k = 1; k < Radix; ++k) {
+            const __m512 w = run_twiddles<Run>(pass.twiddles + 2 * ((k - 1) * m + p));
+            store_runs<Run>(output + 2 * Run * (Radix * p + k), Run * Radix, complex_multiply(a[k], _mm512_moveldup_ps(w), _mm512_movehdup_ps(w)));
+        }
+    }
+    return p;
+}
+
+template <size_t Radix>
+void avx512_fft_radix(const Fft_Pass& pass, size_t first, size_t last, const float* input, float* output) {
+    const size_t m = pass.m, s = pass.stride;
+    size_t p = first;
+    if (s % COMPLEX_LANES == 0) {
+        // a butterfly's runs are whole vectors with one twiddle each
+        for (; p < last; ++p) {
+            __m512 wr[Radix - 1], wi[Radix - 1];
+            for (size_t k = 0; k + 1 < Radix; ++k) {
+                wr[k] = _mm512_set1_ps(pass.twiddles[2 * (k * m + p)]);
+                wi[k] = _mm512_set1_ps(pass.twiddles[2 * (k * m + p) + 1]);
+            }
+            for (size_t q = 0; q < s; q += COMPLEX_LANES) {
+                __m512 a[Radix];
+                for (size_t j = 0; j < Radix; ++j)
+                    a[j] = _mm512_loadu_ps(input + 2 * (q + s * (p + j * m)));
+                fft_butterfly<Radix>(a);
+                float* y = output + 2 * (q + s * Radix * p);
+                _mm512_storeu_ps(y, a[0]);
+                for (size_t k = 1; k < Radix; ++k)
+                    _mm512_storeu_ps(y + 2 * s * k, complex_multiply(a[k], wr[k - 1], wi[k - 1]));
+            }
+        }
+    } else if (s == 1) {
+        p = avx512_fft_runs<Radix, 1>(pass, p, last, input, output);
+    } else if (s == 2) {
+        p = avx512_fft_runs<Radix, 2>(pass, p, last, input, output);
+    } else if (s == 4) {
+        p = avx512_fft_runs<Radix, 4>(pass, p, last, input, output);
+    }
+    // the butterflies left over, or runs no vector kernel handles, by the scalar kernel
+    if (p < last)
+        scalar_dsp_kernels()->fft_pass(pass, p, last, input, output);
+}
+
+void avx512_fft_pass(const Fft_Pass& pass, size_t first, size_t last, const float* input, float* output) {
+    switch (pass.radix) {
+        case 2: avx512_fft_radix<2>(pass, first, last, input, output); break;
+        case 3: avx512_fft_radix<3>(pass, first, last, input, output); break;
+        case 4: avx512_fft_radix<4>(pass, first, last, input, output); break;
+        default: avx512_fft_radix<5>(pass, first, last, input, output); break;
+    }
+}
+
+void avx512_fft_split(float* spectrum, const float* z, const float* twiddles, size_t n, size_t first, size_t last) {
+    const __m512 half = _mm512_set1_ps(0.5f);
+    size_t k = first;
+    for (; k + COMPLEX_LANES <= last; k += COMPLEX_LANES) {
+        const __m512 values = _mm512_loadu_ps(z + 2 * k);
+        // Z[n - k] for the same k, conjugated
+        const __m512 mirror = conjugate(reverse_complex(_mm512_loadu_ps(z + 2 * (n - k - COMPLEX_LANES + 1))));
+        const __m512 even = _mm512_mul_ps(half, _mm512_add_ps(values, mirror));
+        const __m512 odd = _mm512_mul_ps(half, times_minus_i(_mm512_sub_ps(values, mirror)));
+        const __m512 w = _mm512_loadu_ps(twiddles + 2 * k);
+        _mm512_storeu_ps(spectrum + 2 * k, _mm512_add_ps(even, complex_multiply(odd, _mm512_moveldup_ps(w), _mm512_movehdup_ps(w))));
+    }
+    scalar_dsp_kernels()->fft_split(spectrum, z, twiddles, n, k, last);
+}
+
+void avx512_fft_merge(float* z, const float* spectrum, const float* twiddles, size_t n, size_t first, size_t last) {
+    size_t k = first;
+    for (; k + COMPLEX_LANES <= last; k += COMPLEX_LANES) {
+        const __m512 values = _mm512_loadu_ps(spectrum + 2 * k);
+        const __m512 mirror = conjugate(reverse_complex(_mm512_loadu_ps(spectrum + 2 * (n - k - COMPLEX_LANES + 1))));
+        const __m512 even = _mm512_add_ps(values, mirror);
+        // times conj(w^k), its imaginary part negated
+        const __m512 w = conjugate(_mm512_loadu_ps(twiddles + 2 * k));
+        const __m512 odd = complex_multiply(_mm512_sub_ps(values, mirror), _mm512_moveldup_ps(w), _mm512_movehdup_ps(w));
+        // even + i odd, i odd being -(-i odd)
+        _mm512_storeu_ps(z + 2 * k, conjugate(_mm512_sub_ps(even, times_minus_i(odd))));
+    }
+    scalar_dsp_kernels()->fft_merge(z, spectrum, twiddles, n, k, last);
+}
+
+const Dsp_Kernels kernels{"avx512", avx512_biquad, avx512_multiply, avx512_multiply_add, avx512_spectral_subtract,
+                          avx512_energy_crossings, avx512_log_power_sum, avx512_power_spectrum, avx512_dot, avx512_log_floor,
+                          avx512_fft_pass, avx512_fft_split, avx512_fft_merge};
+
+} // namespace
+
+const Dsp_Kernels* avx512_dsp_kernels() noexcept {
+    return &kernels;
+}
+
+#else
+
+const Dsp_Kernels* avx512_dsp_kernels() noexcept {
+    return nullptr;
+}
+
+#endif
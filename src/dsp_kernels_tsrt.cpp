@@ -0,0 +1,85 @@
+#include "dsp_kernels_tsrt.h"
+#include "constants_config_tsrt.h"
+
+#include <cstddef>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+namespace {
+
+/**
+ * @brief Checks if the CPU and the operating system support an instruction set.
+*/
+bool cpu_supports(dsp_isa isa) noexcept {
+    if (isa == DSP_SCALAR)
+        return true;
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    if (isa == DSP_AVX2)
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    return __builtin_cpu_supports("avx512f");
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int registers[4];
+    __cpuid(registers, 1);
+    const bool os_saves_ymm = (registers[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+    const bool fma = (registers[2] & (1 << 12)) != 0;
+    __cpuidex(registers, 7, 0);
+    if (isa == DSP_AVX2)
+        return os_saves_ymm && fma && (registers[1] & (1 << 5)) != 0;
+    return os_saves_ymm && (_xgetbv(0) & 0xe6) == 0xe6 && (registers[1] & (1 << 16)) != 0;
+#else
+    return false;
+#endif
+}
+
+dsp_isa detect_dsp_isa() noexcept {
+    if (avx512_dsp_kernels() != nullptr && cpu_supports(DSP_AVX512))
+        return DSP_AVX512;
+    if (avx2_dsp_kernels() != nullptr && cpu_supports(DSP_AVX2))
+        return DSP_AVX2;
+    return DSP_SCALAR;
+}
+
+} // namespace
+
+void init_biquad_section(Biquad_Section& section, double b0, double b1, double b2, double a0, double a1, double a2) noexcept {
+    section.b0 = static_cast<float>(b0 / a0);
+    section.b1 = static_cast<float>(b1 / a0);
+    section.b2 = static_cast<float>(b2 / a0);
+    section.a1 = static_cast<float>(a1 / a0);
+    section.a2 = static_cast<float>(a2 / a0);
+    section.s1 = 0.0f;
+    section.s2 = 0.0f;
+
+    // run the recursion in double from a unit input at each sample of a block, then from each unit state
+    for (size_t column = 0; column < BIQUAD_BLOCK_SAMPLES + 2; ++column) {
+        double s1 = column == BIQUAD_BLOCK_SAMPLES ? 1.0 : 0.0;
+        double s2 = column == BIQUAD_BLOCK_SAMPLES + 1 ? 1.0 : 0.0;
+        for (size_t n = 0; n < BIQUAD_BLOCK_SAMPLES; ++n) {
+            const double x = n == column ? 1.0 : 0.0;
+            const double y = b0 / a0 * x + s1;
+            s1 = b1 / a0 * x - a1 / a0 * y + s2;
+            s2 = b2 / a0 * x - a2 / a0 * y;
+            section.response[column][n] = static_cast<float>(y);
+        }
+    }
+}
+
+const Dsp_Kernels* get_dsp_kernels(dsp_isa isa) noexcept {
+    switch (isa) {
+    case DSP_SCALAR:
+        return scalar_dsp_kernels();
+    case DSP_AVX2:
+        return cpu_supports(DSP_AVX2) ? avx2_dsp_kernels() : nullptr;
+    case DSP_AVX512:
+        return cpu_supports(DSP_AVX512) ? avx512_dsp_kernels() : nullptr;
+    }
+    return nullptr;
+}
+
+dsp_isa best_dsp_isa() noexcept {
+    static const dsp_isa best = detect_dsp_isa();
+    return best;
+}
@@ -0,0 +1,212 @@
+#include "dsp_kernels_tsrt.h"
+#include "constants_config_tsrt.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace {
+
+void scalar_biquad(Biquad_Section& section, float* samples, size_t count) {
+    const float b0 = section.b0, b1 = section.b1, b2 = section.b2, a1 = section.a1, a2 = section.a2;
+    float s1 = section.s1, s2 = section.s2;
+    for (size_t i = 0; i < count; ++i) {
+        const float x = samples[i];
+        const float y = b0 * x + s1;
+        s1 = b1 * x - a1 * y + s2;
+        s2 = b2 * x - a2 * y;
+        samples[i] = y;
+    }
+    section.s1 = s1;
+    section.s2 = s2;
+}
+
+void scalar_multiply(float* destination, const float* a, const float* b, size_t count) {
+    for (size_t i = 0; i < count; ++i)
+        destination[i] = a[i] * b[i];
+}
+
+void scalar_multiply_add(float* accumulator, const float* a, const float* b, size_t count) {
+    for (size_t i = 0; i < count; ++i)
+        accumulator[i] += a[i] * b[i];
+}
+
+void scalar_spectral_subtract(float* spectrum, float* noise, size_t bins, const Spectral_Subtraction& params) {
+    for (size_t i = 0; i < bins; ++i) {
+        const float re = spectrum[2 * i];
+        const float im = spectrum[2 * i + 1];
+        const float power = re * re + im * im;
+        const float smoothing = power > noise[i] ? params.noise_rise : params.noise_fall;
+        const float estimate = power + smoothing * (noise[i] - power);
+        noise[i] = estimate > params.noise_floor ? estimate : params.noise_floor;
+        // power subtraction, a silent bin divides to -inf and is clamped like any other
+        const float gain_squared = 1.0f - params.oversubtraction * noise[i] / power;
+        const float gain = std::sqrt(gain_squared > params.min_gain_squared ? gain_squared : params.min_gain_squared);
+        spectrum[2 * i] = re * gain;
+        spectrum[2 * i + 1] = im * gain;
+    }
+}
+
+void scalar_energy_crossings(const float* samples, size_t count, float& energy, size_t& crossings) {
+    float sum = 0.0f;
+    size_t changes = 0;
+    for (size_t i = 0; i < count; ++i) {
+        sum += samples[i] * samples[i];
+        // by the sign bit, as the vector kernels compare it
+        if (i + 1 < count && std::signbit(samples[i]) != std::signbit(samples[i + 1]))
+            ++changes;
+    }
+    energy = sum;
+    crossings = changes;
+}
+
+void scalar_log_power_sum(const float* spectrum, size_t bins, float floor, float& power, float& log_power) {
+    float power_sum = 0.0f;
+    float log_sum = 0.0f;
+    for (size_t i = 0; i < bins; ++i) {
+        const float re = spectrum[2 * i];
+        const float im = spectrum[2 * i + 1];
+        const float bin = std::max(re * re + im * im, floor);
+        power_sum += bin;
+        log_sum += std::log2(bin);
+    }
+    power = power_sum;
+    log_power = log_sum;
+}
+
+void scalar_power_spectrum(float* power, const float* spectrum, size_t bins) {
+    for (size_t i = 0; i < bins; ++i)
+        power[i] = spectrum[2 * i] * spectrum[2 * i] + spectrum[2 * i + 1] * spectrum[2 * i + 1];
+}
+
+float scalar_dot(const float* a, const float* b, size_t count) {
+    float sum = 0.0f;
+    for (size_t i = 0; i < count; ++i)
+        sum += a[i] * b[i];
+    return sum;
+}
+
+void scalar_log_floor(float* values, size_t count, float floor) {
+    for (size_t i = 0; i < count; ++i)
+        values[i] = std::log(std::max(values[i], floor));
+}
+
+// A complex value, the DFT of Radix of them in place
+struct Complex {
+    float re;
+    float im;
+};
+
+template <size_t Radix>
+void fft_butterfly(Complex (&a)[Radix]) {
+    if constexpr (Radix == 2) {
+        const Complex a0 = a[0];
+        a[0] = {a0.re + a[1].re, a0.im + a[1].im};
+        a[1] = {a0.re - a[1].re, a0.im - a[1].im};
+    } else if constexpr (Radix == 3) {
+        const Complex t1{a[1].re + a[2].re, a[1].im + a[2].im};
+        // -i sin(2 pi / 3) (a1 - a2)
+        const Complex t2{FFT_SIN_2PI_3 * (a[1].im - a[2].im), -FFT_SIN_2PI_3 * (a[1].re - a[2].re)};
+        const Complex middle{a[0].re - 0.5f * t1.re, a[0].im - 0.5f * t1.im};
+        a[0] = {a[0].re + t1.re, a[0].im + t1.im};
+        a[1] = {middle.re + t2.re, middle.im + t2.im};
+        a[2] = {middle.re - t2.re, middle.im - t2.im};
+    } else if constexpr (Radix == 4) {
+        const Complex t0{a[0].re + a[2].re, a[0].im + a[2].im};
+        const Complex t1{a[0].re - a[2].re, a[0].im - a[2].im};
+        const Complex t2{a[1].re + a[3].re, a[1].im + a[3].im};
+        // -i (a1 - a3)
+        const Complex t3{a[1].im - a[3].im, a[3].re - a[1].re};
+        a[0] = {t0.re + t2.re, t0.im + t2.im};
+        a[1] = {t1.re + t3.re, t1.im + t3.im};
+        a[2] = {t0.re - t2.re, t0.im - t2.im};
+        a[3] = {t1.re - t3.re, t1.im - t3.im};
+    } else {
+        static_assert(Radix == 5, "The FFT passes are radix 2, 3, 4 or 5");
+        const Complex t1{a[1].re + a[4].re, a[1].im + a[4].im};
+        const Complex t2{a[2].re + a[3].re, a[2].im + a[3].im};
+        const Complex t3{a[1].re - a[4].re, a[1].im - a[4].im};
+        const Complex t4{a[2].re - a[3].re, a[2].im - a[3].im};
+        const Complex b1{a[0].re + FFT_COS_2PI_5 * t1.re + FFT_COS_4PI_5 * t2.re, a[0].im + FFT_COS_2PI_5 * t1.im + FFT_COS_4PI_5 * t2.im};
+        const Complex b2{a[0].re + FFT_COS_4PI_5 * t1.re + FFT_COS_2PI_5 * t2.re, a[0].im + FFT_COS_4PI_5 * t1.im + FFT_COS_2PI_5 * t2.im};
+        // -i (sin(2 pi / 5) t3 + sin(4 pi / 5) t4) and -i (sin(4 pi / 5) t3 - sin(2 pi / 5) t4)
+        const Complex d1{FFT_SIN_2PI_5 * t3.im + FFT_SIN_4PI_5 * t4.im, -(FFT_SIN_2PI_5 * t3.re + FFT_SIN_4PI_5 * t4.re)};
+        const Complex d2{FFT_SIN_4PI_5 * t3.im - FFT_SIN_2PI_5 * t4.im, -(FFT_SIN_4PI_5 * t3.re - FFT_SIN_2PI_5 * t4.re)};
+        a[0] = {a[0].re + t1.re + t2.re, a[0].im + t1.im + t2.im};
+        a[1] = {b1.re + d1.re, b1.im + d1.im};
+        a[4] = {b1.re - d1.re, b1.im - d1.im};
+        a[2] = {b2.re + d2.re, b2.im + d2.im};
+        a[3] = {b2.re - d2.re, b2.im - d2.im};
+    }
+}
+
+template <size_t Radix>
+void scalar_fft_radix(const Fft_Pass& pass, size_t first, size_t last, const float* input, float* output) {
+    const size_t m = pass.m, s = pass.stride;
+    for (size_t p = first; p < last; ++p) {
+        for (size_t q = 0; q < s; ++q) {
+            Complex a[Radix];
+            for (size_t j = 0; j < Radix; ++j) {
+                const float* x = input + 2 * (q + s * (p + j * m));
+                a[j] = {x[0], x[1]};
+            }
+            fft_butterfly<Radix>(a);
+            float* y = output + 2 * (q + s * Radix * p);
+            y[0] = a[0].re;
+            y[1] = a[0].im;
+            for (size_t k = 1; k < Radix; ++k) {
+                const float* twiddle = pass.twiddles + 2 * ((k - 1) * m + p);
+                const float wr = twiddle[0], wi = twiddle[1];
+                y[2 * s * k] = a[k].re * wr - a[k].im * wi;
+                y[2 * s * k + 1] = a[k].re * wi + a[k].im * wr;
+            }
+        }
+    }
+}
+
+void scalar_fft_pass(const Fft_Pass& pass, size_t first, size_t last, const float* input, float* output) {
+    switch (pass.radix) {
+        case 2: scalar_fft_radix<2>(pass, first, last, input, output); break;
+        case 3: scalar_fft_radix<3>(pass, first, last, input, output); break;
+        case 4: scalar_fft_radix<4>(pass, first, last, input, output); break;
+        default: scalar_fft_radix<5>(pass, first, last, input, output); break;
+    }
+}
+
+void scalar_fft_split(float* spectrum, const float* z, const float* twiddles, size_t n, size_t first, size_t last) {
+    for (size_t k = first; k < last; ++k) {
+        const float re = z[2 * k], im = z[2 * k + 1];
+        const float mirror_re = z[2 * (n - k)], mirror_im = z[2 * (n - k) + 1];
+        const float wr = twiddles[2 * k], wi = twiddles[2 * k + 1];
+        // E[k] = (Z[k] + conj(Z[n - k])) / 2, O[k] = (Z[k] - conj(Z[n - k])) / 2i and X[k] = E[k] + w^k O[k]
+        const float even_re = 0.5f * (re + mirror_re), even_im = 0.5f * (im - mirror_im);
+        const float odd_re = 0.5f * (im + mirror_im), odd_im = -0.5f * (re - mirror_re);
+        spectrum[2 * k] = even_re + wr * odd_re - wi * odd_im;
+        spectrum[2 * k + 1] = even_im + wr * odd_im + wi * odd_re;
+    }
+}
+
+void scalar_fft_merge(float* z, const float* spectrum, const float* twiddles, size_t n, size_t first, size_t last) {
+    for (size_t k = first; k < last; ++k) {
+        const float re = spectrum[2 * k], im = spectrum[2 * k + 1];
+        const float mirror_re = spectrum[2 * (n - k)], mirror_im = spectrum[2 * (n - k) + 1];
+        const float wr = twiddles[2 * k], wi = twiddles[2 * k + 1];
+        // 2 E[k] = X[k] + conj(X[n - k]), 2 O[k] = (X[k] - conj(X[n - k])) conj(w^k) and Z[k] = 2 (E[k] + i O[k])
+        const float even_re = re + mirror_re, even_im = im - mirror_im;
+        const float difference_re = re - mirror_re, difference_im = im + mirror_im;
+        const float odd_re = difference_re * wr + difference_im * wi;
+        const float odd_im = difference_im * wr - difference_re * wi;
+        z[2 * k] = even_re - odd_im;
+        z[2 * k + 1] = -(even_im + odd_re);
+    }
+}
+
+const Dsp_Kernels kernels{"scalar", scalar_biquad, scalar_multiply, scalar_multiply_add, scalar_spectral_subtract,
+                          scalar_energy_crossings, scalar_log_power_sum, scalar_power_spectrum, scalar_dot, scalar_log_floor,
+                          scalar_fft_pass, scalar_fft_split, scalar_fft_merge};
+
+} // namespace
+
+const Dsp_Kernels* scalar_dsp_kernels() noexcept {
+    return &kernels;
+}
@@ -0,0 +1,161 @@
+#include "fft_tsrt.h"
+#include "aligned_samples_tsrt.h"
+#include "dsp_kernels_tsrt.h"
+#include "exceptions_tsrt.h"
+#include "status_codes_tsrt.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+constexpr double PI = 3.14159265358979323846;
+constexpr size_t FFT_RADICES[] = {4, 2, 3, 5}; // in the order the passes run
+
+} // namespace
+
+Fft_Plan::Fft_Plan(size_t size) :
+    size(size),
+    passes(),
+    twiddles(),
+    split_twiddles() {
+
+    if (size < 2 || size % 2 != 0)
+        throw Tsrt_Exception(INVALID_ARGUMENT, "FFT size must be even: " + std::to_string(size), std::chrono::system_clock::now(), __FILE__, __LINE__);
+
+    // the radices of the complex transform of size / 2
+    std::vector<size_t> radices;
+    size_t rest = size / 2;
+    for (const size_t radix : FFT_RADICES) {
+        while (rest % radix == 0) {
+            radices.push_back(radix);
+            rest /= radix;
+        }
+    }
+    if (rest != 1)
+        throw Tsrt_Exception(INVALID_ARGUMENT, "FFT size must be twice a product of 2, 3 and 5: " + std::to_string(size), std::chrono::system_clock::now(), __FILE__, __LINE__);
+
+    // each pass takes radix - 1 twiddles per butterfly, n / radix butterflies
+    size_t twiddle_floats = 0;
+    size_t n = size / 2;
+    for (const size_t radix : radices) {
+        twiddle_floats += 2 * (radix - 1) * (n / radix);
+        n /= radix;
+    }
+    twiddles.reset(allocate_aligned_samples(twiddle_floats));
+
+    float* twiddle = twiddles.get();
+    n = size / 2;
+    size_t stride = 1;
+    for (const size_t radix : radices) {
+        const size_t m = n / radix;
+        passes.push_back(Fft_Pass{radix, m, stride, twiddle});
+        for (size_t k = 1; k < radix; ++k) {
+            for (size_t p = 0; p < m; ++p) {
+                const double angle = -2.0 * PI * static_cast<double>(p * k) / n;
+                *twiddle++ = static_cast<float>(std::cos(angle));
+                *twiddle++ = static_cast<float>(std::sin(angle));
+            }
+        }
+        n = m;
+        stride *= radix;
+    }
+
+    split_twiddles.reset(allocate_aligned_samples(2 * (size / 2 + 1)));
+    for (size_t k = 0; k <= size / 2; ++k) {
+        const double angle = -2.0 * PI * static_cast<double>(k) / size;
+        split_twiddles[2 * k] = static_cast<float>(std::cos(angle));
+        split_twiddles[2 * k + 1] = static_cast<float>(std::sin(angle));
+    }
+}
+
+size_t Fft_Plan::get_size() const noexcept {
+    return size;
+}
+
+const std::vector<Fft_Pass>& Fft_Plan::get_passes() const noexcept {
+    return passes;
+}
+
+const float* Fft_Plan::get_split_twiddles() const noexcept {
+    return split_twiddles.get();
+}
+
+std::shared_ptr<const Fft_Plan> get_fft_plan(size_t size) {
+    static std::mutex mutex;
+    static std::unordered_map<size_t, std::shared_ptr<const Fft_Plan>> plans;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<const Fft_Plan>& plan = plans[size];
+    if (plan == nullptr) {
+        try {
+            plan = std::make_shared<const Fft_Plan>(size);
+        } catch (...) {
+            // no empty entry left behind for the next caller to find
+            plans.erase(size);
+            throw;
+        }
+    }
+    return plan;
+}
+
+Real_Fft::Real_Fft(size_t size, const Dsp_Kernels& kernels) :
+    kernels(&kernels),
+    plan(get_fft_plan(size)),
+    first(allocate_aligned_samples(size)),
+    second(allocate_aligned_samples(size)) {}
+
+const float* Real_Fft::transform(const float* input, float* to, float* other) noexcept {
+    const float* source = input;
+    float* target = to;
+    for (const Fft_Pass& pass : plan->get_passes()) {
+        kernels->fft_pass(pass, 0, pass.m, source, target);
+        source = target;
+        target = target == to ? other : to;
+    }
+    return source;
+}
+
+void Real_Fft::forward(float* spectrum, const float* samples) noexcept {
+    const size_t n = plan->get_size() / 2;
+    const float* w = plan->get_split_twiddles();
+    // the samples are already n complex values, even ones real and odd ones imaginary
+    const float* z = transform(samples, first.get(), second.get());
+
+    // Z[k] = E[k] + i O[k], E and O the transforms of the even and odd samples, and X[k] = E[k] + w^k O[k], the first
+    // and last bins are real, E[0] + O[0] and E[0] - O[0]
+    spectrum[0] = z[0] + z[1];
+    spectrum[1] = 0.0f;
+    spectrum[2 * n] = z[0] - z[1];
+    spectrum[2 * n + 1] = 0.0f;
+    kernels->fft_split(spectrum, z, w, n, 1, n);
+}
+
+void Real_Fft::inverse(float* samples, const float* spectrum, float scale) noexcept {
+    const size_t n = plan->get_size() / 2;
+    const float* w = plan->get_split_twiddles();
+
+    // Z[k] = 2 (E[k] + i O[k]) from X[k] and X[n - k], conjugated so the forward passes run the inverse transform, Z[0]
+    // from the real parts of the first and last bins
+    float* conjugate = first.get();
+    conjugate[0] = spectrum[0] + spectrum[2 * n];
+    conjugate[1] = -(spectrum[0] - spectrum[2 * n]);
+    kernels->fft_merge(conjugate, spectrum, w, n, 1, n);
+
+    // the passes write the buffer they read last, the input is only read by the first
+    const float* z = transform(conjugate, second.get(), first.get());
+    for (size_t k = 0; k < n; ++k) {
+        samples[2 * k] = z[2 * k] * scale;
+        samples[2 * k + 1] = -z[2 * k + 1] * scale;
+    }
+}
+
+size_t Real_Fft::get_size() const noexcept {
+    return plan->get_size();
+}
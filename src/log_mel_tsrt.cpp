@@ -0,0 +1,118 @@
+#include "log_mel_tsrt.h"
+#include "aligned_samples_tsrt.h"
+#include "audio_window_tsrt.h"
+#include "constants_config_tsrt.h"
+#include "dsp_kernels_tsrt.h"
+#include "fft_tsrt.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+namespace {
+
+constexpr double PI = 3.14159265358979323846;
+constexpr size_t MEL_BINS = MEL_FFT_SAMPLES / 2 + 1;
+constexpr size_t MEL_PADDED_BINS = padded_samples(MEL_BINS);
+
+double hz_to_mel(double hz) noexcept {
+    return 2595.0 * std::log10(1.0 + hz / 700.0);
+}
+
+double mel_to_hz(double mel) noexcept {
+    return 700.0 * (std::pow(10.0, mel / 2595.0) - 1.0);
+}
+
+} // namespace
+
+Log_Mel_Extractor::Log_Mel_Extractor(size_t samples, const Dsp_Kernels& kernels) :
+    kernels(&kernels),
+    fft(MEL_FFT_SAMPLES, kernels),
+    bands(),
+    band_weights(),
+    window(allocate_aligned_samples(MEL_FRAME_SAMPLES)),
+    input(allocate_aligned_samples(MEL_FRAME_SAMPLES)),
+    frame(allocate_aligned_samples(MEL_FFT_SAMPLES)),
+    spectrum(allocate_aligned_samples(2 * MEL_PADDED_BINS)),
+    power(allocate_aligned_samples(MEL_PADDED_BINS)),
+    rows(),
+    capacity(samples / MEL_HOP_SAMPLES + MEL_FRAMES_PER_WINDOW + 1),
+    fill(0),
+    frames(0),
+    origin(0),
+    origin_frame(0) {
+
+    rows.reset(allocate_aligned_samples(2 * capacity * MEL_ROW_FLOATS));
+    // the bins past N / 2 + 1 are never written
+    std::memset(spectrum.get(), 0, 2 * MEL_PADDED_BINS * sizeof(float));
+    for (size_t n = 0; n < MEL_FRAME_SAMPLES; ++n)
+        window[n] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * PI * n / MEL_FRAME_SAMPLES));
+
+    // triangles evenly spaced on the mel scale, each rising from the last one's centre to its own and falling to the next's
+    const double low = hz_to_mel(MEL_LOW_HZ);
+    const double high = hz_to_mel(MEL_HIGH_HZ);
+    for (size_t band = 0; band < MEL_BANDS; ++band) {
+        const double lower = mel_to_hz(low + (high - low) * band / (MEL_BANDS + 1));
+        const double centre = mel_to_hz(low + (high - low) * (band + 1) / (MEL_BANDS + 1));
+        const double upper = mel_to_hz(low + (high - low) * (band + 2) / (MEL_BANDS + 1));
+        Mel_Band mel_band{0, 0, band_weights.size()};
+        for (size_t bin = 0; bin < MEL_BINS; ++bin) {
+            const double frequency = static_cast<double>(bin) * SAMPLE_RATE / MEL_FFT_SAMPLES;
+            const double weight = frequency <= centre ? (frequency - lower) / (centre - lower) : (upper - frequency) / (upper - centre);
+            if (weight <= 0.0)
+                continue;
+            if (mel_band.bins == 0)
+                mel_band.first_bin = bin;
+            band_weights.push_back(static_cast<float>(weight));
+            ++mel_band.bins;
+        }
+        bands.push_back(mel_band);
+    }
+}
+
+void Log_Mel_Extractor::compute_frame() noexcept {
+    kernels->multiply(frame.get(), input.get(), window.get(), MEL_FRAME_SAMPLES);
+    fft.forward(spectrum.get(), frame.get());
+    kernels->power_spectrum(power.get(), spectrum.get(), MEL_PADDED_BINS);
+
+    float* row = rows.get() + (frames % capacity) * MEL_ROW_FLOATS;
+    for (size_t band = 0; band < MEL_BANDS; ++band)
+        row[band] = kernels->dot(power.get() + bands[band].first_bin, band_weights.data() + bands[band].weights, bands[band].bins);
+    std::fill(row + MEL_BANDS, row + MEL_ROW_FLOATS, 0.0f);
+    kernels->log_floor(row, MEL_ROW_FLOATS, MEL_LOG_FLOOR);
+    // the copy past the end keeps the rows of a window that wraps around contiguous
+    std::memcpy(row + capacity * MEL_ROW_FLOATS, row, MEL_ROW_FLOATS * sizeof(float));
+    ++frames;
+}
+
+void Log_Mel_Extractor::restart(uint64_t sample_index) noexcept {
+    fill = 0;
+    origin = sample_index;
+    origin_frame = frames;
+}
+
+void Log_Mel_Extractor::process(const float* samples, size_t count) noexcept {
+    while (count > 0) {
+        const size_t taken = std::min(MEL_FRAME_SAMPLES - fill, count);
+        std::memcpy(input.get() + fill, samples, taken * sizeof(float));
+        fill += taken;
+        samples += taken;
+        count -= taken;
+        if (fill == MEL_FRAME_SAMPLES) {
+            compute_frame();
+            // the next frame starts a hop later, the rest of this one is the start of it
+            std::memmove(input.get(), input.get() + MEL_HOP_SAMPLES, (MEL_FRAME_SAMPLES - MEL_HOP_SAMPLES) * sizeof(float));
+            fill = MEL_FRAME_SAMPLES - MEL_HOP_SAMPLES;
+        }
+    }
+}
+
+Feature_View Log_Mel_Extractor::view(uint64_t start_sample) const noexcept {
+    const uint64_t first = origin_frame + (start_sample - origin) / MEL_HOP_SAMPLES;
+    return Feature_View{rows.get() + (first % capacity) * MEL_ROW_FLOATS, MEL_FRAMES_PER_WINDOW};
+}
+
+uint64_t Log_Mel_Extractor::get_frames() const noexcept {
+    return frames;
+}
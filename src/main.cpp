@@ -1,320 +1,312 @@
-#include "audio_tsrt.h"
-#include "audio_segment_tsrt.h"
+#include "audio_source_tsrt.h"
+#include "batch_tsrt.h"
 #include "constants_config_tsrt.h"
 #include "exceptions_tsrt.h"
 #include "logger_tsrt.h"
+#include "preprocessing_chain_tsrt.h"
 #include "ring_buffer_tsrt.h"
 #include "script_engine_tsrt.h"
+#include "segment_pool_tsrt.h"
+#include "session_tsrt.h"
 #include "status_codes_tsrt.h"
 
+#include <atomic>
 #include <chrono>
+#include <cstdlib>
 #include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
 #include <iostream>
-#include <tbb/tbb.h>
-#include <tbb/parallel_invoke.h>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
 
 /**
- * @brief Manages the recording of audio data into segments.
+ * @brief Logs the wakeup latency and overflow counters of one hop of a session's pipeline.
  *
- * This thread is responsible for capturing audio data and encapsulating it into Audio_Segment objects
- * with precise timestamps. The audio data is read into a local Audio_Segment, timestamped, and then 
- * moved into a shared, thread-safe Ring_Buffer for subsequent processing. The Audio_Segment is then
- * reset with a new buffer, preparing it for the next round of audio capture. This cycle continues until
- * the engine signals to stop recording.
- *
- * @param shared_audio_ring_buffer A thread-safe shared ring buffer for storing audio segments.
+ * @param session The session.
+ * @param hop The name of the hop.
+ * @param latency The time the consuming task took to resume after a publish it was waiting for.
+ * @param stats The overflow counters of the ring buffer between the two stages.
+ * @param size The capacity of the ring buffer between the two stages.
  */
-void audio_recording_thread(Ring_Buffer<Audio_Segment, true, AUDIO_BUFFER_SIZE>& shared_audio_ring_buffer) {
-    try {
-    Script_Engine& engine = Script_Engine::get_instance();
-    Audio_tsrt& audio_tsrt = Audio_tsrt::get_instance();
-    tsrt_status_code status;
-    bool err_on_last_iteration = false;
-
-    Audio_Segment audio_segment;
-    audio_segment.lazy_initialize(SAMPLES_PER_HALF_SEGMENT);
-
-    while (engine.is_running()) {
-        while (!engine.is_recording()) {
-            if (audio_tsrt.is_streaming()) {
-                status = audio_tsrt.stop_stream();
-                if (status != SUCCESS) {
-                    if (err_on_last_iteration)
-                        throw Tsrt_Exception(IO_ERROR, "Consecutive errors stopping stream", std::chrono::system_clock::now(), __FILE__, __LINE__);
-                    log_error(IO_ERROR, "Error stopping stream", std::chrono::system_clock::now(), __FILE__, __LINE__);
-                    err_on_last_iteration = true;
-                    continue;
-                }
-            }
-            std::this_thread::sleep_for(std::chrono::milliseconds(THREAD_SLEEP_MS));
-        }
-
-        if (!audio_tsrt.is_streaming()) {
-            status = audio_tsrt.start_stream();
-            if (status != SUCCESS) {
-                if (err_on_last_iteration)
-                    throw Tsrt_Exception(IO_ERROR, "Consecutive errors starting stream", std::chrono::system_clock::now(), __FILE__, __LINE__);
-                log_error(IO_ERROR, "Error starting stream", std::chrono::system_clock::now(), __FILE__, __LINE__);
-                err_on_last_iteration = true;
-                continue;
-            }
-        }
-
-        audio_segment.get_timestamp() = std::chrono::system_clock::now();
+void log_hop_stats(const Session_tsrt& session, const std::string& hop, const Wakeup_Latency& latency, const Ring_Buffer_Stats& stats, size_t size) {
+    std::ostringstream message;
+    message << "session " << session.get_id() << " " << hop << " wakeup latency: mean " << latency.mean.count() << " ns, max "
+            << latency.max.count() << " ns over " << latency.wakeups << " wakeups; overwritten " << stats.overwritten
+            << ", dropped " << stats.dropped << ", high water " << stats.high_water << "/" << size;
+    log_info(message.str(), std::chrono::system_clock::now(), __FILE__, __LINE__);
+}
 
-        status = audio_tsrt.read_audio_segment(audio_segment.get_audio(), SAMPLES_PER_HALF_SEGMENT);
-        if (status != SUCCESS) {
-            if (err_on_last_iteration)
-                throw Tsrt_Exception(IO_ERROR, "Consecutive errors reading audio segment", std::chrono::system_clock::now(), __FILE__, __LINE__);
-            log_error(IO_ERROR, "Error reading audio segment", std::chrono::system_clock::now(), __FILE__, __LINE__);
-            err_on_last_iteration = true;
-            continue;
-        }
+/**
+ * @brief Logs how much of a segment pool was used and how often it ran dry.
+ *
+ * @param name The name of the pool.
+ * @param stats The pool's usage and exhaustion counters.
+ */
+void log_pool_stats(const std::string& name, const Segment_Pool_Stats& stats) {
+    std::ostringstream message;
+    message << name << " segment pool: high water " << stats.high_water << "/" << stats.capacity
+            << ", in use " << stats.in_use << ", exhausted " << stats.exhausted;
+    log_info(message.str(), std::chrono::system_clock::now(), __FILE__, __LINE__);
+}
 
-        shared_audio_ring_buffer.push(std::move(audio_segment));
+/**
+ * @brief Logs how much audio a session's source produced, how much was lost, its input latency, and the real time factor.
+ *
+ * @param session The session.
+ */
+void log_source_stats(const Session_tsrt& session) {
+    const Audio_Source& audio_source = session.get_audio_source();
+    const Source_Stats stats = audio_source.get_stats();
+    const std::chrono::duration<double> elapsed = session.get_elapsed();
+    const double audio_seconds = static_cast<double>(stats.samples) / SAMPLE_RATE;
+    std::ostringstream message;
+    message << "session " << session.get_id() << " " << audio_source.get_name() << " source: " << audio_seconds << " s of audio in "
+            << elapsed.count() << " s, real time factor " << (audio_seconds > 0.0 ? elapsed.count() / audio_seconds : 0.0)
+            << "; dropped segments " << stats.dropped_segments << ", input overflows " << stats.input_overflows
+            << "; input latency mean " << stats.mean_input_latency.count() << " ns, max " << stats.max_input_latency.count() << " ns"
+            << "; preprocessing latency " << static_cast<double>(session.get_preprocessing_latency()) * MS_PER_SEC / SAMPLE_RATE << " ms"
+            << ", chains swapped in " << session.get_preprocessing_swaps() << ", timestamp regressions " << session.get_pts_regressions();
+    log_info(message.str(), std::chrono::system_clock::now(), __FILE__, __LINE__);
+}
 
-        audio_segment.reset_audio();
+/**
+ * @brief Logs how much of a session's audio was speech and the share of analyses voice activity detection skipped.
+ *
+ * @param session The session.
+ */
+void log_voice_activity_stats(const Session_tsrt& session) {
+    const Voice_Activity_Stats stats = session.get_voice_activity_stats();
+    const uint64_t analyses = stats.analysed + stats.skipped;
+    std::ostringstream message;
+    message << "session " << session.get_id() << " voice activity: " << stats.speech_windows << "/" << stats.windows
+            << " windows speech, analyses run " << stats.analysed << ", skipped " << stats.skipped << " ("
+            << (analyses > 0 ? 100.0 * static_cast<double>(stats.skipped) / static_cast<double>(analyses) : 0.0) << "%)";
+    log_info(message.str(), std::chrono::system_clock::now(), __FILE__, __LINE__);
+}
 
-        if (err_on_last_iteration)
-            err_on_last_iteration = false;
-    }
-    } catch(const Tsrt_Exception) {
-        throw;
-    } catch(const std::exception) {
-        throw;
-    } catch(...) {
-        throw;
-    }
+/**
+ * @brief Logs the share of a session's denoiser hops the SNR estimate bypassed, nothing for a chain without a denoiser.
+ *
+ * @param session The session.
+ */
+void log_denoise_stats(const Session_tsrt& session) {
+    const Denoise_Stats stats = session.get_denoise_stats();
+    if (stats.frames == 0)
+        return;
+    std::ostringstream message;
+    message << "session " << session.get_id() << " denoising: bypassed " << stats.bypassed << "/" << stats.frames << " hops ("
+            << 100.0 * static_cast<double>(stats.bypassed) / static_cast<double>(stats.frames) << "%)";
+    log_info(message.str(), std::chrono::system_clock::now(), __FILE__, __LINE__);
 }
 
 /**
- * @brief Handles audio preprocessing using FFmpeg filter graphs.
+ * @brief Opens a session for every source on the command line.
  *
- * This function operates by continuously retrieving audio segments from a shared Ring_Buffer,
- * timestamped by the recording thread. The audio segments are then processed in-place
- * using an FFmpeg filter graph. It ensures synchronization of audio data with timestamps,
- * making the processed audio available for further analysis.
+ * transScriptRT [source...] [--speed=<times real time>] [--jitter-us=<microseconds>] [--seconds=<duration>] [--script-dir=<dir>]
+ *               [--preprocess=<spec>] [--preprocess-file=<path>]
+ * Each source is a session of its own, the default is one session on the input device, see make_audio_source() for the
+ * others. The speed, jitter and duration options apply to synthetic sources. With a script directory each session
+ * writes its script to session-<id>.tsrt.tsv in it. A source that is not paced from outside, e.g. a file, gets
+ * backpressure, so it runs as fast as the pipeline can take it without losing audio.
  *
- * @param shared_audio_ring_buffer A thread-safe shared ring buffer from which raw audio segments are retrieved.
+ * @param engine The engine to open the sessions on.
  */
-void audio_preprocessing_thread(Ring_Buffer<Audio_Segment, true, AUDIO_BUFFER_SIZE>& shared_audio_ring_buffer) {
-    try {
-    Script_Engine& engine = Script_Engine::get_instance();
-    Audio_tsrt& audio_tsrt = Audio_tsrt::get_instance();
-    tsrt_status_code status;
-    bool first_segment = true;
-
-    // audio_segment for passing onto the next stage of the pipeline
-    Audio_Segment full_audio_segment;
-    full_audio_segment.lazy_initialize(SAMPLES_PER_SEGMENT);
-
-    // keep track of previous half segments timestamp, its the timestamp for the current full segment
-    std::chrono::system_clock::time_point current_timestamp = std::chrono::system_clock::now();
-    std::chrono::system_clock::time_point last_timestamp = std::chrono::system_clock::now();
-
-    while (engine.is_running()) {
-        while (!engine.is_recording()) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(THREAD_SLEEP_MS));
-        }
-
-        // get next segment if it exists, otherwise wait
-        std::optional<Audio_Segment> latest_half_segment_opt = shared_audio_ring_buffer.pop();
-        if (!latest_half_segment_opt.has_value()) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(THREAD_SLEEP_MS));
+void open_sessions_from_args(Script_Engine& engine, int argc, char* argv[]) {
+    std::vector<std::string> specs;
+    double speed = 0.0;
+    long jitter_us = 0;
+    long seconds = 0;
+    std::string script_dir;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg.rfind("--batch=", 0) == 0 || arg.rfind("--output-dir=", 0) == 0 || arg.rfind("--preprocess", 0) == 0)
             continue;
-        }
-
-        Audio_Segment latest_half_segment = std::move(latest_half_segment_opt.value());
-
-        // assign new timestamp and push to ring buffer for alignment after processing
-        current_timestamp = latest_half_segment.get_timestamp();
-
-        status = audio_tsrt.preprocess_audio_segment(latest_half_segment.get_audio());
-        if (status != SUCCESS)
-            throw Tsrt_Exception(UNKNOWN_ERROR, "Error preprocessing audio segment", std::chrono::system_clock::now(), __FILE__, __LINE__);
-
-        // skip the rest on the first segment since there is no previous segment to combine with
-        if (first_segment) {
-            memcpy(full_audio_segment.get_audio(), latest_half_segment.get_audio(), SAMPLES_PER_HALF_SEGMENT * sizeof(float));
-            first_segment = false;
-            continue;
-        }
-
-        // finish the audio_segments buffer by combining the previous segment with the current one
-        memcpy(full_audio_segment.get_midpoint(), latest_half_segment.get_audio(), SAMPLES_PER_HALF_SEGMENT * sizeof(float));
-        
-        full_audio_segment.set_timestamp(last_timestamp);
-        last_timestamp = current_timestamp;
-        
-        engine.push_to_audio_buffer(std::move(full_audio_segment));
-
-        // copy half segment to beginning of full segment for next iteration
-        full_audio_segment.reset_audio();
-        memcpy(full_audio_segment.get_audio(), latest_half_segment.get_audio(), SAMPLES_PER_HALF_SEGMENT * sizeof(float));
+        if (arg.rfind("--speed=", 0) == 0)
+            speed = std::atof(arg.c_str() + 8);
+        else if (arg.rfind("--jitter-us=", 0) == 0)
+            jitter_us = std::atol(arg.c_str() + 12);
+        else if (arg.rfind("--seconds=", 0) == 0)
+            seconds = std::atol(arg.c_str() + 10);
+        else if (arg.rfind("--script-dir=", 0) == 0)
+            script_dir = arg.substr(13);
+        else
+            specs.push_back(arg);
     }
-    } catch(const Tsrt_Exception) {
-        throw;
-    } catch(const std::exception) {
-        throw;
-    } catch(...) {
-        throw;
+    if (specs.empty())
+        specs.push_back("portaudio");
+
+    for (const std::string& spec : specs) {
+        std::unique_ptr<Audio_Source> audio_source = make_audio_source(spec, speed, std::chrono::microseconds(jitter_us), std::chrono::seconds(seconds));
+        const bool live = audio_source->is_live();
+        const std::string script_path = script_dir.empty() ? std::string()
+            : (std::filesystem::path(script_dir) / ("session-" + std::to_string(engine.get_session_count()) + ".tsrt.tsv")).string();
+        Session_tsrt& session = engine.open_session(std::move(audio_source), script_path);
+        if (!live)
+            session.enable_backpressure();
     }
 }
 
-void speaker_diarization_thread() {
-/*
-    speaker diarization loops until the running flag is set.
-    It waits for the recording flag to be set, then reads
-    audio from the ring buffer and performs speaker diarization
-    on it. Segments of speech will be divided into buckets
-    of speakers.
-
-    If speaker identification and or emotional recognition
-    are enabled, their behavior must be modified to handle
-    the case where there are multiple speakers in a segment.
-    They will instead be passed the audio from buckets of
-    speakers instead of the segments of audio.
-*/
-
-    Script_Engine& engine = Script_Engine::get_instance();
-
-    while (engine.is_running()) {
-        while (!engine.is_recording()) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(THREAD_SLEEP_MS));
-        }
-
-        //std::cout << "Speaker diarization..." << std::endl;
+/**
+ * @brief Sets the engine's preprocessing chain from the command line.
+ *
+ * transScriptRT [--preprocess=<spec>] ...
+ * See parse_preprocessor_spec() for the specs, the default is the chain of constants_config_tsrt.h.
+ *
+ * @param engine The engine, before any session is opened.
+ * @return std::string The path given with --preprocess-file=<path>, empty if none.
+ * @throw Tsrt_Exception if the spec is invalid.
+ */
+std::string set_preprocessing_from_args(Script_Engine& engine, int argc, char* argv[]) {
+    std::string spec_path;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg.rfind("--preprocess=", 0) == 0)
+            engine.set_preprocessor_config(parse_preprocessor_spec(arg.substr(13)));
+        else if (arg.rfind("--preprocess-file=", 0) == 0)
+            spec_path = arg.substr(18);
     }
+    return spec_path;
 }
 
-void speech_recognition_thread() {
-/*
-    speech recognition loops until the running flag is set.
-    It waits for the recording flag to be set, then reads
-    audio from the ring buffer and performs speech recognition
-    on it. Segments of speech will be passed to the script
-    writing thread to for deduplication of overlapping 
-    segments before being concatenated and aligned in the script.
-*/
-
-    Script_Engine& engine = Script_Engine::get_instance();
-
-    while ((engine).is_running()) {
-        while (!engine.is_recording()) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(THREAD_SLEEP_MS));
-        }
-
-        if (engine.speaker_diarization_enabled()) {
-            //continue;
+/**
+ * @brief Swaps the chain in a file into every session each time the file changes, until stopped.
+ *
+ * The file holds one spec, see parse_preprocessor_spec(), so a running box can be tuned by rewriting it. The chains
+ * are built on this thread, never on the engine's workers. A bad spec is logged and the sessions keep their chain.
+ *
+ * @param engine The engine.
+ * @param spec_path The file.
+ * @param stop Set to stop watching.
+ */
+void watch_preprocessing_spec(Script_Engine& engine, const std::string& spec_path, const std::atomic<bool>& stop) noexcept {
+    std::error_code error;
+    std::filesystem::file_time_type last_write = std::filesystem::last_write_time(spec_path, error);
+    while (!stop.load(std::memory_order_acquire)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(PREPROCESS_SPEC_POLL_MS));
+        const std::filesystem::file_time_type write = std::filesystem::last_write_time(spec_path, error);
+        if (error || write == last_write)
+            continue;
+        last_write = write;
+
+        try {
+            std::ifstream file(spec_path);
+            std::string spec;
+            std::getline(file, spec);
+            engine.swap_preprocessing(parse_preprocessor_spec(spec));
+            log_info("preprocessing chain swapped to " + spec, std::chrono::system_clock::now(), __FILE__, __LINE__);
+        } catch (const Tsrt_Exception& e) {
+            log_error(e.get_status_code(), std::string("Keeping the preprocessing chain: ") + e.what(), std::chrono::system_clock::now(), __FILE__, __LINE__);
+        } catch (const std::exception& e) {
+            log_error(UNKNOWN_ERROR, std::string("Keeping the preprocessing chain: ") + e.what(), std::chrono::system_clock::now(), __FILE__, __LINE__);
         }
-
-        //std::cout << "Speech recognition..." << std::endl;
     }
 }
 
-
-void speaker_identification_thread() {
-/*
-    speaker identification loops until the running flag is set.
-    It waits for the recording flag to be set. If speaker diarization
-    is enabled, it will wait for the speaker diarization thread
-    to finish processing the audio and pass it the audio from
-    buckets of speakers. Otherwise it will read audio from the
-    ring buffer and perform speaker identification on it. 
-    A struct with a timestamp and the speaker's name will be
-    passed to the script writing thread.
-*/  
-
-    Script_Engine& engine = Script_Engine::get_instance();
-    
-    while (engine.is_running()) {
-        while (!engine.is_recording()) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(THREAD_SLEEP_MS));
-        }
-
-        if (engine.speaker_diarization_enabled()) {
-            //continue;
-        }
-
-        //std::cout << "Speaker identification..." << std::endl;
+/**
+ * @brief Transcribes the files of a batch list instead of running the live engine.
+ *
+ * transScriptRT --batch=<list> [--output-dir=<dir>]
+ * Logs the latency and real time factor of each file and of the whole batch, see run_batch().
+ *
+ * @param argc The argument count.
+ * @param argv The arguments.
+ * @param status Set to SUCCESS if every file was transcribed, else the status of the first file that failed.
+ * @return bool False if the command line does not ask for batch mode.
+ */
+bool run_batch_from_args(int argc, char* argv[], tsrt_status_code& status) {
+    std::string list_path;
+    std::string output_dir;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg.rfind("--batch=", 0) == 0)
+            list_path = arg.substr(8);
+        else if (arg.rfind("--output-dir=", 0) == 0)
+            output_dir = arg.substr(13);
     }
-}
+    if (list_path.empty())
+        return false;
 
-void emotion_recognition_thread() {
-/*
-    emotion recognition loops until the running flag is set.
-    It waits for the recording flag to be set. If speaker diarization
-    is enabled, it will wait for the speaker diarization thread
-    to finish processing the audio and pass it the audio from
-    buckets of speakers. Otherwise it will read audio from the
-    ring buffer and perform emotion recognition on it.
-    A struct with a timestamp and the speaker's emotion will be
-    passed to the script writing thread.
-*/
+    const std::vector<std::string> inputs = read_batch_list(list_path);
+    const auto started = std::chrono::steady_clock::now();
+    // the same workers the live sessions run on
+    std::vector<Batch_Result> results;
     Script_Engine& engine = Script_Engine::get_instance();
-
-    while (engine.is_running()) {
-        while(!engine.is_recording()) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(THREAD_SLEEP_MS));
-        }
-
-        if (engine.speaker_diarization_enabled()) {
-            //continue;
+    const Preprocessor_Config preprocessor_config = engine.get_preprocessor_config();
+    engine.get_arena().execute([&] { results = run_batch(inputs, output_dir, preprocessor_config); });
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - started;
+
+    status = SUCCESS;
+    double audio_seconds = 0.0;
+    size_t failed = 0;
+    for (const Batch_Result& result : results) {
+        if (result.status != SUCCESS) {
+            if (status == SUCCESS)
+                status = result.status;
+            ++failed;
+            continue;
         }
-
-        //std::cout << "Emotion recognition..." << std::endl;
+        audio_seconds += result.audio.count();
+        std::ostringstream message;
+        message << result.input << " -> " << result.output << ": " << result.audio.count() << " s of audio, "
+                << result.windows << " windows in " << result.latency.count() << " s, real time factor "
+                << (result.audio.count() > 0.0 ? result.latency.count() / result.audio.count() : 0.0);
+        log_info(message.str(), std::chrono::system_clock::now(), __FILE__, __LINE__);
     }
-}
 
-void script_writing_thread() {
-/*
-    script writing loops until the running flag is set.
-    It waits for the recording flag to be set. It's precise
-    behavior depends on the enabled analyses. If all analyses
-    are enabled, it will wait for all results for a given
-    timestamp to be available before writing to the script.
-    Any analysis that is disabled will simply be left out of
-    the script data structure.
-*/
-    Script_Engine& engine = Script_Engine::get_instance();
-
-    while (engine.is_running()) {
-        while (!engine.is_recording()) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(THREAD_SLEEP_MS));
-        }
-
-        //std::cout << "Script writing..." << std::endl;
-    }
+    // below a file's own real time factor when files overlap, since every core is kept busy
+    std::ostringstream message;
+    message << "batch: " << results.size() - failed << "/" << results.size() << " files, " << audio_seconds
+            << " s of audio in " << elapsed.count() << " s, aggregate real time factor "
+            << (audio_seconds > 0.0 ? elapsed.count() / audio_seconds : 0.0);
+    log_info(message.str(), std::chrono::system_clock::now(), __FILE__, __LINE__);
+    return true;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
     try {
         init_logging();
         Script_Engine& engine = Script_Engine::get_instance();
+        const std::string spec_path = set_preprocessing_from_args(engine, argc, argv);
+        tsrt_status_code batch_status = SUCCESS;
+        if (run_batch_from_args(argc, argv, batch_status))
+            return batch_status;
+
         engine.enable_speaker_diarization();
         engine.enable_speech_recognition();
         engine.enable_speaker_identification();
         engine.enable_emotion_recognition();
+
+        open_sessions_from_args(engine, argc, argv);
         engine.start_engine();
-        engine.start_recording();
-        
-        auto shared_audio_ring_buffer = std::make_shared<Ring_Buffer<Audio_Segment, true, AUDIO_BUFFER_SIZE>>();
+        for (size_t id = 0; id < engine.get_session_count(); ++id)
+            engine.get_session(id).start();
+        std::atomic<bool> stop_watching{false};
+        std::thread spec_watcher;
+        if (!spec_path.empty())
+            spec_watcher = std::thread(watch_preprocessing_spec, std::ref(engine), std::cref(spec_path), std::cref(stop_watching));
+        engine.run_sessions();
+        stop_watching.store(true, std::memory_order_release);
+        if (spec_watcher.joinable())
+            spec_watcher.join();
+
+        // wakeup latency and losses per hop, for choosing PIPELINE_WAIT_STRATEGY, the overflow policies and SESSION_POLL_SEGMENTS
+        for (size_t id = 0; id < engine.get_session_count(); ++id) {
+            const Session_tsrt& session = engine.get_session(id);
+            log_hop_stats(session, "recording -> preprocessing", session.get_capture_wakeup_latency(), session.get_capture_buffer_stats(), AUDIO_BUFFER_SIZE);
+            log_hop_stats(session, "preprocessing -> analysis", session.get_audio_wakeup_latency(), session.get_audio_buffer_stats(), AUDIO_BUFFER_SIZE);
+            log_source_stats(session);
+            log_voice_activity_stats(session);
+            log_denoise_stats(session);
+        }
 
-        std::vector<std::function<void()>> tasks;
-        tasks.push_back([shared_audio_ring_buffer]() { audio_recording_thread(*shared_audio_ring_buffer); });
-        tasks.push_back([shared_audio_ring_buffer]() { audio_preprocessing_thread(*shared_audio_ring_buffer); });
-        if (engine.speech_recognition_enabled())
-            tasks.push_back([&]() { speech_recognition_thread(); });
-        if (engine.speaker_diarization_enabled())
-            tasks.push_back([&]() { speaker_diarization_thread(); });
-        if (engine.speaker_identification_enabled())
-            tasks.push_back([&]() { speaker_identification_thread(); });
-        if (engine.emotion_recognition_enabled())
-            tasks.push_back([&]() { emotion_recognition_thread(); });
-        tasks.push_back([&] { script_writing_thread(); });
-        tbb::parallel_for(size_t(0), tasks.size(), [&](size_t i) {
-            tasks[i]();
-        });
+        // an exhausted count above 0 means segments were allocated on the heap, raise HALF_SEGMENT_POOL_CHUNK or SEGMENT_POOL_MAX_SESSIONS
+        log_pool_stats("half", Segment_Pool::half_segments().get_stats());
 
     } catch (const std::bad_alloc &e) {
         return handle_exception(e);
@@ -0,0 +1,257 @@
+#include "native_preprocessor_tsrt.h"
+#include "aligned_samples_tsrt.h"
+#include "constants_config_tsrt.h"
+#include "dsp_kernels_tsrt.h"
+#include "exceptions_tsrt.h"
+#include "fft_tsrt.h"
+#include "preprocessing_chain_tsrt.h"
+#include "preprocessor_tsrt.h"
+#include "status_codes_tsrt.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+namespace {
+
+constexpr double PI = 3.14159265358979323846;
+constexpr size_t DENOISE_PADDED_BINS = padded_samples(DENOISE_BINS);
+
+} // namespace
+
+Biquad_Cascade::Biquad_Cascade(const Dsp_Kernels& kernels) :
+    kernels(&kernels),
+    sections() {}
+
+void Biquad_Cascade::add_bandpass(double frequency, double width) {
+    // FFmpeg's biquads, band pass with a constant 0 dB peak and the width as Q = frequency / width
+    const double w0 = 2.0 * PI * frequency / SAMPLE_RATE;
+    const double alpha = std::sin(w0) / (2.0 * frequency / width);
+    sections.emplace_back();
+    init_biquad_section(sections.back(), alpha, 0.0, -alpha, 1.0 + alpha, -2.0 * std::cos(w0), 1.0 - alpha);
+}
+
+void Biquad_Cascade::process(float* samples, size_t count) noexcept {
+    for (Biquad_Section& section : sections)
+        kernels->biquad(section, samples, count);
+}
+
+size_t Biquad_Cascade::get_latency() const noexcept {
+    return 0;
+}
+
+Spectral_Denoiser::Spectral_Denoiser(const Dsp_Kernels& kernels, float reduction_db, float floor_db, float bypass_db) :
+    kernels(&kernels),
+    fft(DENOISE_FRAME_SAMPLES, kernels),
+    params(),
+    window(allocate_aligned_samples(DENOISE_FRAME_SAMPLES)),
+    bypass_window(allocate_aligned_samples(DENOISE_FRAME_SAMPLES)),
+    input(allocate_aligned_samples(DENOISE_FRAME_SAMPLES)),
+    frame(allocate_aligned_samples(DENOISE_FRAME_SAMPLES)),
+    spectrum(allocate_aligned_samples(2 * DENOISE_PADDED_BINS)),
+    noise(allocate_aligned_samples(DENOISE_PADDED_BINS)),
+    overlap(allocate_aligned_samples(DENOISE_FRAME_SAMPLES)),
+    output(allocate_aligned_samples(DENOISE_HOP_SAMPLES)),
+    fill(0),
+    bypass(floor_db, bypass_db) {
+
+    // periodic sqrt Hann, its squares overlapping by half sum to one
+    double window_energy = 0.0;
+    for (size_t n = 0; n < DENOISE_FRAME_SAMPLES; ++n) {
+        window[n] = static_cast<float>(std::sqrt(0.5 - 0.5 * std::cos(2.0 * PI * n / DENOISE_FRAME_SAMPLES)));
+        window_energy += static_cast<double>(window[n]) * window[n];
+        bypass_window[n] = window[n] * window[n];
+    }
+
+    // a bin of noise at floor_db dBFS has the power of the noise times the window's energy
+    params.noise_floor = static_cast<float>(std::pow(10.0, floor_db / 10.0) * window_energy);
+    params.min_gain_squared = static_cast<float>(std::pow(10.0, -reduction_db / 10.0));
+    params.noise_rise = DENOISE_NOISE_RISE;
+    params.noise_fall = DENOISE_NOISE_FALL;
+    params.oversubtraction = DENOISE_OVERSUBTRACTION;
+    std::fill(noise.get(), noise.get() + DENOISE_PADDED_BINS, params.noise_floor);
+}
+
+void Spectral_Denoiser::process_frame() noexcept {
+    const float* hop = input.get() + DENOISE_FRAME_SAMPLES - DENOISE_HOP_SAMPLES;
+    bypass.update(kernels->dot(hop, hop, DENOISE_HOP_SAMPLES) / DENOISE_HOP_SAMPLES);
+    if (bypass.is_bypassed()) {
+        // windowed before and after without filtering in between, the frames still sum back to the input
+        kernels->multiply_add(overlap.get(), input.get(), bypass_window.get(), DENOISE_FRAME_SAMPLES);
+    } else {
+        kernels->multiply(frame.get(), input.get(), window.get(), DENOISE_FRAME_SAMPLES);
+        fft.forward(spectrum.get(), frame.get());
+        // the bins past N / 2 + 1 are only there to make whole vectors, keep them silent
+        std::memset(spectrum.get() + 2 * DENOISE_BINS, 0, 2 * (DENOISE_PADDED_BINS - DENOISE_BINS) * sizeof(float));
+        kernels->spectral_subtract(spectrum.get(), noise.get(), DENOISE_PADDED_BINS, params);
+        // scaled by 1 / N, so a frame comes back at the level it went in
+        fft.inverse(frame.get(), spectrum.get(), 1.0f / DENOISE_FRAME_SAMPLES);
+        kernels->multiply_add(overlap.get(), frame.get(), window.get(), DENOISE_FRAME_SAMPLES);
+    }
+
+    // the oldest hop has every frame it is part of added, the rest waits for the next frame
+    std::memcpy(output.get(), overlap.get(), DENOISE_HOP_SAMPLES * sizeof(float));
+    std::memmove(overlap.get(), overlap.get() + DENOISE_HOP_SAMPLES, (DENOISE_FRAME_SAMPLES - DENOISE_HOP_SAMPLES) * sizeof(float));
+    std::memset(overlap.get() + DENOISE_FRAME_SAMPLES - DENOISE_HOP_SAMPLES, 0, DENOISE_HOP_SAMPLES * sizeof(float));
+    std::memmove(input.get(), input.get() + DENOISE_HOP_SAMPLES, (DENOISE_FRAME_SAMPLES - DENOISE_HOP_SAMPLES) * sizeof(float));
+}
+
+void Spectral_Denoiser::process(float* samples, size_t count) noexcept {
+    while (count > 0) {
+        const size_t taken = std::min(DENOISE_HOP_SAMPLES - fill, count);
+        // the samples go into the newest hop, the same positions of the hop of output take their place
+        std::memcpy(input.get() + DENOISE_FRAME_SAMPLES - DENOISE_HOP_SAMPLES + fill, samples, taken * sizeof(float));
+        std::memcpy(samples, output.get() + fill, taken * sizeof(float));
+        fill += taken;
+        samples += taken;
+        count -= taken;
+        if (fill == DENOISE_HOP_SAMPLES) {
+            process_frame();
+            fill = 0;
+        }
+    }
+}
+
+size_t Spectral_Denoiser::get_latency() const noexcept {
+    // a hop waits for the hop after it to be filtered, then is handed out while the one after that comes in
+    return DENOISE_FRAME_SAMPLES;
+}
+
+Denoise_Stats Spectral_Denoiser::get_stats() const noexcept {
+    return bypass.get_stats();
+}
+
+Native_Preprocessor_tsrt::Native_Preprocessor_tsrt(const Preprocessor_Config& config, const Dsp_Kernels& kernels) :
+    kernels(&kernels),
+    stages(),
+    denoisers(),
+    latency(0),
+    first_index(0),
+    next_index(0),
+    started(false),
+    flushed(false),
+    output{nullptr, 0, 0},
+    output_ready(false),
+    output_pulled(false),
+    handed_inputs(0),
+    tail(),
+    inputs_pushed{0},
+    inputs_released{0} {
+
+    Biquad_Cascade* cascade = nullptr;
+    for (const Native_Stage_Config& stage : config.stages) {
+        if (stage.type == NATIVE_BANDPASS) {
+            if (cascade == nullptr) {
+                auto new_cascade = std::make_unique<Biquad_Cascade>(kernels);
+                cascade = new_cascade.get();
+                stages.push_back(std::move(new_cascade));
+            }
+            cascade->add_bandpass(stage.frequency, stage.width);
+        } else {
+            auto denoiser = std::make_unique<Spectral_Denoiser>(kernels, stage.reduction, stage.floor, stage.bypass);
+            denoisers.push_back(denoiser.get());
+            stages.push_back(std::move(denoiser));
+            cascade = nullptr;
+        }
+    }
+    for (const std::unique_ptr<Native_Stage>& stage : stages)
+        latency += stage->get_latency();
+}
+
+void Native_Preprocessor_tsrt::preprocess(float* samples, size_t count) noexcept {
+    for (const std::unique_ptr<Native_Stage>& stage : stages)
+        stage->process(samples, count);
+}
+
+void Native_Preprocessor_tsrt::set_output(const float* samples, size_t count, uint64_t sample_index) noexcept {
+    // what comes out before the first sample pushed plus the delay is the silence the stages started with
+    size_t skipped = 0;
+    if (sample_index < first_index + latency)
+        skipped = static_cast<size_t>(std::min<uint64_t>(count, first_index + latency - sample_index));
+    output = Filtered_Audio{samples + skipped, count - skipped, sample_index + skipped - latency};
+    output_ready = output.count > 0;
+}
+
+void Native_Preprocessor_tsrt::release_inputs() noexcept {
+    inputs_released.store(handed_inputs, std::memory_order_release);
+    output_pulled = false;
+}
+
+uint64_t Native_Preprocessor_tsrt::push_audio(float* samples, size_t count, uint64_t sample_index) {
+    if (flushed)
+        throw Tsrt_Exception(INVALID_OPERATION, "Error pushing audio into a flushed preprocessing chain", std::chrono::system_clock::now(), __FILE__, __LINE__);
+    if (output_ready)
+        throw Tsrt_Exception(INVALID_OPERATION, "Error pushing audio, the output of the last push has not been pulled", std::chrono::system_clock::now(), __FILE__, __LINE__);
+
+    if (!started) {
+        first_index = sample_index;
+        started = true;
+    }
+    preprocess(samples, count);
+    set_output(samples, count, sample_index);
+    next_index = sample_index + count;
+
+    const uint64_t input = inputs_pushed.load(std::memory_order_relaxed);
+    inputs_pushed.store(input + 1, std::memory_order_release);
+    // nothing came out, so nothing of the input is looked at
+    if (!output_ready) {
+        handed_inputs = input + 1;
+        if (!output_pulled)
+            release_inputs();
+    }
+    return input;
+}
+
+bool Native_Preprocessor_tsrt::pull_audio(Filtered_Audio& filtered) {
+    if (output_pulled)
+        release_inputs();
+    if (!output_ready)
+        return false;
+
+    filtered = output;
+    output_ready = false;
+    output_pulled = true;
+    handed_inputs = inputs_pushed.load(std::memory_order_relaxed);
+    return true;
+}
+
+void Native_Preprocessor_tsrt::flush() {
+    if (output_pulled)
+        release_inputs();
+    if (flushed)
+        return;
+    if (output_ready)
+        throw Tsrt_Exception(INVALID_OPERATION, "Error flushing, the output of the last push has not been pulled", std::chrono::system_clock::now(), __FILE__, __LINE__);
+
+    flushed = true;
+    if (!started || latency == 0)
+        return;
+    // the last samples pushed are still inside the stages, silence pushes them out
+    tail.assign(static_cast<size_t>(latency), 0.0f);
+    preprocess(tail.data(), tail.size());
+    set_output(tail.data(), tail.size(), next_index);
+}
+
+bool Native_Preprocessor_tsrt::input_released(uint64_t input) const noexcept {
+    return input < inputs_released.load(std::memory_order_acquire);
+}
+
+uint64_t Native_Preprocessor_tsrt::get_latency() const noexcept {
+    return latency;
+}
+
+Denoise_Stats Native_Preprocessor_tsrt::get_denoise_stats() const noexcept {
+    Denoise_Stats total{0, 0};
+    for (const Spectral_Denoiser* denoiser : denoisers) {
+        const Denoise_Stats stats = denoiser->get_stats();
+        total.frames += stats.frames;
+        total.bypassed += stats.bypassed;
+    }
+    return total;
+}
+
+const char* Native_Preprocessor_tsrt::get_isa_name() const noexcept {
+    return kernels->name;
+}
@@ -0,0 +1,54 @@
+#include "pcm_source_tsrt.h"
+#include "exceptions_tsrt.h"
+#include "status_codes_tsrt.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/stat.h>
+#endif
+
+Pcm_Source::Pcm_Source(const std::string& path) :
+    file{nullptr},
+    owned{path != "-"},
+    blocking{true} {
+
+    file = owned ? std::fopen(path.c_str(), "rb") : stdin;
+    if (file == nullptr)
+        throw Tsrt_Exception(IO_ERROR, "Error opening " + path, std::chrono::system_clock::now(), __FILE__, __LINE__);
+#if defined(__unix__) || defined(__APPLE__)
+    // a regular file is read as fast as the disk goes, everything else, pipes, fifos and terminals, waits on a writer
+    struct stat status;
+    if (fstat(fileno(file), &status) == 0)
+        blocking = !S_ISREG(status.st_mode);
+#else
+    blocking = !owned;
+#endif
+}
+
+Pcm_Source::~Pcm_Source() {
+    if (owned && file != nullptr)
+        std::fclose(file);
+}
+
+size_t Pcm_Source::read_samples(float* destination, size_t count) {
+    // fread only returns short at the end of the stream or on an error, a pipe is read until the writer closes it
+    const size_t read = std::fread(destination, sizeof(float), count, file);
+    if (read < count && std::ferror(file))
+        throw Tsrt_Exception(IO_ERROR, "Error reading raw samples", std::chrono::system_clock::now(), __FILE__, __LINE__);
+    return read;
+}
+
+bool Pcm_Source::is_live() const noexcept {
+    return false;
+}
+
+bool Pcm_Source::may_block() const noexcept {
+    return blocking;
+}
+
+const char* Pcm_Source::get_name() const noexcept {
+    return "pcm";
+}
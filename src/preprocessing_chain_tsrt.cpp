@@ -0,0 +1,180 @@
+#include "preprocessing_chain_tsrt.h"
+#include "constants_config_tsrt.h"
+#include "exceptions_tsrt.h"
+#include "native_preprocessor_tsrt.h"
+#include "preprocessor_tsrt.h"
+#include "status_codes_tsrt.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Splits a string at every separator.
+ *
+ * @param text The string.
+ * @param separator The separator.
+ * @return std::vector<std::string> The parts, empty ones included.
+*/
+std::vector<std::string> split(const std::string& text, char separator) {
+    std::vector<std::string> parts;
+    std::string part;
+    std::istringstream stream(text);
+    while (std::getline(stream, part, separator))
+        parts.push_back(part);
+    return parts;
+}
+
+/**
+ * @brief Parses one native stage, "<name>=<option>=<value>[:<option>=<value>...]" or just "<name>".
+ *
+ * @param stage The stage.
+ * @param spec The whole spec, for errors.
+ * @return Native_Stage_Config The stage, options left out at their defaults.
+ * @throw Tsrt_Exception if the stage or an option is unknown or a value is not a number.
+*/
+Native_Stage_Config parse_native_stage(const std::string& stage, const std::string& spec) {
+    const size_t equals = stage.find('=');
+    const std::string name = stage.substr(0, equals);
+    Native_Stage_Config config{NATIVE_BANDPASS, BANDPASS_F, BANDPASS_W, AFFTDN_NR, AFFTDN_NF, DENOISE_BYPASS_SNR_DB};
+    if (name == "denoise")
+        config.type = NATIVE_DENOISE;
+    else if (name != "bandpass")
+        throw Tsrt_Exception(INVALID_ARGUMENT, "Unknown native preprocessing stage \"" + name + "\" in " + spec, std::chrono::system_clock::now(), __FILE__, __LINE__);
+    if (equals == std::string::npos)
+        return config;
+
+    for (const std::string& option : split(stage.substr(equals + 1), ':')) {
+        const size_t option_equals = option.find('=');
+        const std::string key = option.substr(0, option_equals);
+        double value = 0.0;
+        try {
+            size_t parsed = 0;
+            const std::string text = option_equals == std::string::npos ? std::string() : option.substr(option_equals + 1);
+            value = std::stod(text, &parsed);
+            if (parsed != text.size())
+                throw std::invalid_argument(text);
+        } catch (const std::exception&) {
+            throw Tsrt_Exception(INVALID_ARGUMENT, "Invalid value for \"" + key + "\" of " + name + " in " + spec, std::chrono::system_clock::now(), __FILE__, __LINE__);
+        }
+
+        if (config.type == NATIVE_BANDPASS && key == "f")
+            config.frequency = value;
+        else if (config.type == NATIVE_BANDPASS && key == "w")
+            config.width = value;
+        else if (config.type == NATIVE_DENOISE && key == "nr")
+            config.reduction = static_cast<float>(value);
+        else if (config.type == NATIVE_DENOISE && key == "nf")
+            config.floor = static_cast<float>(value);
+        else if (config.type == NATIVE_DENOISE && key == "bypass")
+            config.bypass = static_cast<float>(value);
+        else
+            throw Tsrt_Exception(INVALID_ARGUMENT, "Unknown option \"" + key + "\" of " + name + " in " + spec, std::chrono::system_clock::now(), __FILE__, __LINE__);
+    }
+
+    if (config.type == NATIVE_BANDPASS && (config.frequency <= 0.0 || config.frequency >= SAMPLE_RATE / 2.0 || config.width <= 0.0))
+        throw Tsrt_Exception(INVALID_ARGUMENT, "Band pass out of range in " + spec, std::chrono::system_clock::now(), __FILE__, __LINE__);
+    if (config.type == NATIVE_DENOISE && config.reduction < 0.0f)
+        throw Tsrt_Exception(INVALID_ARGUMENT, "Negative noise reduction in " + spec, std::chrono::system_clock::now(), __FILE__, __LINE__);
+    return config;
+}
+
+} // namespace
+
+Snr_Bypass::Snr_Bypass(float floor_db, float bypass_db) :
+    floor_db(floor_db),
+    bypass_db(bypass_db),
+    noise_db(0.0f), // full scale, the noise level drops to the first hops rather than creeping up to them
+    level_db(floor_db),
+    bypassed(false),
+    held_hops(0),
+    hop_energy(0.0),
+    hop_fill(0),
+    stats{0, 0} {}
+
+void Snr_Bypass::update(float power) noexcept {
+    // digital silence has no level, the floor stands in for it
+    const float hop_db = power > 0.0f ? std::max(floor_db, 10.0f * std::log10(power)) : floor_db;
+    noise_db = std::min(hop_db, noise_db + DENOISE_SNR_NOISE_RISE_DB);
+    level_db = std::max(hop_db, level_db - DENOISE_SNR_LEVEL_FALL_DB);
+
+    if (held_hops < DENOISE_BYPASS_HOLD_HOPS) {
+        ++held_hops;
+    } else {
+        const float snr_db = level_db - noise_db;
+        if (bypassed ? snr_db < bypass_db - DENOISE_BYPASS_HYSTERESIS_DB : snr_db > bypass_db) {
+            bypassed = !bypassed;
+            held_hops = 0;
+        }
+    }
+    ++stats.frames;
+    if (bypassed)
+        ++stats.bypassed;
+}
+
+void Snr_Bypass::process(const float* samples, size_t count) noexcept {
+    for (size_t i = 0; i < count; ++i) {
+        hop_energy += static_cast<double>(samples[i]) * samples[i];
+        if (++hop_fill == DENOISE_HOP_SAMPLES) {
+            update(static_cast<float>(hop_energy / DENOISE_HOP_SAMPLES));
+            hop_energy = 0.0;
+            hop_fill = 0;
+        }
+    }
+}
+
+bool Snr_Bypass::is_bypassed() const noexcept {
+    return bypassed;
+}
+
+Denoise_Stats Snr_Bypass::get_stats() const noexcept {
+    return stats;
+}
+
+Preprocessor_Config::Preprocessor_Config() :
+    backend(PREPROCESS_FFMPEG),
+    spec(),
+    filters(),
+    stages() {
+
+    std::ostringstream chain;
+    // the width is in Hz, FFmpeg's default would read it as a Q of 3100
+    chain << "bandpass=f=" << BANDPASS_F << ":width_type=h:w=" << BANDPASS_W << ",afftdn=nr=" << AFFTDN_NR << ":nf=" << AFFTDN_NF;
+    filters = chain.str();
+    spec = "ffmpeg:" + filters;
+    stages.push_back(Native_Stage_Config{NATIVE_BANDPASS, BANDPASS_F, BANDPASS_W, AFFTDN_NR, AFFTDN_NF, DENOISE_BYPASS_SNR_DB});
+    stages.push_back(Native_Stage_Config{NATIVE_DENOISE, BANDPASS_F, BANDPASS_W, AFFTDN_NR, AFFTDN_NF, DENOISE_BYPASS_SNR_DB});
+}
+
+Preprocessor_Config parse_preprocessor_spec(const std::string& spec) {
+    auto starts_with = [&](const std::string& prefix) { return spec.compare(0, prefix.size(), prefix) == 0; };
+
+    Preprocessor_Config config;
+    if (starts_with("native:")) {
+        config.backend = PREPROCESS_NATIVE;
+        config.stages.clear();
+        for (const std::string& stage : split(spec.substr(7), ','))
+            config.stages.push_back(parse_native_stage(stage, spec));
+    } else {
+        config.backend = PREPROCESS_FFMPEG;
+        config.filters = starts_with("ffmpeg:") ? spec.substr(7) : spec;
+        // an empty chain would leave the source unlinked, anull passes the audio through
+        if (config.filters.empty())
+            config.filters = "anull";
+    }
+    config.spec = spec;
+    return config;
+}
+
+std::unique_ptr<Preprocessing_Chain> make_preprocessing_chain(const Preprocessor_Config& config) {
+    if (config.backend == PREPROCESS_NATIVE)
+        return std::make_unique<Native_Preprocessor_tsrt>(config);
+    return std::make_unique<Preprocessor_tsrt>(config);
+}
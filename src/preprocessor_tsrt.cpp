@@ -0,0 +1,255 @@
+#include "preprocessor_tsrt.h"
+#include "constants_config_tsrt.h"
+#include "exceptions_tsrt.h"
+#include "logger_tsrt.h"
+#include "status_codes_tsrt.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+extern "C" {
+#include <libavutil/log.h>
+#include <libavfilter/avfilter.h>
+#include <libavutil/frame.h>
+#include <libavutil/mem.h>
+#include <libavutil/opt.h>
+#include <libavfilter/buffersrc.h>
+#include <libavfilter/buffersink.h>
+}
+
+void avframe_deleter(AVFrame* avframe) {
+    if (avframe != nullptr)
+        av_frame_free(&avframe);
+}
+
+void handle_ffmpeg_errors(std::function<int()> bound_func, const std::string& error_context, std::string file, int line) {
+    int ret = bound_func();
+    if (ret < 0) {
+        char err_buf[AV_ERROR_MAX_STRING_SIZE];
+        av_make_error_string(err_buf, AV_ERROR_MAX_STRING_SIZE, ret);
+        throw Tsrt_Exception(RUNTIME_ERROR, error_context + ": " + err_buf, std::chrono::system_clock::now(), file, line);
+    }
+}
+
+void avfilter_graph_deleter(AVFilterGraph* avfilter_graph) {
+    if (avfilter_graph != nullptr)
+        avfilter_graph_free(&avfilter_graph);
+}
+
+void Preprocessor_tsrt::init_avframes() {
+    input_frame.reset(av_frame_alloc());
+    output_frame.reset(av_frame_alloc());
+    if (!input_frame || !output_frame) {
+        throw Tsrt_Exception(INSUFFICIENT_MEMORY, "Error allocating memory for the filter graph's frames", std::chrono::system_clock::now(), __FILE__, __LINE__);
+    }
+}
+
+void Preprocessor_tsrt::ffmpeg_log_callback(void* ptr, int level, const char* fmt, va_list vargs) {
+    (void)ptr;
+    // every graph's messages come here unfiltered, lower levels are more severe, the rest is dropped before formatting
+    if (level > AV_LOG_WARNING)
+        return;
+    // FFmpeg logs from whichever thread runs a filter graph, so each thread formats into its own buffer
+    thread_local char message[8192];
+    vsnprintf(message, sizeof(message), fmt, vargs);
+    log_error(RUNTIME_ERROR, std::string("ffmpeg: ") + message, std::chrono::system_clock::now(), __FILE__, __LINE__);
+}
+
+void Preprocessor_tsrt::init_avfilter_graph(const Preprocessor_Config& config) {
+    avfilter_graph.reset(avfilter_graph_alloc());
+    if (avfilter_graph == nullptr) {
+        throw Tsrt_Exception(INSUFFICIENT_MEMORY, "Error allocating memory for avfilter_graph", std::chrono::system_clock::now(), __FILE__, __LINE__);
+    }
+    // by default FFmpeg gives every graph a thread per core, the graph is confined to whoever uses it instead,
+    // parallelism comes from running many graphs on the TBB workers. Must be set before any filter is created
+    avfilter_graph->nb_threads = 1;
+
+    const AVFilter *src = avfilter_get_by_name("abuffer");
+    std::ostringstream src_args;
+    // pts count samples, so the output keeps the input's sample indices
+    src_args << "time_base=1/" << SAMPLE_RATE << ":sample_rate=" << SAMPLE_RATE << ":sample_fmt=" << SRC_SAMPLE_FMT << ":channel_layout=" << SRC_CHANNEL_LAYOUT;
+    handle_ffmpeg_errors([&]() -> int { return avfilter_graph_create_filter(&src_ctx, src, "src", src_args.str().c_str(), nullptr, avfilter_graph.get()); }, "Error creating source filter", __FILE__, __LINE__);
+
+    const AVFilter *sink = avfilter_get_by_name("abuffersink");
+    handle_ffmpeg_errors([&]() -> int { return avfilter_graph_create_filter(&sink_ctx, sink, "sink", nullptr, nullptr, avfilter_graph.get()); }, "Error creating sink filter", __FILE__, __LINE__);
+
+    // the config's filters go between the source, the chain's "in", and the sink, its "out"
+    AVFilterInOut* outputs = avfilter_inout_alloc();
+    AVFilterInOut* inputs = avfilter_inout_alloc();
+    char* in_name = av_strdup("in");
+    char* out_name = av_strdup("out");
+    if (outputs == nullptr || inputs == nullptr || in_name == nullptr || out_name == nullptr) {
+        av_free(in_name);
+        av_free(out_name);
+        avfilter_inout_free(&outputs);
+        avfilter_inout_free(&inputs);
+        throw Tsrt_Exception(INSUFFICIENT_MEMORY, "Error allocating memory for the filter chain's ends", std::chrono::system_clock::now(), __FILE__, __LINE__);
+    }
+    *outputs = AVFilterInOut{in_name, src_ctx, 0, nullptr};
+    *inputs = AVFilterInOut{out_name, sink_ctx, 0, nullptr};
+    const int ret = avfilter_graph_parse_ptr(avfilter_graph.get(), config.filters.c_str(), &inputs, &outputs, nullptr);
+    avfilter_inout_free(&outputs);
+    avfilter_inout_free(&inputs);
+    handle_ffmpeg_errors([&]() -> int { return ret; }, "Error parsing filters \"" + config.filters + "\"", __FILE__, __LINE__);
+
+    handle_ffmpeg_errors([&]() -> int { return avfilter_graph_config(avfilter_graph.get(), nullptr); }, "Error configuring filter graph", __FILE__, __LINE__);
+    sink_time_base = av_buffersink_get_time_base(sink_ctx);
+
+    // the sink's frames are taken as SAMPLE_RATE mono float samples
+    if (av_buffersink_get_format(sink_ctx) != AV_SAMPLE_FMT_FLT || av_buffersink_get_sample_rate(sink_ctx) != SAMPLE_RATE || av_buffersink_get_channels(sink_ctx) != 1)
+        throw Tsrt_Exception(CONFIGURATION_ERROR, "Error configuring filter graph, \"" + config.filters + "\" does not keep " + std::to_string(SAMPLE_RATE) + " Hz mono float audio", std::chrono::system_clock::now(), __FILE__, __LINE__);
+
+    // the SNR estimate takes the lowest noise floor of the graph's afftdn filters, hops below it are what they remove
+    bool has_denoiser = false;
+    float floor_db = static_cast<float>(AFFTDN_NF);
+    for (unsigned int i = 0; i < avfilter_graph->nb_filters; ++i) {
+        const AVFilterContext* filter = avfilter_graph->filters[i];
+        if (std::strcmp(filter->filter->name, "afftdn") != 0)
+            continue;
+        double nf = 0.0;
+        if (av_opt_get_double(filter->priv, "nf", 0, &nf) >= 0)
+            floor_db = has_denoiser ? std::min(floor_db, static_cast<float>(nf)) : static_cast<float>(nf);
+        has_denoiser = true;
+    }
+    if (has_denoiser)
+        bypass = std::make_unique<Snr_Bypass>(floor_db, DENOISE_BYPASS_SNR_DB);
+}
+
+void Preprocessor_tsrt::release_input(void* opaque, uint8_t* data) {
+    (void)data;
+    static_cast<std::atomic<bool>*>(opaque)->store(false, std::memory_order_release);
+}
+
+Preprocessor_tsrt::Preprocessor_tsrt(const Preprocessor_Config& config) :
+    input_frame{nullptr, avframe_deleter},
+    output_frame{nullptr, avframe_deleter},
+    avfilter_graph{nullptr, avfilter_graph_deleter},
+    src_ctx{nullptr},
+    sink_ctx{nullptr},
+    sink_time_base{1, SAMPLE_RATE},
+    inputs_held{},
+    inputs_pushed{0},
+    samples_pushed{0},
+    samples_pulled{0},
+    pulled_end{0},
+    max_latency{0},
+    flushed{false},
+    bypass{} {
+
+    // the callback is process wide, set once rather than by every stream's graph while others log through it
+    static std::once_flag log_callback_set;
+    std::call_once(log_callback_set, [] { av_log_set_callback(ffmpeg_log_callback); });
+    init_avfilter_graph(config);
+    init_avframes();
+}
+
+uint64_t Preprocessor_tsrt::push_audio(float* samples, size_t count, uint64_t sample_index) {
+    if (flushed)
+        throw Tsrt_Exception(INVALID_OPERATION, "Error pushing audio into a flushed filter graph", std::chrono::system_clock::now(), __FILE__, __LINE__);
+
+    const uint64_t input = inputs_pushed.load(std::memory_order_relaxed);
+    std::atomic<bool>& held = inputs_held[input % PREPROCESS_MAX_HELD_INPUTS];
+    if (held.load(std::memory_order_acquire))
+        throw Tsrt_Exception(OUT_OF_RANGE_ERROR, "Error pushing audio, the filter graph holds too many inputs", std::chrono::system_clock::now(), __FILE__, __LINE__);
+
+    // the frame only references the caller's samples, flags 0 leaves the buffer writable so the bandpass works in place
+    const size_t bytes = count * sizeof(float);
+    AVFrame* frame = input_frame.get();
+    frame->buf[0] = av_buffer_create(reinterpret_cast<uint8_t*>(samples), bytes, release_input, &held, 0);
+    if (frame->buf[0] == nullptr)
+        throw Tsrt_Exception(INSUFFICIENT_MEMORY, "Error allocating memory for an input buffer", std::chrono::system_clock::now(), __FILE__, __LINE__);
+    held.store(true, std::memory_order_relaxed);
+
+    // the source takes the frame's references and resets it, so every field is set again for each push
+    // avframe.channels and avframe.channel_layout are apparently deprecated
+    // but it doesn't work with the what the documentation says to use instead
+    frame->data[0] = frame->buf[0]->data;
+    frame->extended_data = frame->data;
+    frame->linesize[0] = static_cast<int>(bytes);
+    frame->channels = 1;
+    frame->channel_layout = AV_CH_LAYOUT_MONO;
+    frame->format = AV_SAMPLE_FMT_FLT;
+    frame->sample_rate = SAMPLE_RATE;
+    frame->nb_samples = static_cast<int>(count);
+    frame->pts = static_cast<int64_t>(sample_index);
+
+    // measured before the graph filters the samples in place, a switch applies from this frame on
+    if (bypass != nullptr) {
+        const bool was_bypassed = bypass->is_bypassed();
+        bypass->process(samples, count);
+        if (bypass->is_bypassed() != was_bypassed) {
+            const char* enable = bypass->is_bypassed() ? "0" : "1";
+            const int sent = avfilter_graph_send_command(avfilter_graph.get(), "afftdn", "enable", enable, nullptr, 0, 0);
+            if (sent < 0)
+                av_frame_unref(frame);
+            handle_ffmpeg_errors([&]() -> int { return sent; }, "Error switching afftdn", __FILE__, __LINE__);
+        }
+    }
+
+    // on failure the frame still holds its reference, unref it so the input is released
+    const int ret = av_buffersrc_add_frame_flags(src_ctx, frame, AV_BUFFERSRC_FLAG_PUSH);
+    if (ret < 0)
+        av_frame_unref(frame);
+    handle_ffmpeg_errors([&]() -> int { return ret; }, "Error adding frame to filter", __FILE__, __LINE__);
+
+    inputs_pushed.store(input + 1, std::memory_order_release);
+    samples_pushed += count;
+    return input;
+}
+
+bool Preprocessor_tsrt::pull_audio(Filtered_Audio& filtered) {
+    av_frame_unref(output_frame.get());
+    const int ret = av_buffersink_get_frame(sink_ctx, output_frame.get());
+    if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+        // drained, everything still pending is held back by the graph
+        if (ret == AVERROR(EAGAIN) && samples_pushed - samples_pulled > max_latency)
+            max_latency = samples_pushed - samples_pulled;
+        return false;
+    }
+    handle_ffmpeg_errors([&]() -> int { return ret; }, "Error getting frame from filter", __FILE__, __LINE__);
+
+    const AVFrame* frame = output_frame.get();
+    const AVRational samples_time_base{1, SAMPLE_RATE};
+    filtered.samples = reinterpret_cast<const float*>(frame->data[0]);
+    filtered.count = static_cast<size_t>(frame->nb_samples);
+    // a filter that drops the pts leaves the output contiguous with what was pulled before
+    filtered.sample_index = frame->pts == AV_NOPTS_VALUE ? pulled_end
+                                                         : static_cast<uint64_t>(av_rescale_q(frame->pts, sink_time_base, samples_time_base));
+    pulled_end = filtered.sample_index + filtered.count;
+    samples_pulled += filtered.count;
+    return true;
+}
+
+void Preprocessor_tsrt::flush() {
+    av_frame_unref(output_frame.get());
+    if (flushed)
+        return;
+    handle_ffmpeg_errors([&]() -> int { return av_buffersrc_add_frame_flags(src_ctx, nullptr, AV_BUFFERSRC_FLAG_PUSH); }, "Error flushing filter", __FILE__, __LINE__);
+    flushed = true;
+}
+
+bool Preprocessor_tsrt::input_released(uint64_t input) const noexcept {
+    // an input whose flag was reused had been released, or it could not have been, and one never pushed is not held
+    const uint64_t pushed = inputs_pushed.load(std::memory_order_acquire);
+    if (input >= pushed || input + PREPROCESS_MAX_HELD_INPUTS < pushed)
+        return true;
+    return !inputs_held[input % PREPROCESS_MAX_HELD_INPUTS].load(std::memory_order_acquire);
+}
+
+uint64_t Preprocessor_tsrt::get_pending_samples() const noexcept {
+    return samples_pushed - samples_pulled;
+}
+
+uint64_t Preprocessor_tsrt::get_latency() const noexcept {
+    return max_latency;
+}
+
+Denoise_Stats Preprocessor_tsrt::get_denoise_stats() const noexcept {
+    return bypass != nullptr ? bypass->get_stats() : Denoise_Stats{0, 0};
+}
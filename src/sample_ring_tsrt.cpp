@@ -0,0 +1,144 @@
+#include "sample_ring_tsrt.h"
+#include "aligned_samples_tsrt.h"
+#include "constants_config_tsrt.h"
+#include "exceptions_tsrt.h"
+#include "logger_tsrt.h"
+#include "status_codes_tsrt.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+bool Sample_Ring::map_double(size_t bytes) noexcept {
+#if defined(__unix__) || defined(__APPLE__)
+#if defined(__linux__)
+    int fd = memfd_create("tsrt_sample_ring", MFD_CLOEXEC);
+#else
+    // anonymous shared memory, unlinked straight away so only the mappings keep it alive
+    std::string name = "/tsrt_sample_ring_" + std::to_string(getpid()) + "_" + std::to_string(reinterpret_cast<uintptr_t>(this));
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd != -1)
+        shm_unlink(name.c_str());
+#endif
+    if (fd == -1)
+        return false;
+
+    if (ftruncate(fd, static_cast<off_t>(bytes)) == -1) {
+        close(fd);
+        return false;
+    }
+
+    // reserve twice the size so both mappings land back to back
+    void* base = mmap(nullptr, 2 * bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+
+    char* first = static_cast<char*>(base);
+    char* second = first + bytes;
+    if (mmap(first, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+        mmap(second, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, 2 * bytes);
+        close(fd);
+        return false;
+    }
+
+    // the mappings keep the memory alive
+    close(fd);
+    samples = reinterpret_cast<float*>(first);
+    return true;
+#else
+    (void)bytes;
+    return false;
+#endif
+}
+
+void Sample_Ring::mirror(size_t offset, size_t count) noexcept {
+    // the region written may run past the end of the first half, copy each part to the other half
+    const size_t first_part = std::min(count, capacity - offset);
+    std::memcpy(samples + capacity + offset, samples + offset, first_part * sizeof(float));
+    std::memcpy(samples, samples + capacity, (count - first_part) * sizeof(float));
+}
+
+Sample_Ring::Sample_Ring(size_t min_capacity) :
+    samples{nullptr},
+    capacity{0},
+    mirrored{false},
+    write_index{0} {
+
+    if (min_capacity == 0)
+        throw Tsrt_Exception(INVALID_ARGUMENT, "Sample ring capacity must be greater than 0", std::chrono::system_clock::now(), __FILE__, __LINE__);
+
+    size_t page_size = 4096;
+#if defined(__unix__) || defined(__APPLE__)
+    page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+    const size_t bytes = (min_capacity * sizeof(float) + page_size - 1) / page_size * page_size;
+    capacity = bytes / sizeof(float);
+
+    if (map_double(bytes))
+        return;
+
+    log_info("Double mapped sample ring unavailable, falling back to a mirrored buffer", std::chrono::system_clock::now(), __FILE__, __LINE__);
+    samples = allocate_aligned_samples(2 * capacity, std::nothrow);
+    if (samples == nullptr)
+        throw Tsrt_Exception(INSUFFICIENT_MEMORY, "Error allocating memory for sample ring", std::chrono::system_clock::now(), __FILE__, __LINE__);
+    mirrored = true;
+}
+
+Sample_Ring::~Sample_Ring() {
+    if (mirrored) {
+        free_aligned_samples(samples);
+        return;
+    }
+#if defined(__unix__) || defined(__APPLE__)
+    if (samples != nullptr)
+        munmap(samples, 2 * capacity * sizeof(float));
+#endif
+}
+
+float* Sample_Ring::write_region(size_t count) noexcept {
+    (void)count;
+    return samples + write_index.load(std::memory_order_relaxed) % capacity;
+}
+
+void Sample_Ring::commit_write(size_t count) noexcept {
+    const uint64_t index = write_index.load(std::memory_order_relaxed);
+    if (mirrored)
+        mirror(index % capacity, count);
+    write_index.store(index + count, std::memory_order_release);
+}
+
+void Sample_Ring::write(const float* source, size_t count) noexcept {
+    std::memcpy(write_region(count), source, count * sizeof(float));
+    commit_write(count);
+}
+
+void Sample_Ring::skip(uint64_t count) noexcept {
+    write_index.store(write_index.load(std::memory_order_relaxed) + count, std::memory_order_release);
+}
+
+Sample_View Sample_Ring::view(uint64_t start, size_t length) const noexcept {
+    return Sample_View{samples + start % capacity, length};
+}
+
+uint64_t Sample_Ring::get_write_index() const noexcept {
+    return write_index.load(std::memory_order_acquire);
+}
+
+size_t Sample_Ring::get_capacity() const noexcept {
+    return capacity;
+}
+
+bool Sample_Ring::is_double_mapped() const noexcept {
+    return !mirrored;
+}
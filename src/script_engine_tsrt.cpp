@@ -1,13 +1,22 @@
-#include "audio_tsrt.h"
 #include "constants_config_tsrt.h"
 #include "exceptions_tsrt.h"
 #include "logger_tsrt.h"
 #include "script_engine_tsrt.h"
+#include "segment_pool_tsrt.h"
+#include "session_tsrt.h"
+#include "status_codes_tsrt.h"
+#include "wake_semaphore_tsrt.h"
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 #include <tbb/scalable_allocator.h>
 
@@ -17,9 +26,36 @@ Script_Engine::Script_Engine() :
     speaker_identification(false),
     emotion_recognition(false),
     running(false),
-    recording(false),
     speakers(std::vector<Speaker_ID, tbb::scalable_allocator<Speaker_ID>>()),
-    audio_buffer(Ring_Buffer<Audio_Segment, true, AUDIO_BUFFER_SIZE>()) {}
+    arena(),
+    tasks(),
+    running_sessions(0),
+    tasks_in_flight(0),
+    idle_mutex(),
+    idle(),
+    sessions_mutex(),
+    preprocessor_config(),
+    sessions(),
+    wakes_deferred(false),
+    waker(),
+    waker_running(true),
+    waker_thread() {
+    // sessions hand their segments back to the pool when the engine is destroyed at exit,
+    // constructing the pool first makes it outlive it
+    Segment_Pool::half_segments();
+    arena.initialize();
+    waker_thread = std::thread(&Script_Engine::waker_loop, this);
+}
+
+Script_Engine::~Script_Engine() {
+    waker_running.store(false);
+    waker.post();
+    waker_thread.join();
+
+    // the sessions' tasks point into them, none may be left when they are destroyed
+    std::lock_guard<std::mutex> lock(sessions_mutex);
+    close_sessions();
+}
 
 void Script_Engine::start_engine() noexcept {
     running = true;
@@ -27,18 +63,153 @@ void Script_Engine::start_engine() noexcept {
 
 void Script_Engine::stop_engine() noexcept {
     running = false;
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex);
+        for (const std::unique_ptr<Session_tsrt>& session : sessions)
+            session->stop();
+    }
+    notify_if_idle();
+}
+
+void Script_Engine::wait_for_tasks() {
+    // unlike a check of tasks_in_flight, also waits out the end of the last task, which still touches the engine
+    arena.execute([this] { tasks.wait(); });
+}
+
+void Script_Engine::close_sessions() {
+    // stopping a session schedules it once more to stop its source, those tasks finish before anything is closed
+    for (const std::unique_ptr<Session_tsrt>& session : sessions)
+        session->stop();
+    wait_for_tasks();
+    for (const std::unique_ptr<Session_tsrt>& session : sessions)
+        session->close();
+    // a recording thread's or a callback's last commit may have woken its session after all, the task finds it stopped
+    schedule_deferred_wakes();
+    wait_for_tasks();
+}
+
+void Script_Engine::session_started() noexcept {
+    running_sessions.fetch_add(1);
+}
+
+void Script_Engine::session_stopped() noexcept {
+    if (running_sessions.fetch_sub(1) == 1)
+        notify_if_idle();
+}
+
+void Script_Engine::defer_wake() noexcept {
+    wakes_deferred.store(true);
+    waker.post();
+}
+
+void Script_Engine::wake_waker() noexcept {
+    waker.post();
+}
+
+void Script_Engine::schedule_deferred_wakes() noexcept {
+    for (const std::unique_ptr<Session_tsrt>& session : sessions)
+        session->schedule_deferred_wake();
+}
+
+void Script_Engine::waker_loop() noexcept {
+    while (true) {
+        waker.wait();
+        // one pass schedules every wake left so far, the posts that came with them have nothing more to do
+        while (waker.try_wait()) {}
+        if (!waker_running.load())
+            return;
+        bool backlogged = false;
+        {
+            // whoever holds the mutex never waits for the waker, close_sessions() schedules deferred wakes itself
+            std::lock_guard<std::mutex> lock(sessions_mutex);
+            // cleared first, a task that still can not be allocated defers its wake again
+            wakes_deferred.store(false);
+            schedule_deferred_wakes();
+            backlogged = wakes_deferred.load();
+        }
+        // its defer_wake() posted, give the allocator a moment rather than retrying straight away
+        if (backlogged)
+            std::this_thread::sleep_for(std::chrono::microseconds(WAIT_SLEEP_US));
+    }
 }
 
-void Script_Engine::start_recording() noexcept {
-    recording = true;
+bool Script_Engine::is_idle() const noexcept {
+    // sequentially consistent, so whichever of the last task and the last session finishes second sees the other done
+    return tasks_in_flight.load() == 0 && (running_sessions.load() == 0 || !running.load());
 }
 
-void Script_Engine::stop_recording() noexcept {
-    recording = false;
+void Script_Engine::notify_if_idle() noexcept {
+    if (!is_idle())
+        return;
+    // taken so the notification can not fall between run_sessions() checking and waiting
+    std::lock_guard<std::mutex> lock(idle_mutex);
+    idle.notify_all();
 }
 
-void Script_Engine::push_to_audio_buffer(Audio_Segment&& segment) noexcept {
-    audio_buffer.push(std::move(segment));
+Session_tsrt& Script_Engine::open_session(std::unique_ptr<Audio_Source> audio_source, const std::string& script_path) {
+    std::lock_guard<std::mutex> lock(sessions_mutex);
+    // the session's capture ring buffer takes its segments from the chunk reserved for it here
+    if (!Segment_Pool::reserve_sessions(sessions.size() + 1))
+        log_info("Segment pool is at SEGMENT_POOL_MAX_SESSIONS, session " + std::to_string(sessions.size()) + " may allocate on the heap",
+                 std::chrono::system_clock::now(), __FILE__, __LINE__);
+    sessions.push_back(std::make_unique<Session_tsrt>(sessions.size(), *this, preprocessor_config, std::move(audio_source), script_path));
+    return *sessions.back();
+}
+
+Session_tsrt& Script_Engine::get_session(size_t id) {
+    std::lock_guard<std::mutex> lock(sessions_mutex);
+    if (id >= sessions.size())
+        throw Tsrt_Exception(OUT_OF_RANGE_ERROR, "No session " + std::to_string(id), std::chrono::system_clock::now(), __FILE__, __LINE__);
+    return *sessions[id];
+}
+
+size_t Script_Engine::get_session_count() const noexcept {
+    std::lock_guard<std::mutex> lock(sessions_mutex);
+    return sessions.size();
+}
+
+void Script_Engine::run_sessions() {
+    {
+        std::unique_lock<std::mutex> lock(idle_mutex);
+        idle.wait(lock, [this] { return is_idle(); });
+    }
+
+    std::lock_guard<std::mutex> lock(sessions_mutex);
+    close_sessions();
+}
+
+tbb::task_arena& Script_Engine::get_arena() noexcept {
+    return arena;
+}
+
+void Script_Engine::set_preprocessor_config(const Preprocessor_Config& config) {
+    std::lock_guard<std::mutex> lock(sessions_mutex);
+    preprocessor_config = config;
+}
+
+void Script_Engine::swap_preprocessing(const Preprocessor_Config& config) {
+    // sessions are never removed, so the pointers stay valid after the lock is released
+    std::vector<Session_tsrt*> open;
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex);
+        for (const std::unique_ptr<Session_tsrt>& session : sessions)
+            open.push_back(session.get());
+    }
+
+    // building graphs takes a while, the sessions keep running on their old chains meanwhile
+    std::vector<std::unique_ptr<Preprocessing_Chain>> chains;
+    chains.reserve(open.size());
+    for (size_t i = 0; i < open.size(); ++i)
+        chains.push_back(make_preprocessing_chain(config));
+
+    set_preprocessor_config(config);
+    for (size_t i = 0; i < open.size(); ++i)
+        open[i]->swap_preprocessing(std::move(chains[i]));
+}
+
+Preprocessor_Config Script_Engine::get_preprocessor_config() const {
+    std::lock_guard<std::mutex> lock(sessions_mutex);
+    return preprocessor_config;
 }
 
 tsrt_status_code Script_Engine::add_speaker(std::string name, float* embedding) {
@@ -113,10 +284,6 @@ bool Script_Engine::is_running() const noexcept {
     return running;
 }
 
-bool Script_Engine::is_recording() const noexcept {
-    return recording;
-}
-
 const std::vector<Speaker_ID, tbb::scalable_allocator<Speaker_ID>>& Script_Engine::get_speakers() const noexcept {
     return speakers;
 }
@@ -0,0 +1,186 @@
+#include "segment_pool_tsrt.h"
+#include "constants_config_tsrt.h"
+#include "exceptions_tsrt.h"
+#include "status_codes_tsrt.h"
+
+#include <chrono>
+#include <mutex>
+#include <new>
+#include <utility>
+
+namespace {
+
+// The free stack head packs a tag in the high 32 bits and a slab index in the low 32 bits
+constexpr uint64_t INDEX_MASK = 0xFFFFFFFFull;
+
+uint64_t pack(uint64_t tag, uint32_t index) noexcept {
+    return (tag << 32) | index;
+}
+
+} // namespace
+
+Free_List::Free_List(size_t chunk_capacity, size_t max_chunks) :
+    next_free{nullptr},
+    head{pack(0, EMPTY)},
+    in_use{0},
+    high_water{0},
+    exhausted{0},
+    chunk_count{0},
+    chunk_capacity{0},
+    max_chunks{0} {
+
+    if (chunk_capacity == 0 || max_chunks == 0)
+        throw Tsrt_Exception(INVALID_ARGUMENT, "Free list chunk capacity and chunk count must be greater than 0", std::chrono::system_clock::now(), __FILE__, __LINE__);
+    // every slot index has to fit in the index bits without reaching the empty stack marker
+    if (chunk_capacity >= EMPTY / max_chunks)
+        throw Tsrt_Exception(OUT_OF_RANGE_ERROR, "Free list capacity too large", std::chrono::system_clock::now(), __FILE__, __LINE__);
+
+    next_free.reset(new (std::nothrow) std::unique_ptr<std::atomic<uint32_t>[]>[max_chunks]);
+    if (next_free == nullptr)
+        throw Tsrt_Exception(INSUFFICIENT_MEMORY, "Error allocating memory for free list", std::chrono::system_clock::now(), __FILE__, __LINE__);
+
+    this->chunk_capacity = static_cast<uint32_t>(chunk_capacity);
+    this->max_chunks = static_cast<uint32_t>(max_chunks);
+}
+
+uint32_t Free_List::pop() noexcept {
+    uint64_t current = head.load(std::memory_order_acquire);
+    uint32_t index;
+    do {
+        index = static_cast<uint32_t>(current & INDEX_MASK);
+        if (index == EMPTY) {
+            exhausted.fetch_add(1, std::memory_order_relaxed);
+            return EMPTY;
+        }
+        // may be stale if another thread takes this slot first, the tag makes the compare and swap fail then
+    } while (!head.compare_exchange_weak(current, pack((current >> 32) + 1, next_free[index / chunk_capacity][index % chunk_capacity].load(std::memory_order_relaxed)),
+                                         std::memory_order_acquire, std::memory_order_acquire));
+
+    const size_t held = in_use.fetch_add(1, std::memory_order_relaxed) + 1;
+    size_t max = high_water.load(std::memory_order_relaxed);
+    while (held > max && !high_water.compare_exchange_weak(max, held, std::memory_order_relaxed)) {}
+    return index;
+}
+
+void Free_List::push(uint32_t index) noexcept {
+    std::atomic<uint32_t>& link = next_free[index / chunk_capacity][index % chunk_capacity];
+    uint64_t current = head.load(std::memory_order_relaxed);
+    do {
+        link.store(static_cast<uint32_t>(current & INDEX_MASK), std::memory_order_relaxed);
+    } while (!head.compare_exchange_weak(current, pack((current >> 32) + 1, index), std::memory_order_release, std::memory_order_relaxed));
+    in_use.fetch_sub(1, std::memory_order_relaxed);
+}
+
+bool Free_List::add_chunk() {
+    const uint32_t chunk = chunk_count.load(std::memory_order_relaxed);
+    if (chunk == max_chunks)
+        return false;
+
+    std::unique_ptr<std::atomic<uint32_t>[]> links(new (std::nothrow) std::atomic<uint32_t>[chunk_capacity]);
+    if (links == nullptr)
+        throw Tsrt_Exception(INSUFFICIENT_MEMORY, "Error allocating memory for free list", std::chrono::system_clock::now(), __FILE__, __LINE__);
+
+    const uint32_t first = chunk * chunk_capacity;
+    for (uint32_t i = 0; i + 1 < chunk_capacity; ++i)
+        links[i].store(first + i + 1, std::memory_order_relaxed);
+    std::atomic<uint32_t>& last = links[chunk_capacity - 1];
+    // nothing can pop the new slots before the chunk is linked in, so the table entry needs no ordering of its own
+    next_free[chunk] = std::move(links);
+    chunk_count.store(chunk + 1, std::memory_order_release);
+
+    // the chunk's slots go on top of the stack, its last slot links to the old top
+    uint64_t current = head.load(std::memory_order_relaxed);
+    do {
+        last.store(static_cast<uint32_t>(current & INDEX_MASK), std::memory_order_relaxed);
+    } while (!head.compare_exchange_weak(current, pack((current >> 32) + 1, first), std::memory_order_release, std::memory_order_relaxed));
+    return true;
+}
+
+Segment_Pool_Stats Free_List::get_stats() const noexcept {
+    return Segment_Pool_Stats{
+        static_cast<size_t>(get_chunk_count()) * chunk_capacity,
+        in_use.load(std::memory_order_relaxed),
+        high_water.load(std::memory_order_relaxed),
+        exhausted.load(std::memory_order_relaxed)
+    };
+}
+
+Segment_Pool::Segment_Pool(size_t buffer_size, size_t chunk_capacity, size_t max_chunks) :
+    slabs{nullptr},
+    free_list{chunk_capacity, max_chunks},
+    grow_mutex(),
+    buffer_size{buffer_size},
+    buffer_stride{padded_samples(buffer_size)} {
+
+    if (buffer_size == 0)
+        throw Tsrt_Exception(INVALID_ARGUMENT, "Segment pool buffer size must be greater than 0", std::chrono::system_clock::now(), __FILE__, __LINE__);
+
+    slabs.reset(new (std::nothrow) std::unique_ptr<float[], Aligned_Samples_Deleter>[max_chunks]);
+    if (slabs == nullptr)
+        throw Tsrt_Exception(INSUFFICIENT_MEMORY, "Error allocating memory for segment pool", std::chrono::system_clock::now(), __FILE__, __LINE__);
+}
+
+bool Segment_Pool::reserve(size_t chunks) {
+    std::lock_guard<std::mutex> lock(grow_mutex);
+    while (free_list.get_chunk_count() < chunks) {
+        const uint32_t chunk = free_list.get_chunk_count();
+        // the slab table has max_chunks entries, check before touching the next one rather than leave it to add_chunk()
+        if (chunk == free_list.get_max_chunks())
+            return false;
+        // the slab is in place before add_chunk() publishes its buffers
+        if (slabs[chunk] == nullptr) {
+            slabs[chunk].reset(allocate_aligned_samples(buffer_stride * free_list.get_chunk_capacity(), std::nothrow));
+            if (slabs[chunk] == nullptr)
+                throw Tsrt_Exception(INSUFFICIENT_MEMORY, "Error allocating memory for segment pool", std::chrono::system_clock::now(), __FILE__, __LINE__);
+        }
+        if (!free_list.add_chunk())
+            return false;
+    }
+    return true;
+}
+
+uint32_t Segment_Pool::acquire() noexcept {
+    return free_list.pop();
+}
+
+float* Segment_Pool::get_buffer(uint32_t index) const noexcept {
+    const uint32_t chunk_capacity = free_list.get_chunk_capacity();
+    return slabs[index / chunk_capacity].get() + static_cast<size_t>(index % chunk_capacity) * buffer_stride;
+}
+
+void Segment_Pool::release(uint32_t index) noexcept {
+    free_list.push(index);
+}
+
+size_t Segment_Pool::get_buffer_size() const noexcept {
+    return buffer_size;
+}
+
+Segment_Pool_Stats Segment_Pool::get_stats() const noexcept {
+    return free_list.get_stats();
+}
+
+Segment_Pool& Segment_Pool::half_segments() {
+    static Segment_Pool instance(SAMPLES_PER_HALF_SEGMENT, HALF_SEGMENT_POOL_CHUNK, SEGMENT_POOL_MAX_SESSIONS);
+    return instance;
+}
+
+Segment_Pool* Segment_Pool::for_size(size_t size) {
+    if (size == SAMPLES_PER_HALF_SEGMENT)
+        return &half_segments();
+    return nullptr;
+}
+
+bool Segment_Pool::reserve_sessions(size_t sessions) {
+    return half_segments().reserve(sessions);
+}
+
+Sample_Buffer allocate_samples(size_t size) {
+    Segment_Pool* pool = Segment_Pool::for_size(size);
+    if (pool != nullptr) {
+        const uint32_t index = pool->acquire();
+        if (index != Free_List::EMPTY)
+            return Sample_Buffer(pool->get_buffer(index), Sample_Deleter{pool, index});
+    }
+    return Sample_Buffer(allocate_aligned_samples(size), Sample_Deleter{nullptr});
+}
@@ -0,0 +1,80 @@
+#include "segment_view_tsrt.h"
+#include "constants_config_tsrt.h"
+#include "exceptions_tsrt.h"
+#include "segment_pool_tsrt.h"
+#include "status_codes_tsrt.h"
+
+#include <algorithm>
+#include <chrono>
+#include <new>
+
+void Segment_View::release() noexcept {
+    // acq_rel so every holder's reads of the samples happen before the writer may overwrite them
+    if (pin != nullptr && pin->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        pin->pins->release(*pin);
+    pin = nullptr;
+}
+
+Segment_View Segment_View::slice(size_t offset, size_t length) const {
+    if (offset > this->length || length > this->length - offset)
+        throw Tsrt_Exception(OUT_OF_RANGE_ERROR, "Segment view slice out of range", std::chrono::system_clock::now(), __FILE__, __LINE__);
+    if (pin == nullptr)
+        return Segment_View();
+
+    pin->refs.fetch_add(1, std::memory_order_relaxed);
+    return Segment_View(pin, this->offset + offset, length);
+}
+
+Window_Pins::Window_Pins(size_t capacity) :
+    pins{nullptr},
+    free_list{capacity, 1},
+    capacity{capacity},
+    release_target{nullptr} {
+
+    pins.reset(new (std::nothrow) Window_Pin[capacity]);
+    if (pins == nullptr)
+        throw Tsrt_Exception(INSUFFICIENT_MEMORY, "Error allocating memory for window pins", std::chrono::system_clock::now(), __FILE__, __LINE__);
+    for (size_t i = 0; i < capacity; ++i) {
+        pins[i].index = static_cast<uint32_t>(i);
+        pins[i].pins = this;
+    }
+    free_list.add_chunk();
+}
+
+void Window_Pins::set_release_target(Wake_Target* target) noexcept {
+    release_target = target;
+}
+
+Segment_View Window_Pins::pin(const Sample_View& samples, uint64_t start_sample) noexcept {
+    const uint32_t index = free_list.pop();
+    if (index == Free_List::EMPTY)
+        return Segment_View();
+
+    Window_Pin& pin = pins[index];
+    pin.samples = samples.data;
+    pin.length = samples.size;
+    pin.start_sample.store(start_sample, std::memory_order_relaxed);
+    // the caller still holds the window, so the writer sees the pin before the window's release lets it move on
+    pin.refs.store(1, std::memory_order_release);
+    return Segment_View(&pin, 0, samples.size);
+}
+
+void Window_Pins::release(Window_Pin& pin) noexcept {
+    free_list.push(pin.index);
+    if (release_target != nullptr)
+        release_target->wake();
+}
+
+uint64_t Window_Pins::oldest_pinned(uint64_t none) const noexcept {
+    uint64_t oldest = none;
+    for (size_t i = 0; i < capacity; ++i) {
+        // a pin released and taken again meanwhile only has a newer start, the writer holds back a little longer at most
+        if (pins[i].refs.load(std::memory_order_acquire) != 0)
+            oldest = std::min(oldest, pins[i].start_sample.load(std::memory_order_relaxed));
+    }
+    return oldest;
+}
+
+Segment_Pool_Stats Window_Pins::get_stats() const noexcept {
+    return free_list.get_stats();
+}
@@ -0,0 +1,696 @@
+#include "session_tsrt.h"
+#include "constants_config_tsrt.h"
+#include "exceptions_tsrt.h"
+#include "logger_tsrt.h"
+#include "script_engine_tsrt.h"
+#include "status_codes_tsrt.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace {
+
+// no window holds samples in the sample ring
+constexpr uint64_t NO_SAMPLE = std::numeric_limits<uint64_t>::max();
+
+} // namespace
+
+Session_tsrt::Session_tsrt(size_t id, Script_Engine& engine, const Preprocessor_Config& preprocessor_config, std::unique_ptr<Audio_Source> audio_source, const std::string& script_path) :
+    id(id),
+    engine(engine),
+    audio_source(std::move(audio_source)),
+    callback_driven(this->audio_source->is_callback_driven()),
+    capture_ring(std::make_unique<Capture_Ring_Buffer>(Audio_Segment(SAMPLES_PER_HALF_SEGMENT))),
+    preprocessor(make_preprocessing_chain(preprocessor_config)),
+    backpressure(false),
+    running(false),
+    recording(false),
+    input_finished(false),
+    sample_clock(),
+    sample_ring(SAMPLE_RING_CAPACITY),
+    window_cursor(WINDOW_LENGTH, WINDOW_HOP),
+    window_sequence(0),
+    audio_buffer(),
+    voice_activity(),
+    mel_features(sample_ring.get_capacity()),
+    window_pins(WINDOW_PIN_CAPACITY),
+    analyses(),
+    input_wake(*this),
+    pin_wake(*this),
+    analysis_wake(*this),
+    input_wakes(0),
+    input_wake_deferred(false),
+    capture_published(false),
+    analysis_wakes(),
+    analysis_wake_deferred(),
+    script(),
+    recording_thread(),
+    started(0),
+    finished(0),
+    streaming(false),
+    err_on_last_iteration(false),
+    fed_segments(0),
+    oldest_fed_input(0),
+    filtered{nullptr, 0, 0},
+    filtered_pending(false),
+    preprocessor_flushed(false),
+    next_preprocessor_mutex(),
+    next_preprocessor(),
+    preprocessor_swap_pending(false),
+    preprocessor_swaps(0),
+    pts_regressions(0),
+    retired_denoising{0, 0},
+    published_windows(0),
+    speech_windows(0),
+    analysed_windows(0),
+    skipped_windows(0),
+    denoised_frames(0),
+    bypassed_frames(0) {
+
+    if (engine.speech_recognition_enabled())
+        analyses.push_back(Analysis_Consumer{SPEECH_RECOGNITION, audio_buffer.register_consumer()});
+    if (engine.speaker_diarization_enabled())
+        analyses.push_back(Analysis_Consumer{SPEAKER_DIARIZATION, audio_buffer.register_consumer()});
+    if (engine.speaker_identification_enabled())
+        analyses.push_back(Analysis_Consumer{SPEAKER_IDENTIFICATION, audio_buffer.register_consumer()});
+    if (engine.emotion_recognition_enabled())
+        analyses.push_back(Analysis_Consumer{EMOTION_RECOGNITION, audio_buffer.register_consumer()});
+    for (std::atomic<uint64_t>& wakes : analysis_wakes)
+        wakes.store(0, std::memory_order_relaxed);
+    for (std::atomic<bool>& deferred : analysis_wake_deferred)
+        deferred.store(false, std::memory_order_relaxed);
+    capture_ring->set_wake_target(&input_wake);
+    audio_buffer.set_wake_target(&analysis_wake);
+    window_pins.set_release_target(&pin_wake);
+
+    if (!script_path.empty()) {
+        script.open(script_path);
+        if (!script)
+            throw Tsrt_Exception(IO_ERROR, "Error opening " + script_path, std::chrono::system_clock::now(), __FILE__, __LINE__);
+        script << "sequence\tstart_s\tend_s\tspeaker\temotion\ttext\n";
+    }
+}
+
+Session_tsrt::~Session_tsrt() {
+    stop();
+    close();
+}
+
+void Session_tsrt::start() {
+    // the source, graph and timeline ran to their end, nothing rewinds them for a second run
+    if (finished.load() != 0)
+        throw Tsrt_Exception(INVALID_OPERATION, "Session " + std::to_string(id) + " has already run, it can not be started again",
+                             std::chrono::system_clock::now(), __FILE__, __LINE__);
+    recording = true;
+    if (running.exchange(true))
+        return;
+    // only the start that starts the session resets the clock
+    started.store(std::chrono::steady_clock::now().time_since_epoch().count());
+    engine.session_started();
+    if (records_on_thread())
+        recording_thread = std::thread(&Session_tsrt::recording_loop, this);
+    wake_input();
+}
+
+void Session_tsrt::stop() noexcept {
+    if (!running.load())
+        return;
+    // written before the session is seen stopped, so get_elapsed() never pairs a stopped session with a stale finish
+    finished.store(std::chrono::steady_clock::now().time_since_epoch().count());
+    if (!running.exchange(false))
+        return;
+    // the input task stops a source it started, scheduled before the engine counts the session stopped so it is waited for
+    wake_input();
+    engine.session_stopped();
+}
+
+void Session_tsrt::close() noexcept {
+    if (recording_thread.joinable())
+        recording_thread.join();
+    // a source with a recording thread was stopped by it, any other by the input task once the session stopped
+    if (!records_on_thread() && streaming) {
+        audio_source->stop();
+        streaming = false;
+    }
+    if (script.is_open())
+        script.flush();
+}
+
+void Session_tsrt::start_recording() noexcept {
+    recording = true;
+    wake_input();
+}
+
+void Session_tsrt::stop_recording() noexcept {
+    recording = false;
+    wake_input();
+}
+
+bool Session_tsrt::records_on_thread() const noexcept {
+    return !callback_driven && (audio_source->is_live() || audio_source->may_block());
+}
+
+bool Session_tsrt::follow_recording() {
+    if (recording.load(std::memory_order_relaxed) == streaming)
+        return false;
+
+    const tsrt_status_code status = streaming ? audio_source->stop() : audio_source->start(*capture_ring, sample_clock);
+    if (status != SUCCESS) {
+        if (err_on_last_iteration)
+            throw Tsrt_Exception(IO_ERROR, "Consecutive errors starting or stopping audio source", std::chrono::system_clock::now(), __FILE__, __LINE__);
+        log_error(IO_ERROR, "Error starting or stopping audio source", std::chrono::system_clock::now(), __FILE__, __LINE__);
+        err_on_last_iteration = true;
+        return true;
+    }
+    streaming = !streaming;
+    err_on_last_iteration = false;
+    return true;
+}
+
+bool Session_tsrt::record() {
+    follow_recording();
+    if (!streaming)
+        return true;
+    return audio_source->produce();
+}
+
+void Session_tsrt::recording_loop() noexcept {
+    try {
+        while (running.load(std::memory_order_acquire)) {
+            if (!record())
+                break;
+            if (!streaming)
+                std::this_thread::sleep_for(std::chrono::milliseconds(THREAD_SLEEP_MS));
+        }
+    } catch (const std::exception& e) {
+        log_error(IO_ERROR, "Session " + std::to_string(id) + ": " + e.what(), std::chrono::system_clock::now(), __FILE__, __LINE__);
+    }
+
+    if (streaming) {
+        audio_source->stop();
+        streaming = false;
+    }
+    input_finished.store(true, std::memory_order_release);
+    // the input task flushes what the graph delayed
+    wake_input();
+}
+
+void Session_tsrt::Input_Wake::wake() noexcept {
+    session.capture_published.store(true, std::memory_order_relaxed);
+    if (!session.callback_driven) {
+        session.wake_input();
+        return;
+    }
+    // on the device's real-time thread, no task is allocated and no worker woken here, the engine's waker thread
+    // schedules the task, or any other wake that comes first, posting it is all the callback does
+    if (session.input_wakes.fetch_add(1, std::memory_order_acq_rel) == 0) {
+        session.input_wake_deferred.store(true, std::memory_order_release);
+        session.engine.wake_waker();
+    }
+}
+
+void Session_tsrt::Pin_Wake::wake() noexcept {
+    session.wake_input();
+}
+
+void Session_tsrt::Analysis_Wake::wake() noexcept {
+    for (size_t i = 0; i < session.analyses.size(); ++i)
+        session.wake_analysis(i);
+}
+
+void Session_tsrt::wake_input() noexcept {
+    // only the wake finding the task parked schedules it, a scheduled task sees the others when it goes to park,
+    // a wake a callback left to the engine is taken over by whoever comes first
+    if (input_wakes.fetch_add(1, std::memory_order_acq_rel) == 0 || input_wake_deferred.exchange(false, std::memory_order_acq_rel))
+        schedule_input();
+}
+
+void Session_tsrt::schedule_deferred_wake() noexcept {
+    if (input_wake_deferred.exchange(false, std::memory_order_acq_rel))
+        schedule_input();
+    for (size_t i = 0; i < analyses.size(); ++i)
+        if (analysis_wake_deferred[i].exchange(false, std::memory_order_acq_rel))
+            schedule_analysis(i);
+}
+
+void Session_tsrt::wake_analysis(size_t index) noexcept {
+    if (analysis_wakes[index].fetch_add(1, std::memory_order_acq_rel) == 0 ||
+        analysis_wake_deferred[index].exchange(false, std::memory_order_acq_rel))
+        schedule_analysis(index);
+}
+
+void Session_tsrt::schedule_input() noexcept {
+    // the wake stays counted in input_wakes, so no other wake schedules the task, the flag hands it to the next one
+    if (!engine.enqueue_task([this] { run_input(true); })) {
+        input_wake_deferred.store(true, std::memory_order_release);
+        engine.defer_wake();
+    }
+}
+
+void Session_tsrt::schedule_analysis(size_t index) noexcept {
+    if (!engine.enqueue_task([this, index] { run_analysis(index, true); })) {
+        analysis_wake_deferred[index].store(true, std::memory_order_release);
+        engine.defer_wake();
+    }
+}
+
+void Session_tsrt::run_input(bool parked) noexcept {
+    bool resumed = parked;
+    while (true) {
+        // a half segment committed while the task was parked or lingering woke it, that took the capture hop's wakeup latency
+        if (resumed && capture_published.load(std::memory_order_relaxed))
+            capture_ring->record_wakeup();
+        capture_published.store(false, std::memory_order_relaxed);
+        const uint64_t seen = input_wakes.load(std::memory_order_acquire);
+
+        bool progress = false;
+        try {
+            progress = poll();
+        } catch (const Tsrt_Exception& e) {
+            log_error(e.get_status_code(), "Session " + std::to_string(id) + ": " + e.what(), std::chrono::system_clock::now(), __FILE__, __LINE__);
+        } catch (const std::exception& e) {
+            log_error(UNKNOWN_ERROR, "Session " + std::to_string(id) + ": " + e.what(), std::chrono::system_clock::now(), __FILE__, __LINE__);
+        }
+
+        // there may be more, queue behind the other sessions' tasks rather than hold the worker, or carry on here if
+        // the task can not be allocated
+        if (progress) {
+            if (engine.enqueue_task([this] { run_input(false); }))
+                return;
+            resumed = false;
+            continue;
+        }
+
+        resumed = capture_ring->linger([this, seen] { return input_wakes.load(std::memory_order_acquire) != seen; });
+        if (resumed)
+            continue;
+        // park, unless something woke the session since this pass started
+        if (input_wakes.fetch_sub(seen, std::memory_order_acq_rel) == seen)
+            return;
+    }
+}
+
+void Session_tsrt::run_analysis(size_t index, bool parked) noexcept {
+    const Analysis_Consumer& analysis = analyses[index];
+    bool resumed = parked;
+    while (true) {
+        const uint64_t seen = analysis_wakes[index].load(std::memory_order_acquire);
+        Slot_Runs<const Audio_Window> windows = audio_buffer.peek_n(analysis.consumer, ANALYSIS_MAX_BATCH);
+        if (windows.size() > 0) {
+            // a window published while the task was parked or lingering woke it
+            if (resumed)
+                audio_buffer.record_wakeup();
+            analyse(analysis.stage, windows);
+            // every analysis reads the same windows, the script is written once, by the first
+            if (index == 0)
+                write_script(windows);
+            audio_buffer.release_n(analysis.consumer, windows.size());
+            // the input task may be waiting on this analysis, held back by backpressure or to stop once it has drained
+            wake_input();
+
+            // a full batch, there may be more, queue behind the other tasks rather than hold the worker, or carry on
+            // here if the task can not be allocated
+            if (windows.size() == ANALYSIS_MAX_BATCH && engine.enqueue_task([this, index] { run_analysis(index, false); }))
+                return;
+            resumed = false;
+            continue;
+        }
+
+        resumed = audio_buffer.linger([this, index, seen] { return analysis_wakes[index].load(std::memory_order_acquire) != seen; });
+        if (resumed)
+            continue;
+        if (analysis_wakes[index].fetch_sub(seen, std::memory_order_acq_rel) == seen)
+            return;
+    }
+}
+
+void Session_tsrt::release_preprocessed() {
+    while (fed_segments > 0 && preprocessor->input_released(oldest_fed_input)) {
+        capture_ring->release();
+        --fed_segments;
+        ++oldest_fed_input;
+    }
+}
+
+void Session_tsrt::count_denoising() noexcept {
+    const Denoise_Stats stats = preprocessor->get_denoise_stats();
+    denoised_frames.store(retired_denoising.frames + stats.frames, std::memory_order_relaxed);
+    bypassed_frames.store(retired_denoising.bypassed + stats.bypassed, std::memory_order_relaxed);
+}
+
+bool Session_tsrt::push_filtered() {
+    // a frame whose timestamp goes back, e.g. from a filter that rewrites them, only adds the samples after the ones
+    // already written, push_audio_samples() would reject it whole
+    const uint64_t write_index = sample_ring.get_write_index();
+    if (filtered.sample_index < write_index) {
+        const uint64_t regressions = pts_regressions.fetch_add(1, std::memory_order_relaxed) + 1;
+        if (regressions == 1)
+            log_info("Session " + std::to_string(id) + " preprocessing output went back from sample " + std::to_string(write_index) + " to " +
+                     std::to_string(filtered.sample_index) + ", trimming the overlap, later regressions are only counted",
+                     std::chrono::system_clock::now(), __FILE__, __LINE__);
+        const size_t overlap = static_cast<size_t>(std::min<uint64_t>(write_index - filtered.sample_index, filtered.count));
+        filtered.samples += overlap;
+        filtered.count -= overlap;
+        filtered.sample_index += overlap;
+    }
+
+    // a frame need not fit in the sample ring, it goes in half segment pieces, so one held back by backpressure is
+    // retried from the piece that did not go in
+    while (filtered.count > 0) {
+        const size_t piece = std::min(filtered.count, static_cast<size_t>(SAMPLES_PER_HALF_SEGMENT));
+        if (push_audio_samples(filtered.samples, piece, filtered.sample_index) == TRY_AGAIN && backpressure)
+            return false;
+        filtered.samples += piece;
+        filtered.count -= piece;
+        filtered.sample_index += piece;
+    }
+    return true;
+}
+
+bool Session_tsrt::preprocess() {
+    bool progress = false;
+    size_t pushed = 0;
+    while (true) {
+        // the samples are windowed, if the slowest analysis stage is too far behind they are dropped
+        // with backpressure they stay pending and are retried once an analysis releases windows and wakes the input task,
+        // the graph is not pulled again until then
+        if (filtered_pending) {
+            if (!push_filtered())
+                break;
+            filtered_pending = false;
+            progress = true;
+        }
+
+        // drain the sink before pushing more, frames need not line up with the half segments pushed
+        if (preprocessor->pull_audio(filtered)) {
+            filtered_pending = true;
+            continue;
+        }
+
+        release_preprocessed();
+        if (pushed == SESSION_POLL_SEGMENTS)
+            break;
+
+        // a new chain takes over at a half segment boundary, once the current one has given back everything it
+        // delayed and every half segment pushed into it, so the timeline carries on where it left off
+        if (preprocessor_swap_pending.load(std::memory_order_acquire)) {
+            if (!preprocessor_flushed) {
+                preprocessor->flush();
+                preprocessor_flushed = true;
+                count_denoising();
+                progress = true;
+                continue;
+            }
+            if (fed_segments > 0)
+                break;
+            const Denoise_Stats stats = preprocessor->get_denoise_stats();
+            retired_denoising.frames += stats.frames;
+            retired_denoising.bypassed += stats.bypassed;
+            {
+                // the old chain is left in its place, freed by whoever hands over the next one or with the session,
+                // not by the input task
+                std::lock_guard<std::mutex> lock(next_preprocessor_mutex);
+                preprocessor.swap(next_preprocessor);
+                preprocessor_swap_pending.store(false, std::memory_order_relaxed);
+            }
+            oldest_fed_input = 0;
+            preprocessor_flushed = false;
+            preprocessor_swaps.fetch_add(1, std::memory_order_relaxed);
+            progress = true;
+            continue;
+        }
+
+        // the half segments already pushed are still at the head, the next one is after them
+        Slot_Runs<Audio_Segment> half_segments = capture_ring->peek_n(fed_segments + 1);
+        if (half_segments.size() > fed_segments) {
+            Audio_Segment& half_segment = half_segments[fed_segments];
+            const uint64_t input = preprocessor->push_audio(half_segment.get_audio(), SAMPLES_PER_HALF_SEGMENT, half_segment.get_sample_index());
+            if (fed_segments++ == 0)
+                oldest_fed_input = input;
+            count_denoising();
+            ++pushed;
+            progress = true;
+            continue;
+        }
+
+        // everything the source captured went in, flush out what the graph delayed
+        if (input_finished.load(std::memory_order_acquire) && !preprocessor_flushed) {
+            preprocessor->flush();
+            preprocessor_flushed = true;
+            count_denoising();
+            progress = true;
+            continue;
+        }
+        break;
+    }
+    return progress;
+}
+
+void Session_tsrt::analyse(analysis_stage stage, const Slot_Runs<const Audio_Window>& windows) {
+    uint64_t analysed = 0;
+    for (size_t i = 0; i < windows.size(); ++i) {
+        const Audio_Window& window = windows[i];
+        // every analysis reads its features from window.features, computed once when the window was published
+        // most of a call is silence, only diarization needs it, to tell where one speaker's turn ends
+        if (!window.speech && stage != SPEAKER_DIARIZATION)
+            continue;
+        ++analysed;
+
+        switch (stage) {
+        case SPEECH_RECOGNITION:
+            // segments of speech are passed on for deduplication of overlapping windows before being concatenated and
+            // aligned in the script
+            break;
+        case SPEAKER_DIARIZATION:
+            // segments of speech are divided into buckets of speakers, speaker identification and emotion recognition
+            // are then run on the buckets rather than the windows, a bucket holds its windows with window.share()
+            break;
+        case SPEAKER_IDENTIFICATION:
+            // the windows' embeddings are matched against the engine's speakers, shared by every session
+            break;
+        case EMOTION_RECOGNITION:
+            break;
+        }
+    }
+    analysed_windows.fetch_add(analysed, std::memory_order_relaxed);
+    skipped_windows.fetch_add(windows.size() - analysed, std::memory_order_relaxed);
+}
+
+void Session_tsrt::write_script(const Slot_Runs<const Audio_Window>& windows) {
+    if (!script.is_open())
+        return;
+    for (size_t i = 0; i < windows.size(); ++i) {
+        const Audio_Window& window = windows[i];
+        script << window.sequence << '\t'
+               << static_cast<double>(window.start_sample) / SAMPLE_RATE << '\t'
+               << static_cast<double>(window.start_sample + WINDOW_LENGTH) / SAMPLE_RATE << "\t\t\t\n";
+    }
+}
+
+bool Session_tsrt::poll() {
+    // a source started here is stopped here, a callback driven one stops waking the session
+    if (!running.load(std::memory_order_acquire)) {
+        if (!records_on_thread() && streaming) {
+            audio_source->stop();
+            streaming = false;
+        }
+        return false;
+    }
+
+    try {
+        bool progress = false;
+
+        if (!records_on_thread() && !input_finished.load(std::memory_order_relaxed)) {
+            if (callback_driven) {
+                // the callback produces, the session only starts and stops it
+                progress |= follow_recording();
+            } else {
+                // a source run here only produces into free slots and never blocks on its input, so it never waits
+                for (size_t i = 0; i < SESSION_POLL_SEGMENTS && capture_ring->free_slots() > 0; ++i) {
+                    if (!record()) {
+                        input_finished.store(true, std::memory_order_release);
+                        break;
+                    }
+                    // a paused source did no work
+                    if (!streaming)
+                        break;
+                    progress = true;
+                }
+            }
+        }
+
+        progress |= preprocess();
+
+        // the input was read to the end, went through the filter graph and everything published from it has been analysed
+        if (preprocessor_flushed && !filtered_pending && capture_ring->empty() && audio_drained())
+            stop();
+        return progress;
+    } catch (...) {
+        stop();
+        throw;
+    }
+}
+
+tsrt_status_code Session_tsrt::push_audio_samples(const float* samples, size_t count, uint64_t sample_index) noexcept {
+    const uint64_t write_index = sample_ring.get_write_index();
+    if (count > sample_ring.get_capacity() || sample_index < write_index)
+        return INVALID_ARGUMENT;
+
+    // a gap in the timeline, no window may span it
+    if (sample_index != write_index) {
+        window_cursor.restart(sample_index);
+        voice_activity.restart(sample_index);
+        mel_features.restart(sample_index);
+    }
+
+    // never overwrite samples an analysis stage is still reading or has shared, drop the chunk, the next one sees the gap
+    // the windows are checked first, a window's pin is taken before the window is released
+    const Audio_Window* oldest_window = audio_buffer.oldest_unreleased();
+    const uint64_t oldest_sample = window_pins.oldest_pinned(oldest_window != nullptr ? oldest_window->start_sample : NO_SAMPLE);
+    if (oldest_sample != NO_SAMPLE && sample_index + count > oldest_sample + sample_ring.get_capacity())
+        return TRY_AGAIN;
+
+    // hold the chunk back rather than drop any of the windows it completes
+    if (backpressure) {
+        Window_Cursor cursor = window_cursor;
+        size_t window_count = 0;
+        for (; cursor.ready(sample_index + count); cursor.advance())
+            ++window_count;
+        if (window_count > audio_buffer.free_slots())
+            return TRY_AGAIN;
+    }
+
+    sample_ring.skip(sample_index - write_index);
+    sample_ring.write(samples, count);
+
+    // publish every window the new samples complete, each a view into the ring
+    // if the slowest analysis stage is a full buffer behind, the window is dropped and its sequence number skipped
+    size_t detected = 0;
+    while (window_cursor.ready(sample_index + count)) {
+        const uint64_t start = window_cursor.advance();
+        const uint64_t sequence = window_sequence++;
+        // classify up to the window's end, so speech after it does not count for it, the same pass computes its frames
+        const size_t window_end = static_cast<size_t>(start + window_cursor.get_length() - sample_index);
+        if (window_end > detected) {
+            voice_activity.process(samples + detected, window_end - detected);
+            mel_features.process(samples + detected, window_end - detected);
+            detected = window_end;
+        }
+        Audio_Window* window = audio_buffer.claim();
+        if (window == nullptr)
+            continue;
+
+        window->samples = sample_ring.view(start, window_cursor.get_length());
+        window->start_sample = start;
+        window->sequence = sequence;
+        window->features = mel_features.view(start);
+        window->speech = voice_activity.speech_since(start);
+        window->pins = &window_pins;
+        audio_buffer.commit();
+        published_windows.fetch_add(1, std::memory_order_relaxed);
+        if (window->speech)
+            speech_windows.fetch_add(1, std::memory_order_relaxed);
+    }
+    voice_activity.process(samples + detected, count - detected);
+    mel_features.process(samples + detected, count - detected);
+    return SUCCESS;
+}
+
+bool Session_tsrt::audio_drained() noexcept {
+    return audio_buffer.oldest_unreleased() == nullptr;
+}
+
+tsrt_status_code Session_tsrt::enable_backpressure() noexcept {
+    if (backpressure || running)
+        return INVALID_OPERATION;
+    backpressure = true;
+    return SUCCESS;
+}
+
+bool Session_tsrt::backpressure_enabled() const noexcept {
+    return backpressure;
+}
+
+size_t Session_tsrt::get_id() const noexcept {
+    return id;
+}
+
+const Audio_Source& Session_tsrt::get_audio_source() const noexcept {
+    return *audio_source;
+}
+
+Sample_Clock& Session_tsrt::get_sample_clock() noexcept {
+    return sample_clock;
+}
+
+Ring_Buffer_Stats Session_tsrt::get_capture_buffer_stats() const noexcept {
+    return capture_ring->get_stats();
+}
+
+Ring_Buffer_Stats Session_tsrt::get_audio_buffer_stats() const noexcept {
+    return audio_buffer.get_stats();
+}
+
+Wakeup_Latency Session_tsrt::get_capture_wakeup_latency() const noexcept {
+    return capture_ring->get_wakeup_latency();
+}
+
+Wakeup_Latency Session_tsrt::get_audio_wakeup_latency() const noexcept {
+    return audio_buffer.get_wakeup_latency();
+}
+
+uint64_t Session_tsrt::get_preprocessing_latency() const noexcept {
+    return preprocessor->get_latency();
+}
+
+void Session_tsrt::swap_preprocessing(std::unique_ptr<Preprocessing_Chain> chain) {
+    if (chain == nullptr)
+        throw Tsrt_Exception(INVALID_ARGUMENT, "Error swapping in a preprocessing chain, no chain given", std::chrono::system_clock::now(), __FILE__, __LINE__);
+    // whatever chain was in the slot, swapped out or never swapped in, is freed here, after the lock is released
+    std::unique_ptr<Preprocessing_Chain> previous;
+    {
+        std::lock_guard<std::mutex> lock(next_preprocessor_mutex);
+        previous = std::move(next_preprocessor);
+        next_preprocessor = std::move(chain);
+        preprocessor_swap_pending.store(true, std::memory_order_release);
+    }
+    wake_input();
+}
+
+uint64_t Session_tsrt::get_preprocessing_swaps() const noexcept {
+    return preprocessor_swaps.load(std::memory_order_relaxed);
+}
+
+uint64_t Session_tsrt::get_pts_regressions() const noexcept {
+    return pts_regressions.load(std::memory_order_relaxed);
+}
+
+Voice_Activity_Stats Session_tsrt::get_voice_activity_stats() const noexcept {
+    return Voice_Activity_Stats{published_windows.load(std::memory_order_relaxed), speech_windows.load(std::memory_order_relaxed),
+                                analysed_windows.load(std::memory_order_relaxed), skipped_windows.load(std::memory_order_relaxed)};
+}
+
+Denoise_Stats Session_tsrt::get_denoise_stats() const noexcept {
+    return Denoise_Stats{denoised_frames.load(std::memory_order_relaxed), bypassed_frames.load(std::memory_order_relaxed)};
+}
+
+std::chrono::duration<double> Session_tsrt::get_elapsed() const noexcept {
+    const std::chrono::steady_clock::time_point start{std::chrono::steady_clock::duration(started.load())};
+    if (running.load())
+        return std::chrono::steady_clock::now() - start;
+    return std::chrono::steady_clock::time_point{std::chrono::steady_clock::duration(finished.load())} - start;
+}
+
+bool Session_tsrt::is_running() const noexcept {
+    return running;
+}
+
+bool Session_tsrt::is_recording() const noexcept {
+    return recording;
+}
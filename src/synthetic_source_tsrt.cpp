@@ -0,0 +1,120 @@
+#include "synthetic_source_tsrt.h"
+#include "constants_config_tsrt.h"
+#include "exceptions_tsrt.h"
+#include "status_codes_tsrt.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <utility>
+
+static constexpr double TWO_PI = 6.283185307179586;
+
+Synthetic_Source::Synthetic_Source(synthetic_waveform waveform, double frequency, std::vector<float> loop, double speed,
+                                   std::chrono::microseconds jitter, std::chrono::seconds duration) :
+    waveform{waveform},
+    frequency{frequency},
+    loop{std::move(loop)},
+    speed{speed},
+    jitter{jitter},
+    max_samples{static_cast<uint64_t>(duration.count()) * SAMPLE_RATE},
+    generated{0},
+    noise_rng{SYNTHETIC_NOISE_SEED},
+    jitter_rng{SYNTHETIC_JITTER_SEED},
+    pace_origin{},
+    paced_reads{0},
+    latency_total_ns{0},
+    latency_max_ns{0} {
+
+    if (waveform == SYNTHETIC_LOOP && this->loop.empty())
+        throw Tsrt_Exception(INVALID_ARGUMENT, "Synthetic loop has no samples", std::chrono::system_clock::now(), __FILE__, __LINE__);
+    if (waveform == SYNTHETIC_TONE && !(frequency > 0.0 && frequency < SAMPLE_RATE / 2.0))
+        throw Tsrt_Exception(INVALID_ARGUMENT, "Synthetic tone frequency must be between 0 and the Nyquist frequency", std::chrono::system_clock::now(), __FILE__, __LINE__);
+    if (speed < 0.0)
+        throw Tsrt_Exception(INVALID_ARGUMENT, "Synthetic source speed must not be negative", std::chrono::system_clock::now(), __FILE__, __LINE__);
+}
+
+tsrt_status_code Synthetic_Source::start(Capture_Ring_Buffer& ring, Sample_Clock& clock) {
+    // pacing picks up from the samples already generated, so a pause is not caught up on afterwards
+    if (speed > 0.0)
+        pace_origin = std::chrono::steady_clock::now() -
+                      std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(generated / (SAMPLE_RATE * speed)));
+    return Pull_Audio_Source::start(ring, clock);
+}
+
+void Synthetic_Source::pace(uint64_t end_sample) {
+    const auto due = pace_origin + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                       std::chrono::duration<double>(end_sample / (SAMPLE_RATE * speed)));
+    std::chrono::steady_clock::duration delay(0);
+    if (jitter.count() > 0)
+        delay = std::chrono::microseconds(std::uniform_int_distribution<int64_t>(0, jitter.count())(jitter_rng));
+    std::this_thread::sleep_until(due + delay);
+
+    const int64_t late_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - due).count();
+    ++paced_reads;
+    latency_total_ns += late_ns;
+    latency_max_ns = std::max(latency_max_ns, late_ns);
+}
+
+size_t Synthetic_Source::read_samples(float* destination, size_t count) {
+    if (max_samples != 0)
+        count = static_cast<size_t>(std::min<uint64_t>(count, max_samples - generated));
+
+    switch (waveform) {
+        case SYNTHETIC_TONE: {
+            // the phase is computed from the sample index, so it does not drift over long runs
+            const double period = SAMPLE_RATE / frequency;
+            for (size_t i = 0; i < count; ++i) {
+                const double position = std::fmod(static_cast<double>(generated + i), period);
+                destination[i] = SYNTHETIC_AMPLITUDE * static_cast<float>(std::sin(TWO_PI * position / period));
+            }
+            break;
+        }
+        case SYNTHETIC_NOISE: {
+            std::uniform_real_distribution<float> noise(-SYNTHETIC_AMPLITUDE, SYNTHETIC_AMPLITUDE);
+            for (size_t i = 0; i < count; ++i)
+                destination[i] = noise(noise_rng);
+            break;
+        }
+        case SYNTHETIC_LOOP: {
+            size_t written = 0;
+            while (written < count) {
+                const size_t position = static_cast<size_t>((generated + written) % loop.size());
+                const size_t run = std::min(count - written, loop.size() - position);
+                std::copy(loop.begin() + position, loop.begin() + position + run, destination + written);
+                written += run;
+            }
+            break;
+        }
+    }
+
+    if (speed > 0.0 && count > 0)
+        pace(generated + count);
+    generated += count;
+    return count;
+}
+
+bool Synthetic_Source::is_live() const noexcept {
+    return speed > 0.0;
+}
+
+const char* Synthetic_Source::get_name() const noexcept {
+    switch (waveform) {
+        case SYNTHETIC_TONE:
+            return "synthetic tone";
+        case SYNTHETIC_NOISE:
+            return "synthetic noise";
+        default:
+            return "synthetic loop";
+    }
+}
+
+Source_Stats Synthetic_Source::get_stats() const noexcept {
+    Source_Stats stats = Pull_Audio_Source::get_stats();
+    if (paced_reads != 0) {
+        stats.mean_input_latency = std::chrono::nanoseconds(latency_total_ns / static_cast<int64_t>(paced_reads));
+        stats.max_input_latency = std::chrono::nanoseconds(latency_max_ns);
+    }
+    return stats;
+}
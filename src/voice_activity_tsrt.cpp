@@ -0,0 +1,112 @@
+#include "voice_activity_tsrt.h"
+#include "aligned_samples_tsrt.h"
+#include "constants_config_tsrt.h"
+#include "dsp_kernels_tsrt.h"
+#include "fft_tsrt.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+namespace {
+
+constexpr double PI = 3.14159265358979323846;
+constexpr size_t VAD_PADDED_BINS = padded_samples(VAD_FRAME_SAMPLES / 2 + 1);
+// the bins of the speech band, the ones flatness is measured over
+constexpr size_t VAD_FIRST_BIN = static_cast<size_t>(VAD_LOW_HZ) * VAD_FRAME_SAMPLES / SAMPLE_RATE;
+constexpr size_t VAD_BAND_BINS = static_cast<size_t>(VAD_HIGH_HZ) * VAD_FRAME_SAMPLES / SAMPLE_RATE - VAD_FIRST_BIN + 1;
+static_assert(VAD_FIRST_BIN > 0 && VAD_FIRST_BIN + VAD_BAND_BINS <= VAD_FRAME_SAMPLES / 2, "The speech band must be inside the spectrum, DC and Nyquist excluded");
+
+} // namespace
+
+Voice_Activity_Detector::Voice_Activity_Detector(const Dsp_Kernels& kernels) :
+    kernels(&kernels),
+    fft(VAD_FRAME_SAMPLES, kernels),
+    power_floor(0.0f),
+    window(allocate_aligned_samples(VAD_FRAME_SAMPLES)),
+    frame(allocate_aligned_samples(VAD_FRAME_SAMPLES)),
+    spectrum(allocate_aligned_samples(2 * VAD_PADDED_BINS)),
+    fill(0),
+    next_index(0),
+    speech_end(0),
+    noise_db(VAD_MIN_ENERGY_DB),
+    hangover(0),
+    frames(0),
+    speech_frames(0) {
+
+    // periodic Hann, its low side lobes keep the gaps between harmonics from filling with leakage
+    double window_energy = 0.0;
+    for (size_t n = 0; n < VAD_FRAME_SAMPLES; ++n) {
+        window[n] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * PI * n / VAD_FRAME_SAMPLES));
+        window_energy += static_cast<double>(window[n]) * window[n];
+    }
+    power_floor = static_cast<float>(std::pow(10.0, VAD_MIN_ENERGY_DB / 10.0) * window_energy);
+}
+
+void Voice_Activity_Detector::classify_frame() noexcept {
+    float energy = 0.0f;
+    size_t crossings = 0;
+    kernels->energy_crossings(frame.get(), VAD_FRAME_SAMPLES, energy, crossings);
+
+    kernels->multiply(frame.get(), frame.get(), window.get(), VAD_FRAME_SAMPLES);
+    fft.forward(spectrum.get(), frame.get());
+    float power = 0.0f;
+    float log_power = 0.0f;
+    kernels->log_power_sum(spectrum.get() + 2 * VAD_FIRST_BIN, VAD_BAND_BINS, power_floor, power, log_power);
+
+    // the geometric mean of the band's power over its arithmetic mean, 1 when every bin has the same power
+    const float flatness = std::exp2(log_power / VAD_BAND_BINS) / (power / VAD_BAND_BINS);
+    const float crossing_rate = static_cast<float>(crossings) / (VAD_FRAME_SAMPLES - 1);
+    const float energy_db = 10.0f * std::log10(energy / VAD_FRAME_SAMPLES + 1e-12f);
+
+    const bool loud = energy_db > VAD_MIN_ENERGY_DB && energy_db > noise_db + VAD_ENERGY_MARGIN_DB;
+    const bool voiced = flatness < VAD_FLATNESS_MAX || crossing_rate < VAD_CROSSING_RATE_MAX;
+    noise_db = std::max(std::min(energy_db, noise_db + VAD_NOISE_RISE_DB), VAD_MIN_ENERGY_DB);
+
+    bool speech = loud && voiced;
+    if (speech) {
+        hangover = VAD_HANGOVER_FRAMES;
+    } else if (hangover > 0) {
+        --hangover;
+        speech = true;
+    }
+
+    ++frames;
+    if (speech) {
+        ++speech_frames;
+        speech_end = next_index;
+    }
+}
+
+void Voice_Activity_Detector::restart(uint64_t sample_index) noexcept {
+    fill = 0;
+    next_index = sample_index;
+}
+
+void Voice_Activity_Detector::process(const float* samples, size_t count) noexcept {
+    while (count > 0) {
+        const size_t taken = std::min(VAD_FRAME_SAMPLES - fill, count);
+        std::memcpy(frame.get() + fill, samples, taken * sizeof(float));
+        fill += taken;
+        samples += taken;
+        count -= taken;
+        next_index += taken;
+        if (fill == VAD_FRAME_SAMPLES) {
+            classify_frame();
+            fill = 0;
+        }
+    }
+}
+
+bool Voice_Activity_Detector::speech_since(uint64_t sample_index) const noexcept {
+    return speech_end > sample_index;
+}
+
+uint64_t Voice_Activity_Detector::get_frames() const noexcept {
+    return frames;
+}
+
+uint64_t Voice_Activity_Detector::get_speech_frames() const noexcept {
+    return speech_frames;
+}
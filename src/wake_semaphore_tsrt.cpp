@@ -0,0 +1,79 @@
+#include "wake_semaphore_tsrt.h"
+#include "exceptions_tsrt.h"
+#include "status_codes_tsrt.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#elif defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
+#include <climits>
+#include <windows.h>
+#endif
+
+Wake_Semaphore::Wake_Semaphore() : semaphore{} {
+#if defined(__APPLE__)
+    // named, unlinked straight away so only the handle keeps it alive
+    std::string name = "/tsrt_wake_" + std::to_string(getpid()) + "_" + std::to_string(reinterpret_cast<uintptr_t>(this));
+    semaphore = sem_open(name.c_str(), O_CREAT | O_EXCL, 0600, 0);
+    if (semaphore == SEM_FAILED)
+        throw Tsrt_Exception(RUNTIME_ERROR, "Error creating wake semaphore", std::chrono::system_clock::now(), __FILE__, __LINE__);
+    sem_unlink(name.c_str());
+#elif defined(__unix__)
+    if (sem_init(&semaphore, 0, 0) == -1)
+        throw Tsrt_Exception(RUNTIME_ERROR, "Error creating wake semaphore", std::chrono::system_clock::now(), __FILE__, __LINE__);
+#elif defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
+    semaphore = CreateSemaphoreA(NULL, 0, LONG_MAX, NULL);
+    if (semaphore == NULL)
+        throw Tsrt_Exception(RUNTIME_ERROR, "Error creating wake semaphore", std::chrono::system_clock::now(), __FILE__, __LINE__);
+#else
+    throw Tsrt_Exception(RUNTIME_ERROR, "No wake semaphore on this platform", std::chrono::system_clock::now(), __FILE__, __LINE__);
+#endif
+}
+
+Wake_Semaphore::~Wake_Semaphore() {
+#if defined(__APPLE__)
+    sem_close(semaphore);
+#elif defined(__unix__)
+    sem_destroy(&semaphore);
+#elif defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
+    CloseHandle(semaphore);
+#endif
+}
+
+void Wake_Semaphore::post() noexcept {
+#if defined(__APPLE__)
+    sem_post(semaphore);
+#elif defined(__unix__)
+    sem_post(&semaphore);
+#elif defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
+    ReleaseSemaphore(semaphore, 1, NULL);
+#endif
+}
+
+void Wake_Semaphore::wait() noexcept {
+#if defined(__APPLE__)
+    // a signal handled on this thread interrupts the wait, nothing was taken then
+    while (sem_wait(semaphore) == -1 && errno == EINTR) {}
+#elif defined(__unix__)
+    while (sem_wait(&semaphore) == -1 && errno == EINTR) {}
+#elif defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
+    WaitForSingleObject(semaphore, INFINITE);
+#endif
+}
+
+bool Wake_Semaphore::try_wait() noexcept {
+#if defined(__APPLE__)
+    return sem_trywait(semaphore) == 0;
+#elif defined(__unix__)
+    return sem_trywait(&semaphore) == 0;
+#elif defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
+    return WaitForSingleObject(semaphore, 0) == WAIT_OBJECT_0;
+#else
+    return false;
+#endif
+}